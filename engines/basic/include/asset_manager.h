@@ -12,6 +12,8 @@
 #include "animation_object_controller.h"
 #include "texture_asset.h"
 #include "audio_asset.h"
+#include "asset_streamer.h"
+#include "name_index.h"
 
 #include <vector>
 
@@ -24,6 +26,8 @@ namespace dbasic {
     class DeltaEngine;
 
     class AssetManager : public ysObject {
+        friend AssetStreamer;
+
     public:
         AssetManager();
         ~AssetManager();
@@ -47,6 +51,19 @@ namespace dbasic {
         AudioAsset *GetAudioAsset(const char *name);
         int GetAudioAssetCount() const { return m_audioAssets.GetNumObjects(); }
 
+        // Asynchronous loading, see AssetStreamer. UpdateStreaming() must be
+        // called once per frame on the render thread for these to complete.
+        AssetStreamer::Handle LoadSceneFileAsync(const wchar_t *fname, bool placeInVram = true, bool placeInRam = false,
+            const AssetStreamer::Options &options = AssetStreamer::Options());
+        AssetStreamer::Handle LoadAnimationFileAsync(const wchar_t *fname,
+            const AssetStreamer::Options &options = AssetStreamer::Options());
+        AssetStreamer::Handle LoadTextureAsync(const wchar_t *fname, const char *name,
+            const AssetStreamer::Options &options = AssetStreamer::Options());
+        AssetStreamer::Handle LoadAudioFileAsync(const wchar_t *fname, const char *name,
+            const AssetStreamer::Options &options = AssetStreamer::Options());
+        ysError UpdateStreaming();
+        AssetStreamer *GetStreamer() { return &m_streamer; }
+
         ysError CompileAnimationFileLegacy(const wchar_t *fname);
         ysError LoadAnimationFileLegacy(const wchar_t *fname);
 
@@ -73,6 +90,14 @@ namespace dbasic {
 
         AnimationObjectController *BuildAnimationObjectController(const char *name, ysTransform *transform);
 
+        // --
+        // Lookups by name go through a hash index that picks up new assets
+        // the next time it is used. Assets that are renamed after they were
+        // indexed can only be found under their new name after calling
+        // this.
+        // --
+        void RebuildNameIndices();
+
         void SetEngine(DeltaEngine *engine) { m_engine = engine; }
         DeltaEngine *GetEngine() const { return m_engine; }
 
@@ -90,9 +115,25 @@ namespace dbasic {
         ysDynamicArray<TextureAsset, 4> m_textures;
         ysDynamicArray<AudioAsset, 4> m_audioAssets;
 
+        ysError LoadSceneFile(ysMappedFile *file, const wchar_t *fname, bool placeInVram, bool placeInRam);
+
+        // Loads scenes compiled before the version 2 layout
+        ysError LoadSceneFileLegacy(const wchar_t *fname, bool placeInVram, bool placeInRam);
+
+        static void LoadObjectTransform(
+            SceneObjectAsset *object, const ysGeometryExportFile::ObjectOutputHeader &header, float positionW);
+
         DeltaEngine *m_engine;
 
         std::vector<ysGPUBuffer *> m_buffers;
+
+        AssetStreamer m_streamer;
+
+        NameIndex m_modelAssetNames;
+        NameIndex m_sceneObjectNames;
+        NameIndex m_materialNames;
+        NameIndex m_textureNames;
+        NameIndex m_audioAssetNames;
     };
 
 } /* namespace dbasic */
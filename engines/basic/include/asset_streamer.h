@@ -0,0 +1,208 @@
+#ifndef DELTA_BASIC_ASSET_STREAMER_H
+#define DELTA_BASIC_ASSET_STREAMER_H
+
+#include "delta_core.h"
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ysWindowsAudioWaveFile;
+
+namespace dbasic {
+
+    class AssetManager;
+
+    // --
+    // Loads assets in the background. File I/O and decoding run on a
+    // pool of worker threads; anything that touches the device or the
+    // asset manager is deferred to Update(), which is called once per
+    // frame on the render thread and only uploads as much as the
+    // per-frame budget allows.
+    // --
+    class AssetStreamer : public ysObject {
+    public:
+        typedef int Handle;
+        static const Handle InvalidHandle = -1;
+
+        static const int DefaultUploadBudget = 16 * 1024 * 1024;
+
+        // Number of finished requests whose status is remembered
+        static const int FinishedHistory = 1024;
+
+        enum class Status {
+            Invalid,
+            Queued,
+            Loading,
+            Uploading,
+            Complete,
+            Failed
+        };
+
+        typedef std::function<void(Handle handle, ysError result)> Callback;
+
+        struct Options {
+            Options();
+
+            // Lower values are loaded first
+            float Priority;
+
+            // If set, the distance from the view position is added to the
+            // priority so that nearby assets are loaded first
+            bool HasPosition;
+            ysVector3 Position;
+
+            // Called on the render thread once the asset is usable
+            Callback OnComplete;
+        };
+
+        struct Progress {
+            int Requested;
+            int Completed;
+            int Failed;
+
+            // Fraction of the requests made since the streamer was last
+            // idle that have finished
+            float Fraction;
+        };
+
+    public:
+        AssetStreamer();
+        ~AssetStreamer();
+
+        // --
+        // Start the worker threads.
+        //
+        //   workerCount: Number of threads, 0 picks one based on the
+        //                number of hardware threads
+        //
+        // --
+        void Initialize(AssetManager *manager, int workerCount = 0);
+
+        // --
+        // Stop the worker threads and discard requests that have not
+        // completed. Their callbacks are not called.
+        // --
+        void Destroy();
+
+        Handle RequestTexture(const wchar_t *fname, const char *name, const Options &options = Options());
+        Handle RequestSceneFile(const wchar_t *fname, bool placeInVram, bool placeInRam, const Options &options = Options());
+        Handle RequestAnimationFile(const wchar_t *fname, const Options &options = Options());
+#if defined(_WIN64)
+        Handle RequestAudioFile(const wchar_t *fname, const char *name, const Options &options = Options());
+#endif /* Windows */
+
+        // --
+        // Upload finished requests and run their callbacks. Must be
+        // called on the render thread.
+        // --
+        ysError Update();
+
+        // --
+        // Block until the request has finished and upload it right
+        // away, ignoring the budget. Can be called from a callback.
+        // --
+        ysError Wait(Handle handle);
+
+        // --
+        // Only the last FinishedHistory requests to finish are remembered,
+        // older handles report Invalid.
+        // --
+        Status GetStatus(Handle handle);
+        Progress GetProgress();
+
+        void SetPriority(Handle handle, float priority);
+        void SetViewPosition(const ysVector3 &position);
+
+        // Distance at which an asset is pushed back by one priority unit
+        void SetDistanceScale(float scale);
+
+        // Bytes uploaded per call to Update(), at least one request is
+        // always uploaded
+        void SetUploadBudget(int bytes) { m_uploadBudget = bytes; }
+        int GetUploadBudget() const { return m_uploadBudget; }
+
+        int GetWorkerCount() const { return (int)m_workers.size(); }
+
+    protected:
+        enum class RequestType {
+            Texture,
+            SceneFile,
+            AnimationFile,
+            AudioFile
+        };
+
+        struct Request {
+            Handle Id;
+            RequestType Type;
+            Status State;
+            ysError Result;
+
+            std::wstring Path;
+            std::string Name;
+            Options Settings;
+
+            bool PlaceInVram;
+            bool PlaceInRam;
+
+            // Decoded on a worker
+            unsigned char *Pixels;
+            int Width;
+            int Height;
+
+            ysMappedFile SceneFile;
+            std::vector<ysAnimationAction *> Actions;
+            ysWindowsAudioWaveFile *WaveFile;
+
+            int UploadSize;
+        };
+
+    protected:
+        Handle Submit(Request *request);
+        void WorkerThread();
+
+        Request *NextQueuedRequest();
+        float GetEffectivePriority(const Request *request) const;
+
+        void Decode(Request *request);
+        ysError Upload(Request *request);
+        void Finish(Request *request);
+        void Release(Request *request);
+
+    protected:
+        AssetManager *m_manager;
+
+        std::vector<std::thread> m_workers;
+        bool m_stopping;
+
+        std::mutex m_lock;
+        std::condition_variable m_queueChanged;
+        std::condition_variable m_requestDecoded;
+
+        // All requests that have not finished
+        std::map<Handle, Request *> m_requests;
+
+        std::vector<Request *> m_queued;
+        std::vector<Request *> m_decoded;
+
+        // Outcome of the most recently finished requests
+        std::map<Handle, Status> m_finished;
+
+        Handle m_nextHandle;
+
+        ysVector3 m_viewPosition;
+        float m_distanceScale;
+        int m_uploadBudget;
+
+        int m_requested;
+        int m_completed;
+        int m_failed;
+    };
+
+} /* namespace dbasic */
+
+#endif /* DELTA_BASIC_ASSET_STREAMER_H */
@@ -16,7 +16,7 @@ namespace dbasic {
         ysAudioBuffer *GetBuffer() const { return m_buffer; }
 
         void SetName(const char *name) { m_name = name; }
-        std::string GetName() const { return m_name; }
+        const std::string &GetName() const { return m_name; }
 
     protected:
         ysAudioBuffer *m_buffer;
@@ -110,6 +110,9 @@ namespace dbasic {
 
         void SetDiffuseTexture(ysTexture *texture);
 
+        ShaderStage *GetMainStage() const { return m_mainStage; }
+        TextureHandle GetDiffuseTextureHandle() const { return m_mainStageDiffuseTexture; }
+
         inline ysShaderProgram *shaderProgram() const { return m_shaderProgram; }
         inline ysInputLayout *inputLayout() const { return m_inputLayout; }
 
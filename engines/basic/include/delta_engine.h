@@ -10,13 +10,18 @@
 #include "event_handler.h"
 #include "font.h"
 #include "model_asset.h"
+#include "particle_renderer.h"
 #include "shader_base.h"
 #include "shader_controls.h"
 #include "window_handler.h"
 
+#include "../../../include/yds_linear_allocator.h"
+
 #include "../../../physics/include/mass_spring_system.h"
 #include "../../../physics/include/rigid_body_system.h"
 
+#include <vector>
+
 namespace dbasic {
 
 class RenderSkeleton;
@@ -46,6 +51,10 @@ public:
         int InstanceCount = 0;
         bool DepthTest = true;
         bool Lines = false;
+
+        // Set by the caller if the call doesn't blend with what was drawn
+        // before it, so that it can be reordered to group pipeline state
+        bool Opaque = false;
     };
 
     struct GameEngineSettings {
@@ -61,6 +70,7 @@ public:
         const wchar_t *LoggingDirectory = L"";
         bool DepthBuffer = true;
         bool FrameLogging = false;
+        int FrameAllocatorSize = 1 * MB;
         int WindowWidth = INT_MAX;
         int WindowHeight = INT_MAX;
         int WindowPositionX = INT_MAX;
@@ -96,20 +106,30 @@ public:
     ysError DrawImage(StageEnableFlags flags, ysTexture *image, int layer = 0);
     ysError DrawBox(StageEnableFlags flags, int layer = 0);
     ysError DrawAxis(StageEnableFlags flags, int layer = 0);
-    ysError DrawModel(StageEnableFlags flags, ModelAsset *model, int layer = 0);
+    ysError DrawModel(StageEnableFlags flags, ModelAsset *model, int layer = 0,
+                      bool opaque = false);
     ysError DrawRenderSkeleton(StageEnableFlags flags, RenderSkeleton *skeleton,
                                float scale, ShaderBase *shaders, int layer);
     ysError DrawGeneric(StageEnableFlags flags, ysGPUBuffer *indexBuffer,
                         ysGPUBuffer *vertexBuffer, ysShaderProgram *shader,
                         ysInputLayout *inputLayout, int vertexSize,
                         int baseIndex, int baseVertex, int faceCount,
-                        bool depthTest = true, int layer = 0);
+                        bool depthTest = true, int layer = 0,
+                        bool opaque = false);
     ysError DrawGeneric(StageEnableFlags flags, ysGPUBuffer *indexBuffer,
                         ysGPUBuffer *vertexBuffer, ysGPUBuffer *instanceBuffer,
                         ysShaderProgram *shader, ysInputLayout *inputLayout,
                         int vertexSize, int instanceDataSize, int baseIndex,
                         int baseVertex, int faceCount, int instanceCount,
-                        int baseInstance, bool depthTest = true, int layer = 0);
+                        int baseInstance, bool depthTest = true, int layer = 0,
+                        bool opaque = false);
+    ysError DrawParticles(StageEnableFlags flags,
+                          const dphysics::ParticleSystem *system,
+                          ysShaderProgram *shader, ysInputLayout *inputLayout,
+                          int layer = 0);
+    ysError DrawParticles(StageEnableFlags flags,
+                          const dphysics::ParticleSystem *system,
+                          int layer = 0);
     ysError DrawGenericLines(StageEnableFlags flags, ysGPUBuffer *indexBuffer,
                              ysGPUBuffer *vertexBuffer, int vertexSize,
                              int baseIndex, int baseVertex, int segmentCount,
@@ -160,10 +180,7 @@ public:
     float GetAverageFramerate();
     float GetAverageFrameLength();
     
-    // !!!: Urgent
-    #if defined(_WIN64)
-        ysTimingSystem *GetTimingSystem() const { return m_timingSystem; }
-    #endif /* Windows */
+    ysTimingSystem *GetTimingSystem() const { return m_timingSystem; }
     
     ysDevice *GetDevice() { return m_device; }
 
@@ -172,6 +189,12 @@ public:
 
     Console *GetConsole() { return &m_console; }
     UiRenderer *GetUiRenderer() { return &m_uiRenderer; }
+    ParticleRenderer *GetParticleRenderer() { return &m_particleRenderer; }
+
+    // Memory that stays valid until the end of the next frame. The two frame
+    // allocators are swapped and the new one reset when a frame ends.
+    void *AllocateFrameData(int size) { return GetFrameAllocator()->AllocateBlock(size); }
+    ysLinearAllocator *GetFrameAllocator() { return &m_frameAllocators[m_frameAllocatorIndex]; }
 
     ysAudioDevice *GetAudioDevice() const { return m_audioDevice; }
     ysBreakdownTimer &GetBreakdownTimer() { return m_breakdownTimer; }
@@ -188,6 +211,9 @@ public:
     ysShaderProgram *GetConsoleShaderProgram() const {
         return m_consoleProgram;
     }
+    ysShaderProgram *GetParticleShaderProgram() const {
+        return m_particleShaderProgram;
+    }
 
     ysInputSystem *GetInputSystem() const { return m_inputSystem; }
     ysInputLayout *GetSaqInputLayout() const { return m_saqInputLayout; }
@@ -195,6 +221,9 @@ public:
     ysInputLayout *GetConsoleInputLayout() const {
         return m_consoleInputLayout;
     }
+    ysInputLayout *GetParticleInputLayout() const {
+        return m_particleInputLayout;
+    }
 
     const ysRenderGeometryFormat *GetGeometryFormat() const {
         return &m_standardFormat;
@@ -204,6 +233,13 @@ public:
 
     void SetPaused(bool paused);
 
+    // Appends the calls of one layer to sorted in execution order. Runs of
+    // depth tested opaque calls are sorted by their pipeline state so that
+    // state changes between them are minimized. All other calls keep their
+    // submission order and are not moved across.
+    static void SortDrawCalls(const DrawCall *calls, int callCount,
+                              std::vector<const DrawCall *> &sorted);
+
 protected:
     ysDevice *m_device;
     EventHandler *m_eventHandler;
@@ -242,30 +278,34 @@ protected:
     ysShader *m_consolePixelShader;
     ysShader *m_saqVertexShader;
     ysShader *m_saqPixelShader;
+    ysShader *m_particleVertexShader;
+    ysShader *m_particlePixelShader;
 
     ysShaderProgram *m_shaderProgram;
     ysShaderProgram *m_skinnedShaderProgram;
     ysShaderProgram *m_consoleProgram;
+    ysShaderProgram *m_particleShaderProgram;
 
     ysRenderGeometryFormat m_skinnedFormat;
     ysRenderGeometryFormat m_standardFormat;
     ysRenderGeometryFormat m_consoleVertexFormat;
+    ysRenderGeometryFormat m_particleInstanceFormat;
     ysInputLayout *m_skinnedInputLayout;
     ysInputLayout *m_inputLayout;
     ysInputLayout *m_consoleInputLayout;
     ysInputLayout *m_saqInputLayout;
+    ysInputLayout *m_particleInputLayout;
 
     // Text Support
     UiRenderer m_uiRenderer;
     Console m_console;
 
+    ParticleRenderer m_particleRenderer;
+
     bool m_initialized;
 
     // Timing
-    // !!!: Urgent
-    #if defined(_WIN64)
-        ysTimingSystem *m_timingSystem;
-    #endif /* Windows */
+    ysTimingSystem *m_timingSystem;
     
     ysBreakdownTimer m_breakdownTimer;
 
@@ -292,8 +332,18 @@ protected:
 protected:
     // Drawing queues
     ysExpandingArray<DrawCall, 256> *m_drawQueue;
+    ysLinearAllocator m_frameAllocators[2];
+    int m_frameAllocatorIndex;
+
+    // Layers that have at least one call this frame
+    ysExpandingArray<int, MaxLayers> m_activeLayers;
+
+    // All calls of the frame in execution order
+    std::vector<const DrawCall *> m_sortedDrawCalls;
+
     ysError ExecuteDrawQueue();
     ysError ExecuteShaderStage(int stageIndex);
+    void SortDrawQueue();
 
     void ClearDrawQueue();
 };
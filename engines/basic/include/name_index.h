@@ -0,0 +1,66 @@
+#ifndef DELTA_BASIC_NAME_INDEX_H
+#define DELTA_BASIC_NAME_INDEX_H
+
+#include <vector>
+
+namespace dbasic {
+
+    // --
+    // Hash index from names to positions in an asset array.
+    //
+    // Only the hash of each name is stored; candidates are checked against
+    // the name the asset currently has, so a stale entry can never return
+    // the wrong asset. Names that are equal hash to the same probe
+    // sequence and are found in the order they were added, which matches
+    // a front to back search of the array.
+    // --
+    class NameIndex {
+    public:
+        static const int InvalidIndex = -1;
+
+    public:
+        NameIndex();
+        ~NameIndex();
+
+        void Clear();
+        void Add(const char *name, int index);
+
+        // Number of array entries that have been added
+        int GetCount() const { return m_count; }
+
+        // --
+        // Find the first added index with a matching hash for which
+        // match(index) returns true.
+        // --
+        template <typename Match>
+        int Find(const char *name, Match match) const {
+            if (m_entries.empty()) return InvalidIndex;
+
+            const unsigned int mask = (unsigned int)m_entries.size() - 1;
+            const unsigned int hash = Hash(name);
+            for (unsigned int slot = hash & mask;; slot = (slot + 1) & mask) {
+                const Entry &entry = m_entries[slot];
+                if (entry.Index == InvalidIndex) return InvalidIndex;
+                else if (entry.Hash == hash && match(entry.Index)) return entry.Index;
+            }
+        }
+
+        static unsigned int Hash(const char *name);
+
+    protected:
+        struct Entry {
+            unsigned int Hash;
+            int Index;
+        };
+
+        void Insert(unsigned int hash, int index);
+        void Grow();
+
+    protected:
+        std::vector<Entry> m_entries;
+        int m_count;
+    };
+
+} /* namespace dbasic */
+
+#endif /* DELTA_BASIC_NAME_INDEX_H */
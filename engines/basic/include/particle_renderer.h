@@ -0,0 +1,74 @@
+#ifndef DELTA_BASIC_PARTICLE_RENDERER_H
+#define DELTA_BASIC_PARTICLE_RENDERER_H
+
+#include "delta_core.h"
+
+#include "shader_controls.h"
+#include "shader_stage.h"
+
+#include "../../../physics/include/particle_system.h"
+
+namespace dbasic {
+
+    class DeltaEngine;
+
+    // Draws each particle system as a single instanced quad. Instances of all
+    // systems drawn in a frame share one GPU buffer.
+    class ParticleRenderer : public ysObject {
+    public:
+        ParticleRenderer();
+        ~ParticleRenderer();
+
+        ysError Initialize(int capacity);
+        ysError Reset();
+        ysError Destroy();
+
+        void SetEngine(DeltaEngine *engine) { m_engine = engine; }
+        DeltaEngine *GetEngine() { return m_engine; }
+
+        // Texture input of the particle shader that each system's texture is
+        // bound to when it is drawn. Systems without a texture get a plain
+        // white one. The engine sets this to the default shaders' diffuse
+        // texture; without an input the caller binds textures itself.
+        void SetTextureInput(ShaderStage *stage, TextureHandle handle) {
+            m_textureStage = stage;
+            m_textureHandle = handle;
+        }
+
+        ysError Draw(
+            StageEnableFlags flags,
+            const dphysics::ParticleSystem *system,
+            ysShaderProgram *shader,
+            ysInputLayout *inputLayout,
+            int layer = 0);
+
+        // Instance channels for input layouts of particle shaders
+        static void GetInstanceFormat(ysRenderGeometryFormat *format);
+
+        int GetCapacity() const { return m_capacity; }
+        int GetInstanceCount() const { return m_instanceOffset; }
+
+    protected:
+        ysError InitializeGeometry(int capacity);
+
+    protected:
+        DeltaEngine *m_engine;
+
+        ysGPUBuffer *m_quadVertexBuffer;
+        ysGPUBuffer *m_quadIndexBuffer;
+        ysGPUBuffer *m_instanceBuffer;
+
+        ysTexture *m_defaultTexture;
+
+        ShaderStage *m_textureStage;
+        TextureHandle m_textureHandle;
+
+        int m_capacity;
+        int m_instanceOffset;
+
+        dphysics::ParticleInstance *m_instances;
+    };
+
+} /* namespace dbasic */
+
+#endif /* DELTA_BASIC_PARTICLE_RENDERER_H */
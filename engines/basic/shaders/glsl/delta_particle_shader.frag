@@ -0,0 +1,13 @@
+#version 420
+
+layout(binding = 0) uniform sampler2D diffuseTex;
+
+out vec4 out_Color;
+
+in vec2 ex_Tex;
+in float ex_Alpha;
+
+void main(void) {
+	vec4 color = texture(diffuseTex, ex_Tex).rgba;
+	out_Color = vec4(color.rgb, color.a * ex_Alpha);
+}
@@ -0,0 +1,34 @@
+#version 420
+
+layout(location=0) in vec4 in_Position;
+layout(location=1) in vec2 in_Tex;
+layout(location=2) in vec4 in_Normal;
+
+layout(location=3) in vec4 in_InstancePosition;
+layout(location=4) in vec4 in_InstanceData;
+
+out vec2 ex_Tex;
+out float ex_Alpha;
+
+layout (binding = 0) uniform ScreenVariables {
+	mat4 CameraView;
+	mat4 Projection;
+	vec4 CameraEye;
+
+	vec4 FogColor;
+	float FogNear;
+	float FogFar;
+};
+
+void main(void) {
+	// Instance data is (scale, fade, density, unused)
+	float scale = in_InstanceData.x;
+
+	// Quads always face the camera
+	vec4 viewPos = vec4(in_InstancePosition.xyz, 1.0) * CameraView;
+	viewPos.xy += in_Position.xy * scale;
+
+	gl_Position = viewPos * Projection;
+	ex_Tex = in_Tex;
+	ex_Alpha = in_InstanceData.y * in_InstanceData.z;
+}
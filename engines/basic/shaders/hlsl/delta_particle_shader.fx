@@ -0,0 +1,49 @@
+Texture2D txDiffuse : register( t0 );
+SamplerState samLinear : register( s0 );
+
+struct VS_INPUT_PARTICLE {
+	float4 Pos : POSITION;
+	float2 TexCoord : TEXCOORD0;
+	float4 Normal : NORMAL;
+
+	float4 InstancePosition : INSTANCE_POSITION;
+	float4 InstanceData : INSTANCE_DATA;
+};
+
+struct VS_OUTPUT {
+	float4 Pos : SV_POSITION;
+	float2 TexCoord : TEXCOORD0;
+	float Alpha : ALPHA;
+};
+
+cbuffer ScreenVariables : register(b0) {
+	matrix CameraView;
+	matrix Projection;
+	float4 CameraEye;
+
+	float4 FogColor;
+	float FogNear;
+	float FogFar;
+};
+
+VS_OUTPUT VS_PARTICLE(VS_INPUT_PARTICLE input) {
+	VS_OUTPUT output = (VS_OUTPUT) 0;
+
+	// Instance data is (scale, fade, density, unused)
+	float scale = input.InstanceData.x;
+
+	// Quads always face the camera
+	float4 viewPos = mul(float4(input.InstancePosition.xyz, 1.0f), CameraView);
+	viewPos.xy += input.Pos.xy * scale;
+
+	output.Pos = mul(viewPos, Projection);
+	output.TexCoord = float2(input.TexCoord.x, 1.0f - input.TexCoord.y);
+	output.Alpha = input.InstanceData.y * input.InstanceData.z;
+
+	return output;
+}
+
+float4 PS_PARTICLE(VS_OUTPUT input) : SV_Target {
+	float4 color = txDiffuse.Sample(samLinear, input.TexCoord);
+	return float4(color.rgb, color.a * input.Alpha);
+}
@@ -3,8 +3,10 @@
 #include "../include/animation_export_file.h"
 #include "../include/delta_engine.h"
 
+#include <atomic>
 #include <set>
 #include <sys/stat.h>
+#include <thread>
 
 #if !defined(_WIN64)
     #include "safe_lib.h"
@@ -13,6 +15,50 @@
     #include <sys/stat.h>
 #endif
 
+namespace {
+
+    const char *NameOf(const dbasic::ModelAsset *asset) { return asset->GetName(); }
+    const char *NameOf(const dbasic::SceneObjectAsset *asset) { return asset->GetName(); }
+    const char *NameOf(const dbasic::Material *asset) { return asset->GetName(); }
+    const char *NameOf(const dbasic::TextureAsset *asset) { return asset->GetName().c_str(); }
+    const char *NameOf(const dbasic::AudioAsset *asset) { return asset->GetName().c_str(); }
+
+    // Index the assets that were added since the last lookup
+    template <typename T_Asset, int T_Size>
+    void UpdateNameIndex(dbasic::NameIndex *index, const ysDynamicArray<T_Asset, T_Size> &assets) {
+        const int assetCount = assets.GetNumObjects();
+        if (assetCount < index->GetCount()) index->Clear();
+
+        for (int i = index->GetCount(); i < assetCount; ++i) {
+            index->Add(NameOf(assets.Get(i)), i);
+        }
+    }
+
+    // Run function(i) for i in [0, count) on all hardware threads
+    template <typename T_Function>
+    void ParallelFor(int count, T_Function function) {
+        int threadCount = (int)std::thread::hardware_concurrency();
+        if (threadCount > count) threadCount = count;
+
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            for (int i = next++; i < count; i = next++) function(i);
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < threadCount; ++i) threads.emplace_back(worker);
+        worker();
+
+        for (std::thread &thread : threads) thread.join();
+    }
+
+    // Compiled objects are cached next to the compiled scene
+    std::wstring CompileCachePath(const wchar_t *fname) {
+        return std::wstring(fname) + L".yscc";
+    }
+
+} /* namespace */
+
 dbasic::AssetManager::AssetManager() : ysObject("AssetManager") {
     m_engine = nullptr;
 }
@@ -22,6 +68,8 @@ dbasic::AssetManager::~AssetManager() { /* void */ }
 ysError dbasic::AssetManager::Destroy() {
     YDS_ERROR_DECLARE("Destroy");
 
+    m_streamer.Destroy();
+
     int textureCount = m_textures.GetNumObjects();
     for (int i = 0; i < textureCount; ++i) {
         m_textures.Get(i)->Destroy(m_engine->GetDevice());
@@ -40,12 +88,13 @@ dbasic::Material *dbasic::AssetManager::NewMaterial() {
 }
 
 dbasic::Material *dbasic::AssetManager::FindMaterial(const char *name) {
-    for (int i = 0; i < m_materials.GetNumObjects(); i++) {
-        if (strcmp(m_materials.Get(i)->GetName(), name) == 0)
-            return m_materials.Get(i);
-    }
+    UpdateNameIndex(&m_materialNames, m_materials);
 
-    return nullptr;
+    const int index = m_materialNames.Find(name, [&](int i) {
+        return strcmp(m_materials.Get(i)->GetName(), name) == 0;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr : m_materials.Get(index);
 }
 
 dbasic::SceneObjectAsset *dbasic::AssetManager::NewSceneObject() {
@@ -59,28 +108,28 @@ dbasic::SceneObjectAsset *dbasic::AssetManager::NewSceneObject() {
 dbasic::SceneObjectAsset *
 dbasic::AssetManager::GetSceneObject(const char *name,
                                      ysObjectData::ObjectType type) {
-    const int objectCount = m_sceneObjects.GetNumObjects();
-    for (int i = 0; i < objectCount; i++) {
-        if (m_sceneObjects.Get(i)->GetType() != type) {
-            continue;
-        } else if (strcmp(m_sceneObjects.Get(i)->GetName(), name) == 0) {
-            return m_sceneObjects.Get(i);
-        }
-    }
+    UpdateNameIndex(&m_sceneObjectNames, m_sceneObjects);
 
-    return nullptr;
+    const int index = m_sceneObjectNames.Find(name, [&](int i) {
+        SceneObjectAsset *object = m_sceneObjects.Get(i);
+        return object->GetType() == type &&
+               strcmp(object->GetName(), name) == 0;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr
+                                              : m_sceneObjects.Get(index);
 }
 
 dbasic::SceneObjectAsset *
 dbasic::AssetManager::GetSceneObject(const char *name) {
-    const int objectCount = m_sceneObjects.GetNumObjects();
-    for (int i = 0; i < objectCount; i++) {
-        if (strcmp(m_sceneObjects.Get(i)->GetName(), name) == 0) {
-            return m_sceneObjects.Get(i);
-        }
-    }
+    UpdateNameIndex(&m_sceneObjectNames, m_sceneObjects);
 
-    return nullptr;
+    const int index = m_sceneObjectNames.Find(name, [&](int i) {
+        return strcmp(m_sceneObjects.Get(i)->GetName(), name) == 0;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr
+                                              : m_sceneObjects.Get(index);
 }
 
 dbasic::SceneObjectAsset *
@@ -100,14 +149,22 @@ dbasic::ModelAsset *dbasic::AssetManager::NewModelAsset() {
 }
 
 dbasic::ModelAsset *dbasic::AssetManager::GetModelAsset(const char *name) {
-    int modelCount = m_modelAssets.GetNumObjects();
-    for (int i = 0; i < modelCount; i++) {
-        if (strcmp(m_modelAssets.Get(i)->GetName(), name) == 0) {
-            return m_modelAssets.Get(i);
-        }
-    }
+    UpdateNameIndex(&m_modelAssetNames, m_modelAssets);
 
-    return nullptr;
+    const int index = m_modelAssetNames.Find(name, [&](int i) {
+        return strcmp(m_modelAssets.Get(i)->GetName(), name) == 0;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr
+                                              : m_modelAssets.Get(index);
+}
+
+void dbasic::AssetManager::RebuildNameIndices() {
+    m_modelAssetNames.Clear();
+    m_sceneObjectNames.Clear();
+    m_materialNames.Clear();
+    m_textureNames.Clear();
+    m_audioAssetNames.Clear();
 }
 
 ysError dbasic::AssetManager::CompileSceneFile(const wchar_t *fname,
@@ -159,46 +216,82 @@ ysError dbasic::AssetManager::CompileSceneFile(const wchar_t *fname,
     ysObjectData **objects = new ysObjectData *[toolFile.GetObjectCount()];
     int objectCount = toolFile.GetObjectCount();
 
-    CompiledHeader header;
-    header.ObjectCount = objectCount;
-
-    YDS_NESTED_ERROR_CALL(
-            exportFile.WriteCustomData(&header, sizeof(CompiledHeader)));
-
+    // Material lookups are not thread safe, resolve them up front
+    std::vector<bool> usesNormalMap(objectCount);
+    std::vector<bool> usesMaps(objectCount);
     for (int i = 0; i < objectCount; i++) {
         YDS_NESTED_ERROR_CALL(toolFile.ReadObject(&objects[i]));
         Material *material = FindMaterial(objects[i]->m_materialName);
 
-        if (objects[i]->m_objectInformation.ObjectType ==
+        usesNormalMap[i] = (material != nullptr) && material->UsesNormalMap();
+        usesMaps[i] = (material != nullptr) &&
+                      (material->UsesNormalMap() || material->UsesSpecularMap() ||
+                       material->UsesDiffuseMap());
+    }
+
+    const std::wstring cachePath = CompileCachePath(fname);
+    ysGeometryCompileCache cache;
+    if (!force) { YDS_NESTED_ERROR_CALL(cache.Load(cachePath.c_str())); }
+
+    std::vector<ysGeometryCompileCache::Key> keys(objectCount);
+    ParallelFor(objectCount, [&](int i) {
+        ysGeometryCompileCache::Hasher hasher;
+        ysGeometryCompileCache::HashObject(objects[i], &hasher);
+        hasher.AddValue(scale);
+        hasher.AddValue((bool)usesNormalMap[i]);
+        hasher.AddValue((bool)usesMaps[i]);
+        keys[i] = hasher.GetKey();
+    });
+
+    // Only objects that changed since the last compile are preprocessed
+    std::vector<ysGeometryExportFile::CompiledObject> compiled(objectCount);
+    std::vector<int> pending;
+    for (int i = 0; i < objectCount; i++) {
+        if (!cache.Find(keys[i], &compiled[i])) pending.push_back(i);
+    }
+
+    std::vector<ysError> results(pending.size(), ysError::None);
+    ParallelFor((int)pending.size(), [&](int j) {
+        ysObjectData *object = objects[pending[j]];
+
+        if (object->m_objectInformation.ObjectType ==
             ysObjectData::ObjectType::Geometry) {
-            ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(objects[i]);
-            ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(objects[i]);
-            ysGeometryPreprocessing::SeparateBySmoothingGroups(objects[i]);
-            ysGeometryPreprocessing::CalculateNormals(objects[i]);
-
-            if ((material != nullptr) && material->UsesNormalMap())
-                ysGeometryPreprocessing::CalculateTangents(objects[i], 0);
-
-            if ((material != nullptr) &&
-                (material->UsesNormalMap() || material->UsesSpecularMap() ||
-                 material->UsesDiffuseMap())) {
-                const int startingVerts =
-                        objects[i]->m_objectStatistics.NumVertices;
+            ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(object);
+            ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(object);
+            ysGeometryPreprocessing::SeparateBySmoothingGroups(object);
+            ysGeometryPreprocessing::CalculateNormals(object);
+
+            if (usesNormalMap[pending[j]])
+                ysGeometryPreprocessing::CalculateTangents(object, 0);
+
+            if (usesMaps[pending[j]]) {
                 for (int ii = 0;
-                     ii < objects[i]->m_objectStatistics.NumUVChannels; ii++) {
-                    ysGeometryPreprocessing::SeparateByUVGroups(objects[i], ii);
+                     ii < object->m_objectStatistics.NumUVChannels; ii++) {
+                    ysGeometryPreprocessing::SeparateByUVGroups(object, ii);
                 }
             }
 
-            ysGeometryPreprocessing::SortBoneWeights(objects[i]);
+            ysGeometryPreprocessing::SortBoneWeights(object);
         }
 
-        ysGeometryPreprocessing::CalculateNormals(objects[i]);
-        ysGeometryPreprocessing::UniformScale(objects[i], scale);
+        ysGeometryPreprocessing::CalculateNormals(object);
+        ysGeometryPreprocessing::UniformScale(object, scale);
+
+        results[j] = exportFile.CompileObject(object, &compiled[pending[j]]);
+    });
 
-        YDS_NESTED_ERROR_CALL(exportFile.WriteObject(objects[i]));
+    for (size_t j = 0; j < pending.size(); j++) {
+        YDS_NESTED_ERROR_CALL(results[j]);
+        cache.Store(keys[pending[j]], compiled[pending[j]]);
     }
 
+    for (int i = 0; i < objectCount; i++) {
+        YDS_NESTED_ERROR_CALL(exportFile.AddSceneObject(compiled[i]));
+    }
+
+    YDS_NESTED_ERROR_CALL(exportFile.WriteScene());
+    YDS_NESTED_ERROR_CALL(cache.Save(cachePath.c_str()));
+
     // Clear memory
     for (int i = 0; i < objectCount; i++) { delete objects[i]; }
 
@@ -269,39 +362,70 @@ ysError dbasic::AssetManager::CompileInterchangeFile(const wchar_t *fname,
     const int objectCount = toolFile.GetObjectCount();
     ysInterchangeObject *objects = new ysInterchangeObject[objectCount];
 
-    CompiledHeader header;
-    header.ObjectCount = 0;
     for (int i = 0; i < objectCount; ++i) {
         YDS_NESTED_ERROR_CALL(toolFile.ReadObject(&objects[i]));
+    }
+
+    const ysGeometryExportFile::VertexInfo vertexInfo;
+
+    const std::wstring cachePath = CompileCachePath(target);
+    ysGeometryCompileCache cache;
+    if (!force) { YDS_NESTED_ERROR_CALL(cache.Load(cachePath.c_str())); }
+
+    std::vector<ysGeometryCompileCache::Key> keys(objectCount);
+    ParallelFor(objectCount, [&](int i) {
+        ysGeometryCompileCache::Hasher hasher;
+        ysGeometryCompileCache::HashObject(objects[i], &hasher);
+        hasher.AddValue(scale);
+        hasher.AddValue(vertexInfo.IncludeTangents);
+        hasher.AddValue(vertexInfo.IncludeNormals);
+        hasher.AddValue(vertexInfo.IncludeUVs);
+        hasher.AddValue(vertexInfo.UVChannels);
+        keys[i] = hasher.GetKey();
+    });
+
+    // Only objects that changed since the last compile are processed
+    std::vector<ysGeometryExportFile::CompiledObject> compiled(objectCount);
+    std::vector<int> pending;
+    for (int i = 0; i < objectCount; i++) {
         if (objects[i].Type == ysInterchangeObject::ObjectType::Undefined) {
             continue;
         }
 
-        header.ObjectCount++;
+        if (!cache.Find(keys[i], &compiled[i])) pending.push_back(i);
     }
 
-    YDS_NESTED_ERROR_CALL(
-            exportFile.WriteCustomData(&header, sizeof(CompiledHeader)));
+    std::vector<ysError> results(pending.size(), ysError::None);
+    ParallelFor((int)pending.size(), [&](int j) {
+        ysInterchangeObject &object = objects[pending[j]];
 
-    for (int i = 0; i < objectCount; i++) {
-        if (objects[i].Type == ysInterchangeObject::ObjectType::Undefined) {
-            continue;
+        if (object.Type == ysInterchangeObject::ObjectType::Geometry) {
+            if (vertexInfo.IncludeNormals) object.RipByNormals();
+            if (vertexInfo.IncludeTangents) object.RipByTangents();
+            if (vertexInfo.IncludeUVs) object.RipByUVs();
         }
 
-        Material *material = FindMaterial(objects[i].MaterialName.c_str());
+        object.UniformScale(scale);
 
-        ysGeometryExportFile::VertexInfo vertexInfo;
-        if (objects[i].Type == ysInterchangeObject::ObjectType::Geometry) {
-            if (vertexInfo.IncludeNormals) objects[i].RipByNormals();
-            if (vertexInfo.IncludeTangents) objects[i].RipByTangents();
-            if (vertexInfo.IncludeUVs) objects[i].RipByUVs();
-        }
+        results[j] = exportFile.CompileObject(&object, &vertexInfo, &compiled[pending[j]]);
+    });
 
-        objects[i].UniformScale(scale);
+    for (size_t j = 0; j < pending.size(); j++) {
+        YDS_NESTED_ERROR_CALL(results[j]);
+        cache.Store(keys[pending[j]], compiled[pending[j]]);
+    }
+
+    for (int i = 0; i < objectCount; i++) {
+        if (objects[i].Type == ysInterchangeObject::ObjectType::Undefined) {
+            continue;
+        }
 
-        YDS_NESTED_ERROR_CALL(exportFile.WriteObject(&objects[i]));
+        YDS_NESTED_ERROR_CALL(exportFile.AddSceneObject(compiled[i]));
     }
 
+    YDS_NESTED_ERROR_CALL(exportFile.WriteScene());
+    YDS_NESTED_ERROR_CALL(cache.Save(cachePath.c_str()));
+
     // Clear memory
     delete[] objects;
 
@@ -314,6 +438,95 @@ ysError dbasic::AssetManager::CompileInterchangeFile(const wchar_t *fname,
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+namespace {
+
+    bool SectionInFile(uint64_t offset, uint64_t size, size_t fileSize) {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+
+    bool RangeInSection(int64_t offset, int64_t size, uint64_t sectionSize) {
+        return offset >= 0 && size >= 0 &&
+               (uint64_t) offset <= sectionSize &&
+               (uint64_t) size <= sectionSize - (uint64_t) offset;
+    }
+
+    // Bone maps and extra data have no stored sizes, they extend up to the
+    // section that follows them
+    bool EntryInFile(const ysGeometryExportFile::SceneObjectEntry &entry,
+                     const ysGeometryExportFile::SceneFileHeader &fileHeader) {
+        const ysGeometryExportFile::ObjectOutputHeader &header = entry.Header;
+
+        if (header.NumVertices < 0 || header.NumFaces < 0 ||
+            header.NumBones < 0 || header.VertexDataSize < 0) {
+            return false;
+        }
+
+        const uint64_t boneMapSize =
+                fileHeader.ExtraDataOffset - fileHeader.BoneMapOffset;
+        const uint64_t extraDataSize =
+                fileHeader.VertexDataOffset - fileHeader.ExtraDataOffset;
+
+        if (entry.ExtraDataSize > 0 &&
+            !RangeInSection(entry.ExtraDataOffset, entry.ExtraDataSize,
+                            extraDataSize)) {
+            return false;
+        }
+
+        const ysObjectData::ObjectType objectType =
+                static_cast<ysObjectData::ObjectType>(header.ObjectType);
+        if (objectType != ysObjectData::ObjectType::Geometry) return true;
+
+        if (header.NumVertices > 0 &&
+            header.VertexDataSize < header.NumVertices) {
+            return false;
+        }
+
+        const int64_t boneSize = (int64_t) sizeof(int);
+        const int64_t indexSize = fileHeader.IndexSize;
+
+        return RangeInSection(entry.BoneMapOffset * boneSize,
+                              header.NumBones * boneSize, boneMapSize) &&
+               RangeInSection(entry.VertexOffset, header.VertexDataSize,
+                              fileHeader.VertexDataSize) &&
+               RangeInSection(entry.IndexOffset * indexSize,
+                              header.NumFaces * 3 * indexSize,
+                              fileHeader.IndexDataSize);
+    }
+
+}// namespace
+
+void dbasic::AssetManager::LoadObjectTransform(
+        SceneObjectAsset *object,
+        const ysGeometryExportFile::ObjectOutputHeader &header,
+        float positionW) {
+    ysVector translation = ysMath::LoadVector(header.Position, positionW);
+    ysVector scale = ysMath::LoadVector(header.Scale);
+
+    ysMatrix translationMatrix = ysMath::TranslationTransform(translation);
+    ysMatrix scaleMatrix = ysMath::ScaleTransform(scale);
+
+    ysMatrix rotx = ysMath::RotationTransform(
+            ysMath::Constants::XAxis,
+            header.OrientationEuler.x * ysMath::Constants::PI / 180.0f);
+    ysMatrix roty = ysMath::RotationTransform(
+            ysMath::Constants::YAxis,
+            header.OrientationEuler.y * ysMath::Constants::PI / 180.0f);
+    ysMatrix rotz = ysMath::RotationTransform(
+            ysMath::Constants::ZAxis,
+            header.OrientationEuler.z * ysMath::Constants::PI / 180.0f);
+
+    object->ApplyTransformation(translationMatrix);
+
+    object->ApplyTransformation(rotz);
+    object->ApplyTransformation(roty);
+    object->ApplyTransformation(rotx);
+
+    object->ApplyTransformation(scaleMatrix);
+
+    object->m_localOrientation = ysMath::LoadVector(header.Orientation);
+    object->m_localPosition = translation;
+}
+
 ysError dbasic::AssetManager::LoadSceneFile(const wchar_t *fname,
                                             bool placeInVram, bool placeInRam) {
     YDS_ERROR_DECLARE("LoadSceneFile");
@@ -322,6 +535,206 @@ ysError dbasic::AssetManager::LoadSceneFile(const wchar_t *fname,
     wcscpy_s(fullPath, 512, fname);
     wcscat_s(fullPath, 512, L".ysce");
 
+    ysMappedFile file;
+    YDS_NESTED_ERROR_CALL(file.Open(fullPath));
+    YDS_NESTED_ERROR_CALL(LoadSceneFile(&file, fname, placeInVram, placeInRam));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::AssetManager::LoadSceneFile(ysMappedFile *mappedFile,
+                                            const wchar_t *fname,
+                                            bool placeInVram, bool placeInRam) {
+    YDS_ERROR_DECLARE("LoadSceneFile");
+
+    ysMappedFile &file = *mappedFile;
+
+    typedef ysGeometryExportFile::SceneFileHeader SceneFileHeader;
+    typedef ysGeometryExportFile::SceneObjectEntry SceneObjectEntry;
+
+    const SceneFileHeader *fileHeader =
+            reinterpret_cast<const SceneFileHeader *>(file.GetData());
+    if (file.GetSize() < sizeof(SceneFileHeader) ||
+        fileHeader->Magic != ysGeometryExportFile::SceneFileMagic) {
+        file.Close();
+
+        YDS_NESTED_ERROR_CALL(
+                LoadSceneFileLegacy(fname, placeInVram, placeInRam));
+        return YDS_ERROR_RETURN(ysError::None);
+    }
+
+    if (fileHeader->Version != ysGeometryExportFile::SceneFileVersion) {
+        return YDS_ERROR_RETURN(ysError::UnsupportedFileVersion);
+    }
+
+    const size_t fileSize = file.GetSize();
+    if (fileHeader->ObjectCount < 0 ||
+        (fileHeader->IndexSize != 2 && fileHeader->IndexSize != 4) ||
+        !SectionInFile(fileHeader->ObjectTableOffset,
+                       sizeof(SceneObjectEntry) *
+                               (uint64_t) fileHeader->ObjectCount,
+                       fileSize) ||
+        !SectionInFile(fileHeader->VertexDataOffset,
+                       fileHeader->VertexDataSize, fileSize) ||
+        !SectionInFile(fileHeader->IndexDataOffset, fileHeader->IndexDataSize,
+                       fileSize) ||
+        fileHeader->BoneMapOffset > fileHeader->ExtraDataOffset ||
+        fileHeader->ExtraDataOffset > fileHeader->VertexDataOffset) {
+        return YDS_ERROR_RETURN(ysError::CorruptedFile);
+    }
+
+    const SceneObjectEntry *objectTable =
+            reinterpret_cast<const SceneObjectEntry *>(
+                    file.GetData() + fileHeader->ObjectTableOffset);
+
+    // Entries are checked before anything is created so that a corrupted
+    // file leaves no partially loaded scene behind
+    for (int i = 0; i < fileHeader->ObjectCount; i++) {
+        if (!EntryInFile(objectTable[i], *fileHeader)) {
+            return YDS_ERROR_RETURN(ysError::CorruptedFile);
+        }
+    }
+    const int *boneMaps = reinterpret_cast<const int *>(
+            file.GetData() + fileHeader->BoneMapOffset);
+    const char *extraData = file.GetData() + fileHeader->ExtraDataOffset;
+
+    const int initialIndex = m_sceneObjects.GetNumObjects();
+    const int initialModelIndex = m_modelAssets.GetNumObjects();
+
+    std::map<int, int> modelIndexMap;
+
+    for (int i = 0; i < fileHeader->ObjectCount; i++) {
+        const SceneObjectEntry &entry = objectTable[i];
+        const ysGeometryExportFile::ObjectOutputHeader &header = entry.Header;
+
+        SceneObjectAsset *newObject = NewSceneObject();
+
+        const ysObjectData::ObjectType objectType =
+                static_cast<ysObjectData::ObjectType>(header.ObjectType);
+
+        newObject->m_type = objectType;
+        newObject->m_parent = (header.ParentIndex < 0)
+                                      ? -1
+                                      : header.ParentIndex + initialIndex;
+        strcpy_s(newObject->m_name, 64, header.ObjectName);
+
+        newObject->m_material = FindMaterial(header.ObjectMaterial);
+
+        if (objectType != ysObjectData::ObjectType::Geometry) {
+            newObject->m_skeletonIndex = header.SkeletonIndex;
+            LoadObjectTransform(newObject, header, 1.0f);
+        } else {
+            LoadObjectTransform(newObject, header, 0.0f);
+        }
+
+        if (objectType == ysObjectData::ObjectType::Plane) {
+            return YDS_ERROR_RETURN_MSG(ysError::UnsupportedType,
+                                        "Planes not supported.");
+        } else if (objectType == ysObjectData::ObjectType::Instance) {
+            if (modelIndexMap.count(header.ParentInstanceIndex) == 1) {
+                newObject->m_geometry =
+                        GetModelAsset(modelIndexMap[header.ParentInstanceIndex]);
+            } else {
+                newObject->m_geometry = nullptr;
+            }
+
+            if (header.ParentInstanceIndex != -1) {
+                newObject->SetInstance(
+                        GetSceneObject(header.ParentInstanceIndex));
+            }
+        } else if (objectType == ysObjectData::ObjectType::Light) {
+            if (entry.ExtraDataSize >= (int) sizeof(ysInterchangeObject::Light)) {
+                ysInterchangeObject::Light lightInformation;
+                memcpy(&lightInformation, extraData + entry.ExtraDataOffset,
+                       sizeof(ysInterchangeObject::Light));
+
+                SceneObjectAsset::LightInformation &light =
+                        newObject->GetLightInformation();
+                light.Color = lightInformation.Color;
+                light.CutoffDistance = lightInformation.CutoffDistance;
+                light.Distance = lightInformation.Distance;
+                light.Intensity = lightInformation.Intensity;
+                light.LightType =
+                        static_cast<SceneObjectAsset::LightInformation::Type>(
+                                lightInformation.LightType);
+                light.SpotAngularSize = lightInformation.SpotAngularSize;
+                light.SpotFade = lightInformation.SpotFade;
+            }
+        } else if (objectType == ysObjectData::ObjectType::Geometry) {
+            modelIndexMap[i] = m_modelAssets.GetNumObjects();
+
+            ModelAsset *newModelAsset = NewModelAsset();
+
+            const int stride = (header.NumVertices > 0)
+                                       ? header.VertexDataSize / header.NumVertices
+                                       : 1;
+
+            if (header.NumBones > 0) {
+                newModelAsset->m_boneMap.Preallocate(header.NumBones);
+
+                for (int bone = 0; bone < header.NumBones; bone++) {
+                    newModelAsset->m_boneMap.New() =
+                            boneMaps[entry.BoneMapOffset + bone] + initialIndex;
+                }
+            }
+
+            newModelAsset->m_vertexSize = stride;
+            newModelAsset->m_UVChannelCount = header.NumUVChannels;
+            newModelAsset->m_vertexCount = header.NumVertices;
+            newModelAsset->m_faceCount = header.NumFaces;
+            newModelAsset->m_baseIndex = entry.IndexOffset;
+            newModelAsset->m_baseVertex = entry.VertexOffset / stride;
+            newModelAsset->m_vertexBuffer = nullptr;
+            newModelAsset->m_indexBuffer = nullptr;
+
+            strcpy_s(newModelAsset->m_name, 64, header.ObjectName);
+            newModelAsset->SetMaterial(FindMaterial(header.ObjectMaterial));
+
+            newObject->m_geometry = newModelAsset;
+        }
+    }
+
+    ysGPUBuffer *indexBuffer = nullptr;
+    ysGPUBuffer *vertexBuffer = nullptr;
+
+    // The device copies straight out of the mapped file
+    if (placeInVram && fileHeader->IndexDataSize > 0) {
+        YDS_NESTED_ERROR_CALL(m_engine->GetDevice()->CreateIndexBuffer(
+                &indexBuffer, (int) fileHeader->IndexDataSize,
+                const_cast<char *>(file.GetData() +
+                                   fileHeader->IndexDataOffset),
+                placeInRam));
+        indexBuffer->SetIndexSize(fileHeader->IndexSize);
+
+        YDS_NESTED_ERROR_CALL(m_engine->GetDevice()->CreateVertexBuffer(
+                &vertexBuffer, (int) fileHeader->VertexDataSize,
+                const_cast<char *>(file.GetData() +
+                                   fileHeader->VertexDataOffset),
+                placeInRam));
+    }
+
+    for (int i = initialModelIndex; i < m_modelAssets.GetNumObjects(); ++i) {
+        m_modelAssets.Get(i)->m_vertexBuffer = vertexBuffer;
+        m_modelAssets.Get(i)->m_indexBuffer = indexBuffer;
+    }
+
+    file.Close();
+
+    m_buffers.push_back(indexBuffer);
+    m_buffers.push_back(vertexBuffer);
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::AssetManager::LoadSceneFileLegacy(const wchar_t *fname,
+                                                  bool placeInVram,
+                                                  bool placeInRam) {
+    YDS_ERROR_DECLARE("LoadSceneFileLegacy");
+
+    wchar_t fullPath[512];
+    wcscpy_s(fullPath, 512, fname);
+    wcscat_s(fullPath, 512, L".ysce");
+
     std::fstream file(fullPath, std::ios::in | std::ios::binary);
 
     CompiledHeader fileHeader;
@@ -649,6 +1062,45 @@ ysError dbasic::AssetManager::LoadAnimationFile(const wchar_t *fname) {
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+dbasic::AssetStreamer::Handle dbasic::AssetManager::LoadSceneFileAsync(
+        const wchar_t *fname, bool placeInVram, bool placeInRam,
+        const AssetStreamer::Options &options) {
+    if (m_streamer.GetWorkerCount() == 0) { m_streamer.Initialize(this); }
+    return m_streamer.RequestSceneFile(fname, placeInVram, placeInRam, options);
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetManager::LoadAnimationFileAsync(
+        const wchar_t *fname, const AssetStreamer::Options &options) {
+    if (m_streamer.GetWorkerCount() == 0) { m_streamer.Initialize(this); }
+    return m_streamer.RequestAnimationFile(fname, options);
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetManager::LoadTextureAsync(
+        const wchar_t *fname, const char *name,
+        const AssetStreamer::Options &options) {
+    if (m_streamer.GetWorkerCount() == 0) { m_streamer.Initialize(this); }
+    return m_streamer.RequestTexture(fname, name, options);
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetManager::LoadAudioFileAsync(
+        const wchar_t *fname, const char *name,
+        const AssetStreamer::Options &options) {
+#if defined(_WIN64)
+    if (m_streamer.GetWorkerCount() == 0) { m_streamer.Initialize(this); }
+    return m_streamer.RequestAudioFile(fname, name, options);
+#else
+    return AssetStreamer::InvalidHandle;
+#endif /* Windows */
+}
+
+ysError dbasic::AssetManager::UpdateStreaming() {
+    YDS_ERROR_DECLARE("UpdateStreaming");
+
+    YDS_NESTED_ERROR_CALL(m_streamer.Update());
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
 ysAnimationAction *dbasic::AssetManager::GetAction(const char *name) {
     const int actionCount = GetActionCount();
     for (int i = 0; i < actionCount; ++i) {
@@ -673,12 +1125,13 @@ ysError dbasic::AssetManager::LoadTexture(const wchar_t *fname,
 }
 
 dbasic::TextureAsset *dbasic::AssetManager::GetTexture(const char *name) {
-    const int textureCount = GetTextureCount();
-    for (int i = 0; i < textureCount; ++i) {
-        if (m_textures.Get(i)->GetName() == name) { return m_textures.Get(i); }
-    }
+    UpdateNameIndex(&m_textureNames, m_textures);
 
-    return nullptr;
+    const int index = m_textureNames.Find(name, [&](int i) {
+        return m_textures.Get(i)->GetName() == name;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr : m_textures.Get(index);
 }
 
 #if defined(_WIN64)
@@ -709,14 +1162,14 @@ ysError dbasic::AssetManager::LoadAudioFile(const wchar_t *fname,
 #endif /* Windows */
 
 dbasic::AudioAsset *dbasic::AssetManager::GetAudioAsset(const char *name) {
-    const int assetCount = m_audioAssets.GetNumObjects();
-    for (int i = 0; i < assetCount; ++i) {
-        if (m_audioAssets.Get(i)->GetName() == name) {
-            return m_audioAssets.Get(i);
-        }
-    }
+    UpdateNameIndex(&m_audioAssetNames, m_audioAssets);
 
-    return nullptr;
+    const int index = m_audioAssetNames.Find(name, [&](int i) {
+        return m_audioAssets.Get(i)->GetName() == name;
+    });
+
+    return (index == NameIndex::InvalidIndex) ? nullptr
+                                              : m_audioAssets.Get(index);
 }
 
 dbasic::Skeleton *dbasic::AssetManager::BuildSkeleton(ModelAsset *model) {
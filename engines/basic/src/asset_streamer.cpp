@@ -0,0 +1,475 @@
+#include "../include/asset_streamer.h"
+
+#include "../include/asset_manager.h"
+#include "../include/delta_engine.h"
+
+#include "../../../include/yds_stb_image.h"
+
+#include <algorithm>
+#include <codecvt>
+#include <locale>
+#include <math.h>
+
+dbasic::AssetStreamer::Options::Options() {
+    Priority = 0.0f;
+    HasPosition = false;
+    Position = ysVector3(0.0f, 0.0f, 0.0f);
+}
+
+dbasic::AssetStreamer::AssetStreamer() : ysObject("AssetStreamer") {
+    m_manager = nullptr;
+    m_stopping = false;
+
+    m_nextHandle = 0;
+
+    m_viewPosition = ysVector3(0.0f, 0.0f, 0.0f);
+    m_distanceScale = 1.0f;
+    m_uploadBudget = DefaultUploadBudget;
+
+    m_requested = 0;
+    m_completed = 0;
+    m_failed = 0;
+}
+
+dbasic::AssetStreamer::~AssetStreamer() {
+    Destroy();
+}
+
+void dbasic::AssetStreamer::Initialize(AssetManager *manager, int workerCount) {
+    Destroy();
+
+    m_manager = manager;
+    m_stopping = false;
+
+    if (workerCount <= 0) {
+        // Leave a thread for the frame loop
+        workerCount = (int)std::thread::hardware_concurrency() - 1;
+        if (workerCount < 1) workerCount = 1;
+        else if (workerCount > 4) workerCount = 4;
+    }
+
+    for (int i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back(&AssetStreamer::WorkerThread, this);
+    }
+}
+
+void dbasic::AssetStreamer::Destroy() {
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+
+    m_queueChanged.notify_all();
+    for (std::thread &worker : m_workers) worker.join();
+    m_workers.clear();
+
+    for (auto &entry : m_requests) Release(entry.second);
+
+    m_requests.clear();
+    m_queued.clear();
+    m_decoded.clear();
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetStreamer::RequestTexture(
+    const wchar_t *fname, const char *name, const Options &options)
+{
+    Request *request = new Request;
+    request->Type = RequestType::Texture;
+    request->Path = fname;
+    request->Name = name;
+    request->Settings = options;
+
+    return Submit(request);
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetStreamer::RequestSceneFile(
+    const wchar_t *fname, bool placeInVram, bool placeInRam, const Options &options)
+{
+    Request *request = new Request;
+    request->Type = RequestType::SceneFile;
+    request->Path = fname;
+    request->Settings = options;
+    request->PlaceInVram = placeInVram;
+    request->PlaceInRam = placeInRam;
+
+    return Submit(request);
+}
+
+dbasic::AssetStreamer::Handle dbasic::AssetStreamer::RequestAnimationFile(
+    const wchar_t *fname, const Options &options)
+{
+    Request *request = new Request;
+    request->Type = RequestType::AnimationFile;
+    request->Path = fname;
+    request->Settings = options;
+
+    return Submit(request);
+}
+
+#if defined(_WIN64)
+dbasic::AssetStreamer::Handle dbasic::AssetStreamer::RequestAudioFile(
+    const wchar_t *fname, const char *name, const Options &options)
+{
+    Request *request = new Request;
+    request->Type = RequestType::AudioFile;
+    request->Path = fname;
+    request->Name = name;
+    request->Settings = options;
+
+    return Submit(request);
+}
+#endif /* Windows */
+
+dbasic::AssetStreamer::Handle dbasic::AssetStreamer::Submit(Request *request) {
+    request->State = Status::Queued;
+    request->Result = ysError::None;
+    request->Pixels = nullptr;
+    request->Width = 0;
+    request->Height = 0;
+    request->WaveFile = nullptr;
+    request->UploadSize = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // Progress restarts once everything requested before has finished
+        if (m_requests.empty()) {
+            m_requested = 0;
+            m_completed = 0;
+            m_failed = 0;
+        }
+
+        request->Id = m_nextHandle++;
+        ++m_requested;
+
+        m_requests[request->Id] = request;
+        m_queued.push_back(request);
+    }
+
+    m_queueChanged.notify_one();
+
+    return request->Id;
+}
+
+void dbasic::AssetStreamer::WorkerThread() {
+    while (true) {
+        Request *request = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_queueChanged.wait(lock, [this] { return m_stopping || !m_queued.empty(); });
+
+            if (m_stopping) return;
+
+            request = NextQueuedRequest();
+            request->State = Status::Loading;
+        }
+
+        Decode(request);
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            request->State = Status::Uploading;
+            m_decoded.push_back(request);
+        }
+
+        m_requestDecoded.notify_all();
+    }
+}
+
+dbasic::AssetStreamer::Request *dbasic::AssetStreamer::NextQueuedRequest() {
+    int best = 0;
+    float bestPriority = GetEffectivePriority(m_queued[0]);
+
+    const int queuedCount = (int)m_queued.size();
+    for (int i = 1; i < queuedCount; ++i) {
+        const float priority = GetEffectivePriority(m_queued[i]);
+        if (priority < bestPriority) {
+            best = i;
+            bestPriority = priority;
+        }
+    }
+
+    Request *request = m_queued[best];
+    m_queued.erase(m_queued.begin() + best);
+
+    return request;
+}
+
+float dbasic::AssetStreamer::GetEffectivePriority(const Request *request) const {
+    float priority = request->Settings.Priority;
+    if (request->Settings.HasPosition) {
+        const float dx = request->Settings.Position.x - m_viewPosition.x;
+        const float dy = request->Settings.Position.y - m_viewPosition.y;
+        const float dz = request->Settings.Position.z - m_viewPosition.z;
+
+        priority += sqrt(dx * dx + dy * dy + dz * dz) / m_distanceScale;
+    }
+
+    return priority;
+}
+
+void dbasic::AssetStreamer::Decode(Request *request) {
+    if (request->Type == RequestType::Texture) {
+        std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8_conv;
+        const std::string path = utf8_conv.to_bytes(request->Path);
+
+        int channels;
+        request->Pixels = stbi_load(path.c_str(), &request->Width, &request->Height, &channels, 4);
+        if (request->Pixels == nullptr) {
+            request->Result = ysError::CouldNotOpenTexture;
+            return;
+        }
+
+        request->UploadSize = request->Width * request->Height * 4;
+    }
+    else if (request->Type == RequestType::SceneFile) {
+        const std::wstring path = request->Path + L".ysce";
+
+        request->Result = request->SceneFile.Open(path.c_str());
+        if (request->Result != ysError::None) return;
+
+        // Fault the pages in here rather than on the render thread
+        const char *data = request->SceneFile.GetData();
+        const size_t size = request->SceneFile.GetSize();
+
+        volatile char touch = 0;
+        for (size_t offset = 0; offset < size; offset += 4 * KB) touch += data[offset];
+
+        request->UploadSize = (int)size;
+    }
+    else if (request->Type == RequestType::AnimationFile) {
+        ysAnimationInterchangeFile animationFile;
+
+        request->Result = animationFile.Open(request->Path.c_str());
+        if (request->Result != ysError::None) return;
+
+        const int actionCount = animationFile.GetActionCount();
+        for (int i = 0; i < actionCount; ++i) {
+            ysAnimationAction *action = ysAllocator::TypeAllocate<ysAnimationAction, 1>();
+            action->SetAlignment(1);
+            request->Actions.push_back(action);
+
+            request->Result = animationFile.ReadAction(action);
+            if (request->Result != ysError::None) break;
+        }
+
+        animationFile.Close();
+    }
+#if defined(_WIN64)
+    else if (request->Type == RequestType::AudioFile) {
+        request->WaveFile = new ysWindowsAudioWaveFile;
+
+        if (request->WaveFile->OpenFile(request->Path.c_str()) != ysAudioFile::Error::None ||
+            request->WaveFile->InitializeInternalBuffer(request->WaveFile->GetSampleCount()) != ysAudioFile::Error::None ||
+            request->WaveFile->FillBuffer(0) != ysAudioFile::Error::None)
+        {
+            request->Result = ysError::CouldNotOpenFile;
+            return;
+        }
+
+        request->UploadSize = request->WaveFile->GetAudioParameters()->GetSizeFromSamples(
+            request->WaveFile->GetSampleCount());
+    }
+#endif /* Windows */
+}
+
+ysError dbasic::AssetStreamer::Upload(Request *request) {
+    YDS_ERROR_DECLARE("Upload");
+
+    if (request->Result != ysError::None) return YDS_ERROR_RETURN(request->Result);
+
+    if (request->Type == RequestType::Texture) {
+        // Same texture setup as DeltaEngine::LoadTexture(), only the file
+        // has already been decoded
+        ysTexture *texture = nullptr;
+        YDS_NESTED_ERROR_CALL(m_manager->m_engine->GetDevice()->CreateTexture(
+            &texture, request->Path.c_str(), request->Width, request->Height, request->Pixels));
+
+        TextureAsset *newTextureAsset = m_manager->m_textures.NewGeneric<TextureAsset>();
+        newTextureAsset->SetName(request->Name);
+        newTextureAsset->SetTexture(texture);
+    }
+    else if (request->Type == RequestType::SceneFile) {
+        YDS_NESTED_ERROR_CALL(m_manager->LoadSceneFile(
+            &request->SceneFile, request->Path.c_str(), request->PlaceInVram, request->PlaceInRam));
+    }
+    else if (request->Type == RequestType::AnimationFile) {
+        for (ysAnimationAction *action : request->Actions) m_manager->m_actions.Add(action);
+        request->Actions.clear();
+    }
+#if defined(_WIN64)
+    else if (request->Type == RequestType::AudioFile) {
+        ysWindowsAudioWaveFile *waveFile = request->WaveFile;
+
+        ysAudioBuffer *newBuffer = nullptr;
+        YDS_NESTED_ERROR_CALL(m_manager->m_engine->GetAudioDevice()->CreateBuffer(
+            waveFile->GetAudioParameters(), waveFile->GetSampleCount(), &newBuffer));
+        YDS_NESTED_ERROR_CALL(newBuffer->EditBuffer((void *)waveFile->GetBuffer()));
+
+        AudioAsset *newAsset = m_manager->m_audioAssets.New();
+        newAsset->SetBuffer(newBuffer);
+        newAsset->SetName(request->Name.c_str());
+    }
+#endif /* Windows */
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+void dbasic::AssetStreamer::Finish(Request *request) {
+    const ysError result = Upload(request);
+    const Callback callback = request->Settings.OnComplete;
+    const Handle handle = request->Id;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        request->State = (result == ysError::None) ? Status::Complete : Status::Failed;
+        if (result == ysError::None) ++m_completed;
+        else ++m_failed;
+
+        m_finished[handle] = request->State;
+        m_requests.erase(handle);
+
+        // Handles only grow so the oldest outcomes are at the front
+        while ((int)m_finished.size() > FinishedHistory) m_finished.erase(m_finished.begin());
+    }
+
+    Release(request);
+
+    if (callback) callback(handle, result);
+}
+
+void dbasic::AssetStreamer::Release(Request *request) {
+    if (request->Pixels != nullptr) stbi_image_free(request->Pixels);
+    request->SceneFile.Close();
+
+    // Actions that were never handed to the asset manager
+    for (ysAnimationAction *action : request->Actions) ysAllocator::TypeFree<ysAnimationAction>(action);
+
+#if defined(_WIN64)
+    if (request->WaveFile != nullptr) {
+        request->WaveFile->CloseFile();
+        delete request->WaveFile;
+    }
+#endif /* Windows */
+
+    delete request;
+}
+
+ysError dbasic::AssetStreamer::Update() {
+    YDS_ERROR_DECLARE("Update");
+    YS_PROFILE_ZONE("AssetStreamer::Update");
+
+    std::vector<Handle> uploads;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        std::sort(m_decoded.begin(), m_decoded.end(),
+            [this](const Request *a, const Request *b) {
+                return GetEffectivePriority(a) < GetEffectivePriority(b);
+            });
+
+        int budget = m_uploadBudget;
+        int taken = 0;
+        const int decodedCount = (int)m_decoded.size();
+        for (; taken < decodedCount; ++taken) {
+            if (taken > 0 && m_decoded[taken]->UploadSize > budget) break;
+
+            budget -= m_decoded[taken]->UploadSize;
+            uploads.push_back(m_decoded[taken]->Id);
+        }
+
+        m_decoded.erase(m_decoded.begin(), m_decoded.begin() + taken);
+    }
+
+    // Failed uploads are reported through the callback and status instead.
+    // A callback can Wait() on a request that was taken here, in which case
+    // it is already finished by the time the loop gets to it.
+    for (const Handle handle : uploads) {
+        Request *request = nullptr;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            auto entry = m_requests.find(handle);
+            if (entry == m_requests.end()) continue;
+
+            request = entry->second;
+        }
+
+        Finish(request);
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::AssetStreamer::Wait(Handle handle) {
+    YDS_ERROR_DECLARE("Wait");
+
+    Request *request = nullptr;
+
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        auto entry = m_requests.find(handle);
+        if (entry == m_requests.end()) {
+            return YDS_ERROR_RETURN(
+                (m_finished.count(handle) == 1) ? ysError::None : ysError::InvalidParameter);
+        }
+
+        request = entry->second;
+        m_requestDecoded.wait(lock, [request] { return request->State == Status::Uploading; });
+
+        // Requests that Update() has already taken are not in the list but
+        // are only finished on this thread, so it is safe to finish it here
+        auto decoded = std::find(m_decoded.begin(), m_decoded.end(), request);
+        if (decoded != m_decoded.end()) m_decoded.erase(decoded);
+    }
+
+    Finish(request);
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+dbasic::AssetStreamer::Status dbasic::AssetStreamer::GetStatus(Handle handle) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto entry = m_requests.find(handle);
+    if (entry != m_requests.end()) return entry->second->State;
+
+    auto finished = m_finished.find(handle);
+    return (finished != m_finished.end()) ? finished->second : Status::Invalid;
+}
+
+dbasic::AssetStreamer::Progress dbasic::AssetStreamer::GetProgress() {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    Progress progress;
+    progress.Requested = m_requested;
+    progress.Completed = m_completed;
+    progress.Failed = m_failed;
+    progress.Fraction = (m_requested > 0)
+        ? (float)(m_completed + m_failed) / m_requested
+        : 1.0f;
+
+    return progress;
+}
+
+void dbasic::AssetStreamer::SetPriority(Handle handle, float priority) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto entry = m_requests.find(handle);
+    if (entry != m_requests.end()) entry->second->Settings.Priority = priority;
+}
+
+void dbasic::AssetStreamer::SetViewPosition(const ysVector3 &position) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_viewPosition = position;
+}
+
+void dbasic::AssetStreamer::SetDistanceScale(float scale) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_distanceScale = scale;
+}
@@ -10,7 +10,9 @@
 #include <stb/stb_rect_pack.h>
 #include <stb/stb_truetype.h>
 
+#include <algorithm>
 #include <assert.h>
+#include <string.h>
 
 const std::string dbasic::DeltaEngine::FrameBreakdownFull = "Frame Full";
 const std::string dbasic::DeltaEngine::FrameBreakdownRenderScene = "Scene";
@@ -21,9 +23,7 @@ dbasic::DeltaEngine::DeltaEngine() {
     m_device = nullptr;
 
     m_audioDevice = nullptr;
-#if defined(_WIN64)
     m_timingSystem = nullptr;
-#endif /* Windows */
     m_eventHandler = nullptr;
     m_consoleEnabled = true;
 
@@ -44,6 +44,8 @@ dbasic::DeltaEngine::DeltaEngine() {
     m_vertexSkinnedShader = nullptr;
     m_saqPixelShader = nullptr;
     m_saqVertexShader = nullptr;
+    m_particleVertexShader = nullptr;
+    m_particlePixelShader = nullptr;
     m_shaderProgram = nullptr;
     m_shaderSet = nullptr;
 
@@ -52,11 +54,13 @@ dbasic::DeltaEngine::DeltaEngine() {
 
     m_consoleProgram = nullptr;
     m_skinnedShaderProgram = nullptr;
+    m_particleShaderProgram = nullptr;
 
     m_skinnedInputLayout = nullptr;
     m_inputLayout = nullptr;
     m_consoleInputLayout = nullptr;
     m_saqInputLayout = nullptr;
+    m_particleInputLayout = nullptr;
 
     m_initialized = false;
 
@@ -71,6 +75,7 @@ dbasic::DeltaEngine::DeltaEngine() {
     m_mainMouse = nullptr;
 
     m_drawQueue = new ysExpandingArray<DrawCall, 256>[MaxLayers];
+    m_frameAllocatorIndex = 0;
 
     m_cursorHidden = false;
     m_cursorPositionLocked = false;
@@ -87,16 +92,20 @@ dbasic::DeltaEngine::~DeltaEngine() {
     assert(m_vertexSkinnedShader == nullptr);
     assert(m_consoleVertexShader == nullptr);
     assert(m_saqVertexShader == nullptr);
+    assert(m_particleVertexShader == nullptr);
     assert(m_pixelShader == nullptr);
     assert(m_saqPixelShader == nullptr);
     assert(m_consolePixelShader == nullptr);
+    assert(m_particlePixelShader == nullptr);
     assert(m_shaderProgram == nullptr);
     assert(m_consoleProgram == nullptr);
     assert(m_skinnedShaderProgram == nullptr);
+    assert(m_particleShaderProgram == nullptr);
     assert(m_inputLayout == nullptr);
     assert(m_skinnedInputLayout == nullptr);
     assert(m_consoleInputLayout == nullptr);
     assert(m_saqInputLayout == nullptr);
+    assert(m_particleInputLayout == nullptr);
     assert(m_mainKeyboard == nullptr);
     assert(m_inputSystem == nullptr);
     assert(m_mainMouse == nullptr);
@@ -174,6 +183,14 @@ dbasic::DeltaEngine::CreateGameWindow(const GameEngineSettings &settings) {
     m_uiRenderer.SetEngine(this);
     YDS_NESTED_ERROR_CALL(m_uiRenderer.Initialize(32768));
 
+    // Initialize particle renderer
+    m_particleRenderer.SetEngine(this);
+    YDS_NESTED_ERROR_CALL(m_particleRenderer.Initialize(65536));
+
+    // Per-frame allocations
+    m_frameAllocators[0].CreateBuffer(settings.FrameAllocatorSize);
+    m_frameAllocators[1].CreateBuffer(settings.FrameAllocatorSize);
+
     // Initialize the console
     m_console.SetEngine(this);
     m_console.SetRenderer(&m_uiRenderer);
@@ -184,13 +201,12 @@ dbasic::DeltaEngine::CreateGameWindow(const GameEngineSettings &settings) {
                                             settings.ShaderCompiledDirectory,
                                             settings.CompileShaders));
 
-#if defined(_WIN64)
     // Timing System
     m_timingSystem = ysTimingSystem::Get();
     m_timingSystem->Initialize();
-#endif /* Windows */
 
     InitializeBreakdownTimer(settings.LoggingDirectory);
+    ysProfiler::Get()->SetThreadName("Main");
 
     m_initialized = true;
 
@@ -206,6 +222,7 @@ ysError dbasic::DeltaEngine::StartFrame() {
     YDS_ERROR_DECLARE("StartFrame");
 
     m_uiRenderer.Reset();
+    m_particleRenderer.Reset();
 
     m_breakdownTimer.WriteLastFrameToLogFile();
     m_breakdownTimer.StartFrame();
@@ -214,9 +231,7 @@ ysError dbasic::DeltaEngine::StartFrame() {
     m_audioDevice->UpdateAudioSources();
     m_windowSystem->ProcessMessages();
     
-#if defined(_WIN64)
     m_timingSystem->Update();
-#endif /* Windows */
 
     // TEMP
     if (IsKeyDown(ysKey::Code::B)) {
@@ -273,6 +288,10 @@ ysError dbasic::DeltaEngine::Destroy() {
 
     YDS_NESTED_ERROR_CALL(GetConsole()->Destroy());
     YDS_NESTED_ERROR_CALL(GetUiRenderer()->Destroy());
+    YDS_NESTED_ERROR_CALL(GetParticleRenderer()->Destroy());
+
+    m_frameAllocators[0].Destroy();
+    m_frameAllocators[1].Destroy();
 
     YDS_NESTED_ERROR_CALL(m_device->DestroyGPUBuffer(m_mainIndexBuffer));
     YDS_NESTED_ERROR_CALL(m_device->DestroyGPUBuffer(m_mainVertexBuffer));
@@ -283,20 +302,25 @@ ysError dbasic::DeltaEngine::Destroy() {
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_vertexSkinnedShader));
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_consoleVertexShader));
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_saqVertexShader));
+    YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_particleVertexShader));
 
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_pixelShader));
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_saqPixelShader));
     YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_consolePixelShader));
+    YDS_NESTED_ERROR_CALL(m_device->DestroyShader(m_particlePixelShader));
 
     YDS_NESTED_ERROR_CALL(m_device->DestroyShaderProgram(m_shaderProgram));
     YDS_NESTED_ERROR_CALL(m_device->DestroyShaderProgram(m_consoleProgram));
     YDS_NESTED_ERROR_CALL(
             m_device->DestroyShaderProgram(m_skinnedShaderProgram));
+    YDS_NESTED_ERROR_CALL(
+            m_device->DestroyShaderProgram(m_particleShaderProgram));
 
     YDS_NESTED_ERROR_CALL(m_device->DestroyInputLayout(m_inputLayout));
     YDS_NESTED_ERROR_CALL(m_device->DestroyInputLayout(m_skinnedInputLayout));
     YDS_NESTED_ERROR_CALL(m_device->DestroyInputLayout(m_consoleInputLayout));
     YDS_NESTED_ERROR_CALL(m_device->DestroyInputLayout(m_saqInputLayout));
+    YDS_NESTED_ERROR_CALL(m_device->DestroyInputLayout(m_particleInputLayout));
 
     YDS_NESTED_ERROR_CALL(m_device->DestroyRenderTarget(m_mainRenderTarget));
     YDS_NESTED_ERROR_CALL(
@@ -336,6 +360,10 @@ ysError dbasic::DeltaEngine::InitializeDefaultShaders(DefaultShaders *shaders,
     YDS_NESTED_ERROR_CALL(shaders->Initialize(shaderSet, m_mainRenderTarget,
                                               m_shaderProgram, m_inputLayout));
 
+    // Particles are drawn in the main stage with its diffuse texture input
+    m_particleRenderer.SetTextureInput(shaders->GetMainStage(),
+                                       shaders->GetDiffuseTextureHandle());
+
     return YDS_ERROR_RETURN(ysError::None);
 }
 
@@ -352,8 +380,10 @@ ysError dbasic::DeltaEngine::InitializeConsoleShaders(ShaderSet *shaderSet) {
 dbasic::DeltaEngine::DrawCall *
 dbasic::DeltaEngine::NewDrawCall(int layer, int objectDataSize) {
     DrawCall *newCall = &m_drawQueue[layer].New();
+    if (m_drawQueue[layer].GetNumObjects() == 1) { m_activeLayers.New() = layer; }
+
     if (newCall != nullptr) {
-        newCall->ObjectData = malloc(objectDataSize);
+        newCall->ObjectData = AllocateFrameData(objectDataSize);
         newCall->ObjectDataSize = objectDataSize;
     }
 
@@ -428,6 +458,17 @@ dbasic::DeltaEngine::InitializeShaders(const wchar_t *shaderDirectory,
                 (basePath + L"/hlsl/delta_saq_shader.fx").c_str(),
                 (compiledPath + L"ps_saq.fx.compiled").c_str(), "PS_SAQ",
                 compile));
+
+        YDS_NESTED_ERROR_CALL(m_device->CreateVertexShader(
+                &m_particleVertexShader,
+                (basePath + L"/hlsl/delta_particle_shader.fx").c_str(),
+                (compiledPath + L"vs_particle.fx.compiled").c_str(),
+                "VS_PARTICLE", compile));
+        YDS_NESTED_ERROR_CALL(m_device->CreatePixelShader(
+                &m_particlePixelShader,
+                (basePath + L"/hlsl/delta_particle_shader.fx").c_str(),
+                (compiledPath + L"ps_particle.fx.compiled").c_str(),
+                "PS_PARTICLE", compile));
     } else if (m_device->GetAPI() == ysContextObject::DeviceAPI::OpenGL4_0) {
         YDS_NESTED_ERROR_CALL(m_device->CreateVertexShader(
                 &m_vertexShader,
@@ -461,6 +502,17 @@ dbasic::DeltaEngine::InitializeShaders(const wchar_t *shaderDirectory,
                 (basePath + L"/glsl/delta_saq_shader.frag").c_str(),
                 (compiledPath + L"ps_saq.frag.compiled").c_str(), "PS_SAQ",
                 compile));
+
+        YDS_NESTED_ERROR_CALL(m_device->CreateVertexShader(
+                &m_particleVertexShader,
+                (basePath + L"/glsl/delta_particle_shader.vert").c_str(),
+                (compiledPath + L"vs_particle.vert.compiled").c_str(),
+                "VS_PARTICLE", compile));
+        YDS_NESTED_ERROR_CALL(m_device->CreateVertexShader(
+                &m_particlePixelShader,
+                (basePath + L"/glsl/delta_particle_shader.frag").c_str(),
+                (compiledPath + L"ps_particle.frag.compiled").c_str(),
+                "PS_PARTICLE", compile));
     }
 
     m_skinnedFormat.AddChannel(
@@ -489,6 +541,8 @@ dbasic::DeltaEngine::InitializeShaders(const wchar_t *shaderDirectory,
             "NORMAL", sizeof(float) * (4 + 2),
             ysRenderGeometryChannel::ChannelFormat::R32G32B32A32_FLOAT);
 
+    ParticleRenderer::GetInstanceFormat(&m_particleInstanceFormat);
+
     m_consoleVertexFormat.AddChannel(
             "POSITION", 0,
             ysRenderGeometryChannel::ChannelFormat::R32G32_FLOAT);
@@ -508,6 +562,9 @@ dbasic::DeltaEngine::InitializeShaders(const wchar_t *shaderDirectory,
                                                       &m_consoleVertexFormat));
     YDS_NESTED_ERROR_CALL(m_device->CreateInputLayout(
             &m_saqInputLayout, m_saqVertexShader, &m_standardFormat));
+    YDS_NESTED_ERROR_CALL(m_device->CreateInputLayout(
+            &m_particleInputLayout, m_particleVertexShader, &m_standardFormat,
+            &m_particleInstanceFormat));
 
     YDS_NESTED_ERROR_CALL(m_device->CreateShaderProgram(&m_shaderProgram));
     YDS_NESTED_ERROR_CALL(
@@ -531,6 +588,14 @@ dbasic::DeltaEngine::InitializeShaders(const wchar_t *shaderDirectory,
             m_device->AttachShader(m_consoleProgram, m_consolePixelShader));
     YDS_NESTED_ERROR_CALL(m_device->LinkProgram(m_consoleProgram));
 
+    YDS_NESTED_ERROR_CALL(
+            m_device->CreateShaderProgram(&m_particleShaderProgram));
+    YDS_NESTED_ERROR_CALL(m_device->AttachShader(m_particleShaderProgram,
+                                                 m_particleVertexShader));
+    YDS_NESTED_ERROR_CALL(m_device->AttachShader(m_particleShaderProgram,
+                                                 m_particlePixelShader));
+    YDS_NESTED_ERROR_CALL(m_device->LinkProgram(m_particleShaderProgram));
+
     // Create shader controls
     YDS_NESTED_ERROR_CALL(m_device->CreateConstantBuffer(
             &m_consoleShaderObjectVariablesBuffer,
@@ -779,7 +844,6 @@ void dbasic::DeltaEngine::GetOsMousePos(int *x, int *y) {
     }
 }
 
-#if defined(_WIN64)
 float dbasic::DeltaEngine::GetFrameLength() {
     return (float) (m_timingSystem->GetFrameDuration());
 }
@@ -800,7 +864,6 @@ void dbasic::DeltaEngine::SetPaused(bool paused) {
         m_timingSystem->RestartFrame();
     }
 }
-#endif /* Windows */
 
 int dbasic::DeltaEngine::GetScreenWidth() const {
     return m_gameWindow->GetGameWidth();
@@ -862,13 +925,14 @@ ysError dbasic::DeltaEngine::DrawAxis(StageEnableFlags flags, int layer) {
 }
 
 ysError dbasic::DeltaEngine::DrawModel(StageEnableFlags flags,
-                                       ModelAsset *model, int layer) {
+                                       ModelAsset *model, int layer,
+                                       bool opaque) {
     YDS_ERROR_DECLARE("DrawModel");
     YDS_NESTED_ERROR_CALL(DrawGeneric(
             flags, model->GetIndexBuffer(), model->GetVertexBuffer(),
             m_shaderProgram, m_inputLayout, model->GetVertexSize(),
             model->GetBaseIndex(), model->GetBaseVertex(),
-            model->GetFaceCount(), true, layer));
+            model->GetFaceCount(), true, layer, opaque));
     return YDS_ERROR_RETURN(ysError::None);
 }
 
@@ -896,13 +960,14 @@ ysError dbasic::DeltaEngine::DrawGeneric(
         StageEnableFlags flags, ysGPUBuffer *indexBuffer,
         ysGPUBuffer *vertexBuffer, ysShaderProgram *shader,
         ysInputLayout *inputLayout, int vertexSize, int baseIndex,
-        int baseVertex, int faceCount, bool depthTest, int layer) {
+        int baseVertex, int faceCount, bool depthTest, int layer,
+        bool opaque) {
     YDS_ERROR_DECLARE("DrawGeneric");
 
     YDS_NESTED_ERROR_CALL(DrawGeneric(flags, indexBuffer, vertexBuffer, nullptr,
                                       shader, inputLayout, vertexSize, 0,
                                       baseIndex, baseVertex, faceCount, 0, 0,
-                                      depthTest, layer));
+                                      depthTest, layer, opaque));
     return YDS_ERROR_RETURN(ysError::None);
 }
 
@@ -911,7 +976,8 @@ ysError dbasic::DeltaEngine::DrawGeneric(
         ysGPUBuffer *vertexBuffer, ysGPUBuffer *instanceBuffer,
         ysShaderProgram *shader, ysInputLayout *inputLayout, int vertexSize,
         int instanceDataSize, int baseIndex, int baseVertex, int faceCount,
-        int instanceCount, int baseInstance, bool depthTest, int layer) {
+        int instanceCount, int baseInstance, bool depthTest, int layer,
+        bool opaque) {
     YDS_ERROR_DECLARE("DrawGeneric");
 
     DrawCall *newCall = NewDrawCall(layer, m_shaderSet->GetObjectDataSize());
@@ -933,11 +999,35 @@ ysError dbasic::DeltaEngine::DrawGeneric(
         newCall->Flags = flags;
         newCall->DepthTest = depthTest;
         newCall->Lines = false;
+        newCall->Opaque = opaque;
     }
 
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+ysError dbasic::DeltaEngine::DrawParticles(
+        StageEnableFlags flags, const dphysics::ParticleSystem *system,
+        ysShaderProgram *shader, ysInputLayout *inputLayout, int layer) {
+    YDS_ERROR_DECLARE("DrawParticles");
+
+    YDS_NESTED_ERROR_CALL(m_particleRenderer.Draw(flags, system, shader,
+                                                  inputLayout, layer));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::DeltaEngine::DrawParticles(
+        StageEnableFlags flags, const dphysics::ParticleSystem *system,
+        int layer) {
+    YDS_ERROR_DECLARE("DrawParticles");
+
+    YDS_NESTED_ERROR_CALL(m_particleRenderer.Draw(flags, system,
+                                                  m_particleShaderProgram,
+                                                  m_particleInputLayout, layer));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
 ysError dbasic::DeltaEngine::DrawGenericLines(StageEnableFlags flags,
                                               ysGPUBuffer *indexBuffer,
                                               ysGPUBuffer *vertexBuffer,
@@ -968,8 +1058,57 @@ ysError dbasic::DeltaEngine::DrawGenericLines(StageEnableFlags flags,
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+namespace {
+
+    // Orders calls so that ones sharing a shader, then an input layout and
+    // then buffers end up next to each other
+    bool DrawCallStateLess(const dbasic::DeltaEngine::DrawCall *a,
+                           const dbasic::DeltaEngine::DrawCall *b) {
+        const uintptr_t keyA[] = {
+                (uintptr_t) a->Shader, (uintptr_t) a->InputLayout,
+                (uintptr_t) a->IndexBuffer, (uintptr_t) a->VertexBuffer,
+                (uintptr_t) a->InstanceBuffer, (uintptr_t) a->Lines};
+        const uintptr_t keyB[] = {
+                (uintptr_t) b->Shader, (uintptr_t) b->InputLayout,
+                (uintptr_t) b->IndexBuffer, (uintptr_t) b->VertexBuffer,
+                (uintptr_t) b->InstanceBuffer, (uintptr_t) b->Lines};
+
+        return std::lexicographical_compare(keyA, keyA + 6, keyB, keyB + 6);
+    }
+
+    bool SameObjectData(const dbasic::DeltaEngine::DrawCall *a,
+                        const dbasic::DeltaEngine::DrawCall *b) {
+        return a->ObjectDataSize == b->ObjectDataSize &&
+               memcmp(a->ObjectData, b->ObjectData, a->ObjectDataSize) == 0;
+    }
+
+    // True if b draws further instances of the same geometry as a with the
+    // same object data, so that both can be issued as one instanced draw
+    bool CanMergeInstances(const dbasic::DeltaEngine::DrawCall *a,
+                           int instanceCount,
+                           const dbasic::DeltaEngine::DrawCall *b) {
+        return b->InstanceBuffer == a->InstanceBuffer &&
+               b->InstanceDataSize == a->InstanceDataSize &&
+               b->BaseInstance == a->BaseInstance + instanceCount &&
+               b->Flags == a->Flags && b->Shader == a->Shader &&
+               b->InputLayout == a->InputLayout &&
+               b->IndexBuffer == a->IndexBuffer &&
+               b->VertexBuffer == a->VertexBuffer &&
+               b->VertexSize == a->VertexSize &&
+               b->BaseIndex == a->BaseIndex &&
+               b->BaseVertex == a->BaseVertex &&
+               b->PrimitiveCount == a->PrimitiveCount &&
+               b->DepthTest == a->DepthTest && !b->Lines &&
+               SameObjectData(a, b);
+    }
+
+}// namespace
+
 ysError dbasic::DeltaEngine::ExecuteDrawQueue() {
     YDS_ERROR_DECLARE("ExecuteDrawQueue");
+    YS_PROFILE_ZONE("DeltaEngine::ExecuteDrawQueue");
+
+    SortDrawQueue();
 
     const int stageCount = m_shaderSet->GetStageCount();
     for (int i = 0; i < stageCount; ++i) { ExecuteShaderStage(i); }
@@ -977,6 +1116,40 @@ ysError dbasic::DeltaEngine::ExecuteDrawQueue() {
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+void dbasic::DeltaEngine::SortDrawQueue() {
+    const int layerCount = m_activeLayers.GetNumObjects();
+    int *layers = m_activeLayers.GetBuffer();
+    std::sort(layers, layers + layerCount);
+
+    m_sortedDrawCalls.clear();
+    for (int i = 0; i < layerCount; ++i) {
+        ysExpandingArray<DrawCall, 256> &queue = m_drawQueue[layers[i]];
+        SortDrawCalls(queue.GetBuffer(), queue.GetNumObjects(),
+                      m_sortedDrawCalls);
+    }
+}
+
+void dbasic::DeltaEngine::SortDrawCalls(const DrawCall *calls, int callCount,
+                                        std::vector<const DrawCall *> &sorted) {
+    int runStart = (int) sorted.size();
+    for (int i = 0; i < callCount; ++i) {
+        const DrawCall *call = &calls[i];
+
+        // Blending depends on what was drawn before, and without depth
+        // testing so does the result
+        if (!call->Opaque || !call->DepthTest) {
+            std::stable_sort(sorted.begin() + runStart, sorted.end(),
+                             DrawCallStateLess);
+            runStart = (int) sorted.size() + 1;
+        }
+
+        sorted.push_back(call);
+    }
+
+    std::stable_sort(sorted.begin() + runStart, sorted.end(),
+                     DrawCallStateLess);
+}
+
 ysError dbasic::DeltaEngine::ExecuteShaderStage(int stageIndex) {
     YDS_ERROR_DECLARE("ExecuteShaderStage");
 
@@ -984,54 +1157,101 @@ ysError dbasic::DeltaEngine::ExecuteShaderStage(int stageIndex) {
     if (stage->GetType() == ShaderStage::Type::FullPass) {
         stage->BindScene();
 
-        for (int i = 0; i < MaxLayers; i++) {
-            const int objectsAtLayer = m_drawQueue[i].GetNumObjects();
-            ;
-            for (int j = 0; j < objectsAtLayer; j++) {
-                const DrawCall *call = &m_drawQueue[i][j];
-                if (call == nullptr) continue;
-                if (!stage->CheckFlags(call->Flags)) continue;
-
+        // State last set on the device, only valid once something was bound
+        bool stateBound = false;
+        bool depthTest = false;
+        ysShaderProgram *shader = nullptr;
+        ysInputLayout *inputLayout = nullptr;
+        ysGPUBuffer *indexBuffer = nullptr;
+        ysGPUBuffer *vertexBuffer = nullptr;
+        ysGPUBuffer *instanceBuffer = nullptr;
+        int vertexSize = 0;
+        int instanceDataSize = 0;
+        const DrawCall *objectDataCall = nullptr;
+
+        const int callCount = (int) m_sortedDrawCalls.size();
+        for (int i = 0; i < callCount; ++i) {
+            const DrawCall *call = m_sortedDrawCalls[i];
+            if (!stage->CheckFlags(call->Flags)) continue;
+
+            if (objectDataCall == nullptr ||
+                !SameObjectData(call, objectDataCall)) {
                 m_shaderSet->ReadObjectData(call->ObjectData, stageIndex,
                                             call->ObjectDataSize);
                 stage->BindObject();
+                objectDataCall = call;
+            }
+
+            // Calls without geometry draw the screen quad with whichever
+            // shader is active
+            const bool quad = call->IndexBuffer == nullptr;
+            ysGPUBuffer *callIndexBuffer =
+                    quad ? m_mainIndexBuffer : call->IndexBuffer;
+            ysGPUBuffer *callVertexBuffer =
+                    quad ? m_mainVertexBuffer : call->VertexBuffer;
+            const int callVertexSize =
+                    quad ? (int) sizeof(Vertex) : call->VertexSize;
+
+            if (!stateBound || call->DepthTest != depthTest) {
+                m_device->SetDepthTestEnabled(stage->GetRenderTarget(),
+                                              call->DepthTest);
+                depthTest = call->DepthTest;
+            }
+
+            if (!quad && (!stateBound || call->Shader != shader)) {
+                m_device->UseShaderProgram(call->Shader);
+                shader = call->Shader;
+            }
+
+            if (!quad && (!stateBound || call->InputLayout != inputLayout)) {
+                m_device->UseInputLayout(call->InputLayout);
+                inputLayout = call->InputLayout;
+            }
 
-                if (call->IndexBuffer != nullptr) {
-                    m_device->SetDepthTestEnabled(stage->GetRenderTarget(),
-                                                  call->DepthTest);
-
-                    m_device->UseShaderProgram(call->Shader);
-                    m_device->UseInputLayout(call->InputLayout);
-                    m_device->UseIndexBuffer(call->IndexBuffer, 0);
-                    m_device->UseVertexBuffer(call->VertexBuffer,
-                                              call->VertexSize, 0);
-                    m_device->UseInstanceBuffer(call->InstanceBuffer,
-                                                call->InstanceDataSize, 0);
-
-                    if (!call->Lines) {
-                        if (call->InstanceBuffer != nullptr) {
-                            m_device->DrawInstanced(
-                                    call->PrimitiveCount, call->BaseIndex,
-                                    call->BaseVertex, call->InstanceCount,
-                                    call->BaseInstance);
-                        } else {
-                            m_device->Draw(call->PrimitiveCount,
-                                           call->BaseIndex, call->BaseVertex);
-                        }
-                    } else {
-                        m_device->DrawLines(call->PrimitiveCount * 2,
-                                            call->BaseIndex, call->BaseVertex);
-                    }
-                } else {
-                    m_device->SetDepthTestEnabled(stage->GetRenderTarget(),
-                                                  call->DepthTest);
-
-                    m_device->UseIndexBuffer(m_mainIndexBuffer, 0);
-                    m_device->UseVertexBuffer(m_mainVertexBuffer,
-                                              sizeof(Vertex), 0);
-
-                    m_device->Draw(2, 0, 0);
+            if (!stateBound || callIndexBuffer != indexBuffer) {
+                m_device->UseIndexBuffer(callIndexBuffer, 0);
+                indexBuffer = callIndexBuffer;
+            }
+
+            if (!stateBound || callVertexBuffer != vertexBuffer ||
+                callVertexSize != vertexSize) {
+                m_device->UseVertexBuffer(callVertexBuffer, callVertexSize, 0);
+                vertexBuffer = callVertexBuffer;
+                vertexSize = callVertexSize;
+            }
+
+            if (!quad && (!stateBound || call->InstanceBuffer != instanceBuffer ||
+                          call->InstanceDataSize != instanceDataSize)) {
+                m_device->UseInstanceBuffer(call->InstanceBuffer,
+                                            call->InstanceDataSize, 0);
+                instanceBuffer = call->InstanceBuffer;
+                instanceDataSize = call->InstanceDataSize;
+            }
+
+            stateBound = true;
+
+            if (quad) {
+                m_device->Draw(2, 0, 0);
+            } else if (call->Lines) {
+                m_device->DrawLines(call->PrimitiveCount * 2, call->BaseIndex,
+                                    call->BaseVertex);
+            } else if (call->InstanceBuffer != nullptr) {
+                // Fold in following calls that continue the same instance
+                // range
+                int instanceCount = call->InstanceCount;
+                while (i + 1 < callCount &&
+                       stage->CheckFlags(m_sortedDrawCalls[i + 1]->Flags) &&
+                       CanMergeInstances(call, instanceCount,
+                                         m_sortedDrawCalls[i + 1])) {
+                    instanceCount += m_sortedDrawCalls[++i]->InstanceCount;
                 }
+
+                m_device->DrawInstanced(call->PrimitiveCount, call->BaseIndex,
+                                        call->BaseVertex, instanceCount,
+                                        call->BaseInstance);
+            } else {
+                m_device->Draw(call->PrimitiveCount, call->BaseIndex,
+                               call->BaseVertex);
             }
         }
     } else if (stage->GetType() == ShaderStage::Type::PostProcessing) {
@@ -1055,10 +1275,17 @@ ysError dbasic::DeltaEngine::ExecuteShaderStage(int stageIndex) {
 }
 
 void dbasic::DeltaEngine::ClearDrawQueue() {
-    for (int i = 0; i < MaxLayers; ++i) {
-        const int n = m_drawQueue[i].GetNumObjects();
-        for (int j = 0; j < n; ++j) { free(m_drawQueue[i][j].ObjectData); }
+    const int layerCount = m_activeLayers.GetNumObjects();
+    for (int i = 0; i < layerCount; ++i) {
+        m_drawQueue[m_activeLayers[i]].Clear();
     }
 
-    for (int i = 0; i < MaxLayers; ++i) { m_drawQueue[i].Clear(); }
+    m_activeLayers.Clear();
+    m_sortedDrawCalls.clear();
+
+    // Object data of the calls lived in the frame allocator. The other one is
+    // reset instead of this one so that data from this frame stays valid for
+    // another frame.
+    m_frameAllocatorIndex = 1 - m_frameAllocatorIndex;
+    m_frameAllocators[m_frameAllocatorIndex].Reset();
 }
@@ -0,0 +1,67 @@
+#include "../include/name_index.h"
+
+#include <algorithm>
+
+dbasic::NameIndex::NameIndex() {
+    m_count = 0;
+}
+
+dbasic::NameIndex::~NameIndex() {
+    /* void */
+}
+
+void dbasic::NameIndex::Clear() {
+    m_entries.clear();
+    m_count = 0;
+}
+
+void dbasic::NameIndex::Add(const char *name, int index) {
+    // Keep the table at most half full so that probe sequences stay short
+    if ((m_count + 1) * 2 > (int)m_entries.size()) Grow();
+
+    Insert(Hash(name), index);
+    ++m_count;
+}
+
+unsigned int dbasic::NameIndex::Hash(const char *name) {
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (const char *c = name; *c != '\0'; ++c) {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+void dbasic::NameIndex::Insert(unsigned int hash, int index) {
+    const unsigned int mask = (unsigned int)m_entries.size() - 1;
+    unsigned int slot = hash & mask;
+    while (m_entries[slot].Index != InvalidIndex) {
+        slot = (slot + 1) & mask;
+    }
+
+    m_entries[slot] = { hash, index };
+}
+
+void dbasic::NameIndex::Grow() {
+    std::vector<Entry> entries;
+    entries.swap(m_entries);
+
+    const size_t capacity = entries.empty() ? 64 : entries.size() * 2;
+    m_entries.resize(capacity, { 0, InvalidIndex });
+
+    // Reinsert in index order so that equal names keep their order
+    std::vector<Entry> ordered;
+    ordered.reserve(m_count);
+    for (const Entry &entry : entries) {
+        if (entry.Index != InvalidIndex) ordered.push_back(entry);
+    }
+
+    std::sort(ordered.begin(), ordered.end(),
+        [](const Entry &a, const Entry &b) { return a.Index < b.Index; });
+
+    for (const Entry &entry : ordered) {
+        Insert(entry.Hash, entry.Index);
+    }
+}
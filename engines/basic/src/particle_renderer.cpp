@@ -0,0 +1,139 @@
+#include "../include/particle_renderer.h"
+
+#include "../include/delta_basic_engine.h"
+
+dbasic::ParticleRenderer::ParticleRenderer() : ysObject("ParticleRenderer") {
+    m_engine = nullptr;
+
+    m_quadVertexBuffer = nullptr;
+    m_quadIndexBuffer = nullptr;
+    m_instanceBuffer = nullptr;
+
+    m_defaultTexture = nullptr;
+
+    m_textureStage = nullptr;
+    m_textureHandle = -1;
+
+    m_capacity = 0;
+    m_instanceOffset = 0;
+
+    m_instances = nullptr;
+}
+
+dbasic::ParticleRenderer::~ParticleRenderer() {
+    assert(m_quadVertexBuffer == nullptr);
+    assert(m_quadIndexBuffer == nullptr);
+    assert(m_instanceBuffer == nullptr);
+    assert(m_defaultTexture == nullptr);
+}
+
+ysError dbasic::ParticleRenderer::Initialize(int capacity) {
+    YDS_ERROR_DECLARE("Initialize");
+
+    YDS_NESTED_ERROR_CALL(InitializeGeometry(capacity));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::ParticleRenderer::Reset() {
+    YDS_ERROR_DECLARE("Reset");
+
+    m_instanceOffset = 0;
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::ParticleRenderer::Destroy() {
+    YDS_ERROR_DECLARE("Destroy");
+
+    if (m_engine != nullptr) {
+        m_engine->GetDevice()->DestroyGPUBuffer(m_quadIndexBuffer);
+        m_engine->GetDevice()->DestroyGPUBuffer(m_quadVertexBuffer);
+        m_engine->GetDevice()->DestroyGPUBuffer(m_instanceBuffer);
+        m_engine->GetDevice()->DestroyTexture(m_defaultTexture);
+
+        delete[] m_instances;
+        m_instances = nullptr;
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError dbasic::ParticleRenderer::Draw(
+    StageEnableFlags flags,
+    const dphysics::ParticleSystem *system,
+    ysShaderProgram *shader,
+    ysInputLayout *inputLayout,
+    int layer)
+{
+    YDS_ERROR_DECLARE("Draw");
+
+    dphysics::ParticleInstance *instances = m_instances + m_instanceOffset;
+    const int count = system->WriteInstances(instances, m_capacity - m_instanceOffset);
+    if (count == 0) return YDS_ERROR_RETURN(ysError::None);
+
+    YDS_NESTED_ERROR_CALL(m_engine->GetDevice()->EditBufferDataRange(
+            m_instanceBuffer, (char *) instances,
+            sizeof(dphysics::ParticleInstance) * count,
+            sizeof(dphysics::ParticleInstance) * m_instanceOffset));
+
+    // The draw call captures the stage's textures when it is queued, so
+    // a texture is always bound rather than leaving whatever was drawn last
+    if (m_textureStage != nullptr) {
+        ysTexture *texture = system->GetTexture();
+        if (texture == nullptr) texture = m_defaultTexture;
+
+        YDS_NESTED_ERROR_CALL(m_textureStage->BindTexture(texture, m_textureHandle));
+    }
+
+    YDS_NESTED_ERROR_CALL(m_engine->DrawGeneric(
+            flags, m_quadIndexBuffer, m_quadVertexBuffer, m_instanceBuffer,
+            shader, inputLayout, sizeof(Vertex),
+            sizeof(dphysics::ParticleInstance), 0, 0, 2, count,
+            m_instanceOffset, true, layer));
+
+    m_instanceOffset += count;
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+void dbasic::ParticleRenderer::GetInstanceFormat(ysRenderGeometryFormat *format) {
+    format->AddChannel(
+            "INSTANCE_POSITION", 0,
+            ysRenderGeometryChannel::ChannelFormat::R32G32B32A32_FLOAT);
+    format->AddChannel(
+            "INSTANCE_DATA", sizeof(float) * 4,
+            ysRenderGeometryChannel::ChannelFormat::R32G32B32A32_FLOAT);
+}
+
+ysError dbasic::ParticleRenderer::InitializeGeometry(int capacity) {
+    YDS_ERROR_DECLARE("InitializeGeometry");
+
+    m_capacity = capacity;
+    m_instances = new dphysics::ParticleInstance[m_capacity]();
+
+    Vertex vertexData[] = {
+            {{-1.0f, 1.0f, 0.0f, 1.0f}, {0.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 0.0f}},
+            {{1.0f, 1.0f, 0.0f, 1.0f}, {1.0f, 1.0f}, {0.0f, 0.0f, 1.0f, 0.0f}},
+            {{1.0f, -1.0f, 0.0f, 1.0f}, {1.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}},
+            {{-1.0f, -1.0f, 0.0f, 1.0f},
+             {0.0f, 0.0f},
+             {0.0f, 0.0f, 1.0f, 0.0f}}};
+
+    unsigned short indices[] = {2, 1, 0, 3, 2, 0};
+
+    ysDevice *device = m_engine->GetDevice();
+
+    YDS_NESTED_ERROR_CALL(device->CreateVertexBuffer(
+            &m_quadVertexBuffer, sizeof(vertexData), (char *) vertexData));
+    YDS_NESTED_ERROR_CALL(device->CreateIndexBuffer(
+            &m_quadIndexBuffer, sizeof(indices), (char *) indices));
+    YDS_NESTED_ERROR_CALL(device->CreateVertexBuffer(
+            &m_instanceBuffer, sizeof(dphysics::ParticleInstance) * m_capacity,
+            (char *) m_instances));
+
+    const unsigned char white[] = {0xFF, 0xFF, 0xFF, 0xFF};
+    YDS_NESTED_ERROR_CALL(device->CreateTexture(&m_defaultTexture, 1, 1, white));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
@@ -1,39 +1,56 @@
 #ifndef YDS_ALLOCATOR_H
 #define YDS_ALLOCATOR_H
 
-#if defined(__APPLE__) && defined(__MACH__) // Apple OSX & iOS (Darwin)
-    #include <stdlib.h>
-#elif defined(_WIN64)
-    #include <malloc.h>
-#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <new>
 
+// Define YDS_SYSTEM_ALLOCATOR to send every block straight to the system
+// allocator, e.g. when running under a memory checker.
 class ysAllocator {
 public:
+    // Blocks up to this size (including their header) come from size class
+    // slabs, larger ones from the system allocator
+    static const int MaxSmallSize = 4096;
+    static const int SizeClassCount = 28;
+    static const int SpanSize = 64 * 1024;
+
+    // Every block is at least aligned to this
+    static const int MinimumAlignment = 16;
+
+    struct Statistics {
+        uint64_t Allocations;
+        uint64_t Frees;
+        uint64_t LargeAllocations;
+        uint64_t CacheRefills;
+
+        // Requested bytes of blocks that have not been freed
+        int64_t LiveBytes;
+        int64_t LiveBlocks;
+
+        // Memory taken from the system for slabs
+        uint64_t SpanBytes;
+    };
+
+public:
+    static void *Allocate(size_t size, int alignment = MinimumAlignment);
+    static void Free(void *block);
+
+    static void GetStatistics(Statistics *stats);
+
+    static int GetSizeClass(size_t size);
+    static size_t GetSizeClassSize(int sizeClass);
+
     template <int Alignment>
     static void *BlockAllocate(int size) {
-        #if defined(__APPLE__) && defined(__MACH__)
-            return ::aligned_alloc(size, Alignment);
-        #elif
-            return ::_aligned_malloc(size, Alignment);
-        #endif
-    }
-
-    template <>
-    static void *BlockAllocate<1>(int size) {
-        return ::malloc(size);
+        return Allocate((size_t)size, Alignment);
     }
 
+    // The alignment is recorded with the block, the parameter is only kept for
+    // existing callers
     static void BlockFree(void *block, int alignment) {
-        if (alignment != 1) {
-            #if defined(__APPLE__) && defined(__MACH__)
-                free(block);
-            #elif
-                ::_aligned_free(block);
-            #endif
-        }
-        else {
-            ::free(block);
-        }
+        (void)alignment;
+        Free(block);
     }
 
     template <typename T_Create, int Alignment>
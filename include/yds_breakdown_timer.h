@@ -7,7 +7,9 @@
 #include "yds_dynamic_array.h"
 
 #include <fstream>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class ysBreakdownTimerChannel;
@@ -30,6 +32,10 @@ public:
     void EndMeasurement(const std::string &timerChannelName);
     void SkipMeasurement(const std::string &timerChannelName);
 
+    // Skip the channel lookup on hot paths
+    void StartMeasurement(ysBreakdownTimerChannel *channel);
+    void EndMeasurement(ysBreakdownTimerChannel *channel);
+
     ysBreakdownTimerChannel *CreateChannel(const std::string &timerChannelName, int bufferSize = 1024);
 
     uint64_t GetFrameCount() const { return m_frameCount; }
@@ -39,11 +45,17 @@ public:
     void WriteLastFrameToLogFile();
     void CloseLogFile();
 
-protected:
+    // Measurements are also recorded as profiler zones so they show up in
+    // the same timeline as zones of other threads
+    bool WriteChromeTrace(const std::string &filename);
+
     ysBreakdownTimerChannel *FindChannel(const std::string &timerChannelName);
 
+protected:
     ysDynamicArray<ysBreakdownTimerChannel, 4> m_channels;
-    std::vector<std::string> m_executionOrder;
+    std::unordered_map<std::string, ysBreakdownTimerChannel *> m_channelIndex;
+    std::vector<ysBreakdownTimerChannel *> m_executionOrder;
+    std::mutex m_executionOrderLock;
 
     std::fstream m_logFile;
 
@@ -15,7 +15,10 @@ public:
     void Destroy();
 
     void SetName(const std::string &name) { m_name = name; }
-    std::string GetName() const { return m_name; }
+    const std::string &GetName() const { return m_name; }
+
+    void SetZone(int zone) { m_zone = zone; }
+    int GetZone() const { return m_zone; }
 
     int GetEntryCount() const { return m_entryCount; }
     uint64_t GetFrameCount() const { return m_frameCount; }
@@ -33,6 +36,7 @@ public:
 
 protected:
     std::string m_name;
+    int m_zone;
     double *m_sampleBuffer;
     int m_bufferSize;
     int m_currentWriteIndex;
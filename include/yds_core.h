@@ -30,6 +30,7 @@
 #include "yds_timing.h"
 #include "yds_breakdown_timer.h"
 #include "yds_breakdown_timer_channel.h"
+#include "yds_profiler.h"
 
 // Math
 #include "yds_math.h"
@@ -45,6 +46,7 @@
 
 // Utilities
 #include "yds_registry.h"
+#include "yds_mapped_file.h"
 
 // Geometry
 #include "yds_interchange_file_0_0.h"
@@ -52,6 +54,7 @@
 #include "yds_tool_geometry_file.h"
 #include "yds_geometry_preprocessing.h"
 #include "yds_geometry_export_file.h"
+#include "yds_geometry_compile_cache.h"
 
 // Object
 #include "yds_transform.h"
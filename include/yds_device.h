@@ -251,6 +251,12 @@ public:
     virtual ysError CreateTexture(ysTexture **texture, int width, int height,
                                   const unsigned char *buffer) = 0;
 
+    // Create a texture from rgba pixels that were decoded from a file, set
+    // up the same way as a texture created from the file itself
+    virtual ysError CreateTexture(ysTexture **texture, const wchar_t *fname,
+                                  int width, int height,
+                                  const unsigned char *pixels);
+
     // Create an alpha texture from an in-memory buffer
     virtual ysError CreateAlphaTexture(ysTexture **texture, int width,
                                        int height,
@@ -3,26 +3,67 @@
 
 #include "yds_memory_base.h"
 
-typedef unsigned short int BlockIndex;
-
-struct BlockLink {
-    void *Address;
-    unsigned int Size;
-    unsigned int NumObjects;
-
-    BlockIndex Index;
-    char Free;
-    char Valid;
-
-    BlockLink *Next;
-    BlockLink *Previous;
-};
+#include <stdint.h>
 
 // --
-// Standard allocator for allocating blocks of any 
+// Standard allocator for allocating blocks of any
 // size.
+//
+// Uses a two-level segregated fit (TLSF) scheme: free
+// blocks are kept in lists bucketed by a power of two and
+// a linear subdivision of it, with a bitmap for each level,
+// so that allocating and freeing are constant time. Freed
+// blocks are merged with free neighbours immediately.
 // --
 class ysDynamicAllocator : public ysMemoryAllocator {
+public:
+    static const int Alignment = 16;
+
+    struct Statistics {
+        int TotalSize;
+        int UsedSize;
+        int PeakUsedSize;
+        int FreeSize;
+        int LargestFreeBlock;
+
+        int UsedBlocks;
+        int FreeBlocks;
+
+        // 0 when all free memory is in one block, approaching 1 as it is
+        // split into smaller pieces
+        float Fragmentation;
+    };
+
+protected:
+    // Second level subdivisions per power of two
+    static const int SecondLevelBits = 4;
+    static const int SecondLevelCount = 1 << SecondLevelBits;
+
+    // Blocks below this size are mapped linearly in the first list
+    static const int SmallBlockSize = SecondLevelCount * Alignment;
+    static const int FirstLevelShift = 8;
+    static const int FirstLevelCount = 32 - FirstLevelShift + 1;
+
+    struct BlockHeader {
+        BlockHeader *PreviousPhysical;
+
+        // Size of the whole block including this header. The lowest bit marks
+        // free blocks.
+        uint32_t SizeAndFlags;
+        uint32_t NumObjects;
+
+        // Only valid while the block is free, overlaps the user data
+        BlockHeader *NextFree;
+        BlockHeader *PreviousFree;
+
+        inline uint32_t GetSize() const { return SizeAndFlags & ~1u; }
+        inline bool IsFree() const { return (SizeAndFlags & 1u) != 0; }
+    };
+
+    // Header of a used block, the free list links are not counted
+    static const int HeaderSize = Alignment;
+    static const int MinimumBlockSize = 2 * Alignment;
+
 public:
     ysDynamicAllocator();
     ~ysDynamicAllocator();
@@ -49,7 +90,7 @@ public:
     // to take control of a segment of the parent's memory.
     //
     //   parent: Memory allocator parent
-    // 
+    //
     // --
     void SetParent(ysMemoryAllocator *parent);
 
@@ -62,13 +103,20 @@ public:
     void CreateBuffer(int size);
 
     // --
-    // Initialize the block list to be used by the allocator.
-    // 
-    //   maxBlocks: Number of blocks (ie. maximum number of allocations)
-    // 
+    // Block headers are stored in the buffer, so the number of
+    // allocations is only limited by its size. Kept for existing
+    // callers.
     // --
     void CreateBlocks(int maxBlocks);
 
+    // --
+    // Fill in usage and fragmentation metrics. Runs in time
+    // proportional to the length of a single free list.
+    // --
+    void GetStatistics(Statistics *stats) const;
+
+    int GetMaxSize() const { return m_maxSize; }
+
 public:
 
     /* ERROR CHECKING */
@@ -81,133 +129,58 @@ public:
     bool CheckValid();
 
 protected:
+    static void MapSize(uint32_t size, int *firstLevel, int *secondLevel);
+    BlockHeader *FindFreeBlock(uint32_t size);
 
-    // --
-    // Retrieve the free block with the largest size.
-    // --
-    BlockLink *UpdateAllocatorBlock();
-
-    // --
-    // Add a new block the block queue.
-    //
-    // Returns a pointer to the new block.
-    // --
-    inline BlockLink *AddBlock() {
-        if (m_nBlocks >= m_maxBlocks) return NULL;
-
-        BlockLink *newBlock = m_blocks[m_nBlocks++];
-        newBlock->Valid = 1;
-
-        return newBlock;
+    void InsertFreeBlock(BlockHeader *block);
+    void RemoveFreeBlock(BlockHeader *block);
 
+    inline BlockHeader *NextPhysical(BlockHeader *block) const {
+        return (BlockHeader *)((char *)block + block->GetSize());
     }
 
-    // --
-    // Remove a block from the block queue.
-    // 
-    //   index: Index of the block to remove.
-    // 
-    // --
-    void RemoveBlock(BlockIndex index);
-
 private:
     // Buffer from which the allocator allocates data
     void *m_data;
 
-    // Main pool of preallocated blocks
-    BlockLink *m_blockPool;
-
-    // Table of pointers, to prevent having to reoder full structures
-    BlockLink **m_blocks;
-
-    // Current free block to perform allocations with (also usually the largest)
-    BlockLink *m_allocatorBlock;
+    // Start of the first block, aligned within the buffer
+    BlockHeader *m_firstBlock;
 
-    // Current number of blocks in use by the allocator
-    int m_nBlocks;
-
-
-    // The number of blocks in the allocator pool
-    int m_maxBlocks;
+    // Free list heads and the bitmaps of non-empty lists
+    BlockHeader *m_freeLists[FirstLevelCount][SecondLevelCount];
+    uint32_t m_firstLevelMap;
+    uint32_t m_secondLevelMap[FirstLevelCount];
 
     // The size of the total allocation pool
     int m_maxSize;
 
-
     // Parent
     ysMemoryAllocator *m_parent;
 
 private:
-    // Total allocation tracking, mainly for debugging purposes
+    // Allocation tracking
     int m_totalAllocation;
+    int m_peakAllocation;
+    int m_freeSize;
+    int m_usedBlocks;
+    int m_freeBlocks;
 };
 
+// --
+// Kept for existing callers. Used to split its memory into
+// subdivisions to bound the search cost of the old allocator,
+// which no longer applies, so it manages a single pool of the
+// same total size.
+// --
 class ysCompositeAllocator : public ysDynamicAllocator {
 public:
-    ysCompositeAllocator() { m_currentAllocator = 0; }
+    ysCompositeAllocator() {}
     ~ysCompositeAllocator() {}
 
     void Initialize(int subdivisions, int subdivisionSize, int blocksPerSubdivision) {
-        m_numSubdivisions = subdivisions;
-
-        int bufferSize = subdivisions * subdivisionSize;
-        int blockListSize = subdivisions * (sizeof(BlockLink) + sizeof(BlockLink *)) * blocksPerSubdivision;
-        int allocatorListSize = subdivisions * sizeof(ysDynamicAllocator *);
-        int padding = 100 * KB;
-
-        m_parent.CreateBuffer(bufferSize + blockListSize + allocatorListSize + padding);
-        m_parent.CreateBlocks(subdivisions * 4 + 1);
-
-        m_allocators = m_parent.Allocate<ysDynamicAllocator>(subdivisions);
-
-        for (int i = 0; i < subdivisions; i++) {
-            m_allocators[i].SetParent(&m_parent);
-            m_allocators[i].CreateBuffer(subdivisionSize);
-            m_allocators[i].CreateBlocks(blocksPerSubdivision);
-        }
-    }
-
-    virtual void *AllocateBlock(int size, int numObjects = 1) {
-        void *result;
-        int startIndex = m_currentAllocator;
-
-        do {
-            result = m_allocators[m_currentAllocator++].AllocateBlock(size, numObjects);
-            if (m_currentAllocator >= m_numSubdivisions) m_currentAllocator = 0;
-
-        } while (!result && m_currentAllocator != startIndex);
-
-        return result;
+        CreateBuffer(subdivisions * subdivisionSize);
+        CreateBlocks(subdivisions * blocksPerSubdivision);
     }
-
-    virtual int FreeBlock(void *block) {
-        int left = 0;
-        int right = m_numSubdivisions - 1;
-
-        while (true) {
-            int middle = (left + right) / 2;
-            int result = m_allocators[middle].CheckMemoryAddress(block);
-
-            if (result == 1) {
-                left = middle + 1;
-            }
-            else if (result == -1) {
-                right = middle - 1;
-            }
-            else {
-                return m_allocators[middle].FreeBlock(block);
-                break;
-            }
-        }
-    }
-
-protected:
-    int m_currentAllocator;
-
-    ysDynamicAllocator m_parent;
-
-    ysDynamicAllocator *m_allocators;
-    int m_numSubdivisions;
 };
 
 #endif /* YDS_DYNAMIC_ALLOCATOR_H */
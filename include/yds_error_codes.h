@@ -106,6 +106,7 @@ enum class ysError {
     // ------------------------------------------------------------------------------
 
     CouldNotOpenFile,
+    CouldNotWriteFile,
     InvalidFileType,
     UnsupportedFileVersion,
     CorruptedFile,
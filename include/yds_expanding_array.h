@@ -156,7 +156,7 @@ public:
                 m_array[i] = m_array[i + 1];
             }
 
-            m_array[m_nObjects - 1] = nullptr;
+            m_array[m_nObjects - 1] = TYPE();
         }
         else {
             m_array[index] = m_array[m_nObjects - 1];
@@ -0,0 +1,101 @@
+#ifndef YDS_GEOMETRY_COMPILE_CACHE_H
+#define YDS_GEOMETRY_COMPILE_CACHE_H
+
+#include "yds_base.h"
+
+#include "yds_geometry_export_file.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+
+// --
+// Cache of compiled objects keyed on a hash of their source data
+// and the parameters they were compiled with, so that only objects
+// that changed have to be compiled again.
+//
+// Only entries that were looked up or stored since the cache was
+// loaded are saved, which drops objects that no longer exist.
+// --
+class ysGeometryCompileCache : public ysObject {
+public:
+    typedef uint64_t Key;
+
+    static const uint32_t CacheFileMagic = 0x43435359; // "YSCC"
+
+    // Must be changed whenever the output of the compiler changes
+    static const int CacheFileVersion = 2;
+
+    // --
+    // Incremental 64-bit FNV-1a hash
+    // --
+    class Hasher {
+    public:
+        Hasher() { m_hash = 14695981039346656037ull; }
+
+        void Add(const void *data, size_t size);
+        void Add(const char *s);
+
+        template <typename T>
+        void AddValue(const T &value) { Add(&value, sizeof(T)); }
+
+        template <typename T>
+        void AddArray(const T *values, int count) {
+            AddValue(count);
+            if (count > 0) Add(values, sizeof(T) * count);
+        }
+
+        Key GetKey() const { return m_hash; }
+
+    protected:
+        uint64_t m_hash;
+    };
+
+public:
+    ysGeometryCompileCache();
+    ~ysGeometryCompileCache();
+
+    // --
+    // Load a cache written by Save(). A missing or out of date file
+    // leaves the cache empty and is not an error.
+    // --
+    ysError Load(const wchar_t *fname);
+    ysError Save(const wchar_t *fname);
+
+    void Clear();
+
+    bool Find(Key key, ysGeometryExportFile::CompiledObject *object);
+    void Store(Key key, const ysGeometryExportFile::CompiledObject &object);
+
+    int GetEntryCount() const { return (int)m_entries.size(); }
+
+    int GetHitCount() const { return m_hits; }
+    int GetMissCount() const { return m_misses; }
+
+    // Hash of everything read from the source file for an object
+    static void HashObject(ysObjectData *object, Hasher *hasher);
+    static void HashObject(const ysInterchangeObject &object, Hasher *hasher);
+
+protected:
+    struct Entry {
+        ysGeometryExportFile::CompiledObject Object;
+        bool Used;
+    };
+
+    struct EntryHeader {
+        Key EntryKey;
+        ysGeometryExportFile::ObjectOutputHeader Header;
+
+        int VertexDataSize;
+        int IndexCount;
+        int BoneMapSize;
+        int ExtraDataSize;
+    };
+
+    std::unordered_map<Key, Entry> m_entries;
+
+    int m_hits;
+    int m_misses;
+};
+
+#endif /* YDS_GEOMETRY_COMPILE_CACHE_H */
@@ -7,6 +7,8 @@
 #include "yds_interchange_object.h"
 
 #include <fstream>
+#include <stdint.h>
+#include <vector>
 
 class ysGeometryExportFile : public ysObject {
 public:
@@ -56,6 +58,71 @@ public:
         int VertexDataSize;
     };
 
+    // --
+    // Compiled scene layout (version 2):
+    //
+    //   SceneFileHeader
+    //   SceneObjectEntry[ObjectCount]
+    //   Bone maps (int)
+    //   Extra object data (light and plane parameters)
+    //   Vertex data
+    //   Index data (16 or 32 bit)
+    //
+    // Sections start on a SectionAlignment boundary so that a
+    // mapped file can be handed to the device without copying.
+    // --
+    static const uint32_t SceneFileMagic = 0x45435359; // "YSCE"
+    static const int SceneFileVersion = 2;
+    static const int SectionAlignment = 16;
+
+    struct SceneFileHeader {
+        uint32_t Magic;
+        int Version;
+        int ObjectCount;
+
+        // Size of a single index in bytes, 4 only if a mesh has
+        // more vertices than 16 bit indices can address
+        int IndexSize;
+
+        // Byte offsets from the start of the file
+        uint64_t ObjectTableOffset;
+        uint64_t BoneMapOffset;
+        uint64_t ExtraDataOffset;
+        uint64_t VertexDataOffset;
+        uint64_t VertexDataSize;
+        uint64_t IndexDataOffset;
+        uint64_t IndexDataSize;
+    };
+
+    struct SceneObjectEntry {
+        ObjectOutputHeader Header;
+
+        // Byte offset into the vertex data, a multiple of the
+        // vertex size
+        int VertexOffset;
+
+        // Offsets into the index data and bone maps in elements
+        int IndexOffset;
+        int BoneMapOffset;
+
+        // Byte offset into the extra data, -1 if there is none
+        int ExtraDataOffset;
+        int ExtraDataSize;
+    };
+
+    // --
+    // A single object after compilation, before it is placed in a
+    // scene. Indices are relative to the object's own vertices.
+    // --
+    struct CompiledObject {
+        ObjectOutputHeader Header;
+
+        std::vector<char> VertexData;
+        std::vector<uint32_t> Indices;
+        std::vector<int> BoneMap;
+        std::vector<char> ExtraData;
+    };
+
 public:
     ysGeometryExportFile();
     ~ysGeometryExportFile();
@@ -67,6 +134,27 @@ public:
     ysError WriteObject(ysObjectData *object);
     ysError WriteObject(ysInterchangeObject *object, const VertexInfo *info = nullptr);
 
+    // --
+    // Add an object to a version 2 scene. The objects are kept
+    // in memory until WriteScene() is called.
+    // --
+    ysError AddSceneObject(ysObjectData *object);
+    ysError AddSceneObject(ysInterchangeObject *object, const VertexInfo *info = nullptr);
+    ysError AddSceneObject(const CompiledObject &object);
+
+    // --
+    // Compile an object without adding it to the scene. Does not
+    // touch the file or the scene being built, so different objects
+    // can be compiled on different threads.
+    // --
+    ysError CompileObject(ysObjectData *object, CompiledObject *output);
+    ysError CompileObject(ysInterchangeObject *object, const VertexInfo *info, CompiledObject *output);
+
+    // --
+    // Write all objects added so far as a version 2 scene.
+    // --
+    ysError WriteScene();
+
 protected:
     int GetVertexSize(ysInterchangeObject *object, const VertexInfo *info);
 
@@ -78,8 +166,20 @@ protected:
     void FillOutputHeader(ysObjectData *object, ObjectOutputHeader *header);
     void FillOutputHeader(const ysInterchangeObject *object, const VertexInfo *info, ObjectOutputHeader *header);
 
+    SceneObjectEntry *NewSceneObject(const ObjectOutputHeader &header, const void *vertexData);
+    void AddExtraData(SceneObjectEntry *entry, const void *data, int size);
+    void WritePadding();
+
 protected:
     std::ofstream m_file;
+
+    // Scene being built by AddSceneObject()
+    std::vector<SceneObjectEntry> m_sceneObjects;
+    std::vector<int> m_boneMaps;
+    std::vector<char> m_extraData;
+    std::vector<char> m_vertexData;
+    std::vector<uint32_t> m_indices;
+    int m_maxVertexCount;
 };
 
 #endif /* YDS_GEOMETRY_EXPORT_FILE_H */
@@ -26,6 +26,14 @@ public:
 
     GPU_BUFFER_TYPE GetType() const { return m_bufferType; }
 
+    // --
+    // Size of a single index in bytes, 2 (default) or 4. Only
+    // meaningful for index buffers and must be set before the
+    // buffer is first bound.
+    // --
+    void SetIndexSize(int indexSize) { m_indexSize = indexSize; }
+    int GetIndexSize() const { return m_indexSize; }
+
 protected:
     GPU_BUFFER_TYPE m_bufferType;
 
@@ -33,6 +41,7 @@ protected:
     int m_size;
 
     int m_currentStride;
+    int m_indexSize;
 
     bool m_mirrorToRAM;
 };
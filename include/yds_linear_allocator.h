@@ -0,0 +1,82 @@
+#ifndef YDS_LINEAR_ALLOCATOR_H
+#define YDS_LINEAR_ALLOCATOR_H
+
+#include "yds_memory_base.h"
+
+// --
+// Allocator for short lived data, such as data that only
+// lives for one frame.
+//
+// Allocations bump an offset into a single buffer and are
+// not freed individually. Reset() releases everything at
+// once. When the buffer runs out, blocks are taken from
+// overflow chunks on the heap instead, and the next Reset()
+// grows the buffer to the high-water mark so that the
+// overflow does not happen again.
+// --
+class ysLinearAllocator : public ysMemoryAllocator {
+public:
+    static const int Alignment = 16;
+
+public:
+    ysLinearAllocator();
+    ~ysLinearAllocator();
+
+    virtual void *AllocateBlock(int size, int numObjects = 1);
+
+    // --
+    // Individual blocks are not freed, always returns 0 so
+    // that no destructors are called.
+    // --
+    virtual int FreeBlock(void *block);
+
+    virtual void Destroy();
+
+    // --
+    // Allocate the buffer to be used by the allocator.
+    //
+    //   size: Total size of the buffer (bytes)
+    //
+    // --
+    void CreateBuffer(int size);
+
+    // --
+    // Release all allocations. Constant time unless the
+    // buffer overflowed since the last reset.
+    // --
+    void Reset();
+
+    int GetCapacity() const { return m_capacity; }
+
+    // Bytes allocated since the last reset, including overflow
+    int GetUsed() const { return m_used; }
+
+    // Largest GetUsed() seen before any reset
+    int GetHighWaterMark() const { return m_highWaterMark; }
+
+    // Number of allocations that did not fit into the buffer
+    int GetOverflowCount() const { return m_overflowCount; }
+
+protected:
+    struct OverflowChunk {
+        OverflowChunk *Next;
+        int Size;
+        int Offset;
+    };
+
+    void *AllocateOverflow(int size);
+    void FreeOverflow();
+
+protected:
+    char *m_buffer;
+    int m_capacity;
+    int m_offset;
+
+    OverflowChunk *m_overflow;
+
+    int m_used;
+    int m_highWaterMark;
+    int m_overflowCount;
+};
+
+#endif /* YDS_LINEAR_ALLOCATOR_H */
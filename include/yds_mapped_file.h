@@ -0,0 +1,36 @@
+#ifndef YDS_MAPPED_FILE_H
+#define YDS_MAPPED_FILE_H
+
+#include "yds_base.h"
+
+#include <stddef.h>
+
+// --
+// Read-only view of a whole file mapped into memory. Pages
+// are loaded by the OS as they are first touched, so nothing
+// is copied until the data is used.
+// --
+class ysMappedFile : public ysObject {
+public:
+    ysMappedFile();
+    ~ysMappedFile();
+
+    ysError Open(const wchar_t *fname);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr; }
+
+    const char *GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+protected:
+    const char *m_data;
+    size_t m_size;
+
+#if defined(_WIN64)
+    void *m_file;
+    void *m_mapping;
+#endif
+};
+
+#endif /* YDS_MAPPED_FILE_H */
@@ -105,6 +105,9 @@ public:
                                   const wchar_t *fname) override;
     virtual ysError CreateTexture(ysTexture **texture, int width, int height,
                                   const unsigned char *buffer) override;
+    virtual ysError CreateTexture(ysTexture **texture, const wchar_t *fname,
+                                  int width, int height,
+                                  const unsigned char *pixels) override;
     virtual ysError UpdateTexture(ysTexture *texture,
                                   const unsigned char *buffer) override;
     virtual ysError CreateAlphaTexture(ysTexture **texture, int width,
@@ -0,0 +1,143 @@
+#ifndef YDS_PROFILER_H
+#define YDS_PROFILER_H
+
+#include "yds_base.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define YDS_PROFILER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define YDS_PROFILER_TSC
+#endif
+
+// Hierarchical zone profiler. Each thread records begin/end events into its
+// own ring buffer without taking any locks, so zones can be placed in worker
+// threads. Zone names are interned once per call site by YS_PROFILE_ZONE.
+class ysProfiler : public ysObject {
+public:
+    static const int DefaultBufferSize = 1 << 16;
+
+    enum class EventType : int { Begin, End };
+
+    struct Event {
+        uint64_t Timestamp;
+        int Zone;
+        EventType Type;
+    };
+
+    // Events of one thread. Only the owning thread writes to it.
+    struct ThreadBuffer {
+        std::vector<Event> Events;
+        std::atomic<uint64_t> WriteIndex;
+
+        // Events before this index were dropped by Clear()
+        uint64_t ClearIndex;
+
+        std::string Name;
+        int ThreadId;
+    };
+
+public:
+    ysProfiler();
+    ~ysProfiler();
+
+    static ysProfiler *Get();
+
+    // Nanoseconds on a monotonic clock
+    static uint64_t Now();
+
+    // Raw event timestamp. Uses the time stamp counter where available and
+    // is converted to nanoseconds on export.
+    static inline uint64_t ReadClock() {
+#if defined(YDS_PROFILER_TSC)
+        return __rdtsc();
+#else
+        return Now();
+#endif
+    }
+
+    int RegisterZone(const char *name);
+    std::string GetZoneName(int zone);
+    int GetZoneCount();
+
+    void SetEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool IsEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    // Only affects threads that record their first event afterwards
+    void SetBufferSize(int size);
+
+    void SetThreadName(const char *name);
+
+    inline void BeginZone(int zone) { Record(zone, EventType::Begin); }
+    inline void EndZone(int zone) { Record(zone, EventType::End); }
+
+    // Copies the events that are still in the current thread's buffer
+    void GetThreadEvents(std::vector<Event> *events);
+
+    // Writes all retained zones in the Chrome trace event format, which can
+    // be opened in chrome://tracing or Perfetto. Zones that are still open or
+    // whose begin event was overwritten are left out. Threads should not be
+    // recording while this runs.
+    bool WriteChromeTrace(const std::string &filename);
+
+    // Drops all recorded events
+    void Clear();
+
+protected:
+    inline void Record(int zone, EventType type) {
+        if (!IsEnabled()) return;
+
+        ThreadBuffer *buffer = t_buffer;
+        if (buffer == nullptr) buffer = CreateThreadBuffer();
+
+        const uint64_t index = buffer->WriteIndex.load(std::memory_order_relaxed);
+        Event &e = buffer->Events[index & (buffer->Events.size() - 1)];
+        e.Timestamp = ReadClock();
+        e.Zone = zone;
+        e.Type = type;
+
+        buffer->WriteIndex.store(index + 1, std::memory_order_release);
+    }
+
+    ThreadBuffer *CreateThreadBuffer();
+    void CopyEvents(ThreadBuffer *buffer, std::vector<Event> *events);
+
+    static thread_local ThreadBuffer *t_buffer;
+
+    std::mutex m_lock;
+    std::vector<std::string> m_zones;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_threads;
+
+    std::atomic<bool> m_enabled;
+    int m_bufferSize;
+
+    uint64_t m_epoch;
+    uint64_t m_epochClock;
+};
+
+class ysProfileScope {
+public:
+    explicit ysProfileScope(int zone) : m_zone(zone) { ysProfiler::Get()->BeginZone(zone); }
+    ~ysProfileScope() { ysProfiler::Get()->EndZone(m_zone); }
+
+protected:
+    int m_zone;
+};
+
+#define YS_PROFILE_CONCAT_INNER(a, b) a ## b
+#define YS_PROFILE_CONCAT(a, b) YS_PROFILE_CONCAT_INNER(a, b)
+
+#define YS_PROFILE_ZONE(name)                                                         \
+    static const int YS_PROFILE_CONCAT(ys_profileZone_, __LINE__) =                   \
+        ysProfiler::Get()->RegisterZone(name);                                        \
+    ysProfileScope YS_PROFILE_CONCAT(ys_profileScope_, __LINE__)(                     \
+        YS_PROFILE_CONCAT(ys_profileZone_, __LINE__))
+
+#endif /* YDS_PROFILER_H */
@@ -2,19 +2,37 @@
 #define YS_TIMING_H
 
 #include <stdint.h>
+#include <vector>
 
-#if defined(_WIN64)
-
+// Microseconds on a monotonic clock
 uint64_t SystemTime();
 
 class ysTimingSystem {
 public:
     enum class Precision { Microsecond, Millisecond };
 
+    struct FrameStatistics {
+        int Samples;
+
+        double Average;
+        double Minimum;
+        double Maximum;
+
+        double P50;
+        double P95;
+        double P99;
+
+        // Mean absolute change in duration between consecutive frames
+        double Jitter;
+    };
+
 protected:
     static ysTimingSystem *g_instance;
     static const int DurationSamples = 64;
 
+public:
+    static const int DefaultHistorySize = 1024;
+
 public:
     ysTimingSystem();
     ~ysTimingSystem();
@@ -33,12 +51,7 @@ public:
     uint64_t GetFrameDuration_us();
 
     uint64_t GetTime();
-    
-#if defined(_WIN64)
-    unsigned __int64 GetClock();
-#else
     uint64_t GetClock();
-#endif
 
     void SetPrecisionMode(Precision mode);
     Precision GetPrecisionMode() const { return m_precisionMode; }
@@ -52,6 +65,29 @@ public:
 
     inline int GetDurationSamples() const { return m_durationSamples; }
 
+    // Adds a frame duration in seconds to the history. Called by Update(), but
+    // can also be used to track frames that are timed elsewhere.
+    void RecordFrameDuration(double duration);
+
+    // Number of frames kept for percentiles and jitter. Clears the history.
+    void SetHistorySize(int size);
+    int GetHistorySize() const { return (int)m_history.size(); }
+    int GetHistorySamples() const { return m_historySamples; }
+
+    void GetFrameStatistics(FrameStatistics *stats);
+
+    // Fraction p in [0, 1] of the retained frame durations
+    double GetFrameDurationPercentile(double p);
+
+    // Counts consecutive-frame duration changes into bins of the given width.
+    // The last bin also counts everything beyond it.
+    void GetJitterHistogram(int *bins, int binCount, double binWidth);
+
+protected:
+    double GetHistorySample(int i) const;
+    void SortHistory();
+    double SortedPercentile(double p) const;
+
 protected:
     Precision m_precisionMode;
     double m_div;
@@ -72,8 +108,48 @@ protected:
     double *m_frameDurations;
     int m_durationSampleWriteIndex;
     int m_durationSamples;
+
+    std::vector<double> m_history;
+    std::vector<double> m_sortedHistory;
+    int m_historyWriteIndex;
+    int m_historySamples;
 };
 
-#endif /* Windows */
+// Splits variable frame durations into fixed simulation steps. Time that does
+// not fill a whole step carries over to the next frame. When more than the
+// maximum number of steps is due, the excess is dropped so that a slow frame
+// can't make the following ones even slower.
+class ysTimestepAccumulator {
+public:
+    static const int DefaultMaxSteps = 8;
+
+public:
+    ysTimestepAccumulator();
+    ~ysTimestepAccumulator();
+
+    void SetStep(double step) { m_step = step; }
+    double GetStep() const { return m_step; }
+
+    void SetMaxSteps(int maxSteps) { m_maxSteps = maxSteps; }
+    int GetMaxSteps() const { return m_maxSteps; }
+
+    // Returns the number of fixed steps to run for this frame
+    int Advance(double frameDuration);
+    void Reset();
+
+    // Fraction of a step left over, for interpolating between the last two
+    // simulated states
+    double GetAlpha() const { return m_accumulator / m_step; }
+
+    double GetAccumulator() const { return m_accumulator; }
+    double GetDroppedTime() const { return m_droppedTime; }
+
+protected:
+    double m_step;
+    int m_maxSteps;
+
+    double m_accumulator;
+    double m_droppedTime;
+};
 
 #endif /* YS_TIMING_H */
@@ -0,0 +1,83 @@
+#ifndef DELTA_BASIC_AABB_TREE_H
+#define DELTA_BASIC_AABB_TREE_H
+
+#include "delta_core.h"
+
+#include <vector>
+
+namespace dphysics {
+
+    // Dynamic bounding volume hierarchy over 2D boxes. Leaves store boxes that
+    // are fattened by a margin and a leaf is only reinserted once its bounds
+    // leave the fattened box. The tree is kept balanced with rotations as
+    // leaves are inserted and removed.
+    class AabbTree : public ysObject {
+    public:
+        static constexpr float DefaultMargin = 0.1f;
+        static const int MaxQueryDepth = 256;
+
+    public:
+        AabbTree();
+        ~AabbTree();
+
+        int CreateProxy(const ysVector &minPoint, const ysVector &maxPoint, void *data);
+        void DestroyProxy(int proxy);
+
+        // Returns true if the proxy had to be reinserted
+        bool MoveProxy(int proxy, const ysVector &minPoint, const ysVector &maxPoint);
+
+        void *GetData(int proxy) const { return m_nodes[proxy].Data; }
+
+        // Appends all proxies whose fattened bounds overlap the given box
+        void Query(const ysVector &minPoint, const ysVector &maxPoint, std::vector<int> &proxies) const;
+
+        // Appends all proxies whose fattened bounds come within radius of the
+        // segment from start to end
+        void QuerySegment(const ysVector &start, const ysVector &end, float radius, std::vector<int> &proxies) const;
+
+        void Clear();
+
+        int GetProxyCount() const { return m_proxyCount; }
+        int GetHeight() const { return (m_root == -1) ? 0 : m_nodes[m_root].Height; }
+
+        void SetMargin(float margin) { m_margin = margin; }
+        float GetMargin() const { return m_margin; }
+
+    protected:
+        struct Node {
+            float Min[2];
+            float Max[2];
+
+            void *Data;
+
+            // Doubles as the next pointer of the free list
+            int Parent;
+            int Children[2];
+            int Height;
+
+            bool IsLeaf() const { return Children[0] == -1; }
+        };
+
+        int AllocateNode();
+        void FreeNode(int node);
+
+        void InsertLeaf(int leaf);
+        void RemoveLeaf(int leaf);
+        void Refit(int node);
+        int Balance(int node);
+
+        static float Perimeter(const float min[2], const float max[2]);
+        static float CombinedPerimeter(const Node &a, const Node &b);
+        static bool SegmentOverlaps(const Node &node, const float start[2], const float delta[2], float radius);
+
+        std::vector<Node> m_nodes;
+        int m_root;
+        int m_freeList;
+        int m_proxyCount;
+
+        float m_margin;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_AABB_TREE_H */
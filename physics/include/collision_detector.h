@@ -19,6 +19,14 @@ namespace dphysics {
 
         bool CircleCircleIntersect(RigidBody *body1, RigidBody *body2, CirclePrimitive *circle1, CirclePrimitive *circle2);
 
+        // Scene query tests in the XY plane. Sweeps move a circle of the given
+        // radius (zero for rays) along a unit direction and report the distance
+        // and the surface normal at the first contact.
+        bool SweepCircleCircle(const ysVector &origin, const ysVector &direction, float radius, float maxDistance, const CirclePrimitive *circle, float *distance, ysVector *normal);
+        bool SweepCircleBox(const ysVector &origin, const ysVector &direction, float radius, float maxDistance, const BoxPrimitive *box, float *distance, ysVector *normal);
+        bool OverlapCircleCircle(const ysVector &center, float radius, const CirclePrimitive *circle);
+        bool OverlapCircleBox(const ysVector &center, float radius, const BoxPrimitive *box);
+
         bool _BoxBoxColliding(BoxPrimitive *body1, BoxPrimitive *body2);
         int BoxBoxVertexPenetration(Collision *collisions, BoxPrimitive *body1, BoxPrimitive *body2);
     };
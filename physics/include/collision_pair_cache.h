@@ -0,0 +1,93 @@
+#ifndef DELTA_BASIC_COLLISION_PAIR_CACHE_H
+#define DELTA_BASIC_COLLISION_PAIR_CACHE_H
+
+#include "delta_core.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace dphysics {
+
+    class RigidBody;
+    class Collision;
+
+    // Open-addressed hash of the body pairs that generated contacts. The
+    // table is kept across frames so that a pair's history (how long it has
+    // been in contact and the contacts it produced in the previous frame) is
+    // available to the solver for warm starting.
+    class CollisionPairCache : public ysObject {
+    public:
+        static const int MinCapacity = 1024;
+        static const int DefaultStaleFrameLimit = 4;
+
+        struct Pair {
+            RigidBody *Body1;
+            RigidBody *Body2;
+
+            unsigned int FirstFrame;
+            unsigned int LastFrame;
+
+            // Ranges in the contact lists of the current and previous frame
+            int ContactStart;
+            int ContactCount;
+            int PreviousContactStart;
+            int PreviousContactCount;
+        };
+
+    public:
+        CollisionPairCache();
+        ~CollisionPairCache();
+
+        void BeginFrame();
+        void Clear();
+
+        // Marks the pair as touching during the current frame, creating it if
+        // necessary. The returned pointer is only valid until the next call
+        // to Touch() or BeginFrame().
+        Pair *Touch(RigidBody *body1, RigidBody *body2);
+        Pair *Find(RigidBody *body1, RigidBody *body2);
+
+        // Records a contact of the pair for the current frame
+        void AddContact(Pair *pair, Collision *collision);
+
+        // Contacts the pair produced in the previous frame if it is still
+        // touching in the current one
+        Collision **GetPreviousContacts(RigidBody *body1, RigidBody *body2, int *count);
+
+        // Pairs of the body are dropped by the next BeginFrame()
+        void RemoveBody(RigidBody *body);
+
+        int GetPairAge(const Pair *pair) const { return (int)(m_frame - pair->FirstFrame); }
+        unsigned int GetFrame() const { return m_frame; }
+
+        int GetPairCount() const { return m_pairCount; }
+        int GetCapacity() const { return (int)m_pairs.size(); }
+
+        void SetStaleFrameLimit(int limit) { m_staleFrameLimit = limit; }
+        int GetStaleFrameLimit() const { return m_staleFrameLimit; }
+
+    protected:
+        static uint64_t Hash(const RigidBody *body1, const RigidBody *body2);
+
+        void Rebuild(int capacity);
+        bool IsStale(const Pair &pair) const;
+        bool IsRemoved(const Pair &pair) const;
+
+        std::vector<Collision *> &CurrentContacts() { return m_contacts[m_frame & 1]; }
+        std::vector<Collision *> &PreviousContacts() { return m_contacts[(m_frame + 1) & 1]; }
+
+        std::vector<Pair> m_pairs;
+        std::vector<Pair> m_scratch;
+
+        std::vector<Collision *> m_contacts[2];
+        std::vector<RigidBody *> m_removedBodies;
+
+        int m_pairCount;
+        int m_staleFrameLimit;
+        unsigned int m_frame;
+        unsigned int m_lastRebuildFrame;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_COLLISION_PAIR_CACHE_H */
@@ -0,0 +1,39 @@
+#ifndef DELTA_BASIC_COLLISION_POOL_H
+#define DELTA_BASIC_COLLISION_POOL_H
+
+#include "delta_core.h"
+
+#include "collision_primitives.h"
+
+#include <vector>
+
+namespace dphysics {
+
+    // Frame arena for contacts. Collisions are stored in fixed-size chunks
+    // that are never freed or moved, so pointers stay valid until the next
+    // Reset(), which just rewinds the allocation counter.
+    class CollisionPool : public ysObject {
+    public:
+        static const int ChunkShift = 10;
+        static const int ChunkSize = 1 << ChunkShift;
+
+    public:
+        CollisionPool();
+        ~CollisionPool();
+
+        int Allocate();
+        void Reset() { m_count = 0; }
+
+        Collision *Get(int index) { return &m_chunks[index >> ChunkShift][index & (ChunkSize - 1)]; }
+
+        int GetCount() const { return m_count; }
+        int GetCapacity() const { return (int)m_chunks.size() * ChunkSize; }
+
+    protected:
+        std::vector<Collision *> m_chunks;
+        int m_count;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_COLLISION_POOL_H */
@@ -98,6 +98,9 @@ namespace dphysics {
         ysVector GetContactVelocity() const { return m_initialContactVelocity; }
         ysVector GetContactVelocityWorld() const;
 
+        // Impulse applied by the sequential impulse solver, in contact space
+        ysVector GetAccumulatedImpulse() const { return m_accumulatedImpulse; }
+
         bool IsSameAs(Collision *other) const;
 
     protected:
@@ -108,6 +111,10 @@ namespace dphysics {
 
         float m_desiredDeltaVelocity;
 
+        ysVector m_accumulatedImpulse;
+        ysVector m_effectiveMass;
+        float m_velocityTarget;
+
         void CalculateDesiredDeltaVelocity(float timestep);
 
         ysVector CalculateLocalVelocity(int bodyIndex);
@@ -1,21 +1,30 @@
 #ifndef DELTA_PHYSICS_DELTA_PHYSICS_H
 #define DELTA_PHYSICS_DELTA_PHYSICS_H
 
+#include "aabb_tree.h"
 #include "collision_detector.h"
 #include "collision_geometry.h"
 #include "collision_object.h"
+#include "collision_pair_cache.h"
+#include "collision_pool.h"
 #include "collision_primitives.h"
 #include "expanding_spring.h"
 #include "grid_partition_system.h"
 #include "hinge_link.h"
+#include "island_builder.h"
 #include "mass_spring_system.h"
-#include "particle.h"
 #include "particle_system.h"
+#include "replay_codec.h"
+#include "replay_reader.h"
+#include "replay_recorder.h"
 #include "rigid_body.h"
 #include "rigid_body_link.h"
+#include "rigid_body_state.h"
 #include "rigid_body_system.h"
+#include "scene_query.h"
 #include "force_generator.h"
 #include "spring_link.h"
 #include "ledge_link.h"
+#include "worker_pool.h"
 
 #endif /* DELTA_PHYSICS_DELTA_PHYSICS_H */
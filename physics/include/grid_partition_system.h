@@ -3,6 +3,9 @@
 
 #include "delta_core.h"
 
+#include <stdint.h>
+#include <vector>
+
 namespace dphysics {
 
     class RigidBody;
@@ -21,50 +24,89 @@ namespace dphysics {
         void DecrementRequestCount();
         int GetRequestCount() const { return m_requestCount; }
 
+        int GetObjectCount() const { return m_objectCount; }
+
     protected:
         int m_x;
         int m_y;
         int m_requestCount;
 
+        // Range of this cell's objects in the packed object array of the
+        // partition system. Only valid after GridPartitionSystem::Finalize().
+        int m_objectOffset;
+        int m_objectCount;
+
+        int m_emptyFrames;
+
         bool m_forceProcess;
         bool m_processed;
         bool m_valid;
         bool m_active;
-
-        ysExpandingArray<RigidBody *, 4> m_objects;
     };
 
+    // Uniform grid backed by a flat, open-addressed table of cell indices.
+    // Cells are stored contiguously and their object lists are packed into a
+    // single array which is rebuilt every frame with a counting sort.
     class GridPartitionSystem : public ysObject {
         friend RigidBodySystem;
 
+    public:
+        static const int MinTableCapacity = 256;
+        static const int DefaultEvictionFrameLimit = 32;
+
     public:
         GridPartitionSystem();
         ~GridPartitionSystem();
 
         void Reset();
+        void Finalize();
+
+        // Pointers returned by GetCell() are invalidated when a new cell is
+        // created or when Reset() evicts cells
         GridCell *GetCell(int x, int y);
+        GridCell *GetCell(int index) { return &m_cells[index]; }
+        int GetCellIndex(int x, int y);
+
+        // Returns -1 if there is no cell at the given coordinates
+        int FindCellIndex(int x, int y) const;
+        int GetCellCoordinate(float position) const;
+        int GetCellCount() const { return (int)m_cells.size(); }
+
+        RigidBody **GetCellObjects(const GridCell *cell) { return m_cellObjects.data() + cell->m_objectOffset; }
+
         void ProcessRigidBody(RigidBody *object);
 
         void SetGridCellSize(float gridCellSize) { m_gridCellSize = gridCellSize; if (m_gridCellSize < m_maxObjectSize) m_gridCellSize = m_maxObjectSize; }
         float GetGridCellSize() const { return m_gridCellSize; }
+        float GetMaxObjectSize() const { return m_maxObjectSize; }
+
+        void SetEvictionFrameLimit(int limit) { m_evictionFrameLimit = limit; }
+        int GetEvictionFrameLimit() const { return m_evictionFrameLimit; }
 
         void AddObject(int x, int y, RigidBody *body);
 
     protected:
-        #if defined(_WIN64)
-            unsigned __int64 SzudzikHash(int x, int y);
-            int CalculateLoad();
+        struct CellEntry {
+            int Cell;
+            RigidBody *Body;
+        };
+
+        static uint64_t CellKey(int x, int y);
+        static uint64_t HashKey(uint64_t key);
+
+        int CreateCell(int x, int y);
+        void RebuildTable(int capacity);
+        int CalculateLoad();
+
+        std::vector<GridCell> m_cells;
+        std::vector<int> m_table;
 
-            std::map<unsigned __int64, GridCell *> m_gridCells;
-        #else
-            uint64_t SzudzikHash(int x, int y);
-            int CalculateLoad();
+        std::vector<CellEntry> m_cellEntries;
+        std::vector<RigidBody *> m_cellObjects;
 
-            std::map<uint64_t, GridCell *> m_gridCells;
-        #endif
         float m_gridCellSize;
         float m_maxObjectSize;
-        int m_maxCells;
+        int m_evictionFrameLimit;
     };
 
 } /* namespace dbasic */
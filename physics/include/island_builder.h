@@ -0,0 +1,31 @@
+#ifndef DELTA_BASIC_ISLAND_BUILDER_H
+#define DELTA_BASIC_ISLAND_BUILDER_H
+
+#include "delta_core.h"
+
+#include <vector>
+
+namespace dphysics {
+
+    // Disjoint-set forest used to group bodies that are connected through
+    // contacts or links into islands which can be solved independently
+    class IslandBuilder : public ysObject {
+    public:
+        IslandBuilder();
+        ~IslandBuilder();
+
+        void Initialize(int nodeCount);
+
+        void Merge(int a, int b);
+        int FindRoot(int node);
+
+        int GetNodeCount() const { return (int)m_parents.size(); }
+
+    protected:
+        std::vector<int> m_parents;
+        std::vector<int> m_sizes;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_ISLAND_BUILDER_H */
@@ -3,6 +3,10 @@
 
 #include "delta_core.h"
 
+#include "worker_pool.h"
+
+#include <vector>
+
 namespace dphysics {
 
     class MSSParticle;
@@ -42,11 +46,15 @@ namespace dphysics {
 
     class MassSpringSystem : public ysObject {
     public:
-        enum RK4_PASS {
-            RK4_FIRST_PASS,
-            RK4_SECOND_PASS,
-            RK4_THIRD_PASS,
-            RK4_FOURTH_PASS
+        // Particles or springs handed to each integration job at minimum, so
+        // that small systems are not split across threads
+        static const int MinimumBatchSize = 512;
+
+        static const int DefaultSolverIterations = 8;
+
+        enum class IntegrationMode {
+            RungeKutta4,
+            PositionBased
         };
 
     public:
@@ -58,6 +66,11 @@ namespace dphysics {
         void Update();
         void DrawDebug() {}
 
+        // Runs as many steps of the current step size as fit into the elapsed
+        // time and returns how many were run
+        int Advance(float frameDuration);
+        ysTimestepAccumulator *GetTimestepAccumulator() { return &m_timestepAccumulator; }
+
         MSSParticle *NewParticle();
         void RemoveParticle(MSSParticle *particle);
 
@@ -66,11 +79,35 @@ namespace dphysics {
 
         template <typename SpringType>
         SpringType *NewGenericSpring() {
-            return m_springs.NewGeneric<SpringType>(16);
+            return m_springs.NewGeneric<SpringType, 16>();
         }
 
         void SetEngine(DeltaEngine *engine) { m_engine = engine; }
 
+        void SetThreadCount(int threadCount) { m_threadCount = (threadCount > 0) ? threadCount : 1; }
+        int GetThreadCount() const { return m_threadCount; }
+
+        void SetIntegrationMode(IntegrationMode mode) { m_integrationMode = mode; }
+        IntegrationMode GetIntegrationMode() const { return m_integrationMode; }
+
+        // Number of constraint projection passes per step in PositionBased mode
+        void SetSolverIterations(int iterations) { m_solverIterations = (iterations > 0) ? iterations : 1; }
+        int GetSolverIterations() const { return m_solverIterations; }
+
+    protected:
+        enum class IntegrationKernel {
+            SpringForces,
+            Derivatives
+        };
+
+        struct IntegrationCallData {
+            MassSpringSystem *System;
+            int Start;
+            int Count;
+            int Stage;
+            IntegrationKernel Kernel;
+        };
+
     protected:
         DeltaEngine *m_engine;
 
@@ -78,10 +115,84 @@ namespace dphysics {
         float m_halfStep;
         float m_sixthStep;
 
+        ysTimestepAccumulator m_timestepAccumulator;
+
         void DetectCollisions();
 
+        void PackState();
+        void UnpackState();
+
+        void RunIntegrationKernel(IntegrationKernel kernel, int stage, int count);
+        static void IntegrationThread(void *data);
+
+        void CalculateSpringForces(int stage, int start, int end);
+        void CalculateDerivatives(int stage, int start, int end);
+        ysVector ExternalAcceleration(int particle, const ysVector *positions, const ysVector &velocity) const;
+        ysVector CollisionAcceleration(int particle, const ysVector *positions) const;
+
+        void IntegratePositionBased();
+        void ProjectSprings();
+
+        void BuildConnectivity();
+        bool IsConnected(int particle1, int particle2) const;
+
+        void BuildCollisionGrid(float cellSize);
+        int GetCellBucket(int x, int y, int z) const;
+
         ysDynamicArray<MSSParticle, 4> m_particles;
         ysDynamicArray<MSSSpring, 4> m_springs;
+
+        // Particles that share a spring, sorted per particle so that the
+        // connection test during collision detection is a binary search
+        std::vector<int> m_connectionStart;
+        std::vector<MSSParticle *> m_connections;
+
+        // Collision-enabled particles hashed into uniform cells. Buckets are
+        // stored as ranges of a single array which is rebuilt every step.
+        float m_cellSize;
+        int m_bucketMask;
+        std::vector<int> m_bucketStart;
+        std::vector<int> m_bucketParticles;
+        std::vector<int> m_particleCells;
+        std::vector<int> m_pairStamps;
+        std::vector<int> m_candidates;
+
+        // Packed particle state for the RK4 integrator. Each stage reads one
+        // of the two stage buffers and writes the other one.
+        std::vector<ysVector> m_position;
+        std::vector<ysVector> m_velocity;
+        std::vector<ysVector> m_externalAcceleration;
+        std::vector<ysVector> m_stagePosition[2];
+        std::vector<ysVector> m_stageVelocity[2];
+        std::vector<ysVector> m_dp[4];
+        std::vector<ysVector> m_dv[4];
+        std::vector<float> m_inverseMass;
+        std::vector<float> m_drag;
+
+        std::vector<int> m_collisionStart;
+        std::vector<int> m_collisions;
+
+        // Springs are evaluated once per stage and gathered by both of their
+        // particles. Adjacency entries are (spring << 1) | side where side is
+        // set if the particle is the second end of the spring.
+        std::vector<int> m_springParticles;
+        std::vector<float> m_springConstant;
+        std::vector<float> m_springLength;
+        std::vector<unsigned char> m_springInverted;
+        std::vector<ysVector> m_springForce;
+
+        std::vector<int> m_adjacencyStart;
+        std::vector<int> m_adjacency;
+
+        IntegrationMode m_integrationMode;
+        int m_solverIterations;
+
+        // Accumulated spring impulses of the current step (PositionBased mode)
+        std::vector<float> m_springLambda;
+
+        WorkerPool m_workerPool;
+        int m_threadCount;
+        std::vector<IntegrationCallData> m_integrationJobs;
     };
 
     class MSSParticle : public ysObject {
@@ -91,8 +202,6 @@ namespace dphysics {
         MSSParticle();
         ~MSSParticle();
 
-        ysVector CalculateAcceleration(MassSpringSystem::RK4_PASS pass, float timeDelta);
-
         void RegisterSpring(MSSSpring *spring);
         void UnregisterSpring(MSSSpring *spring);
         void DeleteAllConnections();
@@ -102,17 +211,13 @@ namespace dphysics {
 
         void SetPosition(ysVector position) { m_position = position; }
         ysVector GetPosition() const { return m_position; }
-        ysVector GetPosition(MassSpringSystem::RK4_PASS pass) const;
 
         void SetVelocity(ysVector velocity) { m_velocity = velocity; }
         ysVector GetVelocity() const { return m_velocity; }
-        ysVector GetVelocity(MassSpringSystem::RK4_PASS pass) const;
 
         void SetInverseMass(float inverseMass) { m_inverseMass = inverseMass; }
         float GetInverseMass() const { return m_inverseMass; }
 
-        ysVector ExternalAcceleration(MassSpringSystem::RK4_PASS pass);
-
         void SetDrag(float drag) { m_drag = drag; }
         float GetDrag() const { return m_drag; }
 
@@ -151,17 +256,6 @@ namespace dphysics {
         ysVector m_velocity;
         ysVector m_externalAcceleration;
 
-        ysVector m_DPTemp1;
-        ysVector m_DVTemp1;
-        ysVector m_DPTemp2;
-        ysVector m_DVTemp2;
-        ysVector m_DPTemp3;
-        ysVector m_DVTemp3;
-        ysVector m_DPTemp4;
-        ysVector m_DVTemp4;
-        ysVector m_PTemp;
-        ysVector m_VTemp;
-
         ysExpandingArray<MSSSpring *, 4> m_adjacentSprings;
         ysExpandingArray<MSSParticle *, 4> m_collidingParticles;
 
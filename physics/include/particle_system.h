@@ -3,33 +3,69 @@
 
 #include "delta_core.h"
 
-#include "particle.h"
+#include <vector>
 
 namespace dphysics {
 
-    class DeltaEngine;
+    // Per-particle data of a single instanced draw
+    struct ParticleInstance {
+        float Position[4];
+        float Scale;
+        float Fade;
+        float Density;
+        float Padding;
+    };
 
     class ParticleSystem : public ysObject {
+    public:
+        static const int DefaultCapacity = 4096;
+
     public:
         ParticleSystem();
         ~ParticleSystem();
 
-        ysDynamicArray<Particle, 512> m_particles;
-
         void Update(float timeStep);
-        void SetEngine(DeltaEngine *engine) { m_engine = engine; }
+
+        // Resizing the pool clears all live particles
+        void SetCapacity(int capacity);
+        int GetCapacity() const { return m_capacity; }
+
+        void SetSeed(unsigned int seed) { m_randomState = (seed != 0) ? seed : 1; }
+
         void SetRate(float rate) { m_rate = rate; }
+        float GetRate() const { return m_rate; }
+
         void SetTexture(ysTexture *texture) { m_texture = texture; }
+        ysTexture *GetTexture() const { return m_texture; }
+
         void SetPosition(ysVector position) { m_source = position; }
+        ysVector GetPosition() const { return m_source; }
+
         void SetLayer(int layer) { m_layer = layer; }
+        int GetLayer() const { return m_layer; }
 
-        int GetParticleCount() const { return m_particles.GetNumObjects(); }
+        void SetDamping(float damping) { m_damping = damping; }
+        float GetDamping() const { return m_damping; }
 
-        ysVector GetPosition() const { return m_source; }
+        int GetParticleCount() const { return m_count; }
+
+        ysVector GetParticlePosition(int i) const { return m_position[i]; }
+        ysVector GetParticleVelocity(int i) const { return m_velocity[i]; }
+        float GetParticleAge(int i) const { return m_age[i]; }
+        float GetParticleLife(int i) const { return m_life[i]; }
+        float GetParticleScale(int i) const { return m_scale[i]; }
+
+        // Writes up to maxCount live particles in world space and returns the
+        // number written
+        int WriteInstances(ParticleInstance *target, int maxCount) const;
 
     protected:
-        DeltaEngine *m_engine;
+        void Emit(int count);
+        void Kill(int i);
+
+        float NextRandom();
 
+    protected:
         ysVector m_source;
         ysVector m_direction;
 
@@ -37,8 +73,24 @@ namespace dphysics {
 
         // Number of particles per second
         float m_rate;
+        float m_emissionAccumulator;
+
+        float m_damping;
 
         int m_layer;
+
+        unsigned int m_randomState;
+
+        int m_capacity;
+        int m_count;
+
+        std::vector<ysVector> m_position;
+        std::vector<ysVector> m_velocity;
+        std::vector<float> m_age;
+        std::vector<float> m_life;
+        std::vector<float> m_scale;
+        std::vector<float> m_expansionRate;
+        std::vector<float> m_density;
     };
 
 } /* namespace dbasic */
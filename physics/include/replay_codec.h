@@ -0,0 +1,85 @@
+#ifndef DELTA_BASIC_REPLAY_CODEC_H
+#define DELTA_BASIC_REPLAY_CODEC_H
+
+#include "delta_core.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace dphysics {
+
+    // Shape of one fine collision object, in the body's local space
+    struct ReplayShape {
+        enum class Type : uint8_t {
+            Box,
+            Circle
+        };
+
+        Type ShapeType;
+        float HalfWidth;
+        float HalfHeight;
+        float Radius;
+        float Position[3];
+        float Orientation[4];
+    };
+
+    struct ReplayBodyDescriptor {
+        std::vector<ReplayShape> Shapes;
+    };
+
+    // Binary replay layout shared by ReplayRecorder and ReplayReader.
+    //
+    // Header:  magic, version, body count, flags, quantization, body descriptors
+    // Blocks:  flags, frame, body count, raw size, stored size, payload
+    // Trailer: keyframe index (frame, offset pairs), index offset, end magic
+    //
+    // Every frame stores 7 values per body (position xyz, orientation wxyz).
+    // Values are encoded relative to the previous frame, or to zero in a
+    // keyframe, as variable length integers. Lossless replays encode the XOR
+    // of the raw float bits; quantized replays encode the zigzagged difference
+    // of the quantized values. Payloads can be LZ compressed.
+    class ReplayCodec {
+    public:
+        static const uint32_t Magic = 0x50525044;      // "DPRP"
+        static const uint32_t IndexMagic = 0x49525044; // "DPRI"
+        static const uint32_t Version = 1;
+
+        static const int ValuesPerBody = 7;
+
+        static const uint32_t FlagCompressed = 0x1;
+        static const uint32_t FlagQuantized = 0x2;
+
+        static const uint8_t BlockKeyframe = 0x1;
+        static const uint8_t BlockCompressed = 0x2;
+
+        static const int BlockHeaderSize = 17;
+
+        static constexpr float OrientationQuantization = 1.0f / 32767.0f;
+
+    public:
+        static void WriteVarint(std::vector<uint8_t> &target, uint32_t value);
+        static bool ReadVarint(const uint8_t *&data, const uint8_t *end, uint32_t *value);
+
+        static uint32_t ZigZag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+        static int32_t UnZigZag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+        // Quantized values for lossy replays, indexed by the value's position
+        // within a body (position components first)
+        static int32_t Quantize(float value, int component, float positionQuantization);
+        static float Dequantize(int32_t value, int component, float positionQuantization);
+
+        static void Encode(
+            const uint32_t *values, const uint32_t *previous, int count, bool quantized, std::vector<uint8_t> &target);
+        static bool Decode(
+            const uint8_t *data, const uint8_t *end, const uint32_t *previous, int count, bool quantized, uint32_t *values);
+
+        static void Compress(const uint8_t *data, int size, std::vector<uint8_t> &target);
+        static bool Decompress(const uint8_t *data, int size, uint8_t *target, int targetSize);
+
+        static void WriteU32(uint8_t *target, uint32_t value);
+        static uint32_t ReadU32(const uint8_t *data);
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_REPLAY_CODEC_H */
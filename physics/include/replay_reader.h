@@ -0,0 +1,77 @@
+#ifndef DELTA_BASIC_REPLAY_READER_H
+#define DELTA_BASIC_REPLAY_READER_H
+
+#include "delta_core.h"
+
+#include "replay_codec.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace dphysics {
+
+    // Plays back replays written by ReplayRecorder. Seeking decodes forward
+    // from the closest keyframe at or before the requested frame.
+    class ReplayReader : public ysObject {
+    public:
+        ReplayReader();
+        ~ReplayReader();
+
+        bool Open(const std::string &fname);
+        void Close();
+        bool IsOpen() const { return m_file.is_open(); }
+
+        int GetFrameCount() const { return m_frameCount; }
+        int GetCurrentFrame() const { return m_currentFrame; }
+
+        bool SeekFrame(int frame);
+        bool NextFrame();
+
+        int GetBodyDescriptorCount() const { return (int)m_bodies.size(); }
+        const ReplayBodyDescriptor &GetBodyDescriptor(int body) const { return m_bodies[body]; }
+
+        // Number of bodies in the current frame
+        int GetBodyCount() const { return m_bodyCount; }
+
+        // Transforms of the current frame
+        ysVector GetPosition(int body) const;
+        ysQuaternion GetOrientation(int body) const;
+
+    protected:
+        struct KeyframeEntry {
+            uint32_t Frame;
+            uint64_t Offset;
+        };
+
+        bool ReadHeader();
+        bool ReadIndex();
+        void ScanBlocks();
+        bool ReadBlock(uint64_t offset, uint64_t *nextOffset);
+
+        float GetValue(int body, int component) const;
+
+        std::ifstream m_file;
+        uint64_t m_fileSize;
+        uint64_t m_dataOffset;
+        uint64_t m_dataEnd;
+
+        std::vector<ReplayBodyDescriptor> m_bodies;
+        std::vector<KeyframeEntry> m_keyframes;
+        int m_frameCount;
+
+        bool m_quantized;
+        float m_positionPrecision;
+
+        int m_currentFrame;
+        uint64_t m_nextOffset;
+        int m_bodyCount;
+        std::vector<uint32_t> m_values;
+        std::vector<uint32_t> m_previous;
+        std::vector<uint8_t> m_stored;
+        std::vector<uint8_t> m_encoded;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_REPLAY_READER_H */
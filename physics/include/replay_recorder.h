@@ -0,0 +1,105 @@
+#ifndef DELTA_BASIC_REPLAY_RECORDER_H
+#define DELTA_BASIC_REPLAY_RECORDER_H
+
+#include "delta_core.h"
+
+#include "replay_codec.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dphysics {
+
+    class RigidBody;
+
+    // Writes binary replays from a background thread. The simulation thread
+    // only copies transforms into a bounded ring of frame buffers; encoding,
+    // compression and file I/O happen on the writer thread.
+    class ReplayRecorder : public ysObject {
+    public:
+        static const int DefaultKeyframeInterval = 60;
+        static const int DefaultBufferedFrameLimit = 16;
+
+    public:
+        ReplayRecorder();
+        ~ReplayRecorder();
+
+        bool Open(const std::string &fname, const std::vector<ReplayBodyDescriptor> &bodies);
+        void Close();
+        bool IsOpen() const { return m_open; }
+
+        // Returns storage for bodyCount * ReplayCodec::ValuesPerBody values,
+        // blocking while the ring is full
+        float *BeginFrame(int bodyCount);
+        void EndFrame();
+
+        static void DescribeBody(RigidBody *body, ReplayBodyDescriptor *descriptor);
+
+        // Settings only take effect on the next call to Open()
+        void SetKeyframeInterval(int interval) { m_keyframeInterval = (interval > 0) ? interval : 1; }
+        int GetKeyframeInterval() const { return m_keyframeInterval; }
+
+        void SetCompressionEnabled(bool enabled) { m_compressionEnabled = enabled; }
+        bool IsCompressionEnabled() const { return m_compressionEnabled; }
+
+        // A precision of 0 records lossless replays
+        void SetPositionPrecision(float precision) { m_positionPrecision = precision; }
+        float GetPositionPrecision() const { return m_positionPrecision; }
+
+        void SetBufferedFrameLimit(int limit) { m_bufferedFrameLimit = (limit > 0) ? limit : 1; }
+        int GetBufferedFrameLimit() const { return m_bufferedFrameLimit; }
+
+        int GetFrameCount() const { return m_frameCount; }
+
+    protected:
+        struct FrameBuffer {
+            std::vector<float> Values;
+            int BodyCount;
+        };
+
+        struct KeyframeEntry {
+            uint32_t Frame;
+            uint64_t Offset;
+        };
+
+        void WriterLoop();
+        void WriteFrame(const FrameBuffer &frame);
+        void WriteIndex();
+
+        std::ofstream m_file;
+        bool m_open;
+
+        std::thread m_writer;
+        std::mutex m_lock;
+        std::condition_variable m_frameReady;
+        std::condition_variable m_slotFree;
+
+        std::vector<FrameBuffer> m_ring;
+        int m_ringHead;
+        int m_ringCount;
+        bool m_shutdown;
+
+        // Writer thread state
+        std::vector<uint32_t> m_previous;
+        int m_previousBodyCount;
+        std::vector<uint32_t> m_values;
+        std::vector<uint8_t> m_encoded;
+        std::vector<uint8_t> m_compressed;
+        std::vector<KeyframeEntry> m_keyframes;
+        uint64_t m_offset;
+        int m_writtenFrames;
+
+        int m_frameCount;
+        int m_keyframeInterval;
+        int m_bufferedFrameLimit;
+        bool m_compressionEnabled;
+        float m_positionPrecision;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_REPLAY_RECORDER_H */
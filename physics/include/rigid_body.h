@@ -4,6 +4,7 @@
 #include "delta_core.h"
 
 #include "collision_geometry.h"
+#include "rigid_body_state.h"
 
 namespace dphysics {
 
@@ -13,6 +14,7 @@ namespace dphysics {
 
     class RigidBody : public ysObject {
         friend RigidBodySystem;
+        friend RigidBodyState;
 
     public:
         enum class RigidBodyHint {
@@ -23,44 +25,57 @@ namespace dphysics {
         struct GridCell {
             int x;
             int y;
+            int index;
         };
 
     public:
         RigidBody();
         ~RigidBody();
 
+        // Bodies own their detached state and are referenced by address
+        // from their system, so they cannot be copied
+        RigidBody(const RigidBody &) = delete;
+        RigidBody &operator=(const RigidBody &) = delete;
+
         // Interfaces
         CollisionGeometry CollisionGeometry;
         ysTransform Transform;
 
         void Integrate(float timeStep);
         void UpdateDerivedData(bool force = false);
-        void CheckAwake();
+        void UpdateRestTime(float timeStep, float linearThreshold, float angularThreshold);
+        float GetRestTime() const { return m_restTime; }
+
+        // Whether the transform changed during the last step, either through
+        // the body's velocity or by being placed by the caller
+        void UpdateMoved();
+        bool HasMoved() const { return m_moved; }
 
         void SetMaterial(int material) { m_material = material; }
         int GetMaterial() const { return m_material; }
 
-        void AddAngularVelocity(const ysVector &v) { m_angularVelocity = ysMath::Add(v, m_angularVelocity); }
-        void AddVelocity(const ysVector &v) { m_velocity = ysMath::Add(v, m_velocity); }
+        void AddAngularVelocity(const ysVector &v) { SetAwake(true); ysVector &w = State().m_angularVelocity[m_stateIndex]; w = ysMath::Add(v, w); }
+        void AddVelocity(const ysVector &v) { SetAwake(true); ysVector &u = State().m_velocity[m_stateIndex]; u = ysMath::Add(v, u); }
 
-        void SetVelocity(const ysVector &v) { m_velocity = v; }
-        ysVector GetVelocity() const { return m_velocity; }
+        void SetVelocity(const ysVector &v) { SetAwake(true); State().m_velocity[m_stateIndex] = v; }
+        ysVector GetVelocity() const { return State().m_velocity[m_stateIndex]; }
 
-        void SetAngularVelocity(const ysVector &v) { m_angularVelocity = v; }
-        ysVector GetAngularVelocity() const { return m_angularVelocity; }
+        void SetAngularVelocity(const ysVector &v) { SetAwake(true); State().m_angularVelocity[m_stateIndex] = v; }
+        ysVector GetAngularVelocity() const { return State().m_angularVelocity[m_stateIndex]; }
 
         ysVector GetVelocityAtLocalPoint(const ysVector &localPoint);
         ysVector GetVelocityAtWorldPoint(const ysVector &worldPoint);
 
-        ysMatrix GetInverseInertiaTensor() const { return m_inverseInertiaTensor; }
+        ysMatrix GetInverseInertiaTensor() const { return State().m_inverseInertiaTensor[m_stateIndex]; }
         ysMatrix GetInverseInertiaTensorWorld();
 
         void SetInverseInertiaTensor(const ysMatrix &tensor);
         ysMatrix GetRectangleTensor(float dx, float dy);
 
-        void SetInverseMass(float inverseMass) { m_inverseMass = inverseMass; }
+        void SetInverseMass(float inverseMass) { State().m_inverseMass[m_stateIndex] = inverseMass; }
 
-        float GetInverseMass() const { return m_inverseMass; }
+        float GetInverseMass() const { return State().m_inverseMass[m_stateIndex]; }
+        bool IsImmovable() const;
 
         RigidBody *GetRoot() { if (m_parent != nullptr) return m_parent->GetRoot(); else return this; }
         void AddChild(RigidBody *body);
@@ -69,7 +84,7 @@ namespace dphysics {
 
         void RequestCollisions();
         void ClearCollisions() { m_collisions.Clear(); }
-        void AddCollision(Collision *collision) { SetAwake(true); m_collisions.New() = collision; }
+        void AddCollision(Collision *collision, bool wake = true) { if (wake) SetAwake(true); m_collisions.New() = collision; }
         int GetCollisionCount() { return m_collisions.GetNumObjects(); }
         Collision *GetCollision(int index) { return m_collisions[index]; }
 
@@ -79,7 +94,7 @@ namespace dphysics {
         bool IsRegistered() const { return m_registered; }
 
         bool IsAwake() const { return m_awake; }
-        void SetAwake(bool awake) { m_awake = awake; }
+        void SetAwake(bool awake) { if (awake && !m_awake) m_restTime = 0.0f; m_awake = awake; }
 
         bool RequestsInformation() const { return m_requestsInformation; }
         void SetRequestsInformation(bool ri) { m_requestsInformation = ri; }
@@ -90,36 +105,36 @@ namespace dphysics {
         void SetHint(RigidBodyHint hint) { m_hint = hint; }
         RigidBodyHint GetHint() const { return m_hint; }
 
-        void AddGridCell(int x, int y);
+        void AddGridCell(int x, int y, int index);
         void ClearGridCells() { m_gridCells.Clear(); }
         int GetGridCellCount() { return m_gridCells.GetNumObjects(); }
         GridCell *GetGridCells() { return m_gridCells.GetBuffer(); }
 
-        void SetAcceleration(ysVector &acceleration) { m_acceleration = acceleration; }
-        ysVector GetAcceleration() const { return m_acceleration; }
+        void SetAcceleration(ysVector &acceleration) { SetAwake(true); State().m_acceleration[m_stateIndex] = acceleration; }
+        ysVector GetAcceleration() const { return State().m_acceleration[m_stateIndex]; }
 
         void AddAngularImpulseLocal(const ysVector &impulse);
         void AddImpulseLocalSpace(const ysVector &impulse, const ysVector &localPoint);
         void AddImpulseWorldSpace(const ysVector &impulse, const ysVector &point);
-        void ClearAngularImpulseAccumulator() { m_angularImpulseAccum = ysMath::Constants::Zero; }
-        void ClearImpulseAccumulator() { m_impulseAccum = ysMath::Constants::Zero; }
+        void ClearAngularImpulseAccumulator() { State().m_angularImpulseAccum[m_stateIndex] = ysMath::Constants::Zero; }
+        void ClearImpulseAccumulator() { State().m_impulseAccum[m_stateIndex] = ysMath::Constants::Zero; }
 
         void AddForceLocalSpace(const ysVector &force, const ysVector &localPoint);
         void AddForceWorldSpace(const ysVector &force, const ysVector &point);
-        void ClearForceAccumulator() { m_forceAccum = ysMath::Constants::Zero; }
-        ysVector GetForce() const { return m_forceAccum; }
+        void ClearForceAccumulator() { State().m_forceAccum[m_stateIndex] = ysMath::Constants::Zero; }
+        ysVector GetForce() const { return State().m_forceAccum[m_stateIndex]; }
 
-        void AddTorque(const ysVector &torque) { m_torqueAccum = ysMath::Add(m_torqueAccum, torque); }
+        void AddTorque(const ysVector &torque) { SetAwake(true); ysVector &t = State().m_torqueAccum[m_stateIndex]; t = ysMath::Add(t, torque); }
         void AddTorqueLocal(const ysVector &torque);
-        void ClearTorqueAccumulator() { m_torqueAccum = ysMath::Constants::Zero; }
-        ysVector GetTorque() const { return m_torqueAccum; }
+        void ClearTorqueAccumulator() { State().m_torqueAccum[m_stateIndex] = ysMath::Constants::Zero; }
+        ysVector GetTorque() const { return State().m_torqueAccum[m_stateIndex]; }
 
         void ClearAccumulators();
 
         void SetGhost(bool ghost) { m_ghost = ghost; }
         bool IsGhost() const { return m_ghost; }
 
-        void SetLinearDamping(float damping) { m_linearDamping = damping; }
+        void SetLinearDamping(float damping) { State().SetLinearDamping(m_stateIndex, damping); }
 
         void WriteInfo(std::fstream &target);
 
@@ -141,6 +156,22 @@ namespace dphysics {
 
         Collision *FindMatchingCollision(Collision *collision);
 
+    protected:
+        void IntegrateTransform(float timeStep);
+
+        // Hot state lives in the system's store while the body is registered.
+        // Otherwise the body owns a single-slot store which is released on
+        // registration.
+        RigidBodyState &State() { return *m_state; }
+        const RigidBodyState &State() const { return *m_state; }
+
+        void DetachState();
+        void AttachState(RigidBodyState *state);
+
+        RigidBodyState *m_state;
+        RigidBodyState *m_detachedState;
+        int m_stateIndex;
+
     protected:
         // Properties
         bool m_registered;
@@ -150,25 +181,16 @@ namespace dphysics {
         bool m_fixedPosition;
 
         int m_material;
-        float m_inverseMass;
-        float m_linearDamping;
-        float m_angularDamping;
-
-        ysVector m_torqueAccum;
-        ysVector m_forceAccum;
-        ysVector m_acceleration;
-        ysVector m_velocity;
-        ysVector m_angularVelocity;
-        ysVector m_impulseAccum;
-        ysVector m_angularImpulseAccum;
-
-        ysMatrix m_inverseInertiaTensor;
 
         // Derived
         bool m_derivedValid;
         bool m_ghost;
 
-        ysVector m_lastWorldPosition;
+        float m_restTime;
+
+        ysVector m_lastPosition;
+        ysQuaternion m_lastOrientation;
+        bool m_moved;
 
         ysExpandingArray<RigidBody *, 4> m_children;
         RigidBody *m_parent;
@@ -176,6 +198,10 @@ namespace dphysics {
 
         ysExpandingArray<Collision *, 4> m_collisions;
         ysExpandingArray<GridCell, 4> m_gridCells;
+
+        // Leaf in the system's static tree, -1 while the body is in the grid
+        int m_treeProxy;
+
         ysDynamicArray<ForceGenerator, 4> m_forceGenerators;
 
         RigidBodyHint m_hint;
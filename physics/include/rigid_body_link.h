@@ -15,6 +15,8 @@ namespace dphysics {
         ~RigidBodyLink();
 
         void SetRigidBodies(RigidBody *body1, RigidBody *body2) { m_body1 = body1; m_body2 = body2; }
+        RigidBody *GetBody1() const { return m_body1; }
+        RigidBody *GetBody2() const { return m_body2; }
 
         virtual int GenerateCollisions(Collision *collisionArray) { return 0; }
         virtual void DrawDebug(DeltaEngine *engine, int layer) { /* void */ }
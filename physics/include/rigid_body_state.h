@@ -0,0 +1,71 @@
+#ifndef DELTA_BASIC_RIGID_BODY_STATE_H
+#define DELTA_BASIC_RIGID_BODY_STATE_H
+
+#include "delta_core.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace dphysics {
+
+    class RigidBody;
+    class RigidBodySystem;
+
+    // Structure-of-arrays store for the per-step state of rigid bodies.
+    // Registered bodies keep their state in the store owned by the system and
+    // refer to it by slot index, so the integration kernel walks contiguous
+    // arrays instead of following body pointers.
+    class RigidBodyState : public ysObject {
+        friend RigidBody;
+        friend RigidBodySystem;
+
+    public:
+        RigidBodyState();
+        ~RigidBodyState();
+
+        int Add(RigidBody *body);
+        void Remove(int index);
+        void Copy(int index, const RigidBodyState &source, int sourceIndex);
+
+        int GetCount() const { return (int)m_bodies.size(); }
+        RigidBody *GetBody(int index) const { return m_bodies[index]; }
+
+        void ClearAccumulators();
+        void Integrate(float timeStep);
+
+        void SetLinearDamping(int index, float damping);
+
+    protected:
+        void IntegrateVelocity(int index, float timeStep);
+        void AdvanceVelocity(int index, float timeStep);
+
+        // Damping is per second so it is raised to the time step, which only
+        // has to be done again when the step or the damping changes
+        void UpdateDampingFactors(float timeStep);
+        void UpdateDampingFactors(int index);
+
+        std::vector<RigidBody *> m_bodies;
+
+        std::vector<ysVector> m_velocity;
+        std::vector<ysVector> m_angularVelocity;
+        std::vector<ysVector> m_acceleration;
+        std::vector<ysVector> m_forceAccum;
+        std::vector<ysVector> m_torqueAccum;
+        std::vector<ysVector> m_impulseAccum;
+        std::vector<ysVector> m_angularImpulseAccum;
+        std::vector<ysMatrix> m_inverseInertiaTensor;
+
+        std::vector<float> m_inverseMass;
+        std::vector<float> m_linearDamping;
+        std::vector<float> m_angularDamping;
+        std::vector<float> m_linearDampingFactor;
+        std::vector<float> m_angularDampingFactor;
+        float m_dampingTimeStep;
+
+        // Set by the system for the slots that are integrated this step
+        std::vector<uint8_t> m_integrate;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_RIGID_BODY_STATE_H */
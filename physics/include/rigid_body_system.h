@@ -5,9 +5,17 @@
 
 #include "collision_object.h"
 #include "rigid_body.h"
+#include "rigid_body_state.h"
 #include "collision_detector.h"
 #include "rigid_body_link.h"
 #include "grid_partition_system.h"
+#include "collision_pair_cache.h"
+#include "collision_pool.h"
+#include "aabb_tree.h"
+#include "scene_query.h"
+#include "worker_pool.h"
+#include "island_builder.h"
+#include "replay_recorder.h"
 
 #define NOMINMAX
 
@@ -26,6 +34,22 @@ namespace dphysics {
     public:
         static const int ResolutionIterationLimit = 1024;
         static float ResolutionPenetrationEpsilon;
+        static const int DefaultSolverIterations = 10;
+
+        static const std::string IslandBreakdownCount;
+        static const std::string IslandBreakdownAwake;
+        static const std::string IslandBreakdownLargestBodies;
+        static const std::string IslandBreakdownLargestContacts;
+
+        enum class SolverMode {
+            LargestViolation,
+            SequentialImpulse
+        };
+
+        enum class BroadphaseMode {
+            Grid,
+            GridAndTree
+        };
 
         struct CollisionGenerationCallData {
             RigidBodySystem *System;
@@ -34,6 +58,17 @@ namespace dphysics {
             int ThreadID;
         };
 
+        // Group of bodies connected through contacts or links. Immovable
+        // bodies do not join islands so that, for example, everything resting
+        // on the ground is not merged into a single island.
+        struct Island {
+            int BodyStart;
+            int BodyCount;
+            int CollisionStart;
+            int CollisionCount;
+            bool Awake;
+        };
+
     public:
         RigidBodySystem();
         ~RigidBodySystem();
@@ -52,6 +87,11 @@ namespace dphysics {
 
         void Update(float timeStep);
 
+        // Runs as many fixed steps as fit into the elapsed time and returns
+        // how many were run. The step is set on the timestep accumulator.
+        int Advance(float frameDuration);
+        ysTimestepAccumulator *GetTimestepAccumulator() { return &m_timestepAccumulator; }
+
         template<typename T_Link>
         T_Link *CreateLink(RigidBody *body1, RigidBody *body2) {
             T_Link *newLink = m_rigidBodyLinks.NewGeneric<T_Link, 16>();
@@ -65,44 +105,195 @@ namespace dphysics {
 
         void ProcessGridCell(int x, int y);
 
+        // Number of threads used for collision generation, including the
+        // calling thread. Results do not depend on this setting.
+        void SetThreadCount(int threadCount) { m_threadCount = (threadCount > 0) ? threadCount : 1; }
+        int GetThreadCount() const { return m_threadCount; }
+
+        // An island goes to sleep once all of its bodies stayed below the
+        // velocity thresholds for the given amount of time. Sleeping is off
+        // unless enabled.
+        void SetSleepingEnabled(bool enabled) { m_sleepingEnabled = enabled; }
+        bool IsSleepingEnabled() const { return m_sleepingEnabled; }
+        void SetSleepThresholds(float linearVelocity, float angularVelocity, float time);
+
+        // The sequential impulse solver runs a fixed number of iterations and
+        // is warm started with the impulses of the previous frame's contacts
+        void SetSolverMode(SolverMode mode) { m_solverMode = mode; }
+        SolverMode GetSolverMode() const { return m_solverMode; }
+        void SetSolverIterations(int iterations) { m_solverIterations = (iterations > 0) ? iterations : 1; }
+        int GetSolverIterations() const { return m_solverIterations; }
+
+        // In GridAndTree mode, immovable static bodies and sleeping bodies are
+        // kept in an AABB tree instead of being rebinned into the grid every
+        // frame. Pairs against them are found by querying the tree with the
+        // bounds of each body in the grid.
+        void SetBroadphaseMode(BroadphaseMode mode) { m_broadphaseMode = mode; }
+        BroadphaseMode GetBroadphaseMode() const { return m_broadphaseMode; }
+        const AabbTree &GetStaticTree() const { return m_staticTree; }
+
+        // Scene queries test against the grid and static tree as they were
+        // built by the last Update(). Each batch is split across the collision
+        // threads. Raycasts and sweeps without a positive MaxDistance never
+        // hit anything.
+        void RaycastBatch(const RaycastQuery *queries, int count, QueryHit *hits);
+        void SweepCircleBatch(const SweepCircleQuery *queries, int count, QueryHit *hits);
+        void OverlapCircleBatch(
+            const OverlapCircleQuery *queries, int count, OverlapResult *results, std::vector<RigidBody *> &bodies);
+
+        int GetIslandCount() const { return (int)m_islands.size(); }
+        const Island &GetIsland(int index) const { return m_islands[index]; }
+        RigidBody *GetIslandBody(const Island &island, int index) { return m_islandBodies[island.BodyStart + index]; }
+
+        void AttachBreakdownTimer(ysBreakdownTimer *breakdownTimer);
+
         void OpenReplayFile(const std::string &fname);
         void CloseReplayFile();
+        ReplayRecorder &GetReplayRecorder() { return m_replayRecorder; }
+
+    protected:
+        struct PairContacts {
+            RigidBody *Body1;
+            RigidBody *Body2;
+            int Start;
+            int Count;
+        };
+
+        struct CollisionThreadContext {
+            std::vector<int> PairStamps;
+            std::vector<Collision> Collisions;
+            std::vector<PairContacts> Pairs;
+            std::vector<int> TreeProxies;
+        };
+
+        struct SceneQueryCallData {
+            RigidBodySystem *System;
+            int Start;
+            int Count;
+            int ThreadID;
+
+            const RaycastQuery *Raycasts;
+            const SweepCircleQuery *Sweeps;
+            const OverlapCircleQuery *Overlaps;
+            QueryHit *Hits;
+            OverlapResult *Results;
+        };
+
+        struct SceneQueryContext {
+            std::vector<int> Proxies;
+            std::vector<RigidBody *> Candidates;
+            std::vector<RigidBody *> Bodies;
+        };
+
+        struct IslandSolveCallData {
+            RigidBodySystem *System;
+            int Island;
+            float TimeStep;
+        };
 
     protected:
         bool CollisionExists(Collision *collision);
+        Collision *FindPreviousCollision(Collision *collision);
+        Collision *GetCollision(int index) { return m_collisionPools[m_currentCollisionPool].Get(index); }
 
         void GenerateCollisions();
         void InitializeCollisions();
         void CleanCollisions();
         void ClearCollisions();
         void GenerateCollisions(RigidBody *body1, RigidBody *body2);
+        int DetectCollisions(RigidBody *body1, RigidBody *body2, std::vector<Collision> &collisions);
+        void CommitCollisions(RigidBody *body1, RigidBody *body2, Collision *collisions, int count);
+        void RecordContact(Collision *collision);
 
-        void ResolveCollisions(float dt);
+        void ResolveCollisions(Collision **collisions, int count, float dt);
         void ResolveCollision(Collision *collision, ysVector *velocityChange, ysVector *rotationDirection, float rotationAmount[2], float penetration);
 
-        void AdjustVelocities(float timestep);
+        void AdjustVelocities(Collision **collisions, int count, float timestep);
         void AdjustVelocity(Collision *collision, ysVector velocityChange[2], ysVector rotationChange[2]);
 
+        void SolveSequentialImpulse(Collision **collisions, int count, float timestep);
+        static void ApplyImpulse(Collision *collision, const ysVector &impulse);
+        static ysVector CalculateRelativeVelocity(Collision *collision);
+
         void GenerateForces(float timeStep);
         void Integrate(float timeStep);
         void UpdateDerivedData();
-        void CheckAwake();
+        void CheckAwake(float timeStep);
+
+        void BuildIslands();
+        void MergeIslandBodies(RigidBody *body1, RigidBody *body2);
+
+        // Island of the first body of the collision that has one, -1 if the
+        // collision only involves immovable or foreign bodies
+        int GetCollisionIsland(const Collision *collision) const;
+        void SolveIslands(float timeStep);
+        void SolveIsland(int island, float timeStep);
+        static void SolveIslandThread(void *data);
+        void RecordIslandStatistics();
+
+        static bool IsSimulated(RigidBody *body) { return body->IsAwake() && !body->IsImmovable(); }
+
+        // Immovable bodies that are moved by the caller push other bodies
+        // around just like simulated ones
+        static bool IsWaker(RigidBody *body) { return IsSimulated(body) || (body->HasMoved() && body->IsImmovable()); }
+        static bool NeedsContacts(RigidBody *body) { return IsWaker(body) || body->RequestsInformation(); }
 
         void OrderPrimitives(CollisionObject **prim1, CollisionObject **prim2, RigidBody **body1, RigidBody **body2);
 
-        void GenerateCollisions(int start, int count);
+        void GenerateCollisions(int start, int count, int threadId);
+        static void GenerateCollisionsThread(void *data);
+        static bool ShouldProcessGridCell(const GridCell *gridCell);
 
-        void WriteFrameToReplayFile();
+        void UpdateStaticTree();
+        bool BelongsInStaticTree(RigidBody *body) const;
+        static bool GetBodyBounds(RigidBody *body, ysVector &minPoint, ysVector &maxPoint);
+
+        void RunSceneQueries(const SceneQueryCallData &batch, int count);
+        static void SceneQueryThread(void *data);
+        void ProcessSceneQueries(const SceneQueryCallData &job);
+        void GatherQueryCandidates(const ysVector &start, const ysVector &end, float radius, SceneQueryContext &context);
+        void Sweep(
+            const ysVector &origin, const ysVector &direction, float radius, float maxDistance,
+            unsigned int layerMask, SceneQueryContext &context, QueryHit *hit);
+        void Overlap(const ysVector &center, float radius, unsigned int layerMask, SceneQueryContext &context);
+        static bool IsOnQueryLayer(const CollisionObject *object, unsigned int layerMask);
 
-        void AttachBreakdownTimer(ysBreakdownTimer *breakdownTimer) { m_breakdownTimer = breakdownTimer; }
+        void WriteFrameToReplayFile();
 
     protected:
         ysRegistry<RigidBody, 512> m_rigidBodyRegistry;
+        RigidBodyState m_bodyState;
 
         ysDynamicArray<RigidBodyLink, 512> m_rigidBodyLinks;
 
-        ysDynamicArray<Collision, 4> m_dynamicCollisions;
-        ysExpandingArray<Collision *, 8192> m_collisionAccumulator;
+        // Contacts are allocated from the current pool and referenced by
+        // their index in it
+        CollisionPool m_collisionPools[2];
+        int m_currentCollisionPool;
+        ysExpandingArray<int, 8192> m_collisionAccumulator;
+
+        SolverMode m_solverMode;
+        int m_solverIterations;
+
+        CollisionPairCache m_pairCache;
+
+        WorkerPool m_workerPool;
+        int m_threadCount;
+        std::vector<CollisionGenerationCallData> m_collisionJobs;
+        std::vector<CollisionThreadContext> m_threadContexts;
+        std::vector<Collision> m_narrowphaseScratch;
+
+        IslandBuilder m_islandBuilder;
+        std::vector<Island> m_islands;
+        std::vector<RigidBody *> m_islandBodies;
+        std::vector<Collision *> m_islandCollisions;
+        std::vector<int> m_bodyIslands;
+        std::vector<IslandSolveCallData> m_islandJobs;
+
+        bool m_sleepingEnabled;
+        float m_sleepLinearThreshold;
+        float m_sleepAngularThreshold;
+        float m_sleepTime;
 
         std::vector<std::vector<float>> m_dynamicFrictionTable;
         std::vector<std::vector<float>> m_staticFrictionTable;
@@ -114,16 +305,28 @@ namespace dphysics {
         int m_loadMeasurement;
         float m_currentStep;
 
+        ysTimestepAccumulator m_timestepAccumulator;
+
         ysBreakdownTimer *m_breakdownTimer;
+        ysBreakdownTimerChannel *m_islandCountChannel;
+        ysBreakdownTimerChannel *m_awakeIslandChannel;
+        ysBreakdownTimerChannel *m_largestIslandBodiesChannel;
+        ysBreakdownTimerChannel *m_largestIslandContactsChannel;
 
         // TEST
         GridPartitionSystem m_gridPartitionSystem;
+
+        BroadphaseMode m_broadphaseMode;
+        AabbTree m_staticTree;
+
+        std::vector<SceneQueryCallData> m_queryJobs;
+        std::vector<SceneQueryContext> m_queryContexts;
         std::ofstream m_loggingOutput;
 
     protected:
         // Debug
-        std::fstream m_outputFile;
-        bool m_replayEnabled;
+        ReplayRecorder m_replayRecorder;
+        std::vector<ReplayBodyDescriptor> m_replayBodies;
     };
 
 } /* namespace dbasic */
@@ -0,0 +1,51 @@
+#ifndef DELTA_BASIC_SCENE_QUERY_H
+#define DELTA_BASIC_SCENE_QUERY_H
+
+#include "delta_core.h"
+
+namespace dphysics {
+
+    class RigidBody;
+    class CollisionObject;
+
+    // Queries only consider Fine collision objects whose layer is set in
+    // LayerMask. Directions do not need to be normalized.
+    struct RaycastQuery {
+        ysVector Origin;
+        ysVector Direction;
+        float MaxDistance;
+        unsigned int LayerMask;
+    };
+
+    struct SweepCircleQuery {
+        ysVector Origin;
+        ysVector Direction;
+        float Radius;
+        float MaxDistance;
+        unsigned int LayerMask;
+    };
+
+    struct OverlapCircleQuery {
+        ysVector Center;
+        float Radius;
+        unsigned int LayerMask;
+    };
+
+    // Closest hit of a raycast or sweep. Body is null if nothing was hit.
+    struct QueryHit {
+        RigidBody *Body;
+        CollisionObject *Object;
+        ysVector Position;
+        ysVector Normal;
+        float Distance;
+    };
+
+    // Range of the bodies overlapped by a query in the shared output array
+    struct OverlapResult {
+        int Start;
+        int Count;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_SCENE_QUERY_H */
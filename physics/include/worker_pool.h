@@ -0,0 +1,58 @@
+#ifndef DELTA_BASIC_WORKER_POOL_H
+#define DELTA_BASIC_WORKER_POOL_H
+
+#include "delta_core.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dphysics {
+
+    // Fixed set of threads that execute batches of jobs. The calling thread
+    // takes part in every batch, so a pool without workers simply runs the
+    // jobs serially.
+    class WorkerPool : public ysObject {
+    public:
+        typedef void (*JobFunction)(void *data);
+
+    public:
+        WorkerPool();
+        ~WorkerPool();
+
+        void Initialize(int workerCount);
+        void Destroy();
+
+        // Calls function once for each of the count elements of data (which
+        // are stride bytes apart) and blocks until every job has finished
+        void Run(JobFunction function, void *data, int stride, int count);
+
+        int GetWorkerCount() const { return (int)m_workers.size(); }
+
+        static int GetHardwareThreadCount();
+
+    protected:
+        void WorkerLoop(unsigned int batch);
+        void ExecuteJobs();
+
+        std::vector<std::thread> m_workers;
+        std::mutex m_lock;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+
+        JobFunction m_function;
+        char *m_data;
+        int m_stride;
+        int m_jobCount;
+
+        std::atomic<int> m_nextJob;
+        int m_busyWorkers;
+        unsigned int m_batch;
+        bool m_shutdown;
+    };
+
+} /* namespace dphysics */
+
+#endif /* DELTA_BASIC_WORKER_POOL_H */
@@ -0,0 +1,339 @@
+#include "../include/aabb_tree.h"
+
+#include <algorithm>
+#include <assert.h>
+
+dphysics::AabbTree::AabbTree() : ysObject("AabbTree") {
+    m_root = -1;
+    m_freeList = -1;
+    m_proxyCount = 0;
+
+    m_margin = DefaultMargin;
+}
+
+dphysics::AabbTree::~AabbTree() {
+    /* void */
+}
+
+int dphysics::AabbTree::CreateProxy(const ysVector &minPoint, const ysVector &maxPoint, void *data) {
+    const int proxy = AllocateNode();
+
+    Node &node = m_nodes[proxy];
+    node.Min[0] = ysMath::GetX(minPoint) - m_margin;
+    node.Min[1] = ysMath::GetY(minPoint) - m_margin;
+    node.Max[0] = ysMath::GetX(maxPoint) + m_margin;
+    node.Max[1] = ysMath::GetY(maxPoint) + m_margin;
+    node.Data = data;
+    node.Height = 0;
+
+    InsertLeaf(proxy);
+    ++m_proxyCount;
+
+    return proxy;
+}
+
+void dphysics::AabbTree::DestroyProxy(int proxy) {
+    assert(m_nodes[proxy].IsLeaf());
+
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --m_proxyCount;
+}
+
+bool dphysics::AabbTree::MoveProxy(int proxy, const ysVector &minPoint, const ysVector &maxPoint) {
+    Node &node = m_nodes[proxy];
+
+    const float minX = ysMath::GetX(minPoint), minY = ysMath::GetY(minPoint);
+    const float maxX = ysMath::GetX(maxPoint), maxY = ysMath::GetY(maxPoint);
+
+    if (minX >= node.Min[0] && minY >= node.Min[1] &&
+        maxX <= node.Max[0] && maxY <= node.Max[1])
+    {
+        return false;
+    }
+
+    RemoveLeaf(proxy);
+
+    node.Min[0] = minX - m_margin;
+    node.Min[1] = minY - m_margin;
+    node.Max[0] = maxX + m_margin;
+    node.Max[1] = maxY + m_margin;
+
+    InsertLeaf(proxy);
+
+    return true;
+}
+
+void dphysics::AabbTree::Query(
+    const ysVector &minPoint, const ysVector &maxPoint, std::vector<int> &proxies) const
+{
+    if (m_root == -1) return;
+
+    const float minX = ysMath::GetX(minPoint), minY = ysMath::GetY(minPoint);
+    const float maxX = ysMath::GetX(maxPoint), maxY = ysMath::GetY(maxPoint);
+
+    // The tree is balanced so its height stays far below the stack size
+    int stack[MaxQueryDepth];
+    int stackSize = 0;
+    stack[stackSize++] = m_root;
+
+    while (stackSize > 0) {
+        const Node &node = m_nodes[stack[--stackSize]];
+
+        if (node.Min[0] > maxX || node.Max[0] < minX) continue;
+        if (node.Min[1] > maxY || node.Max[1] < minY) continue;
+
+        if (node.IsLeaf()) {
+            proxies.push_back((int)(&node - m_nodes.data()));
+        }
+        else {
+            assert(stackSize + 2 <= MaxQueryDepth);
+            stack[stackSize++] = node.Children[1];
+            stack[stackSize++] = node.Children[0];
+        }
+    }
+}
+
+void dphysics::AabbTree::QuerySegment(
+    const ysVector &start, const ysVector &end, float radius, std::vector<int> &proxies) const
+{
+    if (m_root == -1) return;
+
+    const float origin[2] = { ysMath::GetX(start), ysMath::GetY(start) };
+    const float delta[2] = { ysMath::GetX(end) - origin[0], ysMath::GetY(end) - origin[1] };
+
+    int stack[MaxQueryDepth];
+    int stackSize = 0;
+    stack[stackSize++] = m_root;
+
+    while (stackSize > 0) {
+        const Node &node = m_nodes[stack[--stackSize]];
+        if (!SegmentOverlaps(node, origin, delta, radius)) continue;
+
+        if (node.IsLeaf()) {
+            proxies.push_back((int)(&node - m_nodes.data()));
+        }
+        else {
+            assert(stackSize + 2 <= MaxQueryDepth);
+            stack[stackSize++] = node.Children[1];
+            stack[stackSize++] = node.Children[0];
+        }
+    }
+}
+
+void dphysics::AabbTree::Clear() {
+    m_nodes.clear();
+    m_root = -1;
+    m_freeList = -1;
+    m_proxyCount = 0;
+}
+
+int dphysics::AabbTree::AllocateNode() {
+    int node;
+    if (m_freeList != -1) {
+        node = m_freeList;
+        m_freeList = m_nodes[node].Parent;
+    }
+    else {
+        node = (int)m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+
+    Node &newNode = m_nodes[node];
+    newNode.Parent = -1;
+    newNode.Children[0] = newNode.Children[1] = -1;
+    newNode.Height = 0;
+    newNode.Data = nullptr;
+
+    return node;
+}
+
+void dphysics::AabbTree::FreeNode(int node) {
+    m_nodes[node].Parent = m_freeList;
+    m_nodes[node].Height = -1;
+    m_freeList = node;
+}
+
+void dphysics::AabbTree::InsertLeaf(int leaf) {
+    if (m_root == -1) {
+        m_root = leaf;
+        m_nodes[leaf].Parent = -1;
+        return;
+    }
+
+    // Descend towards the sibling that increases the total perimeter of the
+    // tree the least
+    int index = m_root;
+    while (!m_nodes[index].IsLeaf()) {
+        const Node &node = m_nodes[index];
+        const Node &leafNode = m_nodes[leaf];
+
+        const float perimeter = Perimeter(node.Min, node.Max);
+        const float combinedPerimeter = CombinedPerimeter(node, leafNode);
+
+        const float cost = 2.0f * combinedPerimeter;
+        const float inheritanceCost = 2.0f * (combinedPerimeter - perimeter);
+
+        float childCost[2];
+        for (int i = 0; i < 2; ++i) {
+            const Node &child = m_nodes[node.Children[i]];
+            childCost[i] = CombinedPerimeter(child, leafNode) + inheritanceCost;
+
+            if (!child.IsLeaf()) {
+                childCost[i] -= Perimeter(child.Min, child.Max);
+            }
+        }
+
+        if (cost < childCost[0] && cost < childCost[1]) break;
+
+        index = (childCost[0] <= childCost[1]) ? node.Children[0] : node.Children[1];
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].Parent;
+    const int newParent = AllocateNode();
+
+    Node &parentNode = m_nodes[newParent];
+    parentNode.Parent = oldParent;
+    parentNode.Children[0] = sibling;
+    parentNode.Children[1] = leaf;
+
+    if (oldParent != -1) {
+        Node &oldParentNode = m_nodes[oldParent];
+        if (oldParentNode.Children[0] == sibling) oldParentNode.Children[0] = newParent;
+        else oldParentNode.Children[1] = newParent;
+    }
+    else {
+        m_root = newParent;
+    }
+
+    m_nodes[sibling].Parent = newParent;
+    m_nodes[leaf].Parent = newParent;
+
+    for (index = newParent; index != -1; index = m_nodes[index].Parent) {
+        index = Balance(index);
+        Refit(index);
+    }
+}
+
+void dphysics::AabbTree::RemoveLeaf(int leaf) {
+    if (leaf == m_root) {
+        m_root = -1;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].Parent;
+    const int grandParent = m_nodes[parent].Parent;
+    const int sibling = (m_nodes[parent].Children[0] == leaf)
+        ? m_nodes[parent].Children[1]
+        : m_nodes[parent].Children[0];
+
+    FreeNode(parent);
+
+    if (grandParent == -1) {
+        m_root = sibling;
+        m_nodes[sibling].Parent = -1;
+        return;
+    }
+
+    Node &grandParentNode = m_nodes[grandParent];
+    if (grandParentNode.Children[0] == parent) grandParentNode.Children[0] = sibling;
+    else grandParentNode.Children[1] = sibling;
+
+    m_nodes[sibling].Parent = grandParent;
+
+    for (int index = grandParent; index != -1; index = m_nodes[index].Parent) {
+        index = Balance(index);
+        Refit(index);
+    }
+}
+
+void dphysics::AabbTree::Refit(int node) {
+    Node &target = m_nodes[node];
+    const Node &a = m_nodes[target.Children[0]];
+    const Node &b = m_nodes[target.Children[1]];
+
+    for (int i = 0; i < 2; ++i) {
+        target.Min[i] = std::min(a.Min[i], b.Min[i]);
+        target.Max[i] = std::max(a.Max[i], b.Max[i]);
+    }
+
+    target.Height = 1 + std::max(a.Height, b.Height);
+}
+
+int dphysics::AabbTree::Balance(int a) {
+    Node &nodeA = m_nodes[a];
+    if (nodeA.IsLeaf() || nodeA.Height < 2) return a;
+
+    // Rotate the taller child up if the subtree heights differ by more than
+    // one. The shorter grandchild stays under the old root.
+    const int balance = m_nodes[nodeA.Children[1]].Height - m_nodes[nodeA.Children[0]].Height;
+    if (balance >= -1 && balance <= 1) return a;
+
+    const int tallSide = (balance > 1) ? 1 : 0;
+    const int up = nodeA.Children[tallSide];
+    Node &nodeUp = m_nodes[up];
+
+    const int child0 = nodeUp.Children[0];
+    const int child1 = nodeUp.Children[1];
+    const bool keepFirst = m_nodes[child0].Height > m_nodes[child1].Height;
+    const int kept = keepFirst ? child0 : child1;
+    const int moved = keepFirst ? child1 : child0;
+
+    nodeUp.Children[0] = a;
+    nodeUp.Children[1] = kept;
+    nodeUp.Parent = nodeA.Parent;
+    nodeA.Parent = up;
+
+    if (nodeUp.Parent != -1) {
+        Node &parent = m_nodes[nodeUp.Parent];
+        if (parent.Children[0] == a) parent.Children[0] = up;
+        else parent.Children[1] = up;
+    }
+    else {
+        m_root = up;
+    }
+
+    nodeA.Children[tallSide] = moved;
+    m_nodes[moved].Parent = a;
+    m_nodes[kept].Parent = up;
+
+    Refit(a);
+    Refit(up);
+
+    return up;
+}
+
+float dphysics::AabbTree::Perimeter(const float min[2], const float max[2]) {
+    return 2.0f * ((max[0] - min[0]) + (max[1] - min[1]));
+}
+
+float dphysics::AabbTree::CombinedPerimeter(const Node &a, const Node &b) {
+    const float min[2] = { std::min(a.Min[0], b.Min[0]), std::min(a.Min[1], b.Min[1]) };
+    const float max[2] = { std::max(a.Max[0], b.Max[0]), std::max(a.Max[1], b.Max[1]) };
+
+    return Perimeter(min, max);
+}
+
+bool dphysics::AabbTree::SegmentOverlaps(const Node &node, const float start[2], const float delta[2], float radius) {
+    float tMin = 0.0f, tMax = 1.0f;
+    for (int i = 0; i < 2; ++i) {
+        const float low = node.Min[i] - radius;
+        const float high = node.Max[i] + radius;
+
+        if (delta[i] == 0.0f) {
+            if (start[i] < low || start[i] > high) return false;
+            continue;
+        }
+
+        float t0 = (low - start[i]) / delta[i];
+        float t1 = (high - start[i]) / delta[i];
+        if (t0 > t1) std::swap(t0, t1);
+
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax) return false;
+    }
+
+    return true;
+}
@@ -443,3 +443,158 @@ int dphysics::CollisionDetector::BoxBoxVertexPenetration(
 
     return 1;
 }
+
+// Ray against a disk of the given radius centered at the origin of the
+// ray's frame
+static bool RayDisk(float ox, float oy, float dx, float dy, float radius, float *t, float *nx, float *ny) {
+    const float b = ox * dx + oy * dy;
+    const float c = ox * ox + oy * oy - radius * radius;
+
+    if (c <= 0.0f) {
+        *t = 0.0f;
+        *nx = -dx;
+        *ny = -dy;
+        return true;
+    }
+
+    if (b > 0.0f) return false;
+
+    const float discriminant = b * b - c;
+    if (discriminant < 0.0f) return false;
+
+    *t = -b - sqrtf(discriminant);
+    *nx = (ox + dx * *t) / radius;
+    *ny = (oy + dy * *t) / radius;
+
+    return true;
+}
+
+// Ray against an axis-aligned box centered at the origin of the ray's frame
+static bool RaySlab(float ox, float oy, float dx, float dy, float hx, float hy, float *t, float *nx, float *ny) {
+    const float o[] = { ox, oy };
+    const float d[] = { dx, dy };
+    const float h[] = { hx, hy };
+
+    float tEnter = -FLT_MAX, tExit = FLT_MAX;
+    float n[] = { 0.0f, 0.0f };
+
+    for (int i = 0; i < 2; ++i) {
+        if (d[i] > THRESH_0_NEGATIVE && d[i] < THRESH_0_POSITIVE) {
+            if (o[i] < -h[i] || o[i] > h[i]) return false;
+            continue;
+        }
+
+        float t0 = (-h[i] - o[i]) / d[i];
+        float t1 = (h[i] - o[i]) / d[i];
+        float side = -1.0f;
+
+        if (t0 > t1) {
+            std::swap(t0, t1);
+            side = 1.0f;
+        }
+
+        if (t0 > tEnter) {
+            tEnter = t0;
+            n[0] = n[1] = 0.0f;
+            n[i] = side;
+        }
+
+        tExit = min(tExit, t1);
+    }
+
+    if (tEnter > tExit || tExit < 0.0f) return false;
+
+    if (tEnter < 0.0f) {
+        *t = 0.0f;
+        *nx = -dx;
+        *ny = -dy;
+    }
+    else {
+        *t = tEnter;
+        *nx = n[0];
+        *ny = n[1];
+    }
+
+    return true;
+}
+
+bool dphysics::CollisionDetector::SweepCircleCircle(
+    const ysVector &origin, const ysVector &direction, float radius, float maxDistance,
+    const CirclePrimitive *circle, float *distance, ysVector *normal)
+{
+    float t, nx, ny;
+    const bool hit = RayDisk(
+        ysMath::GetX(origin) - ysMath::GetX(circle->Position),
+        ysMath::GetY(origin) - ysMath::GetY(circle->Position),
+        ysMath::GetX(direction), ysMath::GetY(direction),
+        radius + circle->Radius, &t, &nx, &ny);
+
+    if (!hit || t > maxDistance) return false;
+
+    *distance = t;
+    *normal = ysMath::LoadVector(nx, ny);
+
+    return true;
+}
+
+bool dphysics::CollisionDetector::SweepCircleBox(
+    const ysVector &origin, const ysVector &direction, float radius, float maxDistance,
+    const BoxPrimitive *box, float *distance, ysVector *normal)
+{
+    const ysVector localOrigin = ysMath::QuatTransformInverse(box->Orientation, ysMath::Sub(origin, box->Position));
+    const ysVector localDirection = ysMath::QuatTransformInverse(box->Orientation, direction);
+
+    const float ox = ysMath::GetX(localOrigin), oy = ysMath::GetY(localOrigin);
+    const float dx = ysMath::GetX(localDirection), dy = ysMath::GetY(localDirection);
+
+    float best = FLT_MAX, bestX = 0.0f, bestY = 0.0f;
+    float t, nx, ny;
+
+    auto keep = [&]() {
+        if (t < best) {
+            best = t;
+            bestX = nx;
+            bestY = ny;
+        }
+    };
+
+    // The swept shape is the box with rounded corners, split into two boxes
+    // that are each grown along one axis and four corner disks
+    if (RaySlab(ox, oy, dx, dy, box->HalfWidth + radius, box->HalfHeight, &t, &nx, &ny)) keep();
+
+    if (radius > 0.0f) {
+        if (RaySlab(ox, oy, dx, dy, box->HalfWidth, box->HalfHeight + radius, &t, &nx, &ny)) keep();
+
+        for (int i = 0; i < 4; ++i) {
+            const float cx = (i & 0x1) ? box->HalfWidth : -box->HalfWidth;
+            const float cy = (i & 0x2) ? box->HalfHeight : -box->HalfHeight;
+
+            if (RayDisk(ox - cx, oy - cy, dx, dy, radius, &t, &nx, &ny)) keep();
+        }
+    }
+
+    if (best > maxDistance) return false;
+
+    *distance = best;
+    *normal = ysMath::QuatTransform(box->Orientation, ysMath::LoadVector(bestX, bestY));
+
+    return true;
+}
+
+bool dphysics::CollisionDetector::OverlapCircleCircle(const ysVector &center, float radius, const CirclePrimitive *circle) {
+    const float dx = ysMath::GetX(center) - ysMath::GetX(circle->Position);
+    const float dy = ysMath::GetY(center) - ysMath::GetY(circle->Position);
+    const float combinedRadius = radius + circle->Radius;
+
+    return dx * dx + dy * dy <= combinedRadius * combinedRadius;
+}
+
+bool dphysics::CollisionDetector::OverlapCircleBox(const ysVector &center, float radius, const BoxPrimitive *box) {
+    const ysVector local = ysMath::QuatTransformInverse(box->Orientation, ysMath::Sub(center, box->Position));
+
+    const float x = ysMath::GetX(local), y = ysMath::GetY(local);
+    const float dx = x - min(max(x, -box->HalfWidth), box->HalfWidth);
+    const float dy = y - min(max(y, -box->HalfHeight), box->HalfHeight);
+
+    return dx * dx + dy * dy <= radius * radius;
+}
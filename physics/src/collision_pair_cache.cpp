@@ -0,0 +1,213 @@
+#include "../include/collision_pair_cache.h"
+
+#include "../include/rigid_body.h"
+
+#include <algorithm>
+#include <utility>
+
+dphysics::CollisionPairCache::CollisionPairCache() : ysObject("CollisionPairCache") {
+    m_pairCount = 0;
+    m_staleFrameLimit = DefaultStaleFrameLimit;
+    m_frame = 0;
+    m_lastRebuildFrame = 0;
+
+    m_pairs.resize(MinCapacity, Pair{ nullptr, nullptr, 0, 0, 0, 0, 0, 0 });
+}
+
+dphysics::CollisionPairCache::~CollisionPairCache() {
+    /* void */
+}
+
+void dphysics::CollisionPairCache::BeginFrame() {
+    ++m_frame;
+    CurrentContacts().clear();
+
+    if (m_pairCount == 0) {
+        m_removedBodies.clear();
+        return;
+    }
+
+    // Pairs take several frames to go stale so they only need to be swept
+    // at that rate, unless bodies were removed since the last frame
+    if (m_removedBodies.empty() && m_frame - m_lastRebuildFrame < (unsigned int)m_staleFrameLimit) {
+        return;
+    }
+
+    // Give back memory if the scene has thinned out considerably
+    int capacity = (int)m_pairs.size();
+    while (capacity > MinCapacity && m_pairCount * 8 < capacity) {
+        capacity /= 2;
+    }
+
+    Rebuild(capacity);
+}
+
+void dphysics::CollisionPairCache::Clear() {
+    std::fill(m_pairs.begin(), m_pairs.end(), Pair{ nullptr, nullptr, 0, 0, 0, 0, 0, 0 });
+    m_pairCount = 0;
+
+    m_contacts[0].clear();
+    m_contacts[1].clear();
+    m_removedBodies.clear();
+}
+
+dphysics::CollisionPairCache::Pair *dphysics::CollisionPairCache::Touch(
+    RigidBody *body1, RigidBody *body2)
+{
+    if (body2 < body1) std::swap(body1, body2);
+
+    if ((m_pairCount + 1) * 2 > (int)m_pairs.size()) {
+        Rebuild((int)m_pairs.size() * 2);
+    }
+
+    const uint64_t mask = m_pairs.size() - 1;
+    uint64_t slot = Hash(body1, body2) & mask;
+
+    while (true) {
+        Pair &pair = m_pairs[slot];
+
+        if (pair.Body1 == nullptr) {
+            pair.Body1 = body1;
+            pair.Body2 = body2;
+            pair.FirstFrame = m_frame;
+            pair.LastFrame = m_frame;
+            pair.ContactStart = (int)CurrentContacts().size();
+            pair.ContactCount = 0;
+            pair.PreviousContactStart = 0;
+            pair.PreviousContactCount = 0;
+            ++m_pairCount;
+
+            return &pair;
+        }
+        else if (pair.Body1 == body1 && pair.Body2 == body2) {
+            if (pair.LastFrame == m_frame) return &pair;
+
+            if (pair.LastFrame + 1 == m_frame) {
+                pair.PreviousContactStart = pair.ContactStart;
+                pair.PreviousContactCount = pair.ContactCount;
+            }
+            else {
+                // The pair separated for at least one frame so its history
+                // no longer applies
+                pair.FirstFrame = m_frame;
+                pair.PreviousContactCount = 0;
+            }
+
+            pair.LastFrame = m_frame;
+            pair.ContactStart = (int)CurrentContacts().size();
+            pair.ContactCount = 0;
+
+            return &pair;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+}
+
+dphysics::CollisionPairCache::Pair *dphysics::CollisionPairCache::Find(
+    RigidBody *body1, RigidBody *body2)
+{
+    if (body2 < body1) std::swap(body1, body2);
+
+    const uint64_t mask = m_pairs.size() - 1;
+    uint64_t slot = Hash(body1, body2) & mask;
+
+    while (m_pairs[slot].Body1 != nullptr) {
+        Pair &pair = m_pairs[slot];
+        if (pair.Body1 == body1 && pair.Body2 == body2) return &pair;
+
+        slot = (slot + 1) & mask;
+    }
+
+    return nullptr;
+}
+
+void dphysics::CollisionPairCache::AddContact(Pair *pair, Collision *collision) {
+    std::vector<Collision *> &contacts = CurrentContacts();
+
+    // Another pair recorded contacts in between, so move this pair's
+    // contacts to the end to keep them contiguous
+    if (pair->ContactStart + pair->ContactCount != (int)contacts.size()) {
+        const int start = (int)contacts.size();
+        for (int i = 0; i < pair->ContactCount; ++i) {
+            Collision *moved = contacts[pair->ContactStart + i];
+            contacts.push_back(moved);
+        }
+
+        pair->ContactStart = start;
+    }
+
+    contacts.push_back(collision);
+    ++pair->ContactCount;
+}
+
+dphysics::Collision **dphysics::CollisionPairCache::GetPreviousContacts(
+    RigidBody *body1, RigidBody *body2, int *count)
+{
+    *count = 0;
+
+    const Pair *pair = Find(body1, body2);
+    if (pair == nullptr || pair->LastFrame != m_frame) return nullptr;
+
+    *count = pair->PreviousContactCount;
+    return PreviousContacts().data() + pair->PreviousContactStart;
+}
+
+void dphysics::CollisionPairCache::RemoveBody(RigidBody *body) {
+    if (m_pairCount == 0) return;
+
+    m_removedBodies.push_back(body);
+}
+
+uint64_t dphysics::CollisionPairCache::Hash(const RigidBody *body1, const RigidBody *body2) {
+    uint64_t h = (uint64_t)(uintptr_t)body1 * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uintptr_t)body2 + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+
+    // MurmurHash3 finalizer
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+
+    return h;
+}
+
+bool dphysics::CollisionPairCache::IsStale(const Pair &pair) const {
+    return pair.LastFrame + (unsigned int)m_staleFrameLimit < m_frame;
+}
+
+bool dphysics::CollisionPairCache::IsRemoved(const Pair &pair) const {
+    return
+        std::binary_search(m_removedBodies.begin(), m_removedBodies.end(), pair.Body1) ||
+        std::binary_search(m_removedBodies.begin(), m_removedBodies.end(), pair.Body2);
+}
+
+void dphysics::CollisionPairCache::Rebuild(int capacity) {
+    std::sort(m_removedBodies.begin(), m_removedBodies.end());
+
+    m_scratch.assign(capacity, Pair{ nullptr, nullptr, 0, 0, 0, 0, 0, 0 });
+
+    const uint64_t mask = (uint64_t)capacity - 1;
+    int pairCount = 0;
+
+    for (const Pair &pair : m_pairs) {
+        if (pair.Body1 == nullptr) continue;
+        if (IsStale(pair)) continue;
+        if (!m_removedBodies.empty() && IsRemoved(pair)) continue;
+
+        uint64_t slot = Hash(pair.Body1, pair.Body2) & mask;
+        while (m_scratch[slot].Body1 != nullptr) {
+            slot = (slot + 1) & mask;
+        }
+
+        m_scratch[slot] = pair;
+        ++pairCount;
+    }
+
+    m_pairs.swap(m_scratch);
+    m_pairCount = pairCount;
+
+    m_removedBodies.clear();
+    m_lastRebuildFrame = m_frame;
+}
@@ -0,0 +1,19 @@
+#include "../include/collision_pool.h"
+
+dphysics::CollisionPool::CollisionPool() : ysObject("CollisionPool") {
+    m_count = 0;
+}
+
+dphysics::CollisionPool::~CollisionPool() {
+    for (Collision *chunk : m_chunks) {
+        delete[] chunk;
+    }
+}
+
+int dphysics::CollisionPool::Allocate() {
+    if (m_count == GetCapacity()) {
+        m_chunks.push_back(new Collision[ChunkSize]);
+    }
+
+    return m_count++;
+}
@@ -27,6 +27,10 @@ dphysics::Collision::Collision() : ysObject("Collision") {
     m_collisionType = CollisionType::Unknown;
     m_feature1 = -1;
     m_feature2 = -1;
+
+    m_accumulatedImpulse = ysMath::Constants::Zero;
+    m_effectiveMass = ysMath::Constants::Zero;
+    m_velocityTarget = 0.0f;
 }
 
 dphysics::Collision::Collision(const Collision &collision) : ysObject("Collision") {
@@ -58,6 +62,10 @@ dphysics::Collision::Collision(const Collision &collision) : ysObject("Collision
     m_collisionType = collision.m_collisionType;
     m_feature1 = collision.m_feature1;
     m_feature2 = collision.m_feature2;
+
+    m_accumulatedImpulse = collision.m_accumulatedImpulse;
+    m_effectiveMass = collision.m_effectiveMass;
+    m_velocityTarget = collision.m_velocityTarget;
 }
 
 dphysics::Collision::~Collision() {
@@ -122,6 +130,10 @@ dphysics::Collision &dphysics::Collision::operator=(dphysics::Collision &collisi
     m_feature1 = collision.m_feature1;
     m_feature2 = collision.m_feature2;
 
+    m_accumulatedImpulse = collision.m_accumulatedImpulse;
+    m_effectiveMass = collision.m_effectiveMass;
+    m_velocityTarget = collision.m_velocityTarget;
+
     return *this;
 }
 
@@ -10,6 +10,9 @@ dphysics::GridCell::GridCell() {
     m_requestCount = 0;
     m_forceProcess = false;
     m_active = false;
+    m_objectOffset = 0;
+    m_objectCount = 0;
+    m_emptyFrames = 0;
 }
 
 dphysics::GridCell::~GridCell() {
@@ -33,9 +36,11 @@ void dphysics::GridCell::DecrementRequestCount() {
 }
 
 dphysics::GridPartitionSystem::GridPartitionSystem() : ysObject("ysGridPartitionSystem") {
-    m_maxCells = 8192;
     m_gridCellSize = 5.0f;
     m_maxObjectSize = 30.0f;
+    m_evictionFrameLimit = DefaultEvictionFrameLimit;
+
+    m_table.assign(MinTableCapacity, -1);
 }
 
 dphysics::GridPartitionSystem::~GridPartitionSystem() {
@@ -43,10 +48,11 @@ dphysics::GridPartitionSystem::~GridPartitionSystem() {
 }
 
 void dphysics::GridPartitionSystem::Reset() {
-    GridCell *gridCell;
+    bool evicted = false;
 
-    for (auto cell: m_gridCells) {
-        gridCell = cell.second;
+    int i = 0;
+    while (i < (int)m_cells.size()) {
+        GridCell *gridCell = &m_cells[i];
 
         if (gridCell->m_requestCount > 0 && gridCell->m_valid) {
             // Allow this block to persist
@@ -58,60 +64,150 @@ void dphysics::GridPartitionSystem::Reset() {
             gridCell->m_active = false;
         }
 
+        gridCell->m_emptyFrames = (gridCell->m_objectCount == 0)
+            ? gridCell->m_emptyFrames + 1
+            : 0;
+
+        // Cells that nothing has occupied or requested for a while are
+        // dropped so that the table tracks the populated part of the world
+        if (gridCell->m_emptyFrames > m_evictionFrameLimit && gridCell->m_requestCount == 0) {
+            *gridCell = m_cells.back();
+            m_cells.pop_back();
+            evicted = true;
+
+            continue;
+        }
+
         gridCell->m_forceProcess = false;
         gridCell->m_valid = true;
         gridCell->m_processed = false;
-        gridCell->m_objects.Clear();
+        gridCell->m_objectOffset = 0;
+        gridCell->m_objectCount = 0;
+
+        ++i;
+    }
+
+    if (evicted) {
+        int capacity = (int)m_table.size();
+        while (capacity > MinTableCapacity && (int)m_cells.size() * 8 < capacity) {
+            capacity /= 2;
+        }
+
+        RebuildTable(capacity);
+    }
+
+    m_cellEntries.clear();
+}
+
+void dphysics::GridPartitionSystem::Finalize() {
+    const int cellCount = (int)m_cells.size();
+    const int entryCount = (int)m_cellEntries.size();
+
+    int offset = 0;
+    for (int i = 0; i < cellCount; ++i) {
+        GridCell &gridCell = m_cells[i];
+        gridCell.m_objectOffset = offset;
+        offset += gridCell.m_objectCount;
+        gridCell.m_objectCount = 0;
+    }
+
+    // Entries were added in body order so each cell keeps its objects sorted
+    // by registry index
+    m_cellObjects.resize(entryCount);
+    for (int i = 0; i < entryCount; ++i) {
+        const CellEntry &entry = m_cellEntries[i];
+        GridCell &gridCell = m_cells[entry.Cell];
+        m_cellObjects[gridCell.m_objectOffset + gridCell.m_objectCount++] = entry.Body;
     }
 }
 
 dphysics::GridCell *dphysics::GridPartitionSystem::GetCell(int x, int y) {
-    #if defined(__APPLE__) && defined(__MACH__)
-        uint64_t hash = SzudzikHash(x, y);
-    #elif defined(_WIN64)
-        unsigned __int64 hash = SzudzikHash(x, y);
-    #endif
-    
-    auto f = m_gridCells.find(hash);
-    if (f == m_gridCells.end()) {
-        GridCell *newCell = new GridCell;
-        m_gridCells[hash] = newCell;
-
-        newCell->m_x = x;
-        newCell->m_y = y;
-        newCell->m_forceProcess = false;
-        newCell->m_valid = true;
-        newCell->m_processed = false;
-        newCell->m_objects.Clear();
-
-        return newCell;
-    }
-    else return f->second;
-}
-
-#if defined(__APPLE__) && defined(__MACH__)
-uint64_t dphysics::GridPartitionSystem::SzudzikHash(int x, int y) {
-#elif defined(_WIN64)
-unsigned __int64 dphysics::GridPartitionSystem::SzudzikHash(int x, int y) {
-#endif
-    void *data0 = reinterpret_cast<void *>(&x);
-    void *data1 = reinterpret_cast<void *>(&y);
-
-    unsigned int *u0 = reinterpret_cast<unsigned int *>(data0);
-    unsigned int *u1 = reinterpret_cast<unsigned int *>(data1);
-
-    
-    #if defined(__APPLE__) && defined(__MACH__)
-        uint64_t a = (uint64_t)(*u0);
-        uint64_t b = (uint64_t)(*u1);
-    #elif defined(_WIN64)
-        unsigned __int64 a = (unsigned __int64)(*u0);
-        unsigned __int64 b = (unsigned __int64)(*u1);
-    #endif
-
-    return (a >= b)
-        ? a * a + a + b
-        : b * b + a;
+    return &m_cells[GetCellIndex(x, y)];
+}
+
+int dphysics::GridPartitionSystem::GetCellIndex(int x, int y) {
+    const uint64_t mask = m_table.size() - 1;
+    uint64_t slot = HashKey(CellKey(x, y)) & mask;
+
+    while (m_table[slot] != -1) {
+        const GridCell &gridCell = m_cells[m_table[slot]];
+        if (gridCell.m_x == x && gridCell.m_y == y) return m_table[slot];
+
+        slot = (slot + 1) & mask;
+    }
+
+    if ((m_cells.size() + 1) * 2 > m_table.size()) {
+        const int index = CreateCell(x, y);
+        RebuildTable((int)m_table.size() * 2);
+
+        return index;
+    }
+    else {
+        m_table[slot] = CreateCell(x, y);
+        return m_table[slot];
+    }
+}
+
+int dphysics::GridPartitionSystem::FindCellIndex(int x, int y) const {
+    const uint64_t mask = m_table.size() - 1;
+    uint64_t slot = HashKey(CellKey(x, y)) & mask;
+
+    while (m_table[slot] != -1) {
+        const GridCell &gridCell = m_cells[m_table[slot]];
+        if (gridCell.m_x == x && gridCell.m_y == y) return m_table[slot];
+
+        slot = (slot + 1) & mask;
+    }
+
+    return -1;
+}
+
+int dphysics::GridPartitionSystem::GetCellCoordinate(float position) const {
+    return (position >= 0)
+        ? (int)(position / m_gridCellSize)
+        : (int)((position - m_gridCellSize) / m_gridCellSize);
+}
+
+uint64_t dphysics::GridPartitionSystem::CellKey(int x, int y) {
+    return ((uint64_t)(uint32_t)x << 32) | (uint64_t)(uint32_t)y;
+}
+
+uint64_t dphysics::GridPartitionSystem::HashKey(uint64_t key) {
+    // MurmurHash3 finalizer
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDull;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ull;
+    key ^= key >> 33;
+
+    return key;
+}
+
+int dphysics::GridPartitionSystem::CreateCell(int x, int y) {
+    GridCell newCell;
+    newCell.m_x = x;
+    newCell.m_y = y;
+    newCell.m_forceProcess = false;
+    newCell.m_valid = true;
+    newCell.m_processed = false;
+
+    m_cells.push_back(newCell);
+    return (int)m_cells.size() - 1;
+}
+
+void dphysics::GridPartitionSystem::RebuildTable(int capacity) {
+    m_table.assign(capacity, -1);
+
+    const uint64_t mask = (uint64_t)capacity - 1;
+    const int cellCount = (int)m_cells.size();
+    for (int i = 0; i < cellCount; ++i) {
+        uint64_t slot = HashKey(CellKey(m_cells[i].m_x, m_cells[i].m_y)) & mask;
+        while (m_table[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+
+        m_table[slot] = i;
+    }
 }
 
 int dphysics::GridPartitionSystem::CalculateLoad() {
@@ -119,14 +215,17 @@ int dphysics::GridPartitionSystem::CalculateLoad() {
 }
 
 void dphysics::GridPartitionSystem::AddObject(int x, int y, RigidBody *body) {
-    GridCell *gridCell = GetCell(x, y);
-    gridCell->m_objects.New() = body;
+    const int index = GetCellIndex(x, y);
+
+    GridCell &gridCell = m_cells[index];
+    gridCell.m_objectCount++;
 
     if (body->GetHint() == RigidBody::RigidBodyHint::Dynamic) {
-        gridCell->m_forceProcess = true;
+        gridCell.m_forceProcess = true;
     }
 
-    body->AddGridCell(x, y);
+    m_cellEntries.push_back({ index, body });
+    body->AddGridCell(x, y, index);
 }
 
 void dphysics::GridPartitionSystem::ProcessRigidBody(RigidBody *object) {
@@ -137,12 +236,8 @@ void dphysics::GridPartitionSystem::ProcessRigidBody(RigidBody *object) {
     float actual_x = ysMath::GetX(pos);
     float actual_y = ysMath::GetY(pos);
 
-    int x = (actual_x >= 0)
-        ? (int)(actual_x / m_gridCellSize)
-        : (int)((actual_x - m_gridCellSize) / m_gridCellSize);
-    int y = (actual_y >= 0)
-        ? (int)(actual_y / m_gridCellSize)
-        : (int)((actual_y - m_gridCellSize) / m_gridCellSize);
+    int x = GetCellCoordinate(actual_x);
+    int y = GetCellCoordinate(actual_y);
 
     float nominal_x = m_gridCellSize * x;
     float nominal_y = m_gridCellSize * y;
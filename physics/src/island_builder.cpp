@@ -0,0 +1,46 @@
+#include "../include/island_builder.h"
+
+#include <utility>
+
+dphysics::IslandBuilder::IslandBuilder() : ysObject("IslandBuilder") {
+    /* void */
+}
+
+dphysics::IslandBuilder::~IslandBuilder() {
+    /* void */
+}
+
+void dphysics::IslandBuilder::Initialize(int nodeCount) {
+    m_parents.resize(nodeCount);
+    m_sizes.assign(nodeCount, 1);
+
+    for (int i = 0; i < nodeCount; ++i) {
+        m_parents[i] = i;
+    }
+}
+
+void dphysics::IslandBuilder::Merge(int a, int b) {
+    a = FindRoot(a);
+    b = FindRoot(b);
+
+    if (a == b) return;
+
+    // Union by size, ties go to the lower index so that the result only
+    // depends on the order of the merges
+    if (m_sizes[a] < m_sizes[b] || (m_sizes[a] == m_sizes[b] && b < a)) {
+        std::swap(a, b);
+    }
+
+    m_parents[b] = a;
+    m_sizes[a] += m_sizes[b];
+}
+
+int dphysics::IslandBuilder::FindRoot(int node) {
+    while (m_parents[node] != node) {
+        // Path halving
+        m_parents[node] = m_parents[m_parents[node]];
+        node = m_parents[node];
+    }
+
+    return node;
+}
@@ -1,6 +1,8 @@
 #include "../include/mass_spring_system.h"
 
 #include <stdlib.h>
+#include <math.h>
+#include <algorithm>
 
 #define max(a ,b)            (((a) > (b)) ? (a) : (b))
 
@@ -54,91 +56,6 @@ dphysics::MSSParticle::~MSSParticle() {
     /* void */
 }
 
-ysVector dphysics::MSSParticle::CalculateAcceleration(MassSpringSystem::RK4_PASS pass, float timeDelta) {
-    ysVector acceleration = ExternalAcceleration(pass);
-    ysVector position = GetPosition(pass);
-    ysVector velocity = GetVelocity(pass);
-
-    int adjacentCount = m_adjacentSprings.GetNumObjects();
-    ysVector diff, force;
-    float ratio;
-
-    for (int i = 0; i < adjacentCount; i++) {
-        MSSSpring *spring = m_adjacentSprings[i];
-
-        if (this != spring->GetParticle0()) {
-            diff = ysMath::Sub(spring->GetParticle0()->GetPosition(pass), position);
-        }
-        else {
-            diff = ysMath::Sub(spring->GetParticle1()->GetPosition(pass), position);
-        }
-
-        float actualLength = ysMath::GetScalar(ysMath::Magnitude(diff));
-        ratio = spring->GetLength(timeDelta) / actualLength;
-
-        float falloff = 1.0f;
-
-        if (spring->IsInvertedForce()) {
-            falloff = powf(2, spring->GetLength(timeDelta) - actualLength);
-            falloff = std::fmin(falloff, 1.0f); // Clamp the value to 0.0 - 1.0
-        }
-
-        force = ysMath::Mul(ysMath::LoadScalar(spring->GetConstant() * (1.0f - ratio) * falloff), diff);
-        acceleration = ysMath::Add(
-            acceleration,
-            ysMath::Mul(ysMath::LoadScalar(m_inverseMass), force)
-        );
-    }
-
-    return acceleration;
-}
-
-ysVector dphysics::MSSParticle::ExternalAcceleration(MassSpringSystem::RK4_PASS pass) {
-    ysVector velocity = GetVelocity(pass);
-
-    float velocity_s = ysMath::GetScalar(ysMath::Magnitude(velocity));
-
-    if (velocity_s > 0.00001f) {
-        velocity = ysMath::Div(velocity, ysMath::LoadScalar(velocity_s));
-    }
-
-    ysVector viscosity = ysMath::LoadScalar(-0.5f * velocity_s * m_drag * 1.0f);
-    viscosity = ysMath::LoadScalar(-0.5f * velocity_s * m_drag * 10.0f);
-
-    ysVector drag = ysMath::Mul(viscosity, velocity);
-
-    // Collisions
-    int numCollisions = m_collidingParticles.GetNumObjects();
-    ysVector avoidance = ysMath::Constants::Zero;
-
-    for (int i = 0; i < numCollisions; i++) {
-        ysVector pos1 = m_collidingParticles[i]->GetPosition(pass);
-        ysVector pos2 = GetPosition(pass);
-        ysVector delta = ysMath::Sub(pos2, pos1);
-
-        ysVector dist = ysMath::Magnitude(delta);
-        ysVector dist2 = ysMath::Mul(dist, dist);
-        delta = ysMath::Div(delta, dist);
-
-        float massRatio;
-        float mass;
-        if (GetInverseMass() <= 0.0f) massRatio = 0.0f;
-        else if (m_collidingParticles[i]->GetInverseMass() <= 0.0f) massRatio = 1.0f;
-        else {
-            mass = 1.0f / GetInverseMass();
-            massRatio = 1.0f - (mass) / (mass + (1.0f / m_collidingParticles[i]->GetInverseMass()));
-        }
-
-        float dist2_f = ysMath::GetScalar(dist2);
-        dist2_f = max(dist2_f, 0.05f);
-
-        avoidance = ysMath::Add(avoidance, ysMath::Mul(ysMath::LoadScalar(5.0f * massRatio), ysMath::Mul(ysMath::Div(ysMath::Constants::One, ysMath::LoadScalar(dist2_f)), delta)));
-        avoidance = ysMath::Add(avoidance, ysMath::Mul(ysMath::LoadScalar(10.0f * massRatio), delta));
-    }
-
-    return ysMath::Add(ysMath::Add(drag, avoidance), m_externalAcceleration);
-}
-
 void dphysics::MSSParticle::RegisterSpring(MSSSpring *spring) {
     m_adjacentSprings.New() = (spring);
 }
@@ -173,32 +90,6 @@ void dphysics::MSSParticle::DeleteAllConnections() {
     }
 }
 
-ysVector dphysics::MSSParticle::GetPosition(MassSpringSystem::RK4_PASS pass) const {
-    switch (pass) {
-    case MassSpringSystem::RK4_FIRST_PASS:
-        return m_position;
-    case MassSpringSystem::RK4_SECOND_PASS:
-    case MassSpringSystem::RK4_THIRD_PASS:
-    case MassSpringSystem::RK4_FOURTH_PASS:
-        return m_PTemp;
-    }
-
-    return m_position;
-}
-
-ysVector dphysics::MSSParticle::GetVelocity(MassSpringSystem::RK4_PASS pass) const {
-    switch (pass) {
-    case MassSpringSystem::RK4_FIRST_PASS:
-        return m_velocity;
-    case MassSpringSystem::RK4_SECOND_PASS:
-    case MassSpringSystem::RK4_THIRD_PASS:
-    case MassSpringSystem::RK4_FOURTH_PASS:
-        return m_VTemp;
-    }
-
-    return m_velocity;
-}
-
 ysVector dphysics::MSSParticle::SampleAverageVelocity() {
     m_averageVelocitySamples++;
 
@@ -246,7 +137,15 @@ bool dphysics::MSSParticle::IsConnected(MSSParticle *particle) {
 
 // Mass spring system
 dphysics::MassSpringSystem::MassSpringSystem() {
-    /* void */
+    m_cellSize = 0.0f;
+    m_bucketMask = 0;
+
+    m_threadCount = WorkerPool::GetHardwareThreadCount();
+
+    m_integrationMode = IntegrationMode::RungeKutta4;
+    m_solverIterations = DefaultSolverIterations;
+
+    SetStep(1 / 60.0f);
 }
 
 dphysics::MassSpringSystem::~MassSpringSystem() {
@@ -257,6 +156,8 @@ void dphysics::MassSpringSystem::SetStep(float step) {
     m_step = step;
     m_halfStep = (0.5f) * m_step;
     m_sixthStep = m_step / 6.0f;
+
+    m_timestepAccumulator.SetStep(step);
 }
 
 dphysics::MSSParticle *dphysics::MassSpringSystem::NewParticle() {
@@ -285,119 +186,418 @@ void dphysics::MassSpringSystem::RemoveSpring(MSSSpring *spring) {
 }
 
 void dphysics::MassSpringSystem::Update() {
+    YS_PROFILE_ZONE("MassSpringSystem::Update");
+
     DetectCollisions();
+    PackState();
 
-    float startTime = 0.0f;
-    float halfTime = m_halfStep;
-    float fullTime = m_step;
+    const int numParticles = (int)m_position.size();
+    const int numSprings = (int)m_springConstant.size();
 
-    ysVector halfStep = ysMath::LoadScalar(m_halfStep);
-    ysVector sixthStep = ysMath::LoadScalar(m_sixthStep);
+    if (m_integrationMode == IntegrationMode::PositionBased) {
+        IntegratePositionBased();
+    }
+    else {
+        for (int stage = 0; stage < 4; stage++) {
+            RunIntegrationKernel(IntegrationKernel::SpringForces, stage, numSprings);
+            RunIntegrationKernel(IntegrationKernel::Derivatives, stage, numParticles);
+        }
+    }
 
-    int i = 0;
-    int numParticles = m_particles.GetNumObjects();
+    UnpackState();
 
-    // Compute first step
-    for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_DPTemp1 = particle->GetVelocity();
-            particle->m_DVTemp1 = particle->CalculateAcceleration(RK4_FIRST_PASS, startTime);
-        }
+    for (int i = 0; i < numSprings; i++) {
+        m_springs.Get(i)->Update(m_step);
     }
+}
 
-    for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_PTemp = ysMath::Add(particle->GetPosition(), ysMath::Mul(halfStep, particle->m_DPTemp1));
-            particle->m_VTemp = ysMath::Add(particle->GetVelocity(), ysMath::Mul(halfStep, particle->m_DVTemp1));
-        }
-        else {
-            particle->m_PTemp = particle->GetPosition();
-            particle->m_VTemp = ysMath::Constants::Zero;
-        }
+int dphysics::MassSpringSystem::Advance(float frameDuration) {
+    const int steps = m_timestepAccumulator.Advance(frameDuration);
+    for (int i = 0; i < steps; ++i) {
+        Update();
     }
 
-    // Compute second step
-    for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_DPTemp2 = particle->m_VTemp;
-            particle->m_DVTemp2 = particle->CalculateAcceleration(RK4_SECOND_PASS, halfTime);
-        }
+    return steps;
+}
+
+void dphysics::MassSpringSystem::PackState() {
+    const int numParticles = m_particles.GetNumObjects();
+    const int numSprings = m_springs.GetNumObjects();
+
+    m_position.resize(numParticles);
+    m_velocity.resize(numParticles);
+    m_externalAcceleration.resize(numParticles);
+    m_inverseMass.resize(numParticles);
+    m_drag.resize(numParticles);
+
+    for (int i = 0; i < 2; i++) {
+        m_stagePosition[i].resize(numParticles);
+        m_stageVelocity[i].resize(numParticles);
     }
 
-    for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_PTemp = ysMath::Add(particle->GetPosition(), ysMath::Mul(halfStep, particle->m_DPTemp2));
-            particle->m_VTemp = ysMath::Add(particle->GetVelocity(), ysMath::Mul(halfStep, particle->m_DVTemp2));
-        }
-        else {
-            particle->m_PTemp = particle->GetPosition();
-            particle->m_VTemp = ysMath::Constants::Zero;
-        }
+    for (int i = 0; i < 4; i++) {
+        m_dp[i].resize(numParticles);
+        m_dv[i].resize(numParticles);
     }
 
-    // Compute third step
-    for (i = 0; i < numParticles; i++) {
+    m_collisionStart.resize(numParticles + 1);
+    m_collisions.clear();
+
+    for (int i = 0; i < numParticles; i++) {
         MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_DPTemp3 = particle->m_VTemp;
-            particle->m_DVTemp3 = particle->CalculateAcceleration(RK4_THIRD_PASS, halfTime);
+        m_position[i] = particle->m_position;
+        m_velocity[i] = particle->m_velocity;
+        m_externalAcceleration[i] = particle->m_externalAcceleration;
+        m_inverseMass[i] = particle->m_inverseMass;
+        m_drag[i] = particle->m_drag;
+
+        m_collisionStart[i] = (int)m_collisions.size();
+
+        const int numCollisions = particle->m_collidingParticles.GetNumObjects();
+        for (int j = 0; j < numCollisions; j++) {
+            m_collisions.push_back(particle->m_collidingParticles[j]->GetIndex());
         }
     }
 
-    for (i = 0; i < numParticles; i++) {
+    m_collisionStart[numParticles] = (int)m_collisions.size();
+
+    // Spring lengths can depend on time so they are sampled at the start,
+    // middle and end of the step
+    m_springParticles.resize(2 * numSprings);
+    m_springConstant.resize(numSprings);
+    m_springLength.resize(3 * numSprings);
+    m_springInverted.resize(numSprings);
+    m_springForce.resize(numSprings);
+
+    for (int i = 0; i < numSprings; i++) {
+        MSSSpring *spring = m_springs.Get(i);
+        MSSParticle *particle0 = spring->GetParticle0();
+        MSSParticle *particle1 = spring->GetParticle1();
+
+        const bool connected = particle0 != NULL && particle1 != NULL;
+        m_springParticles[2 * i + 0] = connected ? particle0->GetIndex() : -1;
+        m_springParticles[2 * i + 1] = connected ? particle1->GetIndex() : -1;
+
+        m_springConstant[i] = spring->GetConstant();
+        m_springInverted[i] = spring->IsInvertedForce() ? 1 : 0;
+        m_springLength[3 * i + 0] = spring->GetLength(0.0f);
+        m_springLength[3 * i + 1] = spring->GetLength(m_halfStep);
+        m_springLength[3 * i + 2] = spring->GetLength(m_step);
+    }
+
+    // Adjacency keeps the order of each particle's spring list so that
+    // forces are accumulated in the same order as before
+    m_adjacencyStart.resize(numParticles + 1);
+    m_adjacency.clear();
+
+    for (int i = 0; i < numParticles; i++) {
         MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_PTemp = ysMath::Add(particle->GetPosition(), ysMath::Mul(halfStep, particle->m_DPTemp3));
-            particle->m_VTemp = ysMath::Add(particle->GetVelocity(), ysMath::Mul(halfStep, particle->m_DVTemp3));
-        }
-        else {
-            particle->m_PTemp = particle->GetPosition();
-            particle->m_VTemp = ysMath::Constants::Zero;
+        m_adjacencyStart[i] = (int)m_adjacency.size();
+
+        const int nSprings = particle->m_adjacentSprings.GetNumObjects();
+        for (int j = 0; j < nSprings; j++) {
+            MSSSpring *spring = particle->m_adjacentSprings[j];
+            const int index = spring->GetIndex();
+
+            if (m_springParticles[2 * index] == -1) continue;
+            else if (spring->GetParticle0() == particle) m_adjacency.push_back(index << 1);
+            else if (spring->GetParticle1() == particle) m_adjacency.push_back((index << 1) | 1);
         }
     }
 
-    // Compute fourth step
-    for (i = 0; i < numParticles; i++) {
+    m_adjacencyStart[numParticles] = (int)m_adjacency.size();
+}
+
+void dphysics::MassSpringSystem::UnpackState() {
+    const int numParticles = (int)m_position.size();
+
+    for (int i = 0; i < numParticles; i++) {
+        if (m_inverseMass[i] <= 0.0f) continue;
+
         MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
-            particle->m_DPTemp4 = particle->m_VTemp;
-            particle->m_DVTemp4 = particle->CalculateAcceleration(RK4_FOURTH_PASS, fullTime);
+        particle->m_position = m_position[i];
+        particle->m_velocity = m_velocity[i];
+    }
+}
+
+void dphysics::MassSpringSystem::RunIntegrationKernel(IntegrationKernel kernel, int stage, int count) {
+    const int batches = count / MinimumBatchSize;
+    const int threadCount = (batches < m_threadCount) ? max(batches, 1) : m_threadCount;
+    if (threadCount > 1 && m_workerPool.GetWorkerCount() != m_threadCount - 1) {
+        m_workerPool.Initialize(m_threadCount - 1);
+    }
+
+    m_integrationJobs.resize(threadCount);
+    for (int i = 0; i < threadCount; i++) {
+        const int start = (int)(((int64_t)count * i) / threadCount);
+        const int end = (int)(((int64_t)count * (i + 1)) / threadCount);
+
+        m_integrationJobs[i] = { this, start, end - start, stage, kernel };
+    }
+
+    m_workerPool.Run(
+        &MassSpringSystem::IntegrationThread,
+        m_integrationJobs.data(),
+        sizeof(IntegrationCallData),
+        threadCount);
+}
+
+void dphysics::MassSpringSystem::IntegrationThread(void *data) {
+    YS_PROFILE_ZONE("MassSpringSystem::IntegrationThread");
+
+    IntegrationCallData *callData = reinterpret_cast<IntegrationCallData *>(data);
+    const int end = callData->Start + callData->Count;
+
+    if (callData->Kernel == IntegrationKernel::SpringForces) {
+        callData->System->CalculateSpringForces(callData->Stage, callData->Start, end);
+    }
+    else {
+        callData->System->CalculateDerivatives(callData->Stage, callData->Start, end);
+    }
+}
+
+void dphysics::MassSpringSystem::CalculateSpringForces(int stage, int start, int end) {
+    static const int LengthSample[] = { 0, 1, 1, 2 };
+
+    const ysVector *positions = (stage == 0)
+        ? m_position.data()
+        : m_stagePosition[(stage - 1) & 1].data();
+
+    for (int i = start; i < end; i++) {
+        const int p0 = m_springParticles[2 * i + 0];
+        const int p1 = m_springParticles[2 * i + 1];
+        if (p0 == -1) continue;
+
+        const ysVector diff = ysMath::Sub(positions[p1], positions[p0]);
+        const float length = m_springLength[3 * i + LengthSample[stage]];
+
+        float actualLength = ysMath::GetScalar(ysMath::Magnitude(diff));
+        float ratio = length / actualLength;
+
+        float falloff = 1.0f;
+
+        if (m_springInverted[i]) {
+            falloff = powf(2, length - actualLength);
+            falloff = std::fmin(falloff, 1.0f); // Clamp the value to 0.0 - 1.0
         }
+
+        // Force on the first particle, the second one receives the opposite
+        m_springForce[i] = ysMath::Mul(ysMath::LoadScalar(m_springConstant[i] * (1.0f - ratio) * falloff), diff);
     }
+}
 
-    for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle = m_particles.Get(i);
-        if (particle->GetInverseMass() > 0.0f) {
+void dphysics::MassSpringSystem::CalculateDerivatives(int stage, int start, int end) {
+    const ysVector *positions = (stage == 0)
+        ? m_position.data()
+        : m_stagePosition[(stage - 1) & 1].data();
+    const ysVector *velocities = (stage == 0)
+        ? m_velocity.data()
+        : m_stageVelocity[(stage - 1) & 1].data();
+
+    ysVector *stagePosition = m_stagePosition[stage & 1].data();
+    ysVector *stageVelocity = m_stageVelocity[stage & 1].data();
+
+    ysVector *dp = m_dp[stage].data();
+    ysVector *dv = m_dv[stage].data();
+
+    const ysVector halfStep = ysMath::LoadScalar(m_halfStep);
+    const ysVector sixthStep = ysMath::LoadScalar(m_sixthStep);
+
+    for (int i = start; i < end; i++) {
+        const float inverseMass = m_inverseMass[i];
+
+        if (inverseMass <= 0.0f) {
+            if (stage < 3) {
+                stagePosition[i] = m_position[i];
+                stageVelocity[i] = ysMath::Constants::Zero;
+            }
+
+            continue;
+        }
+
+        const ysVector inverseMass_v = ysMath::LoadScalar(inverseMass);
+        ysVector acceleration = ExternalAcceleration(i, positions, velocities[i]);
+
+        const int adjacencyEnd = m_adjacencyStart[i + 1];
+        for (int j = m_adjacencyStart[i]; j < adjacencyEnd; j++) {
+            const int entry = m_adjacency[j];
+            const ysVector a = ysMath::Mul(inverseMass_v, m_springForce[entry >> 1]);
+
+            acceleration = (entry & 1)
+                ? ysMath::Sub(acceleration, a)
+                : ysMath::Add(acceleration, a);
+        }
+
+        dp[i] = velocities[i];
+        dv[i] = acceleration;
+
+        if (stage < 3) {
+            stagePosition[i] = ysMath::Add(m_position[i], ysMath::Mul(halfStep, dp[i]));
+            stageVelocity[i] = ysMath::Add(m_velocity[i], ysMath::Mul(halfStep, dv[i]));
+        }
+        else {
             // Implements:
-            // m_position += m_sixthStep * ( m_DPTemp1 + 2 * (m_DPTemp2 + m_DPTemp3 + m_DPTemp4) )
+            // m_position += m_sixthStep * ( m_dp[0] + 2 * (m_dp[1] + m_dp[2] + m_dp[3]) )
 
-            ysVector pCalc = ysMath::Add(ysMath::Add(particle->m_DPTemp2, particle->m_DPTemp3), particle->m_DPTemp4);
+            ysVector pCalc = ysMath::Add(ysMath::Add(m_dp[1][i], m_dp[2][i]), m_dp[3][i]);
             pCalc = ysMath::Mul(pCalc, ysMath::Constants::Double);
-            pCalc = ysMath::Add(pCalc, particle->m_DPTemp1);
+            pCalc = ysMath::Add(pCalc, m_dp[0][i]);
             pCalc = ysMath::Mul(pCalc, sixthStep);
 
-            particle->m_position = ysMath::ExtendVector(ysMath::Add(pCalc, particle->m_position));
+            m_position[i] = ysMath::ExtendVector(ysMath::Add(pCalc, m_position[i]));
 
-            ysVector vCalc = ysMath::Add(ysMath::Add(particle->m_DVTemp2, particle->m_DVTemp3), particle->m_DVTemp4);
+            ysVector vCalc = ysMath::Add(ysMath::Add(m_dv[1][i], m_dv[2][i]), m_dv[3][i]);
             vCalc = ysMath::Mul(vCalc, ysMath::Constants::Double);
-            vCalc = ysMath::Add(vCalc, particle->m_DVTemp1);
+            vCalc = ysMath::Add(vCalc, m_dv[0][i]);
             vCalc = ysMath::Mul(vCalc, sixthStep);
 
-            particle->m_velocity = ysMath::ExtendVector(ysMath::Add(vCalc, particle->m_velocity));
+            m_velocity[i] = ysMath::ExtendVector(ysMath::Add(vCalc, m_velocity[i]));
+        }
+    }
+}
+
+ysVector dphysics::MassSpringSystem::ExternalAcceleration(
+    int particle, const ysVector *positions, const ysVector &velocity) const
+{
+    ysVector direction = velocity;
+
+    float velocity_s = ysMath::GetScalar(ysMath::Magnitude(velocity));
+
+    if (velocity_s > 0.00001f) {
+        direction = ysMath::Div(velocity, ysMath::LoadScalar(velocity_s));
+    }
+
+    ysVector viscosity = ysMath::LoadScalar(-0.5f * velocity_s * m_drag[particle] * 10.0f);
+
+    ysVector drag = ysMath::Mul(viscosity, direction);
+    ysVector avoidance = CollisionAcceleration(particle, positions);
+
+    return ysMath::Add(ysMath::Add(drag, avoidance), m_externalAcceleration[particle]);
+}
+
+ysVector dphysics::MassSpringSystem::CollisionAcceleration(int particle, const ysVector *positions) const {
+    const float inverseMass = m_inverseMass[particle];
+    ysVector avoidance = ysMath::Constants::Zero;
+
+    const int collisionEnd = m_collisionStart[particle + 1];
+    for (int i = m_collisionStart[particle]; i < collisionEnd; i++) {
+        const int other = m_collisions[i];
+
+        ysVector delta = ysMath::Sub(positions[particle], positions[other]);
+
+        ysVector dist = ysMath::Magnitude(delta);
+        ysVector dist2 = ysMath::Mul(dist, dist);
+        delta = ysMath::Div(delta, dist);
+
+        float massRatio;
+        float mass;
+        if (inverseMass <= 0.0f) massRatio = 0.0f;
+        else if (m_inverseMass[other] <= 0.0f) massRatio = 1.0f;
+        else {
+            mass = 1.0f / inverseMass;
+            massRatio = 1.0f - (mass) / (mass + (1.0f / m_inverseMass[other]));
         }
+
+        float dist2_f = ysMath::GetScalar(dist2);
+        dist2_f = max(dist2_f, 0.05f);
+
+        avoidance = ysMath::Add(avoidance, ysMath::Mul(ysMath::LoadScalar(5.0f * massRatio), ysMath::Mul(ysMath::Div(ysMath::Constants::One, ysMath::LoadScalar(dist2_f)), delta)));
+        avoidance = ysMath::Add(avoidance, ysMath::Mul(ysMath::LoadScalar(10.0f * massRatio), delta));
+    }
+
+    return avoidance;
+}
+
+void dphysics::MassSpringSystem::IntegratePositionBased() {
+    const int numParticles = (int)m_position.size();
+    const int numSprings = (int)m_springConstant.size();
+
+    const ysVector step = ysMath::LoadScalar(m_step);
+    const ysVector inverseStep = ysMath::LoadScalar(1.0f / m_step);
+
+    // Velocities are predicted with the same accelerations as the RK4 path.
+    // Drag grows with speed so it is applied implicitly to stay stable at
+    // large steps.
+    ysVector *previousPosition = m_stagePosition[0].data();
+    std::copy(m_position.begin(), m_position.end(), previousPosition);
+
+    for (int i = 0; i < numParticles; i++) {
+        if (m_inverseMass[i] <= 0.0f) continue;
+
+        const ysVector velocity = m_velocity[i];
+        const float velocity_s = ysMath::GetScalar(ysMath::Magnitude(velocity));
+        const float damping = 1.0f / (1.0f + m_step * 0.5f * velocity_s * m_drag[i] * 10.0f);
+
+        const ysVector acceleration = ysMath::Add(
+            CollisionAcceleration(i, previousPosition),
+            m_externalAcceleration[i]);
+
+        m_velocity[i] = ysMath::Mul(
+            ysMath::Add(velocity, ysMath::Mul(step, acceleration)),
+            ysMath::LoadScalar(damping));
+        m_position[i] = ysMath::ExtendVector(
+            ysMath::Add(m_position[i], ysMath::Mul(step, m_velocity[i])));
+    }
+
+    m_springLambda.assign(numSprings, 0.0f);
+    for (int i = 0; i < m_solverIterations; i++) {
+        ProjectSprings();
     }
 
-    int numSprings = m_springs.GetNumObjects();
+    for (int i = 0; i < numParticles; i++) {
+        if (m_inverseMass[i] <= 0.0f) continue;
+
+        m_velocity[i] = ysMath::ExtendVector(
+            ysMath::Mul(ysMath::Sub(m_position[i], previousPosition[i]), inverseStep));
+    }
+}
+
+void dphysics::MassSpringSystem::ProjectSprings() {
+    const int numSprings = (int)m_springConstant.size();
+    const float inverseStep2 = 1.0f / (m_step * m_step);
+
+    // Each spring is a distance constraint with compliance 1 / k. Springs are
+    // projected one after another so corrections propagate within a pass.
     for (int i = 0; i < numSprings; i++) {
-        m_springs.Get(i)->Update(m_step);
+        const int p0 = m_springParticles[2 * i + 0];
+        const int p1 = m_springParticles[2 * i + 1];
+        if (p0 == -1) continue;
+
+        const float w0 = max(m_inverseMass[p0], 0.0f);
+        const float w1 = max(m_inverseMass[p1], 0.0f);
+        if (w0 + w1 <= 0.0f) continue;
+
+        // Pinned particles keep whatever w they were given
+        const ysVector diff = ysMath::Mask(ysMath::Sub(m_position[p1], m_position[p0]), ysMath::Constants::MaskOffW);
+        const float actualLength = ysMath::GetScalar(ysMath::Magnitude(diff));
+        if (actualLength < 1E-6f) continue;
+
+        const float length = m_springLength[3 * i + 2];
+
+        float falloff = 1.0f;
+
+        if (m_springInverted[i]) {
+            falloff = powf(2, length - actualLength);
+            falloff = std::fmin(falloff, 1.0f);
+        }
+
+        const float stiffness = m_springConstant[i] * falloff;
+        if (stiffness <= 0.0f) continue;
+
+        const float compliance = inverseStep2 / stiffness;
+        const float deltaLambda =
+            (length - actualLength - compliance * m_springLambda[i]) / (w0 + w1 + compliance);
+        m_springLambda[i] += deltaLambda;
+
+        const ysVector correction = ysMath::Mul(diff, ysMath::LoadScalar(deltaLambda / actualLength));
+        m_position[p0] = ysMath::Sub(m_position[p0], ysMath::Mul(correction, ysMath::LoadScalar(w0)));
+        m_position[p1] = ysMath::Add(m_position[p1], ysMath::Mul(correction, ysMath::LoadScalar(w1)));
     }
 }
 
 void dphysics::MassSpringSystem::DetectCollisions() {
+    YS_PROFILE_ZONE("MassSpringSystem::DetectCollisions");
+
     int numParticles = m_particles.GetNumObjects();
     int i = 0;
 
@@ -405,31 +605,164 @@ void dphysics::MassSpringSystem::DetectCollisions() {
         m_particles.Get(i)->ClearCollisions();
     }
 
+    int enabledParticles = 0;
+    float maxRadius = 0.0f;
     for (i = 0; i < numParticles; i++) {
-        MSSParticle *particle1 = m_particles.Get(i);
+        MSSParticle *particle = m_particles.Get(i);
+        if (!particle->GetCollisionEnable()) continue;
 
-        for (int j = i + 1; j < numParticles; j++) {
-            MSSParticle *particle2 = m_particles.Get(j);
+        maxRadius = max(maxRadius, particle->GetRadius());
+        ++enabledParticles;
+    }
 
-            if (particle1->GetCollisionEnable() && particle2->GetCollisionEnable()) {
-                float radius1 = particle1->GetRadius();
-                float radius2 = particle2->GetRadius();
+    if (enabledParticles < 2 || maxRadius <= 0.0f) return;
 
-                if (particle1->IsConnected(particle2)) {
-                    continue;
+    // Two particles can only collide if they are closer than twice the
+    // largest radius, so with cells of that size they are always in
+    // neighboring cells
+    BuildCollisionGrid(2.0f * maxRadius);
+    BuildConnectivity();
+
+    m_pairStamps.assign(numParticles, -1);
+
+    for (i = 0; i < numParticles; i++) {
+        MSSParticle *particle1 = m_particles.Get(i);
+        if (!particle1->GetCollisionEnable()) continue;
+
+        // Distinct cells can share a bucket, so candidates are stamped to
+        // only visit them once
+        m_candidates.clear();
+
+        const int *cell = &m_particleCells[3 * i];
+        for (int z = cell[2] - 1; z <= cell[2] + 1; z++) {
+            for (int y = cell[1] - 1; y <= cell[1] + 1; y++) {
+                for (int x = cell[0] - 1; x <= cell[0] + 1; x++) {
+                    const int bucket = GetCellBucket(x, y, z);
+                    const int end = m_bucketStart[bucket + 1];
+
+                    for (int k = m_bucketStart[bucket]; k < end; k++) {
+                        const int j = m_bucketParticles[k];
+                        if (j <= i || m_pairStamps[j] == i) continue;
+
+                        m_pairStamps[j] = i;
+                        m_candidates.push_back(j);
+                    }
                 }
+            }
+        }
 
-                float r = (radius1 + radius2);
-                r *= r;
+        // Visiting partners in index order keeps every particle's collision
+        // list in the same order as an exhaustive pair loop would
+        std::sort(m_candidates.begin(), m_candidates.end());
 
-                ysVector delta = ysMath::Sub(particle1->GetPosition(), particle2->GetPosition());
-                float distance2 = ysMath::GetScalar(ysMath::MagnitudeSquared3(delta));
+        for (int j : m_candidates) {
+            MSSParticle *particle2 = m_particles.Get(j);
 
-                if (distance2 < r) {
-                    particle1->AddCollision(particle2);
-                    particle2->AddCollision(particle1);
-                }
+            float r = (particle1->GetRadius() + particle2->GetRadius());
+            r *= r;
+
+            ysVector delta = ysMath::Sub(particle1->GetPosition(), particle2->GetPosition());
+            float distance2 = ysMath::GetScalar(ysMath::MagnitudeSquared3(delta));
+
+            if (distance2 < r && !IsConnected(i, j)) {
+                particle1->AddCollision(particle2);
+                particle2->AddCollision(particle1);
             }
         }
     }
 }
+
+void dphysics::MassSpringSystem::BuildConnectivity() {
+    const int numParticles = m_particles.GetNumObjects();
+
+    m_connectionStart.resize(numParticles + 1);
+    m_connections.clear();
+
+    for (int i = 0; i < numParticles; i++) {
+        MSSParticle *particle = m_particles.Get(i);
+        const int start = (int)m_connections.size();
+        m_connectionStart[i] = start;
+
+        const int nSprings = particle->m_adjacentSprings.GetNumObjects();
+        for (int j = 0; j < nSprings; j++) {
+            MSSSpring *spring = particle->m_adjacentSprings[j];
+
+            if (spring->GetParticle0() != particle) m_connections.push_back(spring->GetParticle0());
+            if (spring->GetParticle1() != particle) m_connections.push_back(spring->GetParticle1());
+        }
+
+        std::sort(m_connections.begin() + start, m_connections.end());
+        m_connections.erase(
+            std::unique(m_connections.begin() + start, m_connections.end()), m_connections.end());
+    }
+
+    m_connectionStart[numParticles] = (int)m_connections.size();
+}
+
+bool dphysics::MassSpringSystem::IsConnected(int particle1, int particle2) const {
+    MSSParticle *p1 = m_particles.Get(particle1);
+    MSSParticle *p2 = m_particles.Get(particle2);
+
+    // Search the particle with fewer springs, like MSSParticle::IsConnected()
+    if (p2->m_adjacentSprings.GetNumObjects() <= p1->m_adjacentSprings.GetNumObjects()) {
+        std::swap(p1, p2);
+        std::swap(particle1, particle2);
+    }
+
+    return std::binary_search(
+        m_connections.begin() + m_connectionStart[particle1],
+        m_connections.begin() + m_connectionStart[particle1 + 1],
+        p2);
+}
+
+void dphysics::MassSpringSystem::BuildCollisionGrid(float cellSize) {
+    const int numParticles = m_particles.GetNumObjects();
+
+    m_cellSize = cellSize;
+    m_particleCells.resize(3 * numParticles);
+
+    int enabledParticles = 0;
+    for (int i = 0; i < numParticles; i++) {
+        if (m_particles.Get(i)->GetCollisionEnable()) ++enabledParticles;
+    }
+
+    int bucketCount = 16;
+    while (bucketCount < 2 * enabledParticles) bucketCount *= 2;
+    m_bucketMask = bucketCount - 1;
+
+    // Counting sort of the particles into their buckets
+    m_bucketStart.assign(bucketCount + 1, 0);
+    for (int i = 0; i < numParticles; i++) {
+        MSSParticle *particle = m_particles.Get(i);
+        if (!particle->GetCollisionEnable()) continue;
+
+        const ysVector position = particle->GetPosition();
+        int *cell = &m_particleCells[3 * i];
+        cell[0] = (int)floorf(ysMath::GetX(position) / m_cellSize);
+        cell[1] = (int)floorf(ysMath::GetY(position) / m_cellSize);
+        cell[2] = (int)floorf(ysMath::GetZ(position) / m_cellSize);
+
+        m_bucketStart[GetCellBucket(cell[0], cell[1], cell[2])]++;
+    }
+
+    for (int i = 0; i < bucketCount; i++) {
+        m_bucketStart[i + 1] += m_bucketStart[i];
+    }
+
+    m_bucketParticles.resize(enabledParticles);
+    for (int i = numParticles - 1; i >= 0; i--) {
+        if (!m_particles.Get(i)->GetCollisionEnable()) continue;
+
+        const int *cell = &m_particleCells[3 * i];
+        m_bucketParticles[--m_bucketStart[GetCellBucket(cell[0], cell[1], cell[2])]] = i;
+    }
+}
+
+int dphysics::MassSpringSystem::GetCellBucket(int x, int y, int z) const {
+    const unsigned int hash =
+        ((unsigned int)x * 73856093u) ^
+        ((unsigned int)y * 19349663u) ^
+        ((unsigned int)z * 83492791u);
+
+    return (int)(hash & m_bucketMask);
+}
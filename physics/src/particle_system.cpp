@@ -1,50 +1,130 @@
 #include "../include/particle_system.h"
 
-dphysics::ParticleSystem::ParticleSystem() {
+dphysics::ParticleSystem::ParticleSystem() : ysObject("ParticleSystem") {
     m_rate = 0.0f;
+    m_emissionAccumulator = 0.0f;
+    m_damping = 0.98f;
     m_source = ysMath::Constants::Zero;
     m_direction = ysMath::Constants::Zero;
 
-    m_engine = nullptr;
     m_layer = -1;
     m_texture = nullptr;
+
+    m_randomState = 0x9E3779B9u;
+
+    m_capacity = 0;
+    m_count = 0;
+
+    SetCapacity(DefaultCapacity);
 }
 
 dphysics::ParticleSystem::~ParticleSystem() {
     /* void */
 }
 
+void dphysics::ParticleSystem::SetCapacity(int capacity) {
+    m_capacity = capacity;
+    m_count = 0;
+
+    m_position.resize(capacity);
+    m_velocity.resize(capacity);
+    m_age.resize(capacity);
+    m_life.resize(capacity);
+    m_scale.resize(capacity);
+    m_expansionRate.resize(capacity);
+    m_density.resize(capacity);
+}
+
 void dphysics::ParticleSystem::Update(float timeStep) {
     // Phase I: Create new particles
-    float expected = m_rate * timeStep;
-    int n = (rand() % (100)) < 100; // Get a random number centered on the mean
-
-    for (int i = 0; i < n; i++) {
-        Particle *newParticle = m_particles.NewGeneric<Particle, 16>();
-        newParticle->m_age = 0.0f;
-        newParticle->m_life = ((rand() % 100) / 100.0f) + 5.0f;
-        newParticle->m_texture = m_texture;
-        newParticle->m_damping = 0.98f;
-        newParticle->m_scale = 0.0f;
-        newParticle->m_expansionRate = (rand() % 100) / 100.0f;
-        newParticle->SetParent(this);
-        newParticle->m_velocity = ysMath::LoadVector(float((rand() % 200) - 100), float((rand() % 200) - 100), 0.0f);
-        newParticle->m_position = ysMath::Constants::Zero;
-        newParticle->m_density = ((rand() % 200 - 100) / 800.0f) + 0.2f;
-    }
+    m_emissionAccumulator += m_rate * timeStep;
+
+    const int newParticles = (int)m_emissionAccumulator;
+    m_emissionAccumulator -= newParticles;
+
+    Emit(newParticles);
 
     // Phase II: Delete dead particles
-    int n_particles = GetParticleCount();
-    for (int i = 0; i < n_particles; i++) {
-        if (m_particles.Get(i)->GetAge() > m_particles.Get(i)->GetLife()) {
-            m_particles.Delete(i);
-            n_particles--;
-            i--;
-        }
+    for (int i = m_count - 1; i >= 0; i--) {
+        if (m_age[i] > m_life[i]) Kill(i);
     }
 
     // Phase III: Update all particles
-    for (int i = 0; i < n_particles; i++) {
-        m_particles.Get(i)->Update(timeStep);
+    const ysVector damping = ysMath::LoadScalar(m_damping);
+    const ysVector dt = ysMath::LoadScalar(timeStep);
+
+    ysVector *position = m_position.data();
+    ysVector *velocity = m_velocity.data();
+    for (int i = 0; i < m_count; i++) {
+        velocity[i] = ysMath::Mul(velocity[i], damping);
+        position[i] = ysMath::Add(position[i], ysMath::Mul(velocity[i], dt));
+    }
+
+    float *scale = m_scale.data();
+    float *age = m_age.data();
+    const float *expansionRate = m_expansionRate.data();
+    for (int i = 0; i < m_count; i++) {
+        scale[i] += expansionRate[i] * timeStep;
+        age[i] += timeStep;
     }
 }
+
+int dphysics::ParticleSystem::WriteInstances(ParticleInstance *target, int maxCount) const {
+    const int count = (m_count < maxCount) ? m_count : maxCount;
+
+    for (int i = 0; i < count; i++) {
+        const ysVector position = ysMath::Add(m_position[i], m_source);
+
+        ParticleInstance &instance = target[i];
+        instance.Position[0] = ysMath::GetX(position);
+        instance.Position[1] = ysMath::GetY(position);
+        instance.Position[2] = ysMath::GetZ(position);
+        instance.Position[3] = 1.0f;
+        instance.Scale = m_scale[i];
+        instance.Fade = 1.0f - m_age[i] / m_life[i];
+        instance.Density = m_density[i];
+        instance.Padding = 0.0f;
+    }
+
+    return count;
+}
+
+void dphysics::ParticleSystem::Emit(int count) {
+    if (m_count + count > m_capacity) count = m_capacity - m_count;
+
+    for (int i = m_count; i < m_count + count; i++) {
+        m_age[i] = 0.0f;
+        m_life[i] = NextRandom() + 5.0f;
+        m_scale[i] = 0.0f;
+        m_expansionRate[i] = NextRandom();
+        m_velocity[i] = ysMath::LoadVector(NextRandom() * 200.0f - 100.0f, NextRandom() * 200.0f - 100.0f, 0.0f);
+        m_position[i] = ysMath::Constants::Zero;
+        m_density[i] = ((NextRandom() * 200.0f - 100.0f) / 800.0f) + 0.2f;
+    }
+
+    m_count += count;
+}
+
+void dphysics::ParticleSystem::Kill(int i) {
+    // Swap with the last live particle to keep the pool packed
+    const int last = --m_count;
+
+    m_position[i] = m_position[last];
+    m_velocity[i] = m_velocity[last];
+    m_age[i] = m_age[last];
+    m_life[i] = m_life[last];
+    m_scale[i] = m_scale[last];
+    m_expansionRate[i] = m_expansionRate[last];
+    m_density[i] = m_density[last];
+}
+
+float dphysics::ParticleSystem::NextRandom() {
+    // xorshift32, returns a value in [0, 1)
+    unsigned int x = m_randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    m_randomState = x;
+
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,149 @@
+#include "../include/replay_codec.h"
+
+#include <cmath>
+#include <string.h>
+
+void dphysics::ReplayCodec::WriteVarint(std::vector<uint8_t> &target, uint32_t value) {
+    while (value >= 0x80) {
+        target.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+
+    target.push_back((uint8_t)value);
+}
+
+bool dphysics::ReplayCodec::ReadVarint(const uint8_t *&data, const uint8_t *end, uint32_t *value) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data >= end) return false;
+
+        const uint8_t byte = *data++;
+        result |= (uint32_t)(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int32_t dphysics::ReplayCodec::Quantize(float value, int component, float positionQuantization) {
+    const float step = (component < 3) ? positionQuantization : OrientationQuantization;
+    return (int32_t)std::lround(value / step);
+}
+
+float dphysics::ReplayCodec::Dequantize(int32_t value, int component, float positionQuantization) {
+    const float step = (component < 3) ? positionQuantization : OrientationQuantization;
+    return value * step;
+}
+
+void dphysics::ReplayCodec::Encode(
+    const uint32_t *values, const uint32_t *previous, int count, bool quantized, std::vector<uint8_t> &target)
+{
+    for (int i = 0; i < count; ++i) {
+        const uint32_t p = (previous != nullptr) ? previous[i] : 0;
+
+        if (quantized) WriteVarint(target, ZigZag((int32_t)(values[i] - p)));
+        else WriteVarint(target, values[i] ^ p);
+    }
+}
+
+bool dphysics::ReplayCodec::Decode(
+    const uint8_t *data, const uint8_t *end, const uint32_t *previous, int count, bool quantized, uint32_t *values)
+{
+    for (int i = 0; i < count; ++i) {
+        uint32_t delta;
+        if (!ReadVarint(data, end, &delta)) return false;
+
+        const uint32_t p = (previous != nullptr) ? previous[i] : 0;
+
+        if (quantized) values[i] = p + (uint32_t)UnZigZag(delta);
+        else values[i] = p ^ delta;
+    }
+
+    return true;
+}
+
+void dphysics::ReplayCodec::Compress(const uint8_t *data, int size, std::vector<uint8_t> &target) {
+    constexpr int HashBits = 12;
+    constexpr int MinMatch = 4;
+
+    std::vector<int> table(1 << HashBits, -1);
+
+    auto hash = [data](int i) {
+        uint32_t v;
+        memcpy(&v, data + i, sizeof(uint32_t));
+        return (v * 2654435761u) >> (32 - HashBits);
+    };
+
+    int literalStart = 0;
+    int i = 0;
+    while (i + MinMatch <= size) {
+        const uint32_t h = hash(i);
+        const int candidate = table[h];
+        table[h] = i;
+
+        if (candidate < 0 || memcmp(data + candidate, data + i, MinMatch) != 0) {
+            ++i;
+            continue;
+        }
+
+        int length = MinMatch;
+        while (i + length < size && data[candidate + length] == data[i + length]) ++length;
+
+        // Sequence: literal run, then a back reference
+        WriteVarint(target, (uint32_t)(i - literalStart));
+        target.insert(target.end(), data + literalStart, data + i);
+        WriteVarint(target, (uint32_t)length);
+        WriteVarint(target, (uint32_t)(i - candidate));
+
+        i += length;
+        literalStart = i;
+    }
+
+    WriteVarint(target, (uint32_t)(size - literalStart));
+    target.insert(target.end(), data + literalStart, data + size);
+}
+
+bool dphysics::ReplayCodec::Decompress(const uint8_t *data, int size, uint8_t *target, int targetSize) {
+    const uint8_t *end = data + size;
+    int out = 0;
+
+    while (true) {
+        uint32_t literals;
+        if (!ReadVarint(data, end, &literals)) return false;
+        if (literals > (uint32_t)(end - data) || literals > (uint32_t)(targetSize - out)) return false;
+
+        memcpy(target + out, data, literals);
+        data += literals;
+        out += literals;
+
+        if (out == targetSize) return data == end;
+
+        uint32_t length, offset;
+        if (!ReadVarint(data, end, &length)) return false;
+        if (!ReadVarint(data, end, &offset)) return false;
+        if (offset == 0 || offset > (uint32_t)out || length > (uint32_t)(targetSize - out)) return false;
+
+        // Byte by byte since the match may overlap the output
+        for (uint32_t j = 0; j < length; ++j, ++out) {
+            target[out] = target[out - offset];
+        }
+    }
+}
+
+void dphysics::ReplayCodec::WriteU32(uint8_t *target, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        target[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+uint32_t dphysics::ReplayCodec::ReadU32(const uint8_t *data) {
+    return
+        (uint32_t)data[0] |
+        ((uint32_t)data[1] << 8) |
+        ((uint32_t)data[2] << 16) |
+        ((uint32_t)data[3] << 24);
+}
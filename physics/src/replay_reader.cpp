@@ -0,0 +1,276 @@
+#include "../include/replay_reader.h"
+
+#include <algorithm>
+#include <string.h>
+
+dphysics::ReplayReader::ReplayReader() : ysObject("ReplayReader") {
+    m_fileSize = 0;
+    m_dataOffset = 0;
+    m_dataEnd = 0;
+
+    m_frameCount = 0;
+
+    m_quantized = false;
+    m_positionPrecision = 0.0f;
+
+    m_currentFrame = -1;
+    m_nextOffset = 0;
+    m_bodyCount = 0;
+}
+
+dphysics::ReplayReader::~ReplayReader() {
+    Close();
+}
+
+bool dphysics::ReplayReader::Open(const std::string &fname) {
+    Close();
+
+    m_file.open(fname, std::ios::in | std::ios::binary);
+    if (!m_file.is_open()) return false;
+
+    m_file.seekg(0, std::ios::end);
+    m_fileSize = (uint64_t)m_file.tellg();
+    m_file.seekg(0, std::ios::beg);
+
+    if (!ReadHeader()) {
+        Close();
+        return false;
+    }
+
+    // Replays that were not closed properly have no index
+    if (!ReadIndex()) {
+        ScanBlocks();
+    }
+
+    return true;
+}
+
+void dphysics::ReplayReader::Close() {
+    if (m_file.is_open()) m_file.close();
+    m_file.clear();
+
+    m_bodies.clear();
+    m_keyframes.clear();
+    m_frameCount = 0;
+
+    m_currentFrame = -1;
+    m_nextOffset = 0;
+    m_bodyCount = 0;
+    m_values.clear();
+}
+
+bool dphysics::ReplayReader::SeekFrame(int frame) {
+    if (frame < 0 || frame >= m_frameCount) return false;
+
+    auto keyframe = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), (uint32_t)frame,
+        [](uint32_t f, const KeyframeEntry &entry) { return f < entry.Frame; });
+    if (keyframe == m_keyframes.begin()) return false;
+    --keyframe;
+
+    // Keep decoding forward if the current frame is at least as close as the
+    // keyframe
+    if (m_currentFrame < (int)keyframe->Frame || m_currentFrame > frame) {
+        if (!ReadBlock(keyframe->Offset, &m_nextOffset)) return false;
+    }
+
+    while (m_currentFrame < frame) {
+        if (!NextFrame()) return false;
+    }
+
+    return true;
+}
+
+bool dphysics::ReplayReader::NextFrame() {
+    if (m_currentFrame + 1 >= m_frameCount) return false;
+    if (m_currentFrame < 0) return SeekFrame(0);
+
+    return ReadBlock(m_nextOffset, &m_nextOffset);
+}
+
+ysVector dphysics::ReplayReader::GetPosition(int body) const {
+    return ysMath::LoadVector(GetValue(body, 0), GetValue(body, 1), GetValue(body, 2));
+}
+
+ysQuaternion dphysics::ReplayReader::GetOrientation(int body) const {
+    return ysMath::LoadVector(GetValue(body, 3), GetValue(body, 4), GetValue(body, 5), GetValue(body, 6));
+}
+
+bool dphysics::ReplayReader::ReadHeader() {
+    constexpr int FixedSize = 24;
+    if (m_fileSize < FixedSize) return false;
+
+    uint8_t fixed[FixedSize];
+    m_file.read(reinterpret_cast<char *>(fixed), FixedSize);
+
+    if (ReplayCodec::ReadU32(fixed) != ReplayCodec::Magic) return false;
+    if (ReplayCodec::ReadU32(fixed + 4) != ReplayCodec::Version) return false;
+
+    const uint32_t bodyCount = ReplayCodec::ReadU32(fixed + 8);
+    const uint32_t flags = ReplayCodec::ReadU32(fixed + 12);
+    const uint32_t precisionBits = ReplayCodec::ReadU32(fixed + 16);
+
+    m_quantized = (flags & ReplayCodec::FlagQuantized) != 0;
+    memcpy(&m_positionPrecision, &precisionBits, sizeof(float));
+
+    auto readU32 = [this](uint32_t *value) {
+        uint8_t bytes[4];
+        if (!m_file.read(reinterpret_cast<char *>(bytes), 4)) return false;
+        *value = ReplayCodec::ReadU32(bytes);
+        return true;
+    };
+
+    auto readFloat = [&readU32](float *value) {
+        uint32_t bits;
+        if (!readU32(&bits)) return false;
+        memcpy(value, &bits, sizeof(float));
+        return true;
+    };
+
+    m_bodies.resize(bodyCount);
+    for (ReplayBodyDescriptor &body : m_bodies) {
+        uint32_t shapeCount;
+        if (!readU32(&shapeCount)) return false;
+
+        body.Shapes.resize(shapeCount);
+        for (ReplayShape &shape : body.Shapes) {
+            char type;
+            if (!m_file.get(type)) return false;
+            shape.ShapeType = (ReplayShape::Type)type;
+
+            bool valid = readFloat(&shape.HalfWidth) && readFloat(&shape.HalfHeight) && readFloat(&shape.Radius);
+            for (int i = 0; i < 3; ++i) valid = valid && readFloat(&shape.Position[i]);
+            for (int i = 0; i < 4; ++i) valid = valid && readFloat(&shape.Orientation[i]);
+            if (!valid) return false;
+        }
+    }
+
+    m_dataOffset = (uint64_t)m_file.tellg();
+    return true;
+}
+
+bool dphysics::ReplayReader::ReadIndex() {
+    constexpr int TrailerSize = 16;
+    if (m_fileSize < m_dataOffset + TrailerSize + 4) return false;
+
+    uint8_t trailer[TrailerSize];
+    m_file.seekg(m_fileSize - TrailerSize);
+    if (!m_file.read(reinterpret_cast<char *>(trailer), TrailerSize)) return false;
+
+    if (ReplayCodec::ReadU32(trailer + 12) != ReplayCodec::IndexMagic) return false;
+
+    const uint32_t frameCount = ReplayCodec::ReadU32(trailer);
+    const uint64_t indexOffset =
+        (uint64_t)ReplayCodec::ReadU32(trailer + 4) | ((uint64_t)ReplayCodec::ReadU32(trailer + 8) << 32);
+
+    if (indexOffset < m_dataOffset || indexOffset + 4 > m_fileSize - TrailerSize) return false;
+
+    uint8_t countBytes[4];
+    m_file.seekg(indexOffset);
+    if (!m_file.read(reinterpret_cast<char *>(countBytes), 4)) return false;
+
+    const uint32_t keyframeCount = ReplayCodec::ReadU32(countBytes);
+    if (indexOffset + 4 + (uint64_t)keyframeCount * 12 + TrailerSize != m_fileSize) return false;
+
+    std::vector<uint8_t> entries((size_t)keyframeCount * 12);
+    if (!m_file.read(reinterpret_cast<char *>(entries.data()), entries.size())) return false;
+
+    m_keyframes.resize(keyframeCount);
+    for (uint32_t i = 0; i < keyframeCount; ++i) {
+        const uint8_t *entry = entries.data() + i * 12;
+        m_keyframes[i].Frame = ReplayCodec::ReadU32(entry);
+        m_keyframes[i].Offset =
+            (uint64_t)ReplayCodec::ReadU32(entry + 4) | ((uint64_t)ReplayCodec::ReadU32(entry + 8) << 32);
+    }
+
+    m_frameCount = (int)frameCount;
+    m_dataEnd = indexOffset;
+
+    return true;
+}
+
+void dphysics::ReplayReader::ScanBlocks() {
+    m_keyframes.clear();
+    m_frameCount = 0;
+
+    m_file.clear();
+
+    uint64_t offset = m_dataOffset;
+    uint8_t header[ReplayCodec::BlockHeaderSize];
+    while (offset + ReplayCodec::BlockHeaderSize <= m_fileSize) {
+        m_file.seekg(offset);
+        if (!m_file.read(reinterpret_cast<char *>(header), ReplayCodec::BlockHeaderSize)) break;
+
+        const uint64_t next = offset + ReplayCodec::BlockHeaderSize + ReplayCodec::ReadU32(header + 13);
+        if (next > m_fileSize) break;
+
+        if ((header[0] & ReplayCodec::BlockKeyframe) != 0) {
+            m_keyframes.push_back({ ReplayCodec::ReadU32(header + 1), offset });
+        }
+
+        ++m_frameCount;
+        offset = next;
+    }
+
+    m_file.clear();
+    m_dataEnd = offset;
+}
+
+bool dphysics::ReplayReader::ReadBlock(uint64_t offset, uint64_t *nextOffset) {
+    if (offset + ReplayCodec::BlockHeaderSize > m_dataEnd) return false;
+
+    uint8_t header[ReplayCodec::BlockHeaderSize];
+    m_file.clear();
+    m_file.seekg(offset);
+    if (!m_file.read(reinterpret_cast<char *>(header), ReplayCodec::BlockHeaderSize)) return false;
+
+    const uint8_t flags = header[0];
+    const uint32_t frame = ReplayCodec::ReadU32(header + 1);
+    const uint32_t bodyCount = ReplayCodec::ReadU32(header + 5);
+    const uint32_t rawSize = ReplayCodec::ReadU32(header + 9);
+    const uint32_t storedSize = ReplayCodec::ReadU32(header + 13);
+
+    const bool keyframe = (flags & ReplayCodec::BlockKeyframe) != 0;
+    if (!keyframe && (m_currentFrame + 1 != (int)frame || (int)bodyCount != m_bodyCount)) return false;
+    if (offset + ReplayCodec::BlockHeaderSize + storedSize > m_dataEnd) return false;
+
+    m_stored.resize(storedSize);
+    if (!m_file.read(reinterpret_cast<char *>(m_stored.data()), storedSize)) return false;
+
+    const uint8_t *payload = m_stored.data();
+    if ((flags & ReplayCodec::BlockCompressed) != 0) {
+        m_encoded.resize(rawSize);
+        if (!ReplayCodec::Decompress(m_stored.data(), storedSize, m_encoded.data(), rawSize)) return false;
+        payload = m_encoded.data();
+    }
+    else if (storedSize != rawSize) return false;
+
+    const int valueCount = (int)bodyCount * ReplayCodec::ValuesPerBody;
+    m_previous.swap(m_values);
+    m_values.resize(valueCount);
+
+    if (!ReplayCodec::Decode(
+        payload, payload + rawSize, keyframe ? nullptr : m_previous.data(), valueCount, m_quantized, m_values.data()))
+    {
+        m_currentFrame = -1;
+        return false;
+    }
+
+    m_currentFrame = (int)frame;
+    m_bodyCount = (int)bodyCount;
+    *nextOffset = offset + ReplayCodec::BlockHeaderSize + storedSize;
+
+    return true;
+}
+
+float dphysics::ReplayReader::GetValue(int body, int component) const {
+    const uint32_t value = m_values[(size_t)body * ReplayCodec::ValuesPerBody + component];
+
+    if (m_quantized) {
+        return ReplayCodec::Dequantize((int32_t)value, component, m_positionPrecision);
+    }
+    else {
+        float f;
+        memcpy(&f, &value, sizeof(float));
+        return f;
+    }
+}
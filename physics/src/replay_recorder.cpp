@@ -0,0 +1,276 @@
+#include "../include/replay_recorder.h"
+
+#include "../include/collision_object.h"
+#include "../include/rigid_body.h"
+
+#include <string.h>
+
+dphysics::ReplayRecorder::ReplayRecorder() : ysObject("ReplayRecorder") {
+    m_open = false;
+
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_shutdown = false;
+
+    m_previousBodyCount = -1;
+    m_offset = 0;
+    m_writtenFrames = 0;
+
+    m_frameCount = 0;
+    m_keyframeInterval = DefaultKeyframeInterval;
+    m_bufferedFrameLimit = DefaultBufferedFrameLimit;
+    m_compressionEnabled = true;
+    m_positionPrecision = 0.0f;
+}
+
+dphysics::ReplayRecorder::~ReplayRecorder() {
+    Close();
+}
+
+bool dphysics::ReplayRecorder::Open(const std::string &fname, const std::vector<ReplayBodyDescriptor> &bodies) {
+    Close();
+
+    m_file.open(fname, std::ios::out | std::ios::binary);
+    if (!m_file.is_open()) {
+        return false;
+    }
+
+    uint32_t flags = 0;
+    if (m_compressionEnabled) flags |= ReplayCodec::FlagCompressed;
+    if (m_positionPrecision > 0.0f) flags |= ReplayCodec::FlagQuantized;
+
+    uint32_t precisionBits;
+    memcpy(&precisionBits, &m_positionPrecision, sizeof(uint32_t));
+
+    std::vector<uint8_t> header;
+    auto writeU32 = [&header](uint32_t value) {
+        uint8_t bytes[4];
+        ReplayCodec::WriteU32(bytes, value);
+        header.insert(header.end(), bytes, bytes + 4);
+    };
+
+    auto writeFloat = [&writeU32](float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(uint32_t));
+        writeU32(bits);
+    };
+
+    writeU32(ReplayCodec::Magic);
+    writeU32(ReplayCodec::Version);
+    writeU32((uint32_t)bodies.size());
+    writeU32(flags);
+    writeU32(precisionBits);
+    writeU32((uint32_t)m_keyframeInterval);
+
+    for (const ReplayBodyDescriptor &body : bodies) {
+        writeU32((uint32_t)body.Shapes.size());
+
+        for (const ReplayShape &shape : body.Shapes) {
+            header.push_back((uint8_t)shape.ShapeType);
+            writeFloat(shape.HalfWidth);
+            writeFloat(shape.HalfHeight);
+            writeFloat(shape.Radius);
+            for (int i = 0; i < 3; ++i) writeFloat(shape.Position[i]);
+            for (int i = 0; i < 4; ++i) writeFloat(shape.Orientation[i]);
+        }
+    }
+
+    m_file.write(reinterpret_cast<const char *>(header.data()), header.size());
+
+    m_offset = header.size();
+    m_previous.clear();
+    m_previousBodyCount = -1;
+    m_keyframes.clear();
+    m_writtenFrames = 0;
+    m_frameCount = 0;
+
+    m_ring.assign(m_bufferedFrameLimit, FrameBuffer());
+    m_ringHead = 0;
+    m_ringCount = 0;
+    m_shutdown = false;
+
+    m_writer = std::thread(&ReplayRecorder::WriterLoop, this);
+    m_open = true;
+
+    return true;
+}
+
+void dphysics::ReplayRecorder::Close() {
+    if (!m_open) return;
+
+    {
+        std::lock_guard<std::mutex> lk(m_lock);
+        m_shutdown = true;
+    }
+
+    m_frameReady.notify_one();
+    m_writer.join();
+
+    WriteIndex();
+    m_file.close();
+
+    m_open = false;
+}
+
+float *dphysics::ReplayRecorder::BeginFrame(int bodyCount) {
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_slotFree.wait(lk, [this] { return m_ringCount < (int)m_ring.size(); });
+
+    FrameBuffer &frame = m_ring[(m_ringHead + m_ringCount) % m_ring.size()];
+    frame.BodyCount = bodyCount;
+    frame.Values.resize((size_t)bodyCount * ReplayCodec::ValuesPerBody);
+
+    return frame.Values.data();
+}
+
+void dphysics::ReplayRecorder::EndFrame() {
+    {
+        std::lock_guard<std::mutex> lk(m_lock);
+        ++m_ringCount;
+        ++m_frameCount;
+    }
+
+    m_frameReady.notify_one();
+}
+
+void dphysics::ReplayRecorder::DescribeBody(RigidBody *body, ReplayBodyDescriptor *descriptor) {
+    descriptor->Shapes.clear();
+
+    const int objectCount = body->CollisionGeometry.GetNumObjects();
+    for (int i = 0; i < objectCount; ++i) {
+        CollisionObject *object = body->CollisionGeometry.GetCollisionObject(i);
+        if (object->GetMode() != CollisionObject::Mode::Fine) continue;
+
+        ReplayShape shape;
+        shape.HalfWidth = shape.HalfHeight = shape.Radius = 0.0f;
+
+        ysVector position;
+        ysQuaternion orientation = ysMath::Constants::QuatIdentity;
+
+        if (object->GetType() == CollisionObject::Type::Box) {
+            BoxPrimitive *box = object->GetAsBox();
+            shape.ShapeType = ReplayShape::Type::Box;
+            shape.HalfWidth = box->HalfWidth;
+            shape.HalfHeight = box->HalfHeight;
+            position = box->Position;
+            orientation = box->Orientation;
+        }
+        else if (object->GetType() == CollisionObject::Type::Circle) {
+            CirclePrimitive *circle = object->GetAsCircle();
+            shape.ShapeType = ReplayShape::Type::Circle;
+            shape.Radius = circle->Radius;
+            position = circle->Position;
+        }
+        else continue;
+
+        shape.Position[0] = ysMath::GetX(position);
+        shape.Position[1] = ysMath::GetY(position);
+        shape.Position[2] = ysMath::GetZ(position);
+        shape.Orientation[0] = ysMath::GetQuatW(orientation);
+        shape.Orientation[1] = ysMath::GetQuatX(orientation);
+        shape.Orientation[2] = ysMath::GetQuatY(orientation);
+        shape.Orientation[3] = ysMath::GetQuatZ(orientation);
+
+        descriptor->Shapes.push_back(shape);
+    }
+}
+
+void dphysics::ReplayRecorder::WriterLoop() {
+    while (true) {
+        FrameBuffer *frame;
+        {
+            std::unique_lock<std::mutex> lk(m_lock);
+            m_frameReady.wait(lk, [this] { return m_ringCount > 0 || m_shutdown; });
+
+            if (m_ringCount == 0) return;
+            frame = &m_ring[m_ringHead];
+        }
+
+        // The slot stays reserved until it is released below
+        WriteFrame(*frame);
+
+        {
+            std::lock_guard<std::mutex> lk(m_lock);
+            m_ringHead = (m_ringHead + 1) % (int)m_ring.size();
+            --m_ringCount;
+        }
+
+        m_slotFree.notify_one();
+    }
+}
+
+void dphysics::ReplayRecorder::WriteFrame(const FrameBuffer &frame) {
+    const int valueCount = frame.BodyCount * ReplayCodec::ValuesPerBody;
+    const bool quantized = m_positionPrecision > 0.0f;
+
+    m_values.resize(valueCount);
+    for (int i = 0; i < valueCount; ++i) {
+        if (quantized) {
+            m_values[i] = (uint32_t)ReplayCodec::Quantize(
+                frame.Values[i], i % ReplayCodec::ValuesPerBody, m_positionPrecision);
+        }
+        else {
+            memcpy(&m_values[i], &frame.Values[i], sizeof(uint32_t));
+        }
+    }
+
+    const bool keyframe =
+        (m_writtenFrames % m_keyframeInterval) == 0 || frame.BodyCount != m_previousBodyCount;
+
+    m_encoded.clear();
+    ReplayCodec::Encode(
+        m_values.data(), keyframe ? nullptr : m_previous.data(), valueCount, quantized, m_encoded);
+
+    const uint8_t *payload = m_encoded.data();
+    size_t payloadSize = m_encoded.size();
+    uint8_t blockFlags = keyframe ? ReplayCodec::BlockKeyframe : 0;
+
+    if (m_compressionEnabled) {
+        m_compressed.clear();
+        ReplayCodec::Compress(m_encoded.data(), (int)m_encoded.size(), m_compressed);
+
+        if (m_compressed.size() < m_encoded.size()) {
+            payload = m_compressed.data();
+            payloadSize = m_compressed.size();
+            blockFlags |= ReplayCodec::BlockCompressed;
+        }
+    }
+
+    if (keyframe) {
+        m_keyframes.push_back({ (uint32_t)m_writtenFrames, m_offset });
+    }
+
+    uint8_t header[ReplayCodec::BlockHeaderSize];
+    header[0] = blockFlags;
+    ReplayCodec::WriteU32(header + 1, (uint32_t)m_writtenFrames);
+    ReplayCodec::WriteU32(header + 5, (uint32_t)frame.BodyCount);
+    ReplayCodec::WriteU32(header + 9, (uint32_t)m_encoded.size());
+    ReplayCodec::WriteU32(header + 13, (uint32_t)payloadSize);
+
+    m_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+    m_file.write(reinterpret_cast<const char *>(payload), payloadSize);
+    m_offset += sizeof(header) + payloadSize;
+
+    m_previous.swap(m_values);
+    m_previousBodyCount = frame.BodyCount;
+    ++m_writtenFrames;
+}
+
+void dphysics::ReplayRecorder::WriteIndex() {
+    std::vector<uint8_t> index((m_keyframes.size() * 3 + 5) * 4);
+    uint8_t *p = index.data();
+
+    ReplayCodec::WriteU32(p, (uint32_t)m_keyframes.size()); p += 4;
+    for (const KeyframeEntry &entry : m_keyframes) {
+        ReplayCodec::WriteU32(p, entry.Frame); p += 4;
+        ReplayCodec::WriteU32(p, (uint32_t)entry.Offset); p += 4;
+        ReplayCodec::WriteU32(p, (uint32_t)(entry.Offset >> 32)); p += 4;
+    }
+
+    ReplayCodec::WriteU32(p, (uint32_t)m_writtenFrames); p += 4;
+    ReplayCodec::WriteU32(p, (uint32_t)m_offset); p += 4;
+    ReplayCodec::WriteU32(p, (uint32_t)(m_offset >> 32)); p += 4;
+    ReplayCodec::WriteU32(p, ReplayCodec::IndexMagic);
+
+    m_file.write(reinterpret_cast<const char *>(index.data()), index.size());
+}
@@ -4,13 +4,8 @@
 #include "../include/force_generator.h"
 
 dphysics::RigidBody::RigidBody() {
-    m_linearDamping = 0.99f;
-    m_angularDamping = 0.5f;
-
-    m_velocity = ysMath::Constants::Zero;
-    m_angularVelocity = ysMath::Constants::Zero;
-
-    m_inverseInertiaTensor = ysMath::LoadMatrix(ysMath::Constants::Zero, ysMath::Constants::Zero, ysMath::Constants::Zero, ysMath::Constants::IdentityRow4);
+    m_state = m_detachedState = new RigidBodyState;
+    m_stateIndex = m_detachedState->Add(this);
 
     CollisionGeometry.SetParent(this);
 
@@ -24,78 +19,129 @@ dphysics::RigidBody::RigidBody() {
     m_hint = RigidBodyHint::Static;
 
     m_awake = true;
+    m_alwaysAwake = false;
+    m_fixedPosition = false;
     m_requestsInformation = false;
+    m_restTime = 0.0f;
+
+    m_lastPosition = ysMath::Constants::Zero;
+    m_lastOrientation = ysMath::Constants::QuatIdentity;
+    m_moved = false;
 
-    ClearAccumulators();
-    m_acceleration = ysMath::Constants::Zero;
+    m_treeProxy = -1;
 
     m_material = -1;
 }
 
 dphysics::RigidBody::~RigidBody() {
-    /* void */
+    delete m_detachedState;
 }
 
-void dphysics::RigidBody::Integrate(float timeStep) {
-    if (m_hint == RigidBodyHint::Static) return;
-    else m_derivedValid = false;
+void dphysics::RigidBody::DetachState() {
+    if (m_detachedState != nullptr) return;
 
-    ysVector vTimeStep = ysMath::LoadScalar(timeStep);
+    m_detachedState = new RigidBodyState;
+    const int index = m_detachedState->Add(this);
+    m_detachedState->Copy(index, *m_state, m_stateIndex);
 
-    ysQuaternion orientation = Transform.GetOrientationParentSpace();
-    ysVector position = Transform.GetPositionParentSpace();
-    orientation = ysMath::QuatAddScaled(orientation, m_angularVelocity, timeStep);
-    position = ysMath::Add(position, ysMath::Mul(m_velocity, vTimeStep));
+    m_state->Remove(m_stateIndex);
+    m_state = m_detachedState;
+    m_stateIndex = index;
+}
 
-    Transform.SetOrientation(orientation);
-    Transform.SetPosition(position);
+void dphysics::RigidBody::AttachState(RigidBodyState *state) {
+    const int index = state->Add(this);
+    state->Copy(index, *m_state, m_stateIndex);
 
-    ysVector acceleration = m_acceleration;
-    acceleration = ysMath::Add(acceleration, ysMath::Mul(m_forceAccum, ysMath::LoadScalar(m_inverseMass)));
-    ysVector angularAcceleration = ysMath::MatMult(m_inverseInertiaTensor, m_torqueAccum);
+    delete m_detachedState;
+    m_detachedState = nullptr;
 
-    m_velocity = 
-        ysMath::Add(m_velocity, ysMath::Mul(m_impulseAccum, ysMath::LoadScalar(m_inverseMass)));
-    m_angularVelocity = 
-        ysMath::Add(m_angularVelocity, ysMath::Mul(m_angularImpulseAccum, ysMath::LoadScalar(m_inverseMass)));
+    m_state = state;
+    m_stateIndex = index;
+}
 
-    m_velocity = ysMath::Add(m_velocity, ysMath::Mul(acceleration, vTimeStep));
-    m_angularVelocity = ysMath::Add(m_angularVelocity, ysMath::Mul(angularAcceleration, vTimeStep));
+void dphysics::RigidBody::Integrate(float timeStep) {
+    if (m_hint == RigidBodyHint::Static) return;
+    else if (!m_awake) return;
+    else m_derivedValid = false;
 
-    m_angularVelocity = ysMath::Mul(m_angularVelocity, ysMath::LoadScalar(pow(m_angularDamping, timeStep)));
-    m_velocity = ysMath::Mul(m_velocity, ysMath::LoadScalar(pow(m_linearDamping, timeStep)));
+    IntegrateTransform(timeStep);
+    State().IntegrateVelocity(m_stateIndex, timeStep);
 
     int childCount = m_children.GetNumObjects();
     for (int i = 0; i < childCount; i++) {
         m_children[i]->Integrate(timeStep);
     }
+}
+
+void dphysics::RigidBody::IntegrateTransform(float timeStep) {
+    const RigidBodyState &state = State();
+
+    ysQuaternion orientation = Transform.GetOrientationParentSpace();
+    ysVector position = Transform.GetPositionParentSpace();
+    orientation = ysMath::QuatAddScaled(orientation, state.m_angularVelocity[m_stateIndex], timeStep);
+    position = ysMath::Add(position, ysMath::Mul(state.m_velocity[m_stateIndex], ysMath::LoadScalar(timeStep)));
 
-    m_impulseAccum = ysMath::Constants::Zero;
+    Transform.SetOrientation(orientation);
+    Transform.SetPosition(position);
 }
 
 void dphysics::RigidBody::UpdateDerivedData(bool force) {
     /* void */
 }
 
-void dphysics::RigidBody::CheckAwake() {
-    // Determine if rigid body is awake
-    ysVector d = ysMath::Sub(m_lastWorldPosition, Transform.GetWorldPosition());
-    ysVector d2 = ysMath::Mask(ysMath::Mul(d, d), ysMath::Constants::MaskOffW);
+void dphysics::RigidBody::UpdateRestTime(float timeStep, float linearThreshold, float angularThreshold) {
+    const float v2 = ysMath::GetScalar(ysMath::MagnitudeSquared3(GetVelocity()));
+    const float w2 = ysMath::GetScalar(ysMath::MagnitudeSquared3(GetAngularVelocity()));
 
-    float maxMovement = ysMath::GetScalar(ysMath::MaxComponent(d2));
-
-    if (maxMovement < 1E-4 && !IsAlwaysAwake()) {
-        SetAwake(false);
+    if (IsAlwaysAwake() ||
+        v2 > linearThreshold * linearThreshold ||
+        w2 > angularThreshold * angularThreshold)
+    {
+        m_restTime = 0.0f;
     }
     else {
-        SetAwake(true);
+        m_restTime += timeStep;
+    }
+}
+
+void dphysics::RigidBody::UpdateMoved() {
+    // Orientations are renormalized every step, which leaves rounding noise
+    // behind even if the body is at rest
+    const float MoveEpsilon = 1E-5f;
+
+    const ysVector position = Transform.GetPositionParentSpace();
+    const ysQuaternion orientation = Transform.GetOrientationParentSpace();
+
+    const ysVector dp = ysMath::Sub(position, m_lastPosition);
+    const ysVector dq = ysMath::Sub(orientation, m_lastOrientation);
+
+    m_moved =
+        ysMath::GetScalar(ysMath::MagnitudeSquared3(dp)) > MoveEpsilon * MoveEpsilon ||
+        ysMath::GetScalar(ysMath::Dot(dq, dq)) > MoveEpsilon * MoveEpsilon;
+
+    m_lastPosition = position;
+    m_lastOrientation = orientation;
+}
+
+bool dphysics::RigidBody::IsImmovable() const {
+    const RigidBodyState &state = State();
+    if (state.m_inverseMass[m_stateIndex] != 0.0f) return false;
+
+    for (int i = 0; i < 3; ++i) {
+        const ysVector &row = state.m_inverseInertiaTensor[m_stateIndex].rows[i];
+        if (ysMath::GetX(row) != 0.0f) return false;
+        if (ysMath::GetY(row) != 0.0f) return false;
+        if (ysMath::GetZ(row) != 0.0f) return false;
     }
+
+    return true;
 }
 
 ysVector dphysics::RigidBody::GetVelocityAtLocalPoint(const ysVector &localPoint) {
     ysVector delta = Transform.LocalToParentDirection(localPoint);
 
-    ysVector angularComponent = ysMath::Cross(m_angularVelocity, delta);
+    ysVector angularComponent = ysMath::Cross(GetAngularVelocity(), delta);
     ysVector linearComponent = GetVelocity();
     return Transform.ParentToWorldDirection(
         ysMath::Add(angularComponent, linearComponent));
@@ -107,7 +153,7 @@ ysVector dphysics::RigidBody::GetVelocityAtWorldPoint(const ysVector &worldPoint
         Transform.GetWorldPosition());
     delta = Transform.WorldToParentDirection(delta);
 
-    ysVector angularComponent = ysMath::Cross(m_angularVelocity, delta);
+    ysVector angularComponent = ysMath::Cross(GetAngularVelocity(), delta);
     ysVector linearComponent = GetVelocity();
     return Transform.ParentToWorldDirection(
         ysMath::Add(angularComponent, linearComponent));
@@ -115,11 +161,11 @@ ysVector dphysics::RigidBody::GetVelocityAtWorldPoint(const ysVector &worldPoint
 
 ysMatrix dphysics::RigidBody::GetInverseInertiaTensorWorld() {
     ysMatrix orientation = ysMath::LoadMatrix(Transform.GetWorldOrientation());
-    return ysMath::MatMult(orientation, m_inverseInertiaTensor);
+    return ysMath::MatMult(orientation, GetInverseInertiaTensor());
 }
 
 void dphysics::RigidBody::SetInverseInertiaTensor(const ysMatrix &tensor) {
-    m_inverseInertiaTensor = tensor;
+    State().m_inverseInertiaTensor[m_stateIndex] = tensor;
 }
 
 ysMatrix dphysics::RigidBody::GetRectangleTensor(float dx, float dy) {
@@ -128,7 +174,7 @@ ysMatrix dphysics::RigidBody::GetRectangleTensor(float dx, float dy) {
 
     float term1 = 0.0f;
     float term2 = 0.0f;
-    float term3 = (12.0f * m_inverseMass) / (dx2 + dy2);
+    float term3 = (12.0f * GetInverseMass()) / (dx2 + dy2);
 
     ysVector row1 = ysMath::LoadVector(term1, 0.0f, 0.0f, 0.0f);
     ysVector row2 = ysMath::LoadVector(0.0f, term2, 0.0f, 0.0f);
@@ -161,36 +207,46 @@ void dphysics::RigidBody::RequestCollisions() {
     }
 }
 
-void dphysics::RigidBody::AddGridCell(int x, int y) {
+void dphysics::RigidBody::AddGridCell(int x, int y, int index) {
     GridCell *gridCell = &m_gridCells.New();
 
     gridCell->x = x;
     gridCell->y = y;
+    gridCell->index = index;
 }
 
 void dphysics::RigidBody::AddAngularImpulseLocal(const ysVector &impulse) {
+    SetAwake(true);
+
     ysVector impulseWorld = Transform.LocalToParentDirection(impulse);
-    m_angularImpulseAccum = ysMath::Add(impulseWorld, m_angularImpulseAccum);
+    ysVector &angularImpulseAccum = State().m_angularImpulseAccum[m_stateIndex];
+    angularImpulseAccum = ysMath::Add(impulseWorld, angularImpulseAccum);
 }
 
 void dphysics::RigidBody::AddImpulseLocalSpace(const ysVector &impulse, const ysVector &localPoint) {
+    SetAwake(true);
+
     ysVector impulseWorld = Transform.LocalToParentDirection(impulse);
     ysVector delta = Transform.LocalToParentDirection(localPoint);
-    m_impulseAccum = ysMath::Add(m_impulseAccum, impulse);
+    RigidBodyState &state = State();
+    state.m_impulseAccum[m_stateIndex] = ysMath::Add(state.m_impulseAccum[m_stateIndex], impulse);
 
     ysVector angularImpulse = ysMath::Cross(delta, impulse);
-    m_angularImpulseAccum = ysMath::Add(m_angularImpulseAccum, angularImpulse);
+    state.m_angularImpulseAccum[m_stateIndex] = ysMath::Add(state.m_angularImpulseAccum[m_stateIndex], angularImpulse);
 }
 
 void dphysics::RigidBody::AddImpulseWorldSpace(const ysVector &impulse, const ysVector &point) {
+    SetAwake(true);
+
     ysVector delta = ysMath::Sub(point, Transform.GetWorldPosition());
     delta = Transform.WorldToParentDirection(delta);
     ysVector impulseParent = Transform.WorldToParentDirection(impulse);
 
-    m_impulseAccum = ysMath::Add(m_impulseAccum, impulseParent);
+    RigidBodyState &state = State();
+    state.m_impulseAccum[m_stateIndex] = ysMath::Add(state.m_impulseAccum[m_stateIndex], impulseParent);
 
     ysVector angularImpulse = ysMath::Cross(delta, impulseParent);
-    m_angularImpulseAccum = ysMath::Add(m_angularImpulseAccum, angularImpulse);
+    state.m_angularImpulseAccum[m_stateIndex] = ysMath::Add(state.m_angularImpulseAccum[m_stateIndex], angularImpulse);
 }
 
 void dphysics::RigidBody::AddForceLocalSpace(const ysVector &force, const ysVector &localPoint) {
@@ -200,14 +256,17 @@ void dphysics::RigidBody::AddForceLocalSpace(const ysVector &force, const ysVect
 }
 
 void dphysics::RigidBody::AddForceWorldSpace(const ysVector &force, const ysVector &point) {
+    SetAwake(true);
+
     ysVector delta = ysMath::Sub(point, Transform.GetWorldPosition());
 
-    m_forceAccum = ysMath::Add(m_forceAccum, force);
+    ysVector &forceAccum = State().m_forceAccum[m_stateIndex];
+    forceAccum = ysMath::Add(forceAccum, force);
     AddTorque(ysMath::Cross(force, delta));
 }
 
 void dphysics::RigidBody::AddTorqueLocal(const ysVector &torque) {
-    m_torqueAccum = ysMath::Add(m_torqueAccum, torque);
+    AddTorque(torque);
 }
 
 void dphysics::RigidBody::GenerateForces(float dt) {
@@ -226,12 +285,13 @@ void dphysics::RigidBody::GenerateForces(float dt) {
 
 bool dphysics::RigidBody::CheckState() {
     if (!Transform.IsValid()) return false;
-    if (!ysMath::IsValid(m_acceleration)) return false;
-    if (!ysMath::IsValid(m_angularVelocity)) return false;
-    if (!ysMath::IsValid(m_forceAccum)) return false;
-    if (!ysMath::IsValid(m_impulseAccum)) return false;
-    if (!ysMath::IsValid(m_torqueAccum)) return false;
-    if (!ysMath::IsValid(m_velocity)) return false;
+    const RigidBodyState &state = State();
+    if (!ysMath::IsValid(state.m_acceleration[m_stateIndex])) return false;
+    if (!ysMath::IsValid(state.m_angularVelocity[m_stateIndex])) return false;
+    if (!ysMath::IsValid(state.m_forceAccum[m_stateIndex])) return false;
+    if (!ysMath::IsValid(state.m_impulseAccum[m_stateIndex])) return false;
+    if (!ysMath::IsValid(state.m_torqueAccum[m_stateIndex])) return false;
+    if (!ysMath::IsValid(state.m_velocity[m_stateIndex])) return false;
     return true;
 }
 
@@ -0,0 +1,154 @@
+#include "../include/rigid_body_state.h"
+
+#include "../include/rigid_body.h"
+
+dphysics::RigidBodyState::RigidBodyState() : ysObject("RigidBodyState") {
+    m_dampingTimeStep = 0.0f;
+}
+
+dphysics::RigidBodyState::~RigidBodyState() {
+    /* void */
+}
+
+int dphysics::RigidBodyState::Add(RigidBody *body) {
+    const int index = GetCount();
+
+    m_bodies.push_back(body);
+
+    m_velocity.push_back(ysMath::Constants::Zero);
+    m_angularVelocity.push_back(ysMath::Constants::Zero);
+    m_acceleration.push_back(ysMath::Constants::Zero);
+    m_forceAccum.push_back(ysMath::Constants::Zero);
+    m_torqueAccum.push_back(ysMath::Constants::Zero);
+    m_impulseAccum.push_back(ysMath::Constants::Zero);
+    m_angularImpulseAccum.push_back(ysMath::Constants::Zero);
+    m_inverseInertiaTensor.push_back(ysMath::LoadMatrix(
+        ysMath::Constants::Zero,
+        ysMath::Constants::Zero,
+        ysMath::Constants::Zero,
+        ysMath::Constants::IdentityRow4));
+
+    m_inverseMass.push_back(0.0f);
+    m_linearDamping.push_back(0.99f);
+    m_angularDamping.push_back(0.5f);
+    m_linearDampingFactor.push_back(1.0f);
+    m_angularDampingFactor.push_back(1.0f);
+    UpdateDampingFactors(index);
+
+    m_integrate.push_back(0);
+
+    return index;
+}
+
+void dphysics::RigidBodyState::Remove(int index) {
+    const int last = GetCount() - 1;
+
+    if (index != last) {
+        Copy(index, *this, last);
+        m_bodies[index] = m_bodies[last];
+        m_bodies[index]->m_stateIndex = index;
+    }
+
+    m_bodies.pop_back();
+
+    m_velocity.pop_back();
+    m_angularVelocity.pop_back();
+    m_acceleration.pop_back();
+    m_forceAccum.pop_back();
+    m_torqueAccum.pop_back();
+    m_impulseAccum.pop_back();
+    m_angularImpulseAccum.pop_back();
+    m_inverseInertiaTensor.pop_back();
+
+    m_inverseMass.pop_back();
+    m_linearDamping.pop_back();
+    m_angularDamping.pop_back();
+    m_linearDampingFactor.pop_back();
+    m_angularDampingFactor.pop_back();
+
+    m_integrate.pop_back();
+}
+
+void dphysics::RigidBodyState::Copy(int index, const RigidBodyState &source, int sourceIndex) {
+    m_velocity[index] = source.m_velocity[sourceIndex];
+    m_angularVelocity[index] = source.m_angularVelocity[sourceIndex];
+    m_acceleration[index] = source.m_acceleration[sourceIndex];
+    m_forceAccum[index] = source.m_forceAccum[sourceIndex];
+    m_torqueAccum[index] = source.m_torqueAccum[sourceIndex];
+    m_impulseAccum[index] = source.m_impulseAccum[sourceIndex];
+    m_angularImpulseAccum[index] = source.m_angularImpulseAccum[sourceIndex];
+    m_inverseInertiaTensor[index] = source.m_inverseInertiaTensor[sourceIndex];
+
+    m_inverseMass[index] = source.m_inverseMass[sourceIndex];
+    m_linearDamping[index] = source.m_linearDamping[sourceIndex];
+    m_angularDamping[index] = source.m_angularDamping[sourceIndex];
+    UpdateDampingFactors(index);
+
+    m_integrate[index] = source.m_integrate[sourceIndex];
+}
+
+void dphysics::RigidBodyState::SetLinearDamping(int index, float damping) {
+    m_linearDamping[index] = damping;
+    UpdateDampingFactors(index);
+}
+
+void dphysics::RigidBodyState::UpdateDampingFactors(float timeStep) {
+    if (timeStep == m_dampingTimeStep) return;
+
+    m_dampingTimeStep = timeStep;
+
+    const int count = GetCount();
+    for (int i = 0; i < count; ++i) {
+        UpdateDampingFactors(i);
+    }
+}
+
+void dphysics::RigidBodyState::UpdateDampingFactors(int index) {
+    m_linearDampingFactor[index] = pow(m_linearDamping[index], m_dampingTimeStep);
+    m_angularDampingFactor[index] = pow(m_angularDamping[index], m_dampingTimeStep);
+}
+
+void dphysics::RigidBodyState::ClearAccumulators() {
+    const int count = GetCount();
+    for (int i = 0; i < count; ++i) {
+        m_forceAccum[i] = ysMath::Constants::Zero;
+        m_torqueAccum[i] = ysMath::Constants::Zero;
+        m_impulseAccum[i] = ysMath::Constants::Zero;
+        m_angularImpulseAccum[i] = ysMath::Constants::Zero;
+    }
+}
+
+void dphysics::RigidBodyState::Integrate(float timeStep) {
+    UpdateDampingFactors(timeStep);
+
+    const int count = GetCount();
+    for (int i = 0; i < count; ++i) {
+        if (m_integrate[i] == 0) continue;
+        AdvanceVelocity(i, timeStep);
+    }
+}
+
+void dphysics::RigidBodyState::IntegrateVelocity(int i, float timeStep) {
+    UpdateDampingFactors(timeStep);
+    AdvanceVelocity(i, timeStep);
+}
+
+void dphysics::RigidBodyState::AdvanceVelocity(int i, float timeStep) {
+    const ysVector vTimeStep = ysMath::LoadScalar(timeStep);
+    const ysVector inverseMass = ysMath::LoadScalar(m_inverseMass[i]);
+
+    ysVector acceleration = m_acceleration[i];
+    acceleration = ysMath::Add(acceleration, ysMath::Mul(m_forceAccum[i], inverseMass));
+    ysVector angularAcceleration = ysMath::MatMult(m_inverseInertiaTensor[i], m_torqueAccum[i]);
+
+    ysVector velocity = ysMath::Add(m_velocity[i], ysMath::Mul(m_impulseAccum[i], inverseMass));
+    ysVector angularVelocity = ysMath::Add(m_angularVelocity[i], ysMath::Mul(m_angularImpulseAccum[i], inverseMass));
+
+    velocity = ysMath::Add(velocity, ysMath::Mul(acceleration, vTimeStep));
+    angularVelocity = ysMath::Add(angularVelocity, ysMath::Mul(angularAcceleration, vTimeStep));
+
+    m_angularVelocity[i] = ysMath::Mul(angularVelocity, ysMath::LoadScalar(m_angularDampingFactor[i]));
+    m_velocity[i] = ysMath::Mul(velocity, ysMath::LoadScalar(m_linearDampingFactor[i]));
+
+    m_impulseAccum[i] = ysMath::Constants::Zero;
+}
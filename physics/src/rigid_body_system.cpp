@@ -1,5 +1,7 @@
 #include "../include/rigid_body_system.h"
 
+#include "../include/force_generator.h"
+
 #if defined(__APPLE__) && defined(__MACH__) // Apple OSX & iOS (Darwin)
     // #include "win32/windows_modular.h"
 #elif defined(_WIN64)
@@ -8,20 +10,45 @@
 #endif
 
 #include <ctime>
+#include <cfloat>
 #include <assert.h>
+#include <algorithm>
+#include <cmath>
 
 float dphysics::RigidBodySystem::ResolutionPenetrationEpsilon = 1e-4f;
 
+const std::string dphysics::RigidBodySystem::IslandBreakdownCount = "Physics Islands";
+const std::string dphysics::RigidBodySystem::IslandBreakdownAwake = "Physics Awake Islands";
+const std::string dphysics::RigidBodySystem::IslandBreakdownLargestBodies = "Physics Largest Island Bodies";
+const std::string dphysics::RigidBodySystem::IslandBreakdownLargestContacts = "Physics Largest Island Contacts";
+
 dphysics::RigidBodySystem::RigidBodySystem() : ysObject("RigidBodySystem") {
     m_currentStep = 0.1f;
     m_lastLoadMeasurement = 0;
     m_loadMeasurement = 0;
-    m_replayEnabled = false;
 
     m_defaultDynamicFriction = 0.5f;
     m_defaultStaticFriction = 0.5f;
 
     m_breakdownTimer = nullptr;
+    m_islandCountChannel = nullptr;
+    m_awakeIslandChannel = nullptr;
+    m_largestIslandBodiesChannel = nullptr;
+    m_largestIslandContactsChannel = nullptr;
+
+    m_threadCount = WorkerPool::GetHardwareThreadCount();
+
+    m_currentCollisionPool = 0;
+
+    m_solverMode = SolverMode::LargestViolation;
+    m_solverIterations = DefaultSolverIterations;
+
+    m_broadphaseMode = BroadphaseMode::Grid;
+
+    m_sleepingEnabled = false;
+    m_sleepLinearThreshold = 0.05f;
+    m_sleepAngularThreshold = 0.05f;
+    m_sleepTime = 0.5f;
 }
 
 dphysics::RigidBodySystem::~RigidBodySystem() {
@@ -62,15 +89,69 @@ void dphysics::RigidBodySystem::SetFriction(
     m_staticFrictionTable[material2][material1] = staticFriction;
 }
 
+void dphysics::RigidBodySystem::SetSleepThresholds(float linearVelocity, float angularVelocity, float time) {
+    m_sleepLinearThreshold = linearVelocity;
+    m_sleepAngularThreshold = angularVelocity;
+    m_sleepTime = time;
+}
+
+void dphysics::RigidBodySystem::AttachBreakdownTimer(ysBreakdownTimer *breakdownTimer) {
+    m_breakdownTimer = breakdownTimer;
+
+    if (m_breakdownTimer == nullptr) {
+        m_islandCountChannel = nullptr;
+        m_awakeIslandChannel = nullptr;
+        m_largestIslandBodiesChannel = nullptr;
+        m_largestIslandContactsChannel = nullptr;
+    }
+    else {
+        m_islandCountChannel = m_breakdownTimer->CreateChannel(IslandBreakdownCount);
+        m_awakeIslandChannel = m_breakdownTimer->CreateChannel(IslandBreakdownAwake);
+        m_largestIslandBodiesChannel = m_breakdownTimer->CreateChannel(IslandBreakdownLargestBodies);
+        m_largestIslandContactsChannel = m_breakdownTimer->CreateChannel(IslandBreakdownLargestContacts);
+    }
+}
+
 void dphysics::RigidBodySystem::RegisterRigidBody(RigidBody *body) {
+    if (body->m_registered) return;
+
     body->m_registered = true;
     body->m_system = this;
     m_rigidBodyRegistry.Register(body);
+
+    body->AttachState(&m_bodyState);
+    body->UpdateMoved();
 }
 
 void dphysics::RigidBodySystem::RemoveRigidBody(RigidBody *body) {
-    if (body->m_registered) m_rigidBodyRegistry.Remove(body->GetIndex());
+    if (body->m_registered) {
+        m_rigidBodyRegistry.Remove(body->GetIndex());
+
+        body->DetachState();
+
+        if (body->m_treeProxy != -1) {
+            m_staticTree.DestroyProxy(body->m_treeProxy);
+            body->m_treeProxy = -1;
+        }
+
+        // The grid is only rebuilt by the next update so scene queries until
+        // then need to skip this body
+        const int cellCount = body->GetGridCellCount();
+        for (int i = 0; i < cellCount; ++i) {
+            const GridCell *gridCell = m_gridPartitionSystem.GetCell(body->GetGridCells()[i].index);
+            RigidBody **objects = m_gridPartitionSystem.GetCellObjects(gridCell);
+
+            for (int j = 0; j < gridCell->GetObjectCount(); ++j) {
+                if (objects[j] == body) objects[j] = nullptr;
+            }
+        }
+
+        body->ClearGridCells();
+    }
+
     body->m_registered = false;
+
+    m_pairCache.RemoveBody(body);
 }
 
 void dphysics::RigidBodySystem::DeleteLink(RigidBodyLink *link) {
@@ -94,13 +175,14 @@ void dphysics::RigidBodySystem::ProcessGridCell(int x, int y) {
     gridCell->IncrementRequestCount();
 
     if (gridCell->m_valid && !gridCell->m_processed) {
-        int cellObjects = gridCell->m_objects.GetNumObjects();
+        RigidBody **objects = m_gridPartitionSystem.GetCellObjects(gridCell);
+        int cellObjects = gridCell->GetObjectCount();
         for (int i = 0; i < cellObjects; i++) {
             RigidBody *body1, *body2;
-            body1 = gridCell->m_objects[i];
+            body1 = objects[i];
 
             for (int j = i + 1; j < cellObjects; j++) {
-                body2 = gridCell->m_objects[j];
+                body2 = objects[j];
 
                 if (body1->GetRoot() == body2->GetRoot()) continue;
 
@@ -114,98 +196,496 @@ void dphysics::RigidBodySystem::ProcessGridCell(int x, int y) {
 }
 
 void dphysics::RigidBodySystem::OpenReplayFile(const std::string &fname) {
-    m_outputFile = std::fstream(fname, std::ios::out);
+    const int bodyCount = m_rigidBodyRegistry.GetNumObjects();
 
-    if (!m_outputFile.is_open()) {
-        return;
+    m_replayBodies.resize(bodyCount);
+    for (int i = 0; i < bodyCount; ++i) {
+        ReplayRecorder::DescribeBody(m_rigidBodyRegistry.Get(i), &m_replayBodies[i]);
     }
-    
-    int bodyCount = m_rigidBodyRegistry.GetNumObjects();
 
-    m_outputFile << "<Objects>" << "\n";
+    m_replayRecorder.Open(fname, m_replayBodies);
+}
 
-    for (int i = 0; i < bodyCount; ++i) {
-        RigidBody *body = m_rigidBodyRegistry.Get(i);
-        body->WriteInfo(m_outputFile);
+void dphysics::RigidBodySystem::CloseReplayFile() {
+    m_replayRecorder.Close();
+}
+
+void dphysics::RigidBodySystem::GenerateCollisions(int start, int count, int threadId) {
+    CollisionThreadContext &context = m_threadContexts[threadId];
+    context.Collisions.clear();
+    context.Pairs.clear();
+
+    // Pairs are gathered body by body. A pair can share several grid cells, so
+    // the partners of the current body are stamped to only test them once.
+    // Cells list their objects in registry order which allows the scan of a
+    // cell to stop as soon as it reaches bodies that were already handled.
+    context.PairStamps.assign(m_rigidBodyRegistry.GetNumObjects(), -1);
+
+    const int end = start + count;
+    for (int i = start; i < end; ++i) {
+        RigidBody *body1 = m_rigidBodyRegistry.Get(i);
+
+        const int cellCount = body1->GetGridCellCount();
+        const RigidBody::GridCell *cells = body1->GetGridCells();
+
+        for (int c = 0; c < cellCount; ++c) {
+            GridCell *gridCell = m_gridPartitionSystem.GetCell(cells[c].index);
+
+            if (!ShouldProcessGridCell(gridCell)) continue;
+
+            RigidBody **objects = m_gridPartitionSystem.GetCellObjects(gridCell);
+            const int cellObjects = gridCell->GetObjectCount();
+            for (int j = cellObjects - 1; j >= 0; --j) {
+                RigidBody *body2 = objects[j];
+                const int index2 = body2->GetIndex();
+
+                if (index2 <= i) break;
+                if (context.PairStamps[index2] == i) continue;
+
+                context.PairStamps[index2] = i;
+
+                if (body1->GetRoot() == body2->GetRoot()) continue;
+
+                const int initialCollisionCount = (int)context.Collisions.size();
+                const int contactCount = DetectCollisions(body1, body2, context.Collisions);
+
+                if (contactCount > 0) {
+                    context.Pairs.push_back({ body1, body2, initialCollisionCount, contactCount });
+                }
+            }
+        }
+
+        // Everything in the tree is immovable or asleep and does not request
+        // information, so only bodies outside of it need contacts against it
+        if (m_staticTree.GetProxyCount() == 0) continue;
+        if (body1->m_treeProxy != -1 || !NeedsContacts(body1)) continue;
+        if (body1->CollisionGeometry.GetNumObjects() == 0) continue;
+
+        ysVector minPoint, maxPoint;
+        if (!GetBodyBounds(body1, minPoint, maxPoint)) {
+            // Rays are unbounded
+            minPoint = ysMath::LoadVector(-FLT_MAX, -FLT_MAX);
+            maxPoint = ysMath::LoadVector(FLT_MAX, FLT_MAX);
+        }
+
+        context.TreeProxies.clear();
+        m_staticTree.Query(minPoint, maxPoint, context.TreeProxies);
+
+        // Visit partners in registry order so that the contact order does not
+        // depend on the shape of the tree
+        std::sort(context.TreeProxies.begin(), context.TreeProxies.end(),
+            [this](int a, int b) {
+                return static_cast<RigidBody *>(m_staticTree.GetData(a))->GetIndex() <
+                    static_cast<RigidBody *>(m_staticTree.GetData(b))->GetIndex();
+            });
+
+        for (const int proxy : context.TreeProxies) {
+            RigidBody *body2 = static_cast<RigidBody *>(m_staticTree.GetData(proxy));
+            if (body1->GetRoot() == body2->GetRoot()) continue;
+
+            RigidBody *first = (body2->GetIndex() < i) ? body2 : body1;
+            RigidBody *second = (first == body1) ? body2 : body1;
+
+            const int initialCollisionCount = (int)context.Collisions.size();
+            const int contactCount = DetectCollisions(first, second, context.Collisions);
+
+            if (contactCount > 0) {
+                context.Pairs.push_back({ first, second, initialCollisionCount, contactCount });
+            }
+        }
     }
+}
+
+void dphysics::RigidBodySystem::UpdateStaticTree() {
+    const int nObjects = m_rigidBodyRegistry.GetNumObjects();
+    for (int i = 0; i < nObjects; ++i) {
+        RigidBody *body = m_rigidBodyRegistry.Get(i);
 
-    m_outputFile << "</Objects>" << "\n";
+        ysVector minPoint, maxPoint;
+        const bool inTree = BelongsInStaticTree(body) && GetBodyBounds(body, minPoint, maxPoint);
 
-    m_replayEnabled = true;
+        if (!inTree) {
+            if (body->m_treeProxy != -1) {
+                m_staticTree.DestroyProxy(body->m_treeProxy);
+                body->m_treeProxy = -1;
+            }
+        }
+        else if (body->m_treeProxy == -1) {
+            body->m_treeProxy = m_staticTree.CreateProxy(minPoint, maxPoint, body);
+        }
+        else {
+            m_staticTree.MoveProxy(body->m_treeProxy, minPoint, maxPoint);
+        }
+    }
 }
 
-void dphysics::RigidBodySystem::CloseReplayFile() {
-    m_replayEnabled = false;
-    m_outputFile.close();
+bool dphysics::RigidBodySystem::BelongsInStaticTree(RigidBody *body) const {
+    if (m_broadphaseMode != BroadphaseMode::GridAndTree) return false;
+    else if (body->RequestsInformation()) return false;
+    else if (body->HasMoved()) return false;
+    else if (!body->IsAwake()) return true;
+    else return body->GetHint() == RigidBody::RigidBodyHint::Static && body->IsImmovable();
 }
 
-void dphysics::RigidBodySystem::GenerateCollisions(int start, int count) {
+bool dphysics::RigidBodySystem::GetBodyBounds(RigidBody *body, ysVector &minPoint, ysVector &maxPoint) {
+    const int nObjects = body->CollisionGeometry.GetNumObjects();
+    if (nObjects == 0) return false;
+
+    CollisionObject **objects = body->CollisionGeometry.GetCollisionObjects();
+    for (int i = 0; i < nObjects; ++i) {
+        const CollisionObject::Type type = objects[i]->GetType();
+        if (type != CollisionObject::Type::Box && type != CollisionObject::Type::Circle) return false;
+
+        ysVector objectMin, objectMax;
+        objects[i]->GetBounds(objectMin, objectMax);
+
+        minPoint = (i == 0) ? objectMin : ysMath::ComponentMin(minPoint, objectMin);
+        maxPoint = (i == 0) ? objectMax : ysMath::ComponentMax(maxPoint, objectMax);
+    }
+
+    return true;
+}
+
+bool dphysics::RigidBodySystem::ShouldProcessGridCell(const GridCell *gridCell) {
     const int REQUEST_THRESHOLD = 0;
 
-    const int rigidBodyCount = m_rigidBodyRegistry.GetNumObjects();
-    bool **visited = new bool *[rigidBodyCount];
-    for (int i = 0; i < rigidBodyCount; ++i) {
-        visited[i] = new bool[rigidBodyCount];
-        memset((void *)visited[i], 0, sizeof(bool) * rigidBodyCount);
+    if (!gridCell->m_valid) return false;
+    if (!gridCell->m_forceProcess && gridCell->GetRequestCount() < REQUEST_THRESHOLD) return false;
+
+    return true;
+}
+
+void dphysics::RigidBodySystem::GenerateCollisionsThread(void *data) {
+    YS_PROFILE_ZONE("RigidBodySystem::GenerateCollisionsThread");
+
+    CollisionGenerationCallData *callData = reinterpret_cast<CollisionGenerationCallData *>(data);
+    callData->System->GenerateCollisions(callData->Start, callData->Count, callData->ThreadID);
+}
+
+void dphysics::RigidBodySystem::RaycastBatch(const RaycastQuery *queries, int count, QueryHit *hits) {
+    SceneQueryCallData batch = {};
+    batch.Raycasts = queries;
+    batch.Hits = hits;
+
+    RunSceneQueries(batch, count);
+}
+
+void dphysics::RigidBodySystem::SweepCircleBatch(const SweepCircleQuery *queries, int count, QueryHit *hits) {
+    SceneQueryCallData batch = {};
+    batch.Sweeps = queries;
+    batch.Hits = hits;
+
+    RunSceneQueries(batch, count);
+}
+
+void dphysics::RigidBodySystem::OverlapCircleBatch(
+    const OverlapCircleQuery *queries, int count, OverlapResult *results, std::vector<RigidBody *> &bodies)
+{
+    SceneQueryCallData batch = {};
+    batch.Overlaps = queries;
+    batch.Results = results;
+
+    RunSceneQueries(batch, count);
+
+    // Every thread collected the overlaps of its own range of queries
+    bodies.clear();
+    for (const SceneQueryCallData &job : m_queryJobs) {
+        const std::vector<RigidBody *> &threadBodies = m_queryContexts[job.ThreadID].Bodies;
+        const int offset = (int)bodies.size();
+
+        for (int i = job.Start; i < job.Start + job.Count; ++i) {
+            results[i].Start += offset;
+        }
+
+        bodies.insert(bodies.end(), threadBodies.begin(), threadBodies.end());
     }
+}
 
-    for (auto cell: m_gridPartitionSystem.m_gridCells) {
-        GridCell *gridCell = cell.second;
+void dphysics::RigidBodySystem::RunSceneQueries(const SceneQueryCallData &batch, int count) {
+    const int threadCount = (count < m_threadCount) ? 1 : m_threadCount;
+    if (m_workerPool.GetWorkerCount() != m_threadCount - 1) {
+        m_workerPool.Initialize(m_threadCount - 1);
+    }
 
-        if (gridCell->m_valid && (gridCell->m_forceProcess || gridCell->GetRequestCount() >= REQUEST_THRESHOLD)) {
-            int cellObjects = gridCell->m_objects.GetNumObjects();
+    m_queryContexts.resize(threadCount);
+    m_queryJobs.resize(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        const int start = (int)(((int64_t)count * i) / threadCount);
+        const int end = (int)(((int64_t)count * (i + 1)) / threadCount);
+
+        m_queryJobs[i] = batch;
+        m_queryJobs[i].System = this;
+        m_queryJobs[i].Start = start;
+        m_queryJobs[i].Count = end - start;
+        m_queryJobs[i].ThreadID = i;
+    }
 
-            for (int i = 0; i < cellObjects; i++) {
-                RigidBody *body1, *body2;
-                body1 = gridCell->m_objects[i];
+    m_workerPool.Run(
+        &RigidBodySystem::SceneQueryThread,
+        m_queryJobs.data(),
+        sizeof(SceneQueryCallData),
+        threadCount);
+}
 
-                for (int j = i + 1; j < cellObjects; j++) {
-                    body2 = gridCell->m_objects[j];
+void dphysics::RigidBodySystem::SceneQueryThread(void *data) {
+    YS_PROFILE_ZONE("RigidBodySystem::SceneQueryThread");
 
-                    if (visited[body1->GetIndex()][body2->GetIndex()]) continue;
-                    if (body1->GetRoot() == body2->GetRoot()) continue;
+    SceneQueryCallData *callData = reinterpret_cast<SceneQueryCallData *>(data);
+    callData->System->ProcessSceneQueries(*callData);
+}
 
-                    visited[body1->GetIndex()][body2->GetIndex()] = true;
+void dphysics::RigidBodySystem::ProcessSceneQueries(const SceneQueryCallData &job) {
+    SceneQueryContext &context = m_queryContexts[job.ThreadID];
+    context.Bodies.clear();
 
-                    GenerateCollisions(body1, body2);
-                }
+    const int end = job.Start + job.Count;
+    for (int i = job.Start; i < end; ++i) {
+        if (job.Raycasts != nullptr) {
+            const RaycastQuery &query = job.Raycasts[i];
+            Sweep(query.Origin, query.Direction, 0.0f, query.MaxDistance, query.LayerMask, context, &job.Hits[i]);
+        }
+        else if (job.Sweeps != nullptr) {
+            const SweepCircleQuery &query = job.Sweeps[i];
+            Sweep(query.Origin, query.Direction, query.Radius, query.MaxDistance, query.LayerMask, context, &job.Hits[i]);
+        }
+        else {
+            const OverlapCircleQuery &query = job.Overlaps[i];
+            OverlapResult &result = job.Results[i];
+
+            result.Start = (int)context.Bodies.size();
+            Overlap(query.Center, query.Radius, query.LayerMask, context);
+            result.Count = (int)context.Bodies.size() - result.Start;
+        }
+    }
+}
+
+void dphysics::RigidBodySystem::GatherQueryCandidates(
+    const ysVector &start, const ysVector &end, float radius, SceneQueryContext &context)
+{
+    context.Candidates.clear();
+
+    context.Proxies.clear();
+    m_staticTree.QuerySegment(start, end, radius, context.Proxies);
+    for (const int proxy : context.Proxies) {
+        context.Candidates.push_back(static_cast<RigidBody *>(m_staticTree.GetData(proxy)));
+    }
+
+    // Bodies are assumed to fit within the maximum object size around their
+    // position, so only the cells close to the segment need to be visited.
+    // Each body is picked up from the cell that contains its position.
+    const float cellSize = m_gridPartitionSystem.GetGridCellSize();
+    const float margin = m_gridPartitionSystem.GetMaxObjectSize() * 0.5f + radius;
+
+    const float x0 = ysMath::GetX(start), y0 = ysMath::GetY(start);
+    const float dx = ysMath::GetX(end) - x0, dy = ysMath::GetY(end) - y0;
+
+    const int firstColumn = m_gridPartitionSystem.GetCellCoordinate(std::min(x0, x0 + dx) - margin);
+    const int lastColumn = m_gridPartitionSystem.GetCellCoordinate(std::max(x0, x0 + dx) + margin);
+
+    for (int x = firstColumn; x <= lastColumn; ++x) {
+        // Part of the segment that passes close to this column
+        float t0 = 0.0f, t1 = 1.0f;
+        if (dx != 0.0f) {
+            float ta = (x * cellSize - margin - x0) / dx;
+            float tb = ((x + 1) * cellSize + margin - x0) / dx;
+            if (ta > tb) std::swap(ta, tb);
+
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+            if (t0 > t1) continue;
+        }
+
+        const float ya = y0 + dy * t0, yb = y0 + dy * t1;
+        const int firstRow = m_gridPartitionSystem.GetCellCoordinate(std::min(ya, yb) - margin);
+        const int lastRow = m_gridPartitionSystem.GetCellCoordinate(std::max(ya, yb) + margin);
+
+        for (int y = firstRow; y <= lastRow; ++y) {
+            const int cellIndex = m_gridPartitionSystem.FindCellIndex(x, y);
+            if (cellIndex == -1) continue;
+
+            const GridCell *gridCell = m_gridPartitionSystem.GetCell(cellIndex);
+            RigidBody **objects = m_gridPartitionSystem.GetCellObjects(gridCell);
+            for (int i = 0; i < gridCell->GetObjectCount(); ++i) {
+                RigidBody *body = objects[i];
+                if (body == nullptr || body->GetGridCells()[0].index != cellIndex) continue;
+
+                context.Candidates.push_back(body);
             }
+        }
+    }
+}
 
-            gridCell->m_processed = true;
+void dphysics::RigidBodySystem::Sweep(
+    const ysVector &origin, const ysVector &direction, float radius, float maxDistance,
+    unsigned int layerMask, SceneQueryContext &context, QueryHit *hit)
+{
+    hit->Body = nullptr;
+    hit->Object = nullptr;
+    hit->Position = ysMath::Constants::Zero;
+    hit->Normal = ysMath::Constants::Zero;
+    hit->Distance = maxDistance;
+
+    const float dx = ysMath::GetX(direction), dy = ysMath::GetY(direction);
+    const float length = std::sqrt(dx * dx + dy * dy);
+    if (maxDistance <= 0.0f || length == 0.0f) return;
+
+    const float ox = ysMath::GetX(origin), oy = ysMath::GetY(origin);
+    const float ux = dx / length, uy = dy / length;
+
+    const ysVector start = ysMath::LoadVector(ox, oy);
+    const ysVector unit = ysMath::LoadVector(ux, uy);
+
+    GatherQueryCandidates(start, ysMath::LoadVector(ox + ux * maxDistance, oy + uy * maxDistance), radius, context);
+
+    for (RigidBody *body : context.Candidates) {
+        const int objectCount = body->CollisionGeometry.GetNumObjects();
+        CollisionObject **objects = body->CollisionGeometry.GetCollisionObjects();
+
+        for (int i = 0; i < objectCount; ++i) {
+            CollisionObject *object = objects[i];
+            if (object->GetMode() != CollisionObject::Mode::Fine) continue;
+            if (!IsOnQueryLayer(object, layerMask)) continue;
+
+            float distance;
+            ysVector normal;
+            bool intersects = false;
+
+            if (object->GetType() == CollisionObject::Type::Circle) {
+                intersects = CollisionDetector.SweepCircleCircle(
+                    start, unit, radius, hit->Distance, object->GetAsCircle(), &distance, &normal);
+            }
+            else if (object->GetType() == CollisionObject::Type::Box) {
+                intersects = CollisionDetector.SweepCircleBox(
+                    start, unit, radius, hit->Distance, object->GetAsBox(), &distance, &normal);
+            }
+
+            if (!intersects) continue;
+
+            // Ties go to the body that was registered first so that the result
+            // does not depend on the order of the candidates
+            if (hit->Body == nullptr ||
+                distance < hit->Distance ||
+                (distance == hit->Distance && body->GetIndex() < hit->Body->GetIndex()))
+            {
+                hit->Body = body;
+                hit->Object = object;
+                hit->Normal = normal;
+                hit->Distance = distance;
+            }
         }
     }
 
-    for (int i = 0; i < rigidBodyCount; ++i) {
-        delete[] visited[i];
+    if (hit->Body != nullptr) {
+        hit->Position = ysMath::LoadVector(
+            ox + ux * hit->Distance - ysMath::GetX(hit->Normal) * radius,
+            oy + uy * hit->Distance - ysMath::GetY(hit->Normal) * radius);
     }
-    delete[] visited;
+}
+
+void dphysics::RigidBodySystem::Overlap(
+    const ysVector &center, float radius, unsigned int layerMask, SceneQueryContext &context)
+{
+    GatherQueryCandidates(center, center, radius, context);
+
+    const int start = (int)context.Bodies.size();
+    for (RigidBody *body : context.Candidates) {
+        const int objectCount = body->CollisionGeometry.GetNumObjects();
+        CollisionObject **objects = body->CollisionGeometry.GetCollisionObjects();
+
+        for (int i = 0; i < objectCount; ++i) {
+            CollisionObject *object = objects[i];
+            if (object->GetMode() != CollisionObject::Mode::Fine) continue;
+            if (!IsOnQueryLayer(object, layerMask)) continue;
+
+            bool overlaps = false;
+            if (object->GetType() == CollisionObject::Type::Circle) {
+                overlaps = CollisionDetector.OverlapCircleCircle(center, radius, object->GetAsCircle());
+            }
+            else if (object->GetType() == CollisionObject::Type::Box) {
+                overlaps = CollisionDetector.OverlapCircleBox(center, radius, object->GetAsBox());
+            }
+
+            if (overlaps) {
+                context.Bodies.push_back(body);
+                break;
+            }
+        }
+    }
+
+    std::sort(context.Bodies.begin() + start, context.Bodies.end(),
+        [](RigidBody *a, RigidBody *b) { return a->GetIndex() < b->GetIndex(); });
+}
+
+bool dphysics::RigidBodySystem::IsOnQueryLayer(const CollisionObject *object, unsigned int layerMask) {
+    const int layer = object->GetLayer();
+    if (layer < 0 || layer >= 32) return false;
+
+    return (layerMask & (0x1u << layer)) != 0;
 }
 
 void dphysics::RigidBodySystem::WriteFrameToReplayFile() {
-    m_outputFile << "<Frame>" << "\n";
+    const int bodyCount = m_rigidBodyRegistry.GetNumObjects();
 
-    int bodyCount = m_rigidBodyRegistry.GetNumObjects();
+    float *values = m_replayRecorder.BeginFrame(bodyCount);
     for (int i = 0; i < bodyCount; ++i) {
         RigidBody *body = m_rigidBodyRegistry.Get(i);
-        
-        m_outputFile << "<Body>" << "\n";
-        m_outputFile << "POSITION " <<
-            ysMath::GetX(body->Transform.GetWorldPosition()) << " " <<
-            ysMath::GetY(body->Transform.GetWorldPosition()) << " " <<
-            ysMath::GetZ(body->Transform.GetWorldPosition()) << "\n";
-        m_outputFile << "ORIENTATION " <<
-            ysMath::GetQuatW(body->Transform.GetWorldOrientation()) << " " <<
-            ysMath::GetQuatX(body->Transform.GetWorldOrientation()) << " " <<
-            ysMath::GetQuatY(body->Transform.GetWorldOrientation()) << " " <<
-            ysMath::GetQuatZ(body->Transform.GetWorldOrientation()) << "\n";
-        m_outputFile << "</Body>" << "\n";
+
+        const ysVector position = body->Transform.GetWorldPosition();
+        const ysQuaternion orientation = body->Transform.GetWorldOrientation();
+
+        float *target = values + i * ReplayCodec::ValuesPerBody;
+        target[0] = ysMath::GetX(position);
+        target[1] = ysMath::GetY(position);
+        target[2] = ysMath::GetZ(position);
+        target[3] = ysMath::GetQuatW(orientation);
+        target[4] = ysMath::GetQuatX(orientation);
+        target[5] = ysMath::GetQuatY(orientation);
+        target[6] = ysMath::GetQuatZ(orientation);
     }
 
-    m_outputFile << "</Frame>" << "\n";
+    m_replayRecorder.EndFrame();
 }
 
 void dphysics::RigidBodySystem::GenerateCollisions(RigidBody *body1, RigidBody *body2) {
-    if (!body1->IsAwake() && !body2->IsAwake()) return;
+    m_narrowphaseScratch.clear();
+
+    const int count = DetectCollisions(body1, body2, m_narrowphaseScratch);
+    CommitCollisions(body1, body2, m_narrowphaseScratch.data(), count);
+}
+
+void dphysics::RigidBodySystem::CommitCollisions(
+    RigidBody *body1, RigidBody *body2, Collision *collisions, int count)
+{
+    // Contacts between bodies that are not simulated are only reported, a
+    // sleeping body is woken up by a simulated or moving body touching it
+    const bool wake = IsWaker(body1) || IsWaker(body2);
+
+    for (int i = 0; i < count; ++i) {
+        const int newCollisionIndex = m_collisionPools[m_currentCollisionPool].Allocate();
+        m_collisionAccumulator.New() = newCollisionIndex;
+
+        Collision *newCollisionEntry = GetCollision(newCollisionIndex);
+        *newCollisionEntry = collisions[i];
+
+        if (!newCollisionEntry->m_sensor || body1->RequestsInformation()) {
+            body1->AddCollision(newCollisionEntry, wake);
+        }
+
+        if (!newCollisionEntry->m_sensor || body2->RequestsInformation()) {
+            body2->AddCollision(newCollisionEntry, wake);
+        }
+
+        RecordContact(newCollisionEntry);
+    }
+}
+
+int dphysics::RigidBodySystem::DetectCollisions(
+    RigidBody *body1, RigidBody *body2, std::vector<Collision> &collisions)
+{
+    // Neither body can move and nobody is listening for the result
+    if (!NeedsContacts(body1) && !NeedsContacts(body2)) return 0;
+
+    const int initialCount = (int)collisions.size();
 
     const int nPrim1 = body1->CollisionGeometry.GetNumObjects();
     const int nPrim2 = body2->CollisionGeometry.GetNumObjects();
@@ -304,30 +784,22 @@ void dphysics::RigidBodySystem::GenerateCollisions(RigidBody *body1, RigidBody *
                 }
 
                 for (int i = 0; i < nCollisions; ++i) {
-                    Collision *newCollisionEntry = m_dynamicCollisions.NewGeneric<Collision, 16>();
-                    m_collisionAccumulator.New() = newCollisionEntry;
-
-                    *newCollisionEntry = newCollisions[i];
-
-                    if (!sensorTest || body1->RequestsInformation()) {
-                        body1->AddCollision(newCollisionEntry);
-                    }
-                    
-                    if (!sensorTest || body2->RequestsInformation()) {
-                        body2->AddCollision(newCollisionEntry);
-                    }
-
-                    newCollisionEntry->m_collisionObject1 = prim1;
-                    newCollisionEntry->m_collisionObject2 = prim2;
-                    newCollisionEntry->m_sensor = sensorTest;
-                    newCollisionEntry->m_dynamicFriction =
+                    Collision &newCollision = newCollisions[i];
+                    newCollision.m_collisionObject1 = prim1;
+                    newCollision.m_collisionObject2 = prim2;
+                    newCollision.m_sensor = sensorTest;
+                    newCollision.m_dynamicFriction =
                         GetDynamicFriction(body1->GetMaterial(), body2->GetMaterial());
-                    newCollisionEntry->m_staticFriction =
+                    newCollision.m_staticFriction =
                         GetStaticFriction(body1->GetMaterial(), body2->GetMaterial());
+
+                    collisions.push_back(newCollision);
                 }
             }
         }
     }
+
+    return (int)collisions.size() - initialCount;
 }
 
 #define sgn(x) ( ((x) > 0.0f) ? 1.0f : -1.0f )
@@ -336,22 +808,88 @@ bool dphysics::RigidBodySystem::CollisionExists(Collision *collision) {
     return collision->m_body1->FindMatchingCollision(collision) != nullptr;
 }
 
+dphysics::Collision *dphysics::RigidBodySystem::FindPreviousCollision(Collision *collision) {
+    int count;
+    Collision **previous = m_pairCache.GetPreviousContacts(collision->m_body1, collision->m_body2, &count);
+
+    for (int i = 0; i < count; ++i) {
+        if (previous[i]->IsSameAs(collision)) return previous[i];
+    }
+
+    return nullptr;
+}
+
+void dphysics::RigidBodySystem::RecordContact(Collision *collision) {
+    // Contacts of the last frame are only kept alive for warm starting
+    if (m_solverMode != SolverMode::SequentialImpulse) return;
+    if (collision->m_body1 == nullptr || collision->m_body2 == nullptr) return;
+
+    CollisionPairCache::Pair *pair = m_pairCache.Touch(collision->m_body1, collision->m_body2);
+    m_pairCache.AddContact(pair, collision);
+}
+
 void dphysics::RigidBodySystem::GenerateCollisions() {
+    YS_PROFILE_ZONE("RigidBodySystem::GenerateCollisions");
+
     ClearCollisions();
     int nObjects = m_rigidBodyRegistry.GetNumObjects();
 
+    for (int i = 0; i < nObjects; i++) {
+        m_rigidBodyRegistry.Get(i)->ClearCollisions();
+        m_rigidBodyRegistry.Get(i)->CollisionGeometry.UpdatePrimitives();
+    }
+
+    UpdateStaticTree();
+
     // Generate grid cells
     m_gridPartitionSystem.Reset();
     for (int i = 0; i < nObjects; i++) {
-        m_gridPartitionSystem.ProcessRigidBody(m_rigidBodyRegistry.Get(i));
+        RigidBody *body = m_rigidBodyRegistry.Get(i);
+
+        if (body->m_treeProxy == -1) m_gridPartitionSystem.ProcessRigidBody(body);
+        else body->ClearGridCells();
+    }
+    m_gridPartitionSystem.Finalize();
+
+    // Bodies are split into contiguous ranges, one per thread. Each range
+    // writes its contacts to its own buffer and the buffers are committed in
+    // range order, which reproduces the serial ordering exactly.
+    const int threadCount = (nObjects < m_threadCount) ? 1 : m_threadCount;
+    if (m_workerPool.GetWorkerCount() != m_threadCount - 1) {
+        m_workerPool.Initialize(m_threadCount - 1);
     }
 
-    for (int i = 0; i < nObjects; i++) {
-        m_rigidBodyRegistry.Get(i)->ClearCollisions();
-        m_rigidBodyRegistry.Get(i)->CollisionGeometry.UpdatePrimitives();
+    m_threadContexts.resize(threadCount);
+    m_collisionJobs.resize(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        const int start = (int)(((int64_t)nObjects * i) / threadCount);
+        const int end = (int)(((int64_t)nObjects * (i + 1)) / threadCount);
+
+        m_collisionJobs[i] = { this, start, end - start, i };
     }
 
-    GenerateCollisions(0, 0);
+    m_workerPool.Run(
+        &RigidBodySystem::GenerateCollisionsThread,
+        m_collisionJobs.data(),
+        sizeof(CollisionGenerationCallData),
+        threadCount);
+
+    m_pairCache.BeginFrame();
+    for (int i = 0; i < threadCount; ++i) {
+        CollisionThreadContext &context = m_threadContexts[i];
+
+        for (const PairContacts &pair : context.Pairs) {
+            CommitCollisions(pair.Body1, pair.Body2, &context.Collisions[pair.Start], pair.Count);
+        }
+    }
+
+    const int cellCount = m_gridPartitionSystem.GetCellCount();
+    for (int i = 0; i < cellCount; ++i) {
+        GridCell *gridCell = m_gridPartitionSystem.GetCell(i);
+        if (gridCell->GetObjectCount() > 0 && ShouldProcessGridCell(gridCell)) {
+            gridCell->m_processed = true;
+        }
+    }
 
     const int load = m_loadMeasurement;
 
@@ -369,22 +907,35 @@ void dphysics::RigidBodySystem::GenerateCollisions() {
     Collision collisions[16];
     int nLinks = m_rigidBodyLinks.GetNumObjects();
     for (int i = 0; i < nLinks; i++) {
-        int nGenerated = m_rigidBodyLinks.Get(i)->GenerateCollisions(collisions);
+        RigidBodyLink *link = m_rigidBodyLinks.Get(i);
+
+        // Links with a single body attach it to the world
+        RigidBody *body1 = link->GetBody1();
+        RigidBody *body2 = link->GetBody2();
+        if ((body1 == nullptr || !IsWaker(body1)) && (body2 == nullptr || !IsWaker(body2))) continue;
+
+        int nGenerated = link->GenerateCollisions(collisions);
         for (int j = 0; j < nGenerated; j++) {
-            Collision *newCollisionEntry = m_dynamicCollisions.NewGeneric<Collision, 16>();
-            m_collisionAccumulator.New() = newCollisionEntry;
+            const int newCollisionIndex = m_collisionPools[m_currentCollisionPool].Allocate();
+            m_collisionAccumulator.New() = newCollisionIndex;
+
+            Collision *newCollisionEntry = GetCollision(newCollisionIndex);
             *newCollisionEntry = collisions[j];
 
-            newCollisionEntry->m_body1->AddCollision(newCollisionEntry);
-            newCollisionEntry->m_body2->AddCollision(newCollisionEntry);
+            if (newCollisionEntry->m_body1 != nullptr) newCollisionEntry->m_body1->AddCollision(newCollisionEntry);
+            if (newCollisionEntry->m_body2 != nullptr) newCollisionEntry->m_body2->AddCollision(newCollisionEntry);
+
+            RecordContact(newCollisionEntry);
         }
     }
 }
 
 void dphysics::RigidBodySystem::InitializeCollisions() {
+    YS_PROFILE_ZONE("RigidBodySystem::InitializeCollisions");
+
     int numContacts = m_collisionAccumulator.GetNumObjects();
     for (int i = 0; i < numContacts; ++i) {
-        Collision &collision = *m_collisionAccumulator[i];
+        Collision &collision = *GetCollision(m_collisionAccumulator[i]);
 
         if (collision.m_sensor) continue;
         if (collision.IsGhost()) continue;
@@ -398,14 +949,13 @@ void dphysics::RigidBodySystem::CleanCollisions() {
 
     int numContacts = m_collisionAccumulator.GetNumObjects();
     for (int i = 0; i < numContacts; ++i) {
-        Collision &collision = *m_collisionAccumulator[i];
+        Collision &collision = *GetCollision(m_collisionAccumulator[i]);
 
         if (collision.m_penetration < MinPenetration || 
             collision.IsGhost() ||
             collision.m_sensor) 
         {
             m_collisionAccumulator.Delete(i, false);
-            m_dynamicCollisions.Delete(collision.GetIndex());
             --numContacts;
         }
     }
@@ -413,7 +963,14 @@ void dphysics::RigidBodySystem::CleanCollisions() {
 
 void dphysics::RigidBodySystem::ClearCollisions() {
     m_collisionAccumulator.Clear();
-    m_dynamicCollisions.Clear();
+
+    // The last frame's contacts are kept alive in the other pool for warm
+    // starting
+    if (m_solverMode == SolverMode::SequentialImpulse) {
+        m_currentCollisionPool = 1 - m_currentCollisionPool;
+    }
+
+    m_collisionPools[m_currentCollisionPool].Reset();
 }
 
 void dphysics::RigidBodySystem::ResolveCollision(Collision *collision, ysVector *velocityChange, ysVector *rotationDirection, float rotationAmount[2], float penetration) {
@@ -507,6 +1064,10 @@ void dphysics::RigidBodySystem::ResolveCollision(Collision *collision, ysVector
             velocityChange[b] = collision->m_normal;
             velocityChange[b] = ysMath::Mul(velocityChange[b], ysMath::LoadScalar(linearMove[b] / rotationAmount[b]));
 
+            // Immovable bodies can be shared by islands that are solved
+            // concurrently and would only receive a zero move anyway
+            if (body->IsImmovable()) continue;
+
             ysVector pos = body->Transform.GetPositionParentSpace();
             pos = ysMath::Add(pos, ysMath::Mul(collision->m_normal, ysMath::LoadScalar(linearMove[b])));
             body->Transform.SetPosition(pos);
@@ -518,9 +1079,7 @@ void dphysics::RigidBodySystem::ResolveCollision(Collision *collision, ysVector
     }
 }
 
-void dphysics::RigidBodySystem::AdjustVelocities(float timestep) {
-    const int numContacts = m_collisionAccumulator.GetNumObjects();
-
+void dphysics::RigidBodySystem::AdjustVelocities(Collision **collisions, int numContacts, float timestep) {
     ysVector velocityChange[2], rotationChange[2];
     ysVector cp;
 
@@ -530,7 +1089,7 @@ void dphysics::RigidBodySystem::AdjustVelocities(float timestep) {
         float max = 1E-4f;
         int index = numContacts;
         for(int i = 0; i < numContacts; ++i) {
-            Collision &collision = *m_collisionAccumulator[i];
+            Collision &collision = *collisions[i];
             if (collision.m_desiredDeltaVelocity > max) {
                 if (collision.m_sensor) continue;
                 if (collision.IsGhost()) continue;
@@ -542,7 +1101,7 @@ void dphysics::RigidBodySystem::AdjustVelocities(float timestep) {
         }
         if (index == numContacts) break;
 
-        Collision *biggestCollision = m_collisionAccumulator[index];
+        Collision *biggestCollision = collisions[index];
 
         // Match the awake state at the contact
         //c[index].matchAwakeState();
@@ -554,7 +1113,7 @@ void dphysics::RigidBodySystem::AdjustVelocities(float timestep) {
         // contact velocities means that some of the relative closing 
         // velocities need recomputing.
         for (int i = 0; i < numContacts; ++i) {
-            Collision *c = m_collisionAccumulator[i];
+            Collision *c = collisions[i];
 
             if (c->m_sensor) continue;
             if (c->IsGhost()) continue;
@@ -685,8 +1244,10 @@ void dphysics::RigidBodySystem::AdjustVelocity(Collision *collision, ysVector ve
     velocityChange[0] = ysMath::Mul(impulse, ysMath::LoadScalar(collision->m_bodies[0]->GetInverseMass()));
 
     // Apply the changes
-    collision->m_bodies[0]->AddVelocity(velocityChange[0]);
-    collision->m_bodies[0]->AddAngularVelocity(rotationChange[0]);
+    if (!collision->m_bodies[0]->IsImmovable()) {
+        collision->m_bodies[0]->AddVelocity(velocityChange[0]);
+        collision->m_bodies[0]->AddAngularVelocity(rotationChange[0]);
+    }
 
     if (collision->m_bodies[1] != nullptr) {
         // Work out body one's linear and angular changes
@@ -695,8 +1256,10 @@ void dphysics::RigidBodySystem::AdjustVelocity(Collision *collision, ysVector ve
         velocityChange[1] = ysMath::Mul(impulse, ysMath::LoadScalar(-collision->m_bodies[1]->GetInverseMass()));
 
         // And apply them.
-        collision->m_bodies[1]->AddVelocity(velocityChange[1]);
-        collision->m_bodies[1]->AddAngularVelocity(rotationChange[1]);
+        if (!collision->m_bodies[1]->IsImmovable()) {
+            collision->m_bodies[1]->AddVelocity(velocityChange[1]);
+            collision->m_bodies[1]->AddAngularVelocity(rotationChange[1]);
+        }
     }
 
     assert(ysMath::IsValid(velocityChange[0]));
@@ -705,9 +1268,8 @@ void dphysics::RigidBodySystem::AdjustVelocity(Collision *collision, ysVector ve
     assert(ysMath::IsValid(rotationChange[1]));
 }
 
-void dphysics::RigidBodySystem::ResolveCollisions(float dt) {
+void dphysics::RigidBodySystem::ResolveCollisions(Collision **collisions, int numContacts, float dt) {
     int i, index;
-    int numContacts = m_collisionAccumulator.GetNumObjects();
 
     float max;
     int iterationsUsed = 0;
@@ -721,7 +1283,7 @@ void dphysics::RigidBodySystem::ResolveCollisions(float dt) {
         index = numContacts;
 
         for (i = 0; i < numContacts; i++) {
-            Collision &collision = *m_collisionAccumulator[i];
+            Collision &collision = *collisions[i];
 
             if (collision.m_sensor) continue;
             if (collision.IsGhost()) continue;
@@ -737,7 +1299,7 @@ void dphysics::RigidBodySystem::ResolveCollisions(float dt) {
 
         if (index == numContacts) return;
 
-        Collision *biggestCollision = m_collisionAccumulator[index];
+        Collision *biggestCollision = collisions[index];
 
         biggestCollision->UpdateInternals(dt);
         ResolveCollision(biggestCollision,
@@ -747,7 +1309,7 @@ void dphysics::RigidBodySystem::ResolveCollisions(float dt) {
             max);
 
         for (i = 0; i < numContacts; i++) {
-            Collision &collision = *m_collisionAccumulator[i];
+            Collision &collision = *collisions[i];
 
             if (collision.m_sensor) continue;
             if (collision.IsGhost()) continue;
@@ -791,19 +1353,182 @@ void dphysics::RigidBodySystem::ResolveCollisions(float dt) {
     }
 }
 
+void dphysics::RigidBodySystem::SolveSequentialImpulse(Collision **collisions, int numContacts, float timestep) {
+    constexpr float BaumgarteFactor = 0.2f;
+    constexpr float PenetrationSlop = 0.01f;
+    constexpr float VelocityLimit = 0.25f;
+
+    const ysVector axes[] = {
+        ysMath::Constants::XAxis, ysMath::Constants::YAxis, ysMath::Constants::ZAxis };
+
+    for (int i = 0; i < numContacts; ++i) {
+        Collision *collision = collisions[i];
+
+        if (collision->m_sensor) continue;
+        if (collision->IsGhost()) continue;
+        if (!collision->IsResolvable()) continue;
+
+        collision->UpdateInternals(timestep);
+
+        // Impulse needed per unit velocity change along each contact axis
+        float effectiveMass[3];
+        for (int axis = 0; axis < 3; ++axis) {
+            const ysVector direction = ysMath::MatMult(collision->m_contactSpace, axes[axis]);
+
+            float k = 0.0f;
+            for (int b = 0; b < 2; ++b) {
+                RigidBody *body = collision->m_bodies[b];
+                if (body == nullptr) continue;
+
+                ysVector angular = ysMath::Cross(collision->m_relativePosition[b], direction);
+                angular = ysMath::MatMult(body->GetInverseInertiaTensorWorld(), angular);
+                angular = ysMath::Cross(angular, collision->m_relativePosition[b]);
+
+                k += body->GetInverseMass() + ysMath::GetScalar(ysMath::Dot(angular, direction));
+            }
+
+            effectiveMass[axis] = (k > 0.0f) ? 1.0f / k : 0.0f;
+        }
+
+        collision->m_effectiveMass = ysMath::LoadVector(effectiveMass[0], effectiveMass[1], effectiveMass[2]);
+
+        // Penetration is removed with a velocity bias instead of a separate
+        // position pass
+        const float closingVelocity = ysMath::GetX(collision->m_contactVelocity);
+        const float restitution = (closingVelocity < -VelocityLimit) ? collision->m_restitution : 0.0f;
+        const float bias = (BaumgarteFactor / timestep) * std::max(collision->m_penetration - PenetrationSlop, 0.0f);
+        collision->m_velocityTarget = -restitution * closingVelocity + bias;
+
+        // Warm start
+        Collision *previous = FindPreviousCollision(collision);
+        collision->m_accumulatedImpulse = (previous != nullptr)
+            ? previous->m_accumulatedImpulse
+            : ysMath::Constants::Zero;
+
+        ApplyImpulse(collision, ysMath::MatMult(collision->m_contactSpace, collision->m_accumulatedImpulse));
+    }
+
+    for (int iteration = 0; iteration < m_solverIterations; ++iteration) {
+        for (int i = 0; i < numContacts; ++i) {
+            Collision *collision = collisions[i];
+
+            if (collision->m_sensor) continue;
+            if (collision->IsGhost()) continue;
+            if (!collision->IsResolvable()) continue;
+
+            float accumulated[3] = {
+                ysMath::GetX(collision->m_accumulatedImpulse),
+                ysMath::GetY(collision->m_accumulatedImpulse),
+                ysMath::GetZ(collision->m_accumulatedImpulse) };
+            const float effectiveMass[3] = {
+                ysMath::GetX(collision->m_effectiveMass),
+                ysMath::GetY(collision->m_effectiveMass),
+                ysMath::GetZ(collision->m_effectiveMass) };
+
+            // Normal impulse, clamped so that contacts can only push
+            ysVector normal = ysMath::MatMult(collision->m_contactSpace, axes[0]);
+            float velocity = ysMath::GetScalar(ysMath::Dot(CalculateRelativeVelocity(collision), normal));
+            float impulse = effectiveMass[0] * (collision->m_velocityTarget - velocity);
+            float total = std::max(accumulated[0] + impulse, 0.0f);
+            impulse = total - accumulated[0];
+            accumulated[0] = total;
+
+            ApplyImpulse(collision, ysMath::Mul(normal, ysMath::LoadScalar(impulse)));
+
+            // Friction impulses, bounded by the current normal impulse
+            const float frictionLimit = collision->m_staticFriction * accumulated[0];
+            for (int axis = 1; axis < 3; ++axis) {
+                ysVector tangent = ysMath::MatMult(collision->m_contactSpace, axes[axis]);
+                velocity = ysMath::GetScalar(ysMath::Dot(CalculateRelativeVelocity(collision), tangent));
+                impulse = -effectiveMass[axis] * velocity;
+                total = std::min(std::max(accumulated[axis] + impulse, -frictionLimit), frictionLimit);
+                impulse = total - accumulated[axis];
+                accumulated[axis] = total;
+
+                ApplyImpulse(collision, ysMath::Mul(tangent, ysMath::LoadScalar(impulse)));
+            }
+
+            collision->m_accumulatedImpulse = ysMath::LoadVector(accumulated[0], accumulated[1], accumulated[2]);
+        }
+    }
+}
+
+void dphysics::RigidBodySystem::ApplyImpulse(Collision *collision, const ysVector &impulse) {
+    RigidBody *body1 = collision->m_bodies[0];
+    RigidBody *body2 = collision->m_bodies[1];
+
+    if (!body1->IsImmovable()) {
+        body1->AddVelocity(ysMath::Mul(impulse, ysMath::LoadScalar(body1->GetInverseMass())));
+        body1->AddAngularVelocity(ysMath::MatMult(body1->GetInverseInertiaTensorWorld(),
+            ysMath::Cross(collision->m_relativePosition[0], impulse)));
+    }
+
+    if (body2 != nullptr && !body2->IsImmovable()) {
+        body2->AddVelocity(ysMath::Mul(impulse, ysMath::LoadScalar(-body2->GetInverseMass())));
+        body2->AddAngularVelocity(ysMath::MatMult(body2->GetInverseInertiaTensorWorld(),
+            ysMath::Cross(impulse, collision->m_relativePosition[1])));
+    }
+}
+
+ysVector dphysics::RigidBodySystem::CalculateRelativeVelocity(Collision *collision) {
+    ysVector velocity = collision->m_bodies[0]->GetVelocityAtWorldPoint(collision->m_position);
+
+    if (collision->m_bodies[1] != nullptr) {
+        velocity = ysMath::Sub(velocity, collision->m_bodies[1]->GetVelocityAtWorldPoint(collision->m_position));
+    }
+
+    return velocity;
+}
+
 void dphysics::RigidBodySystem::GenerateForces(float timeStep) {
+    m_bodyState.ClearAccumulators();
+
     int nObjects = m_rigidBodyRegistry.GetNumObjects();
     for (int i = 0; i < nObjects; i++) {
-        m_rigidBodyRegistry.Get(i)->GenerateForces(timeStep);
+        RigidBody *body = m_rigidBodyRegistry.Get(i);
+
+        int generatorCount = body->m_forceGenerators.GetNumObjects();
+        for (int j = 0; j < generatorCount; ++j) {
+            body->m_forceGenerators.Get(j)->GenerateForces(timeStep);
+        }
     }
 }
 
 void dphysics::RigidBodySystem::Integrate(float timeStep) {
-    int nObjects = m_rigidBodyRegistry.GetNumObjects();
+    YS_PROFILE_ZONE("RigidBodySystem::Integrate");
+
+    const int nObjects = m_bodyState.GetCount();
+
+    // Positions and orientations are owned by the body transforms, so they
+    // are advanced in a separate pass before the velocity kernel runs
     for (int i = 0; i < nObjects; i++) {
-        m_rigidBodyRegistry.Get(i)->Integrate(timeStep);
-        m_rigidBodyRegistry.Get(i)->UpdateDerivedData();
+        RigidBody *body = m_bodyState.GetBody(i);
+
+        const bool integrate =
+            body->m_hint != RigidBody::RigidBodyHint::Static && body->m_awake;
+        m_bodyState.m_integrate[i] = integrate ? 1 : 0;
+
+        if (integrate) {
+            body->m_derivedValid = false;
+            body->IntegrateTransform(timeStep);
+        }
+    }
+
+    m_bodyState.Integrate(timeStep);
+
+    for (int i = 0; i < nObjects; i++) {
+        RigidBody *body = m_bodyState.GetBody(i);
+        body->UpdateMoved();
+
+        if (m_bodyState.m_integrate[i] == 0) continue;
+
+        const int childCount = body->m_children.GetNumObjects();
+        for (int j = 0; j < childCount; j++) {
+            body->m_children[j]->Integrate(timeStep);
+        }
     }
+
+    UpdateDerivedData();
 }
 
 void dphysics::RigidBodySystem::UpdateDerivedData() {
@@ -813,29 +1538,258 @@ void dphysics::RigidBodySystem::UpdateDerivedData() {
     }
 }
 
-void dphysics::RigidBodySystem::CheckAwake() {
+void dphysics::RigidBodySystem::CheckAwake(float timeStep) {
+    YS_PROFILE_ZONE("RigidBodySystem::CheckAwake");
+
     const int nObjects = m_rigidBodyRegistry.GetNumObjects();
     for (int i = 0; i < nObjects; i++) {
-        m_rigidBodyRegistry.Get(i)->CheckAwake();
+        m_rigidBodyRegistry.Get(i)->UpdateRestTime(
+            timeStep, m_sleepLinearThreshold, m_sleepAngularThreshold);
+    }
+
+    const int islandCount = (int)m_islands.size();
+    for (int i = 0; i < islandCount; ++i) {
+        Island &island = m_islands[i];
+
+        bool sleep = m_sleepingEnabled;
+        for (int j = 0; j < island.BodyCount && sleep; ++j) {
+            if (GetIslandBody(island, j)->GetRestTime() < m_sleepTime) sleep = false;
+        }
+
+        for (int j = 0; j < island.BodyCount; ++j) {
+            RigidBody *body = GetIslandBody(island, j);
+
+            // Setting the velocity wakes the body, so it is only cleared
+            // while the body is still awake
+            if (sleep && body->IsAwake()) {
+                body->SetVelocity(ysMath::Constants::Zero);
+                body->SetAngularVelocity(ysMath::Constants::Zero);
+            }
+
+            body->SetAwake(!sleep);
+        }
+
+        island.Awake = !sleep;
+    }
+
+    RecordIslandStatistics();
+}
+
+void dphysics::RigidBodySystem::MergeIslandBodies(RigidBody *body1, RigidBody *body2) {
+    if (body1 == nullptr || body2 == nullptr) return;
+    if (!body1->IsRegistered() || !body2->IsRegistered()) return;
+    if (body1->IsImmovable() || body2->IsImmovable()) return;
+
+    m_islandBuilder.Merge(body1->GetIndex(), body2->GetIndex());
+}
+
+int dphysics::RigidBodySystem::GetCollisionIsland(const Collision *collision) const {
+    for (int i = 0; i < 2; ++i) {
+        const RigidBody *body = collision->m_bodies[i];
+        if (body == nullptr || body->m_system != this || !body->IsRegistered()) continue;
+
+        const int island = m_bodyIslands[body->GetIndex()];
+        if (island != -1) return island;
+    }
+
+    return -1;
+}
+
+void dphysics::RigidBodySystem::BuildIslands() {
+    YS_PROFILE_ZONE("RigidBodySystem::BuildIslands");
+
+    const int bodyCount = m_rigidBodyRegistry.GetNumObjects();
+    const int collisionCount = m_collisionAccumulator.GetNumObjects();
+    const int linkCount = m_rigidBodyLinks.GetNumObjects();
+
+    m_islandBuilder.Initialize(bodyCount);
+
+    for (int i = 0; i < bodyCount; ++i) {
+        RigidBody *body = m_rigidBodyRegistry.Get(i);
+        MergeIslandBodies(body, body->GetRoot());
+    }
+
+    for (int i = 0; i < collisionCount; ++i) {
+        Collision *collision = GetCollision(m_collisionAccumulator[i]);
+        if (collision->m_sensor) continue;
+        if (collision->IsGhost()) continue;
+        if (!collision->IsResolvable()) continue;
+
+        MergeIslandBodies(collision->m_body1, collision->m_body2);
+    }
+
+    for (int i = 0; i < linkCount; ++i) {
+        RigidBodyLink *link = m_rigidBodyLinks.Get(i);
+        MergeIslandBodies(link->GetBody1(), link->GetBody2());
+    }
+
+    // Islands are numbered in order of their lowest body index. The slot of a
+    // set's root body is used to look up the island of the whole set.
+    m_islands.clear();
+    m_bodyIslands.assign(bodyCount, -1);
+
+    for (int i = 0; i < bodyCount; ++i) {
+        RigidBody *body = m_rigidBodyRegistry.Get(i);
+        if (body->IsImmovable()) continue;
+
+        const int root = m_islandBuilder.FindRoot(i);
+        if (m_bodyIslands[root] == -1) {
+            m_bodyIslands[root] = (int)m_islands.size();
+            m_islands.push_back({ 0, 0, 0, 0, false });
+        }
+
+        Island &island = m_islands[m_bodyIslands[root]];
+        island.BodyCount++;
+        island.Awake = island.Awake || body->IsAwake();
+
+        m_bodyIslands[i] = m_bodyIslands[root];
+    }
+
+    for (int i = 0; i < collisionCount; ++i) {
+        Collision *collision = GetCollision(m_collisionAccumulator[i]);
+        if (collision->m_sensor) continue;
+        if (collision->IsGhost()) continue;
+        if (!collision->IsResolvable()) continue;
+
+        const int island = GetCollisionIsland(collision);
+        if (island == -1) continue;
+
+        m_islands[island].CollisionCount++;
+    }
+
+    int bodyOffset = 0, collisionOffset = 0;
+    for (Island &island : m_islands) {
+        island.BodyStart = bodyOffset;
+        island.CollisionStart = collisionOffset;
+        bodyOffset += island.BodyCount;
+        collisionOffset += island.CollisionCount;
+
+        island.BodyCount = 0;
+        island.CollisionCount = 0;
+    }
+
+    m_islandBodies.resize(bodyOffset);
+    m_islandCollisions.resize(collisionOffset);
+
+    for (int i = 0; i < bodyCount; ++i) {
+        if (m_bodyIslands[i] == -1) continue;
+
+        Island &island = m_islands[m_bodyIslands[i]];
+        m_islandBodies[island.BodyStart + island.BodyCount++] = m_rigidBodyRegistry.Get(i);
+    }
+
+    for (int i = 0; i < collisionCount; ++i) {
+        Collision *collision = GetCollision(m_collisionAccumulator[i]);
+        if (collision->m_sensor) continue;
+        if (collision->IsGhost()) continue;
+        if (!collision->IsResolvable()) continue;
+
+        const int islandIndex = GetCollisionIsland(collision);
+        if (islandIndex == -1) continue;
+
+        Island &island = m_islands[islandIndex];
+        m_islandCollisions[island.CollisionStart + island.CollisionCount++] = collision;
     }
 }
 
+void dphysics::RigidBodySystem::SolveIslands(float timeStep) {
+    YS_PROFILE_ZONE("RigidBodySystem::SolveIslands");
+
+    m_islandJobs.clear();
+
+    const int islandCount = (int)m_islands.size();
+    for (int i = 0; i < islandCount; ++i) {
+        const Island &island = m_islands[i];
+        if (!island.Awake || island.CollisionCount == 0) continue;
+
+        m_islandJobs.push_back({ this, i, timeStep });
+    }
+
+    // Islands do not share any movable bodies so the order in which they are
+    // solved does not affect the result. Start with the largest ones to keep
+    // the workers balanced.
+    std::sort(m_islandJobs.begin(), m_islandJobs.end(),
+        [this](const IslandSolveCallData &a, const IslandSolveCallData &b) {
+            const int countA = m_islands[a.Island].CollisionCount;
+            const int countB = m_islands[b.Island].CollisionCount;
+            return (countA != countB) ? countA > countB : a.Island < b.Island;
+        });
+
+    m_workerPool.Run(
+        &RigidBodySystem::SolveIslandThread,
+        m_islandJobs.data(),
+        sizeof(IslandSolveCallData),
+        (int)m_islandJobs.size());
+}
+
+void dphysics::RigidBodySystem::SolveIsland(int islandIndex, float timeStep) {
+    const Island &island = m_islands[islandIndex];
+    Collision **collisions = m_islandCollisions.data() + island.CollisionStart;
+
+    if (m_solverMode == SolverMode::SequentialImpulse) {
+        SolveSequentialImpulse(collisions, island.CollisionCount, timeStep);
+    }
+    else {
+        ResolveCollisions(collisions, island.CollisionCount, timeStep);
+        AdjustVelocities(collisions, island.CollisionCount, timeStep);
+    }
+}
+
+void dphysics::RigidBodySystem::SolveIslandThread(void *data) {
+    YS_PROFILE_ZONE("RigidBodySystem::SolveIslandThread");
+
+    IslandSolveCallData *callData = reinterpret_cast<IslandSolveCallData *>(data);
+    callData->System->SolveIsland(callData->Island, callData->TimeStep);
+}
+
+void dphysics::RigidBodySystem::RecordIslandStatistics() {
+    if (m_breakdownTimer == nullptr) return;
+
+    int awakeIslands = 0;
+    int largestBodies = 0;
+    int largestContacts = 0;
+
+    for (const Island &island : m_islands) {
+        if (island.Awake) ++awakeIslands;
+        largestBodies = std::max(largestBodies, island.BodyCount);
+        largestContacts = std::max(largestContacts, island.CollisionCount);
+    }
+
+    m_islandCountChannel->RecordSample((double)m_islands.size());
+    m_awakeIslandChannel->RecordSample((double)awakeIslands);
+    m_largestIslandBodiesChannel->RecordSample((double)largestBodies);
+    m_largestIslandContactsChannel->RecordSample((double)largestContacts);
+}
+
 void dphysics::RigidBodySystem::Update(float timestep) {
+    YS_PROFILE_ZONE("RigidBodySystem::Update");
+
     //GenerateForces(timestep);
 
     Integrate(timestep);
 
     GenerateCollisions();
     InitializeCollisions();
-    ResolveCollisions(timestep);
-    AdjustVelocities(timestep);
-    CheckAwake();    
+    BuildIslands();
+    SolveIslands(timestep);
+    CheckAwake(timestep);
 
-    if (m_replayEnabled) {
+    if (m_replayRecorder.IsOpen()) {
         WriteFrameToReplayFile();
     }
 }
 
+int dphysics::RigidBodySystem::Advance(float frameDuration) {
+    const int steps = m_timestepAccumulator.Advance(frameDuration);
+    const float step = (float)m_timestepAccumulator.GetStep();
+
+    for (int i = 0; i < steps; ++i) {
+        Update(step);
+    }
+
+    return steps;
+}
+
 bool dphysics::RigidBodySystem::CheckState() {
     const int nBodies = m_rigidBodyRegistry.GetNumObjects();
     for (int i = 0; i < nBodies; ++i) {
@@ -852,7 +1806,7 @@ void dphysics::RigidBodySystem::DrawCollisionDebug(int layer) {
     int color[3] = { 255, 0, 0 };
 
     for (int i = 0; i < nCollisions; i++) {
-        Collision *collision = m_collisionAccumulator[i];
+        Collision *collision = GetCollision(m_collisionAccumulator[i]);
 
         if (collision->m_penetration < -10.0f) {
             int a = 0;
@@ -0,0 +1,103 @@
+#include "../include/worker_pool.h"
+
+dphysics::WorkerPool::WorkerPool() : ysObject("WorkerPool") {
+    m_function = nullptr;
+    m_data = nullptr;
+    m_stride = 0;
+    m_jobCount = 0;
+    m_nextJob = 0;
+    m_busyWorkers = 0;
+    m_batch = 0;
+    m_shutdown = false;
+}
+
+dphysics::WorkerPool::~WorkerPool() {
+    Destroy();
+}
+
+void dphysics::WorkerPool::Initialize(int workerCount) {
+    Destroy();
+
+    m_shutdown = false;
+    for (int i = 0; i < workerCount; ++i) {
+        m_workers.push_back(std::thread(&WorkerPool::WorkerLoop, this, m_batch));
+    }
+}
+
+void dphysics::WorkerPool::Destroy() {
+    {
+        std::lock_guard<std::mutex> lk(m_lock);
+        m_shutdown = true;
+    }
+
+    m_wake.notify_all();
+
+    for (std::thread &worker : m_workers) {
+        worker.join();
+    }
+
+    m_workers.clear();
+}
+
+void dphysics::WorkerPool::Run(JobFunction function, void *data, int stride, int count) {
+    if (count <= 0) return;
+
+    if (m_workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            function(reinterpret_cast<char *>(data) + (size_t)i * stride);
+        }
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(m_lock);
+        m_function = function;
+        m_data = reinterpret_cast<char *>(data);
+        m_stride = stride;
+        m_jobCount = count;
+        m_nextJob = 0;
+        m_busyWorkers = (int)m_workers.size();
+        ++m_batch;
+    }
+
+    m_wake.notify_all();
+
+    ExecuteJobs();
+
+    std::unique_lock<std::mutex> lk(m_lock);
+    m_done.wait(lk, [this] { return m_busyWorkers == 0; });
+}
+
+int dphysics::WorkerPool::GetHardwareThreadCount() {
+    const int threadCount = (int)std::thread::hardware_concurrency();
+    return (threadCount > 0) ? threadCount : 1;
+}
+
+void dphysics::WorkerPool::WorkerLoop(unsigned int batch) {
+    ysProfiler::Get()->SetThreadName("Worker");
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lk(m_lock);
+            m_wake.wait(lk, [this, batch] { return m_shutdown || m_batch != batch; });
+
+            if (m_shutdown) return;
+            batch = m_batch;
+        }
+
+        ExecuteJobs();
+
+        {
+            std::lock_guard<std::mutex> lk(m_lock);
+            if (--m_busyWorkers == 0) m_done.notify_one();
+        }
+    }
+}
+
+void dphysics::WorkerPool::ExecuteJobs() {
+    int job;
+    while ((job = m_nextJob.fetch_add(1)) < m_jobCount) {
+        m_function(m_data + (size_t)job * m_stride);
+    }
+}
@@ -435,6 +435,7 @@ TEST(CollisionTests, RayCircleCollision) {
 
     b1.Position = ysMath::LoadVector(0.0f, 0.0f, 0.0f, 0.0f);
     b1.Direction = ysMath::LoadVector(1.0f, 0.0f, 0.0f, 0.0f);
+    b1.MaxDistance = 0.0f;
 
     b2.Position = ysMath::LoadVector(10.0f, 0.0f, 0.0f, 0.0f);
     b2.Radius = 1.0f;
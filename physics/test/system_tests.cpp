@@ -3,6 +3,8 @@
 #include "../include/delta_physics.h"
 #include "utilities.h"
 
+#include <chrono>
+
 TEST(DeltaPhysicsSystemTests, SanityCheck) {
     EXPECT_EQ(1, 1);
     EXPECT_TRUE(true);
@@ -838,3 +840,1357 @@ TEST(DeltaPhysicsSystemTests, ForceWithFriction) {
 
     rb.CloseReplayFile();
 }
+
+TEST(DeltaPhysicsSystemTests, BroadphasePairs) {
+    constexpr int BodyCount = 60;
+    constexpr float Radius = 0.5f;
+
+    dphysics::RigidBodySystem rb;
+    dphysics::RigidBody bodies[BodyCount];
+
+    // Scatter the bodies so that the grid sees pairs across cell borders
+    unsigned int seed = 12345;
+    for (int i = 0; i < BodyCount; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        const float x = ((seed >> 8) % 800) * 0.01f;
+        seed = seed * 1103515245u + 12345u;
+        const float y = ((seed >> 8) % 800) * 0.01f;
+
+        dphysics::RigidBody &body = bodies[i];
+        body.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+        body.SetInverseMass(1.0f);
+        body.Transform.SetPosition(ysMath::LoadVector(x, y, 0.0f));
+        body.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        dphysics::CollisionObject *col;
+        body.CollisionGeometry.NewCircleObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsCircle()->Position = ysMath::Constants::Zero;
+        col->GetAsCircle()->Radius = Radius;
+
+        rb.RegisterRigidBody(&body);
+    }
+
+    ysVector positions[BodyCount];
+    for (int i = 0; i < BodyCount; ++i) {
+        positions[i] = bodies[i].Transform.GetWorldPosition();
+    }
+
+    // Contacts are generated before the solver moves anything
+    rb.Update(1 / 60.0f);
+
+    auto touching = [](dphysics::RigidBody &body, dphysics::RigidBody *other) {
+        for (int i = 0; i < body.GetCollisionCount(); ++i) {
+            dphysics::Collision *collision = body.GetCollision(i);
+            if (collision->m_body1 == other || collision->m_body2 == other) return true;
+        }
+
+        return false;
+    };
+
+    int overlapping = 0;
+    for (int i = 0; i < BodyCount; ++i) {
+        for (int j = i + 1; j < BodyCount; ++j) {
+            const float distance =
+                ysMath::GetScalar(ysMath::Magnitude(ysMath::Sub(positions[i], positions[j])));
+
+            // Leave out pairs that are too close to call
+            if (std::abs(distance - 2 * Radius) < 0.01f) continue;
+
+            const bool expected = distance < 2 * Radius;
+            if (expected) ++overlapping;
+
+            EXPECT_EQ(touching(bodies[i], &bodies[j]), expected) << "Pair: " << i << ", " << j;
+            EXPECT_EQ(touching(bodies[j], &bodies[i]), expected) << "Pair: " << j << ", " << i;
+        }
+    }
+
+    EXPECT_GT(overlapping, 0);
+}
+
+// Exposes the broadphase and the one GenerateCollisions() used before pairs
+// were gathered body by body, which scanned every cell and de-duplicated
+// pairs through an N x N visited matrix
+class BroadphaseBenchmarkSystem : public dphysics::RigidBodySystem {
+public:
+    void GenerateCollisions() {
+        dphysics::RigidBodySystem::GenerateCollisions();
+    }
+
+    void GenerateCollisionsLegacy() {
+        ClearCollisions();
+
+        const int bodyCount = m_rigidBodyRegistry.GetNumObjects();
+        for (int i = 0; i < bodyCount; i++) {
+            m_rigidBodyRegistry.Get(i)->ClearCollisions();
+            m_rigidBodyRegistry.Get(i)->CollisionGeometry.UpdatePrimitives();
+        }
+
+        m_gridPartitionSystem.Reset();
+        for (int i = 0; i < bodyCount; i++) {
+            m_gridPartitionSystem.ProcessRigidBody(m_rigidBodyRegistry.Get(i));
+        }
+        m_gridPartitionSystem.Finalize();
+
+        bool **visited = new bool *[bodyCount];
+        for (int i = 0; i < bodyCount; ++i) {
+            visited[i] = new bool[bodyCount];
+            memset((void *)visited[i], 0, sizeof(bool) * bodyCount);
+        }
+
+        const int cellCount = m_gridPartitionSystem.GetCellCount();
+        for (int c = 0; c < cellCount; ++c) {
+            dphysics::GridCell *gridCell = m_gridPartitionSystem.GetCell(c);
+            if (!ShouldProcessGridCell(gridCell)) continue;
+
+            dphysics::RigidBody **objects = m_gridPartitionSystem.GetCellObjects(gridCell);
+            const int cellObjects = gridCell->GetObjectCount();
+            for (int i = 0; i < cellObjects; i++) {
+                dphysics::RigidBody *body1 = objects[i];
+
+                for (int j = i + 1; j < cellObjects; j++) {
+                    dphysics::RigidBody *body2 = objects[j];
+
+                    if (visited[body1->GetIndex()][body2->GetIndex()]) continue;
+                    if (body1->GetRoot() == body2->GetRoot()) continue;
+
+                    visited[body1->GetIndex()][body2->GetIndex()] = true;
+
+                    dphysics::RigidBodySystem::GenerateCollisions(body1, body2);
+                }
+            }
+        }
+
+        for (int i = 0; i < bodyCount; ++i) {
+            delete[] visited[i];
+        }
+        delete[] visited;
+    }
+};
+
+TEST(DeltaPhysicsSystemTests, DISABLED_BroadphaseScaling) {
+    constexpr int Steps = 4;
+    constexpr float Radius = 0.55f;
+    const int bodyCounts[] = { 1000, 5000, 20000 };
+
+    for (const int bodyCount : bodyCounts) {
+        BroadphaseBenchmarkSystem rb;
+        dphysics::RigidBody *bodies = new dphysics::RigidBody[bodyCount];
+
+        // Lattice neighbors overlap, diagonal ones do not
+        const int columns = (int)std::sqrt((float)bodyCount);
+        for (int i = 0; i < bodyCount; ++i) {
+            dphysics::RigidBody &body = bodies[i];
+            body.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+            body.SetInverseMass(1.0f);
+            body.Transform.SetPosition(
+                ysMath::LoadVector((i % columns) * 1.0f, (i / columns) * 1.0f, 0.0f));
+            body.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+            dphysics::CollisionObject *col;
+            body.CollisionGeometry.NewCircleObject(&col);
+            col->SetMode(dphysics::CollisionObject::Mode::Fine);
+            col->GetAsCircle()->Position = ysMath::Constants::Zero;
+            col->GetAsCircle()->Radius = Radius;
+
+            rb.RegisterRigidBody(&body);
+        }
+
+        std::vector<int> expected(bodyCount, 0);
+        for (int i = 0; i < bodyCount; ++i) {
+            const ysVector p_i = bodies[i].Transform.GetWorldPosition();
+            for (int j = i + 1; j < bodyCount; ++j) {
+                const ysVector d = ysMath::Sub(bodies[j].Transform.GetWorldPosition(), p_i);
+                if (ysMath::GetScalar(ysMath::MagnitudeSquared3(d)) < 4 * Radius * Radius) {
+                    ++expected[i];
+                    ++expected[j];
+                }
+            }
+        }
+
+        auto checkContacts = [&](const char *path) {
+            for (int i = 0; i < bodyCount; ++i) {
+                ASSERT_EQ(bodies[i].GetCollisionCount(), expected[i]) << path << ", body: " << i;
+            }
+        };
+
+        auto timeSteps = [&](auto generate) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < Steps; ++i) {
+                generate();
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            return (int)(std::chrono::duration<double, std::micro>(end - start).count() / Steps);
+        };
+
+        const int current = timeSteps([&] { rb.GenerateCollisions(); });
+        checkContacts("Current");
+
+        const int legacy = timeSteps([&] { rb.GenerateCollisionsLegacy(); });
+        checkContacts("Legacy");
+
+        const std::string prefix = "Bodies" + std::to_string(bodyCount);
+        RecordProperty(prefix + "CurrentMicroseconds", current);
+        RecordProperty(prefix + "LegacyMicroseconds", legacy);
+
+        for (int i = 0; i < bodyCount; ++i) {
+            rb.RemoveRigidBody(&bodies[i]);
+        }
+
+        delete[] bodies;
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, CollisionPairCacheHistory) {
+    dphysics::CollisionPairCache cache;
+    dphysics::RigidBody A, B, C;
+    dphysics::Collision contacts[3];
+
+    cache.BeginFrame();
+    cache.AddContact(cache.Touch(&A, &B), &contacts[0]);
+    cache.AddContact(cache.Touch(&A, &C), &contacts[1]);
+    cache.AddContact(cache.Touch(&B, &A), &contacts[2]);
+
+    cache.BeginFrame();
+    cache.Touch(&B, &A);
+
+    int count;
+    dphysics::Collision **previous = cache.GetPreviousContacts(&A, &B, &count);
+    ASSERT_EQ(count, 2);
+    EXPECT_EQ(previous[0], &contacts[0]);
+    EXPECT_EQ(previous[1], &contacts[2]);
+
+    // Pairs that are not touching this frame have nothing to warm start from
+    cache.GetPreviousContacts(&A, &C, &count);
+    EXPECT_EQ(count, 0);
+
+    cache.RemoveBody(&C);
+    cache.BeginFrame();
+    EXPECT_EQ(cache.Find(&A, &C), nullptr);
+    EXPECT_NE(cache.Find(&A, &B), nullptr);
+    EXPECT_EQ(cache.GetPairCount(), 1);
+}
+
+TEST(DeltaPhysicsSystemTests, GridCellEviction) {
+    dphysics::GridPartitionSystem grid;
+    grid.SetEvictionFrameLimit(2);
+
+    dphysics::RigidBody A;
+    A.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    A.Transform.SetPosition(ysMath::LoadVector(0.0f, 0.0f, 0.0f));
+
+    grid.Reset();
+    grid.ProcessRigidBody(&A);
+    grid.Finalize();
+
+    const int occupiedCells = grid.GetCellCount();
+    EXPECT_EQ(occupiedCells, A.GetGridCellCount());
+
+    dphysics::GridCell *cell = grid.GetCell(A.GetGridCells()[0].index);
+    EXPECT_EQ(cell->GetObjectCount(), 1);
+    EXPECT_EQ(grid.GetCellObjects(cell)[0], &A);
+
+    A.Transform.SetPosition(ysMath::LoadVector(1000.0f, 1000.0f, 0.0f));
+    for (int i = 0; i < 4; ++i) {
+        grid.Reset();
+        grid.ProcessRigidBody(&A);
+        grid.Finalize();
+    }
+
+    EXPECT_EQ(grid.GetCellCount(), A.GetGridCellCount());
+
+    cell = grid.GetCell(A.GetGridCells()[0].index);
+    EXPECT_EQ(grid.GetCellObjects(cell)[0], &A);
+}
+
+TEST(DeltaPhysicsSystemTests, ParallelCollisionDeterminism) {
+    constexpr int BodyCount = 400;
+    constexpr int Columns = 20;
+
+    dphysics::RigidBodySystem systems[2];
+    dphysics::RigidBody *bodies[2];
+
+    for (int s = 0; s < 2; ++s) {
+        systems[s].SetThreadCount((s == 0) ? 1 : 4);
+        bodies[s] = new dphysics::RigidBody[BodyCount];
+
+        for (int i = 0; i < BodyCount; ++i) {
+            dphysics::RigidBody &body = bodies[s][i];
+            body.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+            body.SetInverseMass(1.0f);
+            body.Transform.SetPosition(
+                ysMath::LoadVector((i % Columns) * 0.8f, (i / Columns) * 0.8f, 0.0f));
+            body.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+            dphysics::CollisionObject *col;
+            body.CollisionGeometry.NewCircleObject(&col);
+            col->SetMode(dphysics::CollisionObject::Mode::Fine);
+            col->GetAsCircle()->Position = ysMath::Constants::Zero;
+            col->GetAsCircle()->Radius = 0.45f;
+
+            systems[s].RegisterRigidBody(&body);
+        }
+
+        for (int i = 0; i < 10; ++i) {
+            systems[s].Update(1 / 60.0f);
+        }
+    }
+
+    for (int i = 0; i < BodyCount; ++i) {
+        const ysVector p0 = bodies[0][i].Transform.GetWorldPosition();
+        const ysVector p1 = bodies[1][i].Transform.GetWorldPosition();
+
+        EXPECT_EQ(ysMath::GetX(p0), ysMath::GetX(p1));
+        EXPECT_EQ(ysMath::GetY(p0), ysMath::GetY(p1));
+    }
+
+    for (int s = 0; s < 2; ++s) {
+        for (int i = 0; i < BodyCount; ++i) {
+            systems[s].RemoveRigidBody(&bodies[s][i]);
+        }
+
+        delete[] bodies[s];
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, IslandSleeping) {
+    dphysics::RigidBodySystem rb;
+    EXPECT_FALSE(rb.IsSleepingEnabled());
+    rb.SetSleepingEnabled(true);
+
+    dphysics::CollisionObject *col;
+
+    dphysics::RigidBody G;
+    G.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+    G.SetInverseMass(0.0f);
+    G.Transform.SetPosition(ysMath::LoadVector(0.0f, -0.5f, 0.0f));
+    G.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    G.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 20.0f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    rb.RegisterRigidBody(&G);
+
+    ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+
+    dphysics::RigidBody boxes[2];
+    for (int i = 0; i < 2; ++i) {
+        dphysics::RigidBody &box = boxes[i];
+        box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+        box.SetInverseMass(1.0f);
+        box.SetInverseInertiaTensor(box.GetRectangleTensor(1.0f, 1.0f));
+        box.SetAcceleration(gravity);
+        box.Transform.SetPosition(ysMath::LoadVector(i * 10.0f - 5.0f, 0.5f, 0.0f));
+        box.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        box.CollisionGeometry.NewBoxObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsBox()->Position = ysMath::Constants::Zero;
+        col->GetAsBox()->HalfHeight = 0.5f;
+        col->GetAsBox()->HalfWidth = 0.5f;
+        col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+        rb.RegisterRigidBody(&box);
+    }
+
+    for (int i = 0; i < 120; ++i) {
+        rb.Update(1 / 60.0f);
+        EXPECT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+    }
+
+    // The ground is immovable so it does not join the two boxes together
+    ASSERT_EQ(rb.GetIslandCount(), 2);
+    EXPECT_EQ(rb.GetIsland(0).BodyCount, 1);
+    EXPECT_EQ(rb.GetIsland(1).BodyCount, 1);
+
+    EXPECT_FALSE(boxes[0].IsAwake());
+    EXPECT_FALSE(boxes[1].IsAwake());
+    EXPECT_NEAR(ysMath::GetY(boxes[0].Transform.GetWorldPosition()), 0.5f, 0.01f);
+
+    boxes[0].SetVelocity(ysMath::LoadVector(1.0f, 0.0f, 0.0f));
+    rb.Update(1 / 60.0f);
+
+    EXPECT_TRUE(boxes[0].IsAwake());
+    EXPECT_FALSE(boxes[1].IsAwake());
+}
+
+TEST(DeltaPhysicsSystemTests, SleepingBodyWakesOnImpulse) {
+    dphysics::RigidBodySystem rb;
+    rb.SetSleepingEnabled(true);
+
+    dphysics::CollisionObject *col;
+
+    dphysics::RigidBody G;
+    G.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+    G.SetInverseMass(0.0f);
+    G.Transform.SetPosition(ysMath::LoadVector(0.0f, -0.5f, 0.0f));
+    G.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    G.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 20.0f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    rb.RegisterRigidBody(&G);
+
+    ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+
+    dphysics::RigidBody A;
+    A.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    A.SetInverseMass(1.0f);
+    A.SetInverseInertiaTensor(A.GetRectangleTensor(1.0f, 1.0f));
+    A.SetAcceleration(gravity);
+    A.Transform.SetPosition(ysMath::LoadVector(0.0f, 0.5f, 0.0f));
+    A.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    A.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 0.5f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    rb.RegisterRigidBody(&A);
+
+    for (int i = 0; i < 120; ++i) {
+        rb.Update(1 / 60.0f);
+    }
+
+    ASSERT_FALSE(A.IsAwake());
+
+    // Resting on the ground alone must not wake the body up again
+    rb.Update(1 / 60.0f);
+    EXPECT_FALSE(A.IsAwake());
+
+    A.AddImpulseWorldSpace(
+        ysMath::LoadVector(0.0f, 5.0f, 0.0f), A.Transform.GetWorldPosition());
+    EXPECT_TRUE(A.IsAwake());
+
+    for (int i = 0; i < 10; ++i) {
+        rb.Update(1 / 60.0f);
+        EXPECT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+    }
+
+    EXPECT_TRUE(A.IsAwake());
+    EXPECT_GT(ysMath::GetY(A.Transform.GetWorldPosition()), 1.0f);
+}
+
+TEST(DeltaPhysicsSystemTests, KinematicBodyWakesSleepingBodies) {
+    dphysics::RigidBodySystem rb;
+    rb.SetSleepingEnabled(true);
+
+    dphysics::CollisionObject *col;
+
+    dphysics::RigidBody G;
+    G.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+    G.SetInverseMass(0.0f);
+    G.Transform.SetPosition(ysMath::LoadVector(0.0f, -0.5f, 0.0f));
+    G.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    G.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 20.0f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    rb.RegisterRigidBody(&G);
+
+    ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+
+    // A is pushed by the pusher, B hangs off the anchor
+    dphysics::RigidBody boxes[2];
+    for (int i = 0; i < 2; ++i) {
+        dphysics::RigidBody &box = boxes[i];
+        box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+        box.SetInverseMass(1.0f);
+        box.SetInverseInertiaTensor(box.GetRectangleTensor(1.0f, 1.0f));
+        box.SetAcceleration(gravity);
+        box.Transform.SetPosition(ysMath::LoadVector(i * 10.0f, 0.5f, 0.0f));
+        box.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        box.CollisionGeometry.NewBoxObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsBox()->Position = ysMath::Constants::Zero;
+        col->GetAsBox()->HalfHeight = 0.5f;
+        col->GetAsBox()->HalfWidth = 0.5f;
+        col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+        rb.RegisterRigidBody(&box);
+    }
+
+    dphysics::RigidBody &A = boxes[0];
+    dphysics::RigidBody &B = boxes[1];
+
+    // Immovable bodies that are only ever moved by the caller
+    dphysics::RigidBody pusher;
+    pusher.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    pusher.SetInverseMass(0.0f);
+    pusher.Transform.SetPosition(ysMath::LoadVector(-3.0f, 0.6f, 0.0f));
+    pusher.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    pusher.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 0.5f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    dphysics::RigidBody anchor;
+    anchor.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    anchor.SetInverseMass(0.0f);
+    anchor.Transform.SetPosition(ysMath::LoadVector(10.0f, 3.0f, 0.0f));
+    anchor.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    rb.RegisterRigidBody(&pusher);
+    rb.RegisterRigidBody(&anchor);
+
+    dphysics::HingeLink *hinge = rb.CreateLink<dphysics::HingeLink>(&B, &anchor);
+    hinge->SetConnectionPoints(ysMath::Constants::Zero, ysMath::LoadVector(0.0f, -2.5f, 0.0f));
+
+    for (int i = 0; i < 120; ++i) {
+        rb.Update(1 / 60.0f);
+    }
+
+    ASSERT_FALSE(A.IsAwake());
+    ASSERT_FALSE(B.IsAwake());
+
+    // Standing still does not wake anything up
+    rb.Update(1 / 60.0f);
+    EXPECT_FALSE(pusher.HasMoved());
+    EXPECT_FALSE(A.IsAwake());
+    EXPECT_FALSE(B.IsAwake());
+
+    pusher.SetVelocity(ysMath::LoadVector(4.0f, 0.0f, 0.0f));
+    for (int i = 0; i < 60; ++i) {
+        rb.Update(1 / 60.0f);
+        EXPECT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+    }
+
+    EXPECT_TRUE(pusher.HasMoved());
+    EXPECT_TRUE(A.IsAwake());
+    EXPECT_GT(ysMath::GetX(A.Transform.GetWorldPosition()), 0.5f);
+    EXPECT_FALSE(B.IsAwake());
+
+    anchor.Transform.SetPosition(ysMath::LoadVector(11.0f, 3.0f, 0.0f));
+    rb.Update(1 / 60.0f);
+
+    EXPECT_TRUE(B.IsAwake());
+}
+
+// Pins a point of a single body to a fixed point in the world
+class WorldAnchorLink : public dphysics::RigidBodyLink {
+public:
+    ysVector Anchor = ysMath::Constants::Zero;
+
+    virtual int GenerateCollisions(dphysics::Collision *collisionArray) {
+        const ysVector position = m_body1->Transform.GetWorldPosition();
+        const ysVector delta = ysMath::Sub(Anchor, position);
+        const float length = ysMath::GetScalar(ysMath::Magnitude(delta));
+        if (length < 1E-6f) return 0;
+
+        dphysics::Collision &collision = collisionArray[0];
+        collision.m_body1 = m_body1;
+        collision.m_body2 = nullptr;
+        collision.m_normal = ysMath::Div(delta, ysMath::LoadScalar(length));
+        collision.m_penetration = length;
+        collision.m_position = position;
+        collision.m_sensor = false;
+        collision.m_collisionObject1 = nullptr;
+        collision.m_collisionObject2 = nullptr;
+        collision.m_restitution = 0.0f;
+        collision.m_staticFriction = 10.0f;
+        collision.m_dynamicFriction = 10.0f;
+
+        return 1;
+    }
+};
+
+static void CheckIslandsWithoutMovableBodies(dphysics::RigidBodySystem::SolverMode solverMode) {
+    dphysics::RigidBodySystem rb;
+    rb.SetSolverMode(solverMode);
+
+    dphysics::CollisionObject *col;
+
+    // Two overlapping immovable bodies, one of which listens for contacts
+    dphysics::RigidBody statics[2];
+    for (int i = 0; i < 2; ++i) {
+        dphysics::RigidBody &body = statics[i];
+        body.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+        body.SetInverseMass(0.0f);
+        body.Transform.SetPosition(ysMath::LoadVector(i * 1.0f, -0.5f, 0.0f));
+        body.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        body.CollisionGeometry.NewBoxObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsBox()->Position = ysMath::Constants::Zero;
+        col->GetAsBox()->HalfHeight = 0.5f;
+        col->GetAsBox()->HalfWidth = 20.0f;
+        col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+        rb.RegisterRigidBody(&body);
+    }
+
+    statics[0].SetRequestsInformation(true);
+
+    // A body hanging from a fixed point and an immovable body that is
+    // moved while pinned in place
+    dphysics::RigidBody hanging;
+    hanging.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    hanging.SetInverseMass(1.0f);
+    hanging.SetInverseInertiaTensor(hanging.GetRectangleTensor(1.0f, 1.0f));
+    ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+    hanging.SetAcceleration(gravity);
+    hanging.Transform.SetPosition(ysMath::LoadVector(0.0f, 5.0f, 0.0f));
+    hanging.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    dphysics::RigidBody kinematic;
+    kinematic.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    kinematic.SetInverseMass(0.0f);
+    kinematic.SetVelocity(ysMath::LoadVector(1.0f, 0.0f, 0.0f));
+    kinematic.Transform.SetPosition(ysMath::LoadVector(-5.0f, 5.0f, 0.0f));
+    kinematic.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    rb.RegisterRigidBody(&hanging);
+    rb.RegisterRigidBody(&kinematic);
+
+    rb.CreateLink<WorldAnchorLink>(&hanging, nullptr)->Anchor = ysMath::LoadVector(0.0f, 5.0f, 0.0f);
+    rb.CreateLink<WorldAnchorLink>(&kinematic, nullptr)->Anchor = ysMath::LoadVector(-5.0f, 5.0f, 0.0f);
+
+    for (int i = 0; i < 120; ++i) {
+        rb.Update(1 / 60.0f);
+        ASSERT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+    }
+
+    EXPECT_GT(statics[0].GetCollisionCount(), 0);
+    EXPECT_GT(ysMath::GetY(hanging.Transform.GetWorldPosition()), 3.0f);
+
+    ASSERT_EQ(rb.GetIslandCount(), 1);
+    EXPECT_EQ(rb.GetIsland(0).BodyCount, 1);
+}
+
+TEST(DeltaPhysicsSystemTests, IslandsWithoutMovableBodies) {
+    CheckIslandsWithoutMovableBodies(dphysics::RigidBodySystem::SolverMode::LargestViolation);
+    CheckIslandsWithoutMovableBodies(dphysics::RigidBodySystem::SolverMode::SequentialImpulse);
+}
+
+TEST(DeltaPhysicsSystemTests, SequentialImpulseStack) {
+    constexpr int StackHeight = 5;
+
+    dphysics::RigidBodySystem rb;
+    rb.SetSolverMode(dphysics::RigidBodySystem::SolverMode::SequentialImpulse);
+    rb.SetSleepingEnabled(false);
+
+    dphysics::CollisionObject *col;
+
+    dphysics::RigidBody G;
+    G.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+    G.SetInverseMass(0.0f);
+    G.Transform.SetPosition(ysMath::LoadVector(0.0f, -0.5f, 0.0f));
+    G.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    G.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->HalfHeight = 0.5f;
+    col->GetAsBox()->HalfWidth = 20.0f;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+    rb.RegisterRigidBody(&G);
+
+    ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+
+    dphysics::RigidBody boxes[StackHeight];
+    for (int i = 0; i < StackHeight; ++i) {
+        dphysics::RigidBody &box = boxes[i];
+        box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+        box.SetInverseMass(1.0f);
+        box.SetInverseInertiaTensor(box.GetRectangleTensor(1.0f, 1.0f));
+        box.SetAcceleration(gravity);
+        box.Transform.SetPosition(ysMath::LoadVector(0.0f, i + 0.5f, 0.0f));
+        box.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        box.CollisionGeometry.NewBoxObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsBox()->Position = ysMath::Constants::Zero;
+        col->GetAsBox()->HalfHeight = 0.5f;
+        col->GetAsBox()->HalfWidth = 0.5f;
+        col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+        rb.RegisterRigidBody(&box);
+    }
+
+    for (int i = 0; i < 300; ++i) {
+        rb.Update(1 / 60.0f);
+        EXPECT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+    }
+
+    for (int i = 0; i < StackHeight; ++i) {
+        ysVector position = boxes[i].Transform.GetWorldPosition();
+        EXPECT_NEAR(ysMath::GetX(position), 0.0f, 0.05f) << "Box: " << i;
+        EXPECT_NEAR(ysMath::GetY(position), i + 0.5f, 0.05f) << "Box: " << i;
+    }
+
+    // Warm starting carries the resting impulses over between frames
+    float normalImpulse = 0.0f;
+    for (int i = 0; i < boxes[0].GetCollisionCount(); ++i) {
+        dphysics::Collision *collision = boxes[0].GetCollision(i);
+        if (collision->m_body1 == &G || collision->m_body2 == &G) {
+            normalImpulse += ysMath::GetX(collision->GetAccumulatedImpulse());
+        }
+    }
+
+    EXPECT_NEAR(normalImpulse, StackHeight * 10.0f / 60.0f, 0.1f);
+}
+
+TEST(DeltaPhysicsSystemTests, BodyStateRegistration) {
+    dphysics::RigidBodySystem rb;
+
+    dphysics::RigidBody bodies[3];
+    for (int i = 0; i < 3; ++i) {
+        bodies[i].SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+        bodies[i].SetInverseMass(1.0f / (i + 1));
+        bodies[i].SetVelocity(ysMath::LoadVector((float)i, 0.0f, 0.0f));
+
+        rb.RegisterRigidBody(&bodies[i]);
+    }
+
+    // Removing a body moves the last slot of the store into its place and
+    // hands the removed body its state back
+    rb.RemoveRigidBody(&bodies[0]);
+    EXPECT_FLOAT_EQ(bodies[0].GetInverseMass(), 1.0f);
+
+    bodies[0].SetVelocity(ysMath::LoadVector(5.0f, 0.0f, 0.0f));
+
+    rb.Update(1 / 60.0f);
+
+    EXPECT_FLOAT_EQ(ysMath::GetX(bodies[0].GetVelocity()), 5.0f);
+    EXPECT_NEAR(ysMath::GetX(bodies[1].GetVelocity()), 1.0f, 0.01f);
+    EXPECT_NEAR(ysMath::GetX(bodies[2].GetVelocity()), 2.0f, 0.01f);
+    EXPECT_FLOAT_EQ(bodies[2].GetInverseMass(), 1.0f / 3);
+}
+
+TEST(DeltaPhysicsSystemTests, ReplayRoundTrip) {
+    constexpr int FrameCount = 200;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool quantized = (pass == 1);
+        const float tolerance = quantized ? 1E-3f : 0.0f;
+
+        dphysics::RigidBodySystem rb;
+        dphysics::CollisionObject *col;
+
+        dphysics::RigidBody G;
+        G.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+        G.SetInverseMass(0.0f);
+        G.Transform.SetPosition(ysMath::LoadVector(0.0f, -0.5f, 0.0f));
+        G.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+        G.CollisionGeometry.NewBoxObject(&col);
+        col->SetMode(dphysics::CollisionObject::Mode::Fine);
+        col->GetAsBox()->Position = ysMath::Constants::Zero;
+        col->GetAsBox()->HalfHeight = 0.5f;
+        col->GetAsBox()->HalfWidth = 20.0f;
+        col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+        rb.RegisterRigidBody(&G);
+
+        ysVector gravity = ysMath::LoadVector(0.0f, -10.0f, 0.0f);
+
+        dphysics::RigidBody boxes[3];
+        for (int i = 0; i < 3; ++i) {
+            dphysics::RigidBody &box = boxes[i];
+            box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+            box.SetInverseMass(1.0f);
+            box.SetInverseInertiaTensor(box.GetRectangleTensor(1.0f, 1.0f));
+            box.SetAcceleration(gravity);
+            box.Transform.SetPosition(ysMath::LoadVector(i * 0.3f, i * 1.5f + 2.0f, 0.0f));
+            box.Transform.SetOrientation(ysMath::LoadQuaternion(i * 0.4f, ysMath::Constants::ZAxis));
+
+            box.CollisionGeometry.NewBoxObject(&col);
+            col->SetMode(dphysics::CollisionObject::Mode::Fine);
+            col->GetAsBox()->Position = ysMath::Constants::Zero;
+            col->GetAsBox()->HalfHeight = 0.5f;
+            col->GetAsBox()->HalfWidth = 0.5f;
+            col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+
+            rb.RegisterRigidBody(&box);
+        }
+
+        rb.GetReplayRecorder().SetKeyframeInterval(16);
+        rb.GetReplayRecorder().SetBufferedFrameLimit(4);
+        rb.GetReplayRecorder().SetPositionPrecision(quantized ? 1E-4f : 0.0f);
+        rb.OpenReplayFile("SystemTest_replay.bin");
+
+        std::vector<ysVector> positions;
+        for (int i = 0; i < FrameCount; ++i) {
+            rb.Update(1 / 60.0f);
+            for (int j = 0; j < 3; ++j) {
+                positions.push_back(boxes[j].Transform.GetWorldPosition());
+            }
+        }
+
+        rb.CloseReplayFile();
+
+        dphysics::ReplayReader reader;
+        ASSERT_TRUE(reader.Open("SystemTest_replay.bin"));
+        ASSERT_EQ(reader.GetFrameCount(), FrameCount);
+        ASSERT_EQ(reader.GetBodyDescriptorCount(), 4);
+        EXPECT_FLOAT_EQ(reader.GetBodyDescriptor(0).Shapes[0].HalfWidth, 20.0f);
+
+        // Forward, backward and sequential access
+        const int frames[] = { 150, 10, 11, 12, 199, 0, 33 };
+        for (int frame : frames) {
+            ASSERT_TRUE(reader.SeekFrame(frame));
+            ASSERT_EQ(reader.GetCurrentFrame(), frame);
+            ASSERT_EQ(reader.GetBodyCount(), 4);
+
+            for (int j = 0; j < 3; ++j) {
+                const ysVector expected = positions[frame * 3 + j];
+                const ysVector actual = reader.GetPosition(j + 1);
+                EXPECT_NEAR(ysMath::GetX(actual), ysMath::GetX(expected), tolerance);
+                EXPECT_NEAR(ysMath::GetY(actual), ysMath::GetY(expected), tolerance);
+            }
+        }
+
+        EXPECT_TRUE(reader.NextFrame());
+        EXPECT_EQ(reader.GetCurrentFrame(), 34);
+        EXPECT_FALSE(reader.SeekFrame(FrameCount));
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, CollisionPoolReuse) {
+    dphysics::CollisionPool pool;
+
+    const int count = dphysics::CollisionPool::ChunkSize + 10;
+    for (int i = 0; i < count; ++i) {
+        EXPECT_EQ(pool.Allocate(), i);
+        pool.Get(i)->m_penetration = (float)i;
+    }
+
+    // Growing the pool does not move existing collisions
+    dphysics::Collision *first = pool.Get(0);
+    EXPECT_FLOAT_EQ(first->m_penetration, 0.0f);
+    EXPECT_FLOAT_EQ(pool.Get(count - 1)->m_penetration, (float)(count - 1));
+
+    const int capacity = pool.GetCapacity();
+    pool.Reset();
+
+    EXPECT_EQ(pool.GetCount(), 0);
+    EXPECT_EQ(pool.Allocate(), 0);
+    EXPECT_EQ(pool.Get(0), first);
+    EXPECT_EQ(pool.GetCapacity(), capacity);
+}
+
+TEST(DeltaPhysicsSystemTests, StaticTreeBroadphase) {
+    dphysics::RigidBodySystem rb;
+    rb.SetBroadphaseMode(dphysics::RigidBodySystem::BroadphaseMode::GridAndTree);
+
+    // The floor is much larger than the maximum object size of the grid, the
+    // box lands far away from its center
+    dphysics::RigidBody floor;
+    floor.SetHint(dphysics::RigidBody::RigidBodyHint::Static);
+    floor.SetInverseMass(0.0f);
+    floor.Transform.SetPosition(ysMath::LoadVector(0.0f, 0.0f, 0.0f));
+    floor.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    dphysics::CollisionObject *col;
+    floor.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+    col->GetAsBox()->HalfWidth = 200.0f;
+    col->GetAsBox()->HalfHeight = 1.0f;
+
+    dphysics::RigidBody box;
+    box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    box.SetInverseMass(1.0f);
+    box.SetInverseInertiaTensor(box.GetRectangleTensor(2.0f, 2.0f));
+    box.Transform.SetPosition(ysMath::LoadVector(150.0f, 4.0f, 0.0f));
+    box.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    box.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+    col->GetAsBox()->HalfWidth = 1.0f;
+    col->GetAsBox()->HalfHeight = 1.0f;
+
+    rb.RegisterRigidBody(&floor);
+    rb.RegisterRigidBody(&box);
+
+    for (int i = 0; i < 300; ++i) {
+        box.ClearAccumulators();
+        box.AddForceWorldSpace(ysMath::LoadVector(0.0f, -10.0f, 0.0f), box.Transform.GetWorldPosition());
+
+        rb.Update(1 / 60.0f);
+        EXPECT_TRUE(rb.CheckState()) << "Check failed on iteration: " << i;
+
+        if (i == 0) {
+            EXPECT_EQ(rb.GetStaticTree().GetProxyCount(), 1);
+            EXPECT_EQ(floor.GetGridCellCount(), 0);
+        }
+    }
+
+    EXPECT_GT(ysMath::GetY(box.Transform.GetWorldPosition()), 1.5f);
+
+    rb.SetBroadphaseMode(dphysics::RigidBodySystem::BroadphaseMode::Grid);
+    rb.Update(1 / 60.0f);
+    EXPECT_EQ(rb.GetStaticTree().GetProxyCount(), 0);
+
+    rb.RemoveRigidBody(&box);
+    rb.RemoveRigidBody(&floor);
+}
+
+TEST(DeltaPhysicsSystemTests, SceneQueryBatch) {
+    dphysics::RigidBodySystem rb;
+    rb.SetThreadCount(4);
+
+    dphysics::RigidBody circle;
+    circle.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    circle.SetInverseMass(1.0f);
+    circle.Transform.SetPosition(ysMath::LoadVector(10.0f, 0.0f, 0.0f));
+    circle.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    dphysics::CollisionObject *col;
+    circle.CollisionGeometry.NewCircleObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsCircle()->Position = ysMath::Constants::Zero;
+    col->GetAsCircle()->Radius = 1.0f;
+
+    dphysics::RigidBody box;
+    box.SetHint(dphysics::RigidBody::RigidBodyHint::Dynamic);
+    box.SetInverseMass(1.0f);
+    box.Transform.SetPosition(ysMath::LoadVector(0.0f, 10.0f, 0.0f));
+    box.Transform.SetOrientation(ysMath::Constants::QuatIdentity);
+
+    box.CollisionGeometry.NewBoxObject(&col);
+    col->SetMode(dphysics::CollisionObject::Mode::Fine);
+    col->GetAsBox()->Position = ysMath::Constants::Zero;
+    col->GetAsBox()->Orientation = ysMath::Constants::QuatIdentity;
+    col->GetAsBox()->HalfWidth = 1.0f;
+    col->GetAsBox()->HalfHeight = 1.0f;
+
+    rb.RegisterRigidBody(&circle);
+    rb.RegisterRigidBody(&box);
+    rb.Update(1 / 60.0f);
+
+    const ysVector origin = ysMath::LoadVector(0.0f, 0.0f);
+    std::vector<dphysics::RaycastQuery> rays = {
+        { origin, ysMath::LoadVector(2.0f, 0.0f), 100.0f, 0xFFFFFFFF },
+        { origin, ysMath::LoadVector(0.0f, 1.0f), 100.0f, 0xFFFFFFFF },
+        { origin, ysMath::LoadVector(-1.0f, 0.0f), 100.0f, 0xFFFFFFFF },
+        { origin, ysMath::LoadVector(1.0f, 0.0f), 5.0f, 0xFFFFFFFF },
+        { origin, ysMath::LoadVector(1.0f, 0.0f), 100.0f, 0x0 }
+    };
+
+    // Enough queries to be split across threads
+    while (rays.size() < 1000) rays.push_back(rays[rays.size() % 5]);
+
+    std::vector<dphysics::QueryHit> hits(rays.size());
+    rb.RaycastBatch(rays.data(), (int)rays.size(), hits.data());
+
+    EXPECT_EQ(hits[0].Body, &circle);
+    EXPECT_NEAR(hits[0].Distance, 9.0f, 1E-4f);
+    VecEq(hits[0].Normal, ysMath::LoadVector(-1.0f, 0.0f));
+    VecEq(hits[0].Position, ysMath::LoadVector(9.0f, 0.0f));
+
+    EXPECT_EQ(hits[1].Body, &box);
+    EXPECT_NEAR(hits[1].Distance, 9.0f, 1E-4f);
+    VecEq(hits[1].Normal, ysMath::LoadVector(0.0f, -1.0f));
+
+    EXPECT_EQ(hits[2].Body, nullptr);
+    EXPECT_EQ(hits[3].Body, nullptr);
+    EXPECT_EQ(hits[4].Body, nullptr);
+
+    for (size_t i = 5; i < hits.size(); ++i) {
+        EXPECT_EQ(hits[i].Body, hits[i % 5].Body);
+        EXPECT_EQ(hits[i].Distance, hits[i % 5].Distance);
+    }
+
+    dphysics::SweepCircleQuery sweep = { origin, ysMath::LoadVector(1.0f, 0.0f), 0.5f, 100.0f, 0xFFFFFFFF };
+    dphysics::QueryHit sweepHit;
+    rb.SweepCircleBatch(&sweep, 1, &sweepHit);
+
+    EXPECT_EQ(sweepHit.Body, &circle);
+    EXPECT_NEAR(sweepHit.Distance, 8.5f, 1E-4f);
+
+    const dphysics::OverlapCircleQuery overlaps[] = {
+        { ysMath::LoadVector(10.0f, 1.5f), 1.0f, 0xFFFFFFFF },
+        { ysMath::LoadVector(5.0f, 5.0f), 0.5f, 0xFFFFFFFF },
+        { ysMath::LoadVector(5.0f, 5.0f), 10.0f, 0xFFFFFFFF }
+    };
+
+    dphysics::OverlapResult results[3];
+    std::vector<dphysics::RigidBody *> bodies;
+    rb.OverlapCircleBatch(overlaps, 3, results, bodies);
+
+    ASSERT_EQ(results[0].Count, 1);
+    EXPECT_EQ(bodies[results[0].Start], &circle);
+    EXPECT_EQ(results[1].Count, 0);
+    ASSERT_EQ(results[2].Count, 2);
+    EXPECT_EQ(bodies[results[2].Start], &circle);
+    EXPECT_EQ(bodies[results[2].Start + 1], &box);
+
+    rb.RemoveRigidBody(&box);
+    rb.RemoveRigidBody(&circle);
+}
+
+// Exposes collision detection and the exhaustive pair loop that was used
+// before particles were hashed into a uniform grid
+class MassSpringBenchmarkSystem : public dphysics::MassSpringSystem {
+public:
+    void DetectCollisions() {
+        dphysics::MassSpringSystem::DetectCollisions();
+    }
+
+    void DetectCollisionsLegacy() {
+        const int numParticles = m_particles.GetNumObjects();
+        for (int i = 0; i < numParticles; i++) {
+            m_particles.Get(i)->ClearCollisions();
+        }
+
+        for (int i = 0; i < numParticles; i++) {
+            dphysics::MSSParticle *particle1 = m_particles.Get(i);
+
+            for (int j = i + 1; j < numParticles; j++) {
+                dphysics::MSSParticle *particle2 = m_particles.Get(j);
+
+                if (!particle1->GetCollisionEnable() || !particle2->GetCollisionEnable()) continue;
+                if (particle1->IsConnected(particle2)) continue;
+
+                const float r = particle1->GetRadius() + particle2->GetRadius();
+                const ysVector delta = ysMath::Sub(particle1->GetPosition(), particle2->GetPosition());
+                if (ysMath::GetScalar(ysMath::MagnitudeSquared3(delta)) < r * r) {
+                    particle1->AddCollision(particle2);
+                    particle2->AddCollision(particle1);
+                }
+            }
+        }
+    }
+};
+
+// Builds an overlapping grid of particles and returns the brute force
+// collision counts of the first checkedCount particles
+static std::vector<int> BuildMassSpringGrid(
+    dphysics::MassSpringSystem *system,
+    std::vector<dphysics::MSSParticle *> &particles,
+    int particleCount,
+    int checkedCount)
+{
+    system->SetStep(1 / 60.0f);
+
+    particles.resize(particleCount);
+    const int columns = (int)std::sqrt((float)particleCount);
+    for (int i = 0; i < particleCount; ++i) {
+        dphysics::MSSParticle *particle = system->NewParticle();
+        particle->SetInverseMass(1.0f);
+        particle->SetRadius((i % 7 == 0) ? 0.6f : 0.4f);
+        particle->SetCollisionEnable(i % 11 != 0);
+        particle->SetPosition(ysMath::LoadVector(
+            (i % columns) * 0.9f + (i % 3) * 0.1f,
+            (i / columns) * 0.9f + (i % 5) * 0.05f,
+            0.0f));
+
+        particles[i] = particle;
+    }
+
+    // Springs along each row so that some overlapping neighbors are
+    // connected and must not collide
+    for (int i = 0; i + 1 < particleCount; i += 2) {
+        dphysics::MSSSpring *spring = system->NewSpring();
+        spring->SetLength(0.9f);
+        spring->SetConstant(1.0f);
+        spring->SetParticle0(particles[i]);
+        spring->SetParticle1(particles[i + 1]);
+    }
+
+    std::vector<int> expected(checkedCount, 0);
+    for (int i = 0; i < checkedCount; ++i) {
+        for (int j = 0; j < particleCount; ++j) {
+            if (i == j) continue;
+            if (!particles[i]->GetCollisionEnable() || !particles[j]->GetCollisionEnable()) continue;
+            if (particles[i]->IsConnected(particles[j])) continue;
+
+            const float r = particles[i]->GetRadius() + particles[j]->GetRadius();
+            const ysVector delta = ysMath::Sub(particles[i]->GetPosition(), particles[j]->GetPosition());
+            if (ysMath::GetScalar(ysMath::MagnitudeSquared3(delta)) < r * r) {
+                ++expected[i];
+            }
+        }
+    }
+
+    return expected;
+}
+
+TEST(DeltaPhysicsSystemTests, MassSpringCollisionPairs) {
+    dphysics::MassSpringSystem system;
+    std::vector<dphysics::MSSParticle *> particles;
+    const std::vector<int> expected = BuildMassSpringGrid(&system, particles, 1000, 1000);
+
+    system.Update();
+
+    for (int i = 0; i < (int)expected.size(); ++i) {
+        EXPECT_EQ(particles[i]->GetCollisionCount(), expected[i]) << "Particle " << i;
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, DISABLED_MassSpringCollisionScaling) {
+    constexpr int Steps = 2;
+    constexpr int CheckedCount = 1000;
+    const int particleCounts[] = { 1000, 10000, 50000 };
+
+    for (const int particleCount : particleCounts) {
+        MassSpringBenchmarkSystem system;
+        std::vector<dphysics::MSSParticle *> particles;
+        const std::vector<int> expected = BuildMassSpringGrid(&system, particles, particleCount, CheckedCount);
+
+        auto checkCollisions = [&](const char *path) {
+            for (int i = 0; i < (int)expected.size(); ++i) {
+                ASSERT_EQ(particles[i]->GetCollisionCount(), expected[i]) << path << ", particle: " << i;
+            }
+        };
+
+        auto timeSteps = [&](auto detect) {
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < Steps; ++i) {
+                detect();
+            }
+            const auto end = std::chrono::steady_clock::now();
+
+            return (int)(std::chrono::duration<double, std::micro>(end - start).count() / Steps);
+        };
+
+        const int current = timeSteps([&] { system.DetectCollisions(); });
+        checkCollisions("Current");
+
+        const int legacy = timeSteps([&] { system.DetectCollisionsLegacy(); });
+        checkCollisions("Legacy");
+
+        const std::string prefix = "Particles" + std::to_string(particleCount);
+        RecordProperty(prefix + "CurrentMicroseconds", current);
+        RecordProperty(prefix + "LegacyMicroseconds", legacy);
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, MassSpringClothThreading) {
+    const int columns = 64;
+    const int rows = 64;
+
+    std::vector<ysVector> positions[2];
+    for (int run = 0; run < 2; ++run) {
+        dphysics::MassSpringSystem system;
+        system.SetStep(1 / 240.0f);
+        system.SetThreadCount((run == 0) ? 1 : 4);
+
+        std::vector<dphysics::MSSParticle *> particles(columns * rows);
+        for (int i = 0; i < columns * rows; ++i) {
+            const int x = i % columns, y = i / columns;
+
+            dphysics::MSSParticle *particle = system.NewParticle();
+            particle->SetInverseMass((y == 0) ? 0.0f : 1.0f + (x % 3));
+            particle->SetPosition(ysMath::LoadVector(x * 0.5f, -y * 0.5f, 0.0f));
+            particle->SetExternalAcceleration(ysMath::LoadVector(0.0f, -9.8f, 0.0f));
+            particle->SetRadius(0.3f);
+            particle->SetCollisionEnable(true);
+
+            particles[i] = particle;
+        }
+
+        for (int i = 0; i < columns * rows; ++i) {
+            const int x = i % columns, y = i / columns;
+
+            if (x + 1 < columns) {
+                dphysics::MSSSpring *spring = system.NewSpring();
+                spring->SetLength(0.5f);
+                spring->SetConstant(60.0f);
+                spring->SetInvertedForce(i % 7 == 0);
+                spring->SetParticle0(particles[i]);
+                spring->SetParticle1(particles[i + 1]);
+            }
+
+            if (y + 1 < rows) {
+                dphysics::MSSSpring *spring = system.NewSpring();
+                spring->SetLength(0.5f);
+                spring->SetConstant(80.0f);
+                spring->SetParticle0(particles[i + columns]);
+                spring->SetParticle1(particles[i]);
+            }
+        }
+
+        for (int i = 0; i < 120; ++i) {
+            system.Update();
+        }
+
+        for (dphysics::MSSParticle *particle : particles) {
+            positions[run].push_back(particle->GetPosition());
+        }
+
+        EXPECT_EQ(ysMath::GetY(particles[columns - 1]->GetPosition()), 0.0f);
+        EXPECT_LT(ysMath::GetY(particles[columns * rows - 1]->GetPosition()), -0.5f * (rows - 1));
+    }
+
+    // Every particle is integrated independently of how the work is split
+    for (int i = 0; i < columns * rows; ++i) {
+        EXPECT_EQ(ysMath::GetX(positions[0][i]), ysMath::GetX(positions[1][i])) << "Particle " << i;
+        EXPECT_EQ(ysMath::GetY(positions[0][i]), ysMath::GetY(positions[1][i])) << "Particle " << i;
+        EXPECT_EQ(ysMath::GetZ(positions[0][i]), ysMath::GetZ(positions[1][i])) << "Particle " << i;
+    }
+}
+
+TEST(DeltaPhysicsSystemTests, MassSpringPositionBasedStiffRope) {
+    const int particleCount = 20;
+    const float segmentLength = 0.5f;
+
+    dphysics::MassSpringSystem system;
+    system.SetStep(1 / 60.0f);
+    system.SetIntegrationMode(dphysics::MassSpringSystem::IntegrationMode::PositionBased);
+    system.SetSolverIterations(20);
+
+    // Far too stiff for a single explicit step at 60 Hz. The rope starts out
+    // horizontal and swings down.
+    std::vector<dphysics::MSSParticle *> particles(particleCount);
+    for (int i = 0; i < particleCount; ++i) {
+        particles[i] = system.NewParticle();
+        particles[i]->SetInverseMass((i == 0) ? 0.0f : 1.0f);
+        particles[i]->SetDrag(0.1f);
+        particles[i]->SetPosition(ysMath::LoadVector(i * segmentLength, 0.0f, 0.0f));
+        particles[i]->SetExternalAcceleration(ysMath::LoadVector(0.0f, -9.8f, 0.0f));
+
+        if (i > 0) {
+            dphysics::MSSSpring *spring = system.NewSpring();
+            spring->SetLength(segmentLength);
+            spring->SetConstant(1E6f);
+            spring->SetParticle0(particles[i - 1]);
+            spring->SetParticle1(particles[i]);
+        }
+    }
+
+    for (int i = 0; i < 600; ++i) {
+        system.Update();
+    }
+
+    for (int i = 1; i < particleCount; ++i) {
+        const ysVector delta = ysMath::Sub(particles[i]->GetPosition(), particles[i - 1]->GetPosition());
+        const float length = std::sqrt(ysMath::GetScalar(ysMath::MagnitudeSquared3(delta)));
+
+        EXPECT_NEAR(length, segmentLength, 0.02f * segmentLength) << "Segment " << i;
+    }
+
+    const ysVector end = particles[particleCount - 1]->GetPosition();
+    EXPECT_NEAR(ysMath::GetX(end), 0.0f, 0.25f);
+    EXPECT_NEAR(ysMath::GetY(end), -(particleCount - 1) * segmentLength, 0.1f);
+    EXPECT_EQ(ysMath::GetX(particles[0]->GetPosition()), 0.0f);
+}
+
+TEST(DeltaPhysicsSystemTests, ParticleSystemPool) {
+    dphysics::ParticleSystem system;
+    system.SetCapacity(1000);
+    system.SetRate(600.0f);
+    system.SetPosition(ysMath::LoadVector(10.0f, 0.0f, 0.0f));
+
+    // 600 particles per second at 60 Hz is 10 per frame
+    for (int i = 0; i < 30; ++i) {
+        system.Update(1 / 60.0f);
+        EXPECT_EQ(system.GetParticleCount(), 10 * (i + 1));
+    }
+
+    // The pool stops emitting once full and old particles start dying after
+    // their life of 5 to 6 seconds
+    int maxCount = 0;
+    for (int i = 0; i < 600; ++i) {
+        system.Update(1 / 60.0f);
+        maxCount = std::max(maxCount, system.GetParticleCount());
+    }
+
+    EXPECT_EQ(maxCount, 1000);
+
+    for (int i = 0; i < system.GetParticleCount(); ++i) {
+        EXPECT_LE(system.GetParticleAge(i), system.GetParticleLife(i) + 1 / 60.0f);
+    }
+
+    std::vector<dphysics::ParticleInstance> instances(system.GetParticleCount());
+    const int written = system.WriteInstances(instances.data(), (int)instances.size());
+    ASSERT_EQ(written, system.GetParticleCount());
+
+    for (int i = 0; i < written; ++i) {
+        const float x = ysMath::GetX(system.GetParticlePosition(i)) + 10.0f;
+        EXPECT_FLOAT_EQ(instances[i].Position[0], x);
+        EXPECT_GE(instances[i].Fade, -1 / 60.0f);
+        EXPECT_LE(instances[i].Fade, 1.0f);
+    }
+
+    system.SetRate(0.0f);
+    for (int i = 0; i < 400; ++i) {
+        system.Update(1 / 60.0f);
+    }
+
+    EXPECT_EQ(system.GetParticleCount(), 0);
+}
+
+TEST(DeltaPhysicsSystemTests, MassSpringFixedTimestep) {
+    dphysics::MassSpringSystem fixed, reference;
+
+    dphysics::MassSpringSystem *systems[] = { &fixed, &reference };
+    dphysics::MSSParticle *bobs[2];
+    for (int i = 0; i < 2; ++i) {
+        dphysics::MassSpringSystem *system = systems[i];
+        system->SetStep(1 / 120.0f);
+
+        dphysics::MSSParticle *anchor = system->NewParticle();
+        anchor->SetInverseMass(0.0f);
+        anchor->SetPosition(ysMath::LoadVector(0.0f, 0.0f, 0.0f));
+
+        dphysics::MSSParticle *bob = system->NewParticle();
+        bob->SetInverseMass(1.0f);
+        bob->SetPosition(ysMath::LoadVector(1.0f, 0.0f, 0.0f));
+        bob->SetExternalAcceleration(ysMath::LoadVector(0.0f, -9.8f, 0.0f));
+
+        dphysics::MSSSpring *spring = system->NewSpring();
+        spring->SetLength(1.0f);
+        spring->SetConstant(100.0f);
+        spring->SetParticle0(anchor);
+        spring->SetParticle1(bob);
+
+        bobs[i] = bob;
+    }
+
+    fixed.GetTimestepAccumulator()->SetMaxSteps(4);
+
+    // Irregular frames, including a stall that is longer than the step limit
+    const float frames[] = { 1 / 144.0f, 1 / 60.0f, 1 / 30.0f, 0.5f, 1 / 90.0f, 1 / 144.0f };
+
+    int totalSteps = 0;
+    for (int i = 0; i < 60; ++i) {
+        const int steps = fixed.Advance(frames[i % 6]);
+        EXPECT_LE(steps, 4);
+
+        for (int j = 0; j < steps; ++j) {
+            reference.Update();
+        }
+
+        totalSteps += steps;
+    }
+
+    const ysTimestepAccumulator *accumulator = fixed.GetTimestepAccumulator();
+    const double simulated = totalSteps / 120.0;
+
+    double elapsed = 0.0;
+    for (int i = 0; i < 60; ++i) elapsed += frames[i % 6];
+
+    EXPECT_NEAR(simulated + accumulator->GetAccumulator() + accumulator->GetDroppedTime(), elapsed, 1E-4);
+    EXPECT_GT(accumulator->GetDroppedTime(), 0.0);
+    EXPECT_LT(accumulator->GetAlpha(), 1.0);
+
+    const ysVector a = bobs[0]->GetPosition();
+    const ysVector b = bobs[1]->GetPosition();
+    EXPECT_EQ(ysMath::GetX(a), ysMath::GetX(b));
+    EXPECT_EQ(ysMath::GetY(a), ysMath::GetY(b));
+}
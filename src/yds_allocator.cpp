@@ -0,0 +1,434 @@
+#include "../include/yds_allocator.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <stdlib.h>
+
+#if defined(_WIN64)
+    #include <malloc.h>
+#endif
+
+namespace {
+
+    // Precedes every block so that it can be freed without knowing its type
+    // or size. Derived objects are freed through base class pointers by
+    // ysDynamicArray.
+    struct BlockHeader {
+        int32_t SizeClass;
+        uint32_t Offset;
+        uint64_t Size;
+    };
+
+    static_assert(sizeof(BlockHeader) == ysAllocator::MinimumAlignment, "Block header breaks alignment");
+
+    const int32_t LargeBlock = -1;
+
+    struct FreeBlock {
+        FreeBlock *Next;
+    };
+
+    void *SystemAllocate(size_t size, size_t alignment) {
+    #if defined(_WIN64)
+        return ::_aligned_malloc(size, alignment);
+    #else
+        return ::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    #endif
+    }
+
+    void SystemFree(void *block) {
+    #if defined(_WIN64)
+        ::_aligned_free(block);
+    #else
+        ::free(block);
+    #endif
+    }
+
+    // Number of blocks moved between a thread cache and the central pool at a
+    // time. Keeps the amount of memory moved roughly constant across classes.
+    int GetBatchSize(int sizeClass) {
+        const int batch = 16 * 1024 / (int)ysAllocator::GetSizeClassSize(sizeClass);
+        return (batch < 4) ? 4 : (batch > 64) ? 64 : batch;
+    }
+
+    struct ThreadCache {
+        FreeBlock *Lists[ysAllocator::SizeClassCount];
+        int Counts[ysAllocator::SizeClassCount];
+
+        // Only written by the owning thread, read by GetStatistics()
+        std::atomic<uint64_t> Allocations;
+        std::atomic<uint64_t> Frees;
+        std::atomic<uint64_t> LargeAllocations;
+        std::atomic<uint64_t> CacheRefills;
+        std::atomic<int64_t> LiveBytes;
+        std::atomic<int64_t> LiveBlocks;
+    };
+
+    template <typename T>
+    inline void Increment(std::atomic<T> &counter, T amount) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    struct CentralPool {
+        std::mutex Lock;
+
+        FreeBlock *Lists[ysAllocator::SizeClassCount];
+        char *SpanCursor[ysAllocator::SizeClassCount];
+        char *SpanEnd[ysAllocator::SizeClassCount];
+
+        std::vector<ThreadCache *> Threads;
+
+        // Totals of exited threads and of allocations made without a cache
+        ysAllocator::Statistics Retired;
+        uint64_t SpanBytes;
+    };
+
+    // Never destroyed, since static objects may still free memory while the
+    // program shuts down
+    CentralPool *GetCentralPool() {
+        static CentralPool *pool = [] {
+            CentralPool *newPool = new CentralPool;
+            for (int i = 0; i < ysAllocator::SizeClassCount; ++i) {
+                newPool->Lists[i] = nullptr;
+                newPool->SpanCursor[i] = nullptr;
+                newPool->SpanEnd[i] = nullptr;
+            }
+
+            newPool->Retired = {};
+            newPool->SpanBytes = 0;
+
+            return newPool;
+        }();
+
+        return pool;
+    }
+
+    // Pops up to count blocks from the central pool. Must be called with the
+    // pool locked.
+    FreeBlock *TakeBlocks(CentralPool *pool, int sizeClass, int count, int *taken) {
+        FreeBlock *head = nullptr;
+        int n = 0;
+
+        while (n < count && pool->Lists[sizeClass] != nullptr) {
+            FreeBlock *block = pool->Lists[sizeClass];
+            pool->Lists[sizeClass] = block->Next;
+
+            block->Next = head;
+            head = block;
+            ++n;
+        }
+
+        const size_t blockSize = ysAllocator::GetSizeClassSize(sizeClass);
+        while (n < count) {
+            if (pool->SpanCursor[sizeClass] + blockSize > pool->SpanEnd[sizeClass]) {
+                char *span = (char *)SystemAllocate(ysAllocator::SpanSize, ysAllocator::MinimumAlignment);
+                if (span == nullptr) break;
+
+                pool->SpanCursor[sizeClass] = span;
+                pool->SpanEnd[sizeClass] = span + ysAllocator::SpanSize;
+                pool->SpanBytes += ysAllocator::SpanSize;
+            }
+
+            FreeBlock *block = (FreeBlock *)pool->SpanCursor[sizeClass];
+            pool->SpanCursor[sizeClass] += blockSize;
+
+            block->Next = head;
+            head = block;
+            ++n;
+        }
+
+        *taken = n;
+        return head;
+    }
+
+    void ReturnBlocks(CentralPool *pool, int sizeClass, FreeBlock *head, FreeBlock *tail) {
+        tail->Next = pool->Lists[sizeClass];
+        pool->Lists[sizeClass] = head;
+    }
+
+    void ReleaseThreadCache(ThreadCache *cache);
+
+    thread_local ThreadCache *t_cache = nullptr;
+    thread_local bool t_exited = false;
+
+    struct ThreadCacheOwner {
+        ThreadCache *Cache = nullptr;
+
+        ~ThreadCacheOwner() {
+            if (Cache != nullptr) ReleaseThreadCache(Cache);
+
+            t_cache = nullptr;
+            t_exited = true;
+        }
+    };
+
+    thread_local ThreadCacheOwner t_owner;
+
+    ThreadCache *GetThreadCache() {
+        if (t_cache != nullptr) return t_cache;
+
+        // Blocks that are allocated or freed by thread_local destructors that
+        // run after the cache is gone go through the central pool
+        if (t_exited) return nullptr;
+
+        ThreadCache *cache = new ThreadCache;
+        for (int i = 0; i < ysAllocator::SizeClassCount; ++i) {
+            cache->Lists[i] = nullptr;
+            cache->Counts[i] = 0;
+        }
+
+        cache->Allocations = 0;
+        cache->Frees = 0;
+        cache->LargeAllocations = 0;
+        cache->CacheRefills = 0;
+        cache->LiveBytes = 0;
+        cache->LiveBlocks = 0;
+
+        CentralPool *pool = GetCentralPool();
+        {
+            std::lock_guard<std::mutex> lock(pool->Lock);
+            pool->Threads.push_back(cache);
+        }
+
+        t_owner.Cache = cache;
+        t_cache = cache;
+
+        return cache;
+    }
+
+    void ReleaseThreadCache(ThreadCache *cache) {
+        CentralPool *pool = GetCentralPool();
+        std::lock_guard<std::mutex> lock(pool->Lock);
+
+        for (int i = 0; i < ysAllocator::SizeClassCount; ++i) {
+            FreeBlock *head = cache->Lists[i];
+            if (head == nullptr) continue;
+
+            FreeBlock *tail = head;
+            while (tail->Next != nullptr) tail = tail->Next;
+
+            ReturnBlocks(pool, i, head, tail);
+        }
+
+        ysAllocator::Statistics &retired = pool->Retired;
+        retired.Allocations += cache->Allocations;
+        retired.Frees += cache->Frees;
+        retired.LargeAllocations += cache->LargeAllocations;
+        retired.CacheRefills += cache->CacheRefills;
+        retired.LiveBytes += cache->LiveBytes;
+        retired.LiveBlocks += cache->LiveBlocks;
+
+        for (size_t i = 0; i < pool->Threads.size(); ++i) {
+            if (pool->Threads[i] == cache) {
+                pool->Threads[i] = pool->Threads.back();
+                pool->Threads.pop_back();
+                break;
+            }
+        }
+
+        delete cache;
+    }
+
+    FreeBlock *AllocateSmall(int sizeClass, size_t size) {
+        ThreadCache *cache = GetThreadCache();
+
+        if (cache == nullptr) {
+            CentralPool *pool = GetCentralPool();
+            std::lock_guard<std::mutex> lock(pool->Lock);
+
+            int taken = 0;
+            FreeBlock *block = TakeBlocks(pool, sizeClass, 1, &taken);
+            if (block != nullptr) {
+                ++pool->Retired.Allocations;
+                pool->Retired.LiveBytes += size;
+                ++pool->Retired.LiveBlocks;
+            }
+
+            return block;
+        }
+
+        if (cache->Lists[sizeClass] == nullptr) {
+            CentralPool *pool = GetCentralPool();
+            std::lock_guard<std::mutex> lock(pool->Lock);
+
+            int taken = 0;
+            cache->Lists[sizeClass] = TakeBlocks(pool, sizeClass, GetBatchSize(sizeClass), &taken);
+            cache->Counts[sizeClass] = taken;
+
+            Increment(cache->CacheRefills, (uint64_t)1);
+
+            if (taken == 0) return nullptr;
+        }
+
+        FreeBlock *block = cache->Lists[sizeClass];
+        cache->Lists[sizeClass] = block->Next;
+        --cache->Counts[sizeClass];
+
+        Increment(cache->Allocations, (uint64_t)1);
+        Increment(cache->LiveBytes, (int64_t)size);
+        Increment(cache->LiveBlocks, (int64_t)1);
+
+        return block;
+    }
+
+    void FreeSmall(FreeBlock *block, int sizeClass, size_t size) {
+        ThreadCache *cache = GetThreadCache();
+
+        if (cache == nullptr) {
+            CentralPool *pool = GetCentralPool();
+            std::lock_guard<std::mutex> lock(pool->Lock);
+
+            ReturnBlocks(pool, sizeClass, block, block);
+            ++pool->Retired.Frees;
+            pool->Retired.LiveBytes -= size;
+            --pool->Retired.LiveBlocks;
+
+            return;
+        }
+
+        block->Next = cache->Lists[sizeClass];
+        cache->Lists[sizeClass] = block;
+        ++cache->Counts[sizeClass];
+
+        Increment(cache->Frees, (uint64_t)1);
+        Increment(cache->LiveBytes, -(int64_t)size);
+        Increment(cache->LiveBlocks, (int64_t)-1);
+
+        // Hand a batch back once the cache holds two, so that memory freed on
+        // one thread can be reused by others
+        const int batch = GetBatchSize(sizeClass);
+        if (cache->Counts[sizeClass] >= 2 * batch) {
+            FreeBlock *head = cache->Lists[sizeClass];
+            FreeBlock *tail = head;
+            for (int i = 1; i < batch; ++i) tail = tail->Next;
+
+            cache->Lists[sizeClass] = tail->Next;
+            cache->Counts[sizeClass] -= batch;
+
+            CentralPool *pool = GetCentralPool();
+            std::lock_guard<std::mutex> lock(pool->Lock);
+            ReturnBlocks(pool, sizeClass, head, tail);
+        }
+    }
+
+    void CountLargeBlock(int64_t size, bool allocate) {
+        ThreadCache *cache = GetThreadCache();
+
+        if (cache == nullptr) {
+            CentralPool *pool = GetCentralPool();
+            std::lock_guard<std::mutex> lock(pool->Lock);
+
+            ysAllocator::Statistics &retired = pool->Retired;
+            if (allocate) {
+                ++retired.Allocations;
+                ++retired.LargeAllocations;
+            }
+            else {
+                ++retired.Frees;
+            }
+
+            retired.LiveBytes += allocate ? size : -size;
+            retired.LiveBlocks += allocate ? 1 : -1;
+
+            return;
+        }
+
+        if (allocate) {
+            Increment(cache->Allocations, (uint64_t)1);
+            Increment(cache->LargeAllocations, (uint64_t)1);
+        }
+        else {
+            Increment(cache->Frees, (uint64_t)1);
+        }
+
+        Increment(cache->LiveBytes, allocate ? size : -size);
+        Increment(cache->LiveBlocks, (int64_t)(allocate ? 1 : -1));
+    }
+
+} /* namespace */
+
+void *ysAllocator::Allocate(size_t size, int alignment) {
+#if !defined(YDS_SYSTEM_ALLOCATOR)
+    if (alignment <= MinimumAlignment && size <= MaxSmallSize - sizeof(BlockHeader)) {
+        const int sizeClass = GetSizeClass(size + sizeof(BlockHeader));
+
+        BlockHeader *header = (BlockHeader *)AllocateSmall(sizeClass, size);
+        if (header == nullptr) return nullptr;
+
+        header->SizeClass = sizeClass;
+        header->Offset = sizeof(BlockHeader);
+        header->Size = size;
+
+        return header + 1;
+    }
+#endif /* YDS_SYSTEM_ALLOCATOR */
+
+    // The header sits directly in front of the block, padded so that the block
+    // keeps the requested alignment
+    const size_t blockAlignment = (alignment > MinimumAlignment) ? alignment : MinimumAlignment;
+
+    char *base = (char *)SystemAllocate(size + blockAlignment, blockAlignment);
+    if (base == nullptr) return nullptr;
+
+    BlockHeader *header = (BlockHeader *)(base + blockAlignment) - 1;
+    header->SizeClass = LargeBlock;
+    header->Offset = (uint32_t)blockAlignment;
+    header->Size = size;
+
+    CountLargeBlock((int64_t)size, true);
+
+    return base + blockAlignment;
+}
+
+void ysAllocator::Free(void *block) {
+    if (block == nullptr) return;
+
+    BlockHeader *header = (BlockHeader *)block - 1;
+    const int sizeClass = header->SizeClass;
+    const size_t size = header->Size;
+
+    if (sizeClass == LargeBlock) {
+        CountLargeBlock((int64_t)size, false);
+        SystemFree((char *)block - header->Offset);
+    }
+    else {
+        FreeSmall((FreeBlock *)header, sizeClass, size);
+    }
+}
+
+void ysAllocator::GetStatistics(Statistics *stats) {
+    CentralPool *pool = GetCentralPool();
+    std::lock_guard<std::mutex> lock(pool->Lock);
+
+    *stats = pool->Retired;
+    stats->SpanBytes = pool->SpanBytes;
+
+    for (ThreadCache *cache : pool->Threads) {
+        stats->Allocations += cache->Allocations.load(std::memory_order_relaxed);
+        stats->Frees += cache->Frees.load(std::memory_order_relaxed);
+        stats->LargeAllocations += cache->LargeAllocations.load(std::memory_order_relaxed);
+        stats->CacheRefills += cache->CacheRefills.load(std::memory_order_relaxed);
+        stats->LiveBytes += cache->LiveBytes.load(std::memory_order_relaxed);
+        stats->LiveBlocks += cache->LiveBlocks.load(std::memory_order_relaxed);
+    }
+}
+
+int ysAllocator::GetSizeClass(size_t size) {
+    // Steps of 16 bytes up to 128, then four classes per power of two
+    if (size <= 128) return (size <= 16) ? 0 : (int)((size + 15) / 16) - 1;
+
+    int p = 7;
+    while (((size - 1) >> (p + 1)) != 0) ++p;
+
+    const int sub = (int)(((size - 1) >> (p - 2)) & 3);
+    return 8 + (p - 7) * 4 + sub;
+}
+
+size_t ysAllocator::GetSizeClassSize(int sizeClass) {
+    if (sizeClass < 8) return (size_t)(sizeClass + 1) * 16;
+
+    const int p = 7 + (sizeClass - 8) / 4;
+    const int sub = (sizeClass - 8) % 4;
+    return ((size_t)1 << p) + (size_t)(sub + 1) * ((size_t)1 << (p - 2));
+}
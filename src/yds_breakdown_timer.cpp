@@ -1,7 +1,7 @@
 #include "../include/yds_breakdown_timer.h"
 
 #include "../include/yds_breakdown_timer_channel.h"
-#include "../include/yds_timing.h"
+#include "../include/yds_profiler.h"
 
 #include <assert.h>
 
@@ -25,39 +25,55 @@ void ysBreakdownTimer::ResetChannels() {
 void ysBreakdownTimer::Clear() {
     m_frameCount = 0;
 
-    m_executionOrder.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_executionOrderLock);
+        m_executionOrder.clear();
+    }
+
+    m_channelIndex.clear();
     m_channels.Clear();
 }
 
-void ysBreakdownTimer::StartFrame() { m_executionOrder.clear(); }
-void ysBreakdownTimer::EndFrame() { ++m_frameCount; }
+void ysBreakdownTimer::StartFrame() {
+    std::lock_guard<std::mutex> lock(m_executionOrderLock);
+    m_executionOrder.clear();
+}
 
-#if defined(_WIN64) // YSTimingSystem 
+void ysBreakdownTimer::EndFrame() { ++m_frameCount; }
 
 void ysBreakdownTimer::StartMeasurement(const std::string &timerChannelName) {
     ysBreakdownTimerChannel *channel = FindChannel(timerChannelName);
     assert(channel != nullptr);
 
-    m_executionOrder.push_back(timerChannelName);
-
-    uint64_t timestamp = ysTimingSystem::Get()->GetTime();
-
-    channel->StartMeasurement(timestamp);
-
-    uint64_t frameCount = channel->GetFrameCount();
-    assert(frameCount == m_frameCount);
+    StartMeasurement(channel);
 }
 
 void ysBreakdownTimer::EndMeasurement(const std::string &timerChannelName) {
     ysBreakdownTimerChannel *channel = FindChannel(timerChannelName);
     assert(channel != nullptr);
 
-    uint64_t timestamp = ysTimingSystem::Get()->GetTime();
+    EndMeasurement(channel);
+}
 
-    channel->EndMeasurement(timestamp);
+void ysBreakdownTimer::StartMeasurement(ysBreakdownTimerChannel *channel) {
+    // Channels can be measured from worker threads, each channel is only
+    // ever measured by one thread at a time
+    {
+        std::lock_guard<std::mutex> lock(m_executionOrderLock);
+        m_executionOrder.push_back(channel);
+    }
+
+    ysProfiler::Get()->BeginZone(channel->GetZone());
+    channel->StartMeasurement(ysProfiler::Now());
+
+    uint64_t frameCount = channel->GetFrameCount();
+    assert(frameCount == m_frameCount);
 }
 
-#endif /* Windows */
+void ysBreakdownTimer::EndMeasurement(ysBreakdownTimerChannel *channel) {
+    channel->EndMeasurement(ysProfiler::Now());
+    ysProfiler::Get()->EndZone(channel->GetZone());
+}
 
 void ysBreakdownTimer::SkipMeasurement(const std::string &timerChannelName) {
     StartMeasurement(timerChannelName);
@@ -69,8 +85,11 @@ ysBreakdownTimer::CreateChannel(const std::string &timerChannelName,
                                 int bufferSize) {
     ysBreakdownTimerChannel *newChannel = m_channels.New();
     newChannel->SetName(timerChannelName);
+    newChannel->SetZone(ysProfiler::Get()->RegisterZone(timerChannelName.c_str()));
     newChannel->Initialize(bufferSize);
 
+    m_channelIndex[timerChannelName] = newChannel;
+
     return newChannel;
 }
 
@@ -112,11 +131,13 @@ void ysBreakdownTimer::CloseLogFile() {
     if (m_logFile.is_open()) { m_logFile.close(); }
 }
 
-ysBreakdownTimerChannel *ysBreakdownTimer::FindChannel(const std::string &s) {
-    const int n = GetChannelCount();
-    for (int i = 0; i < n; ++i) {
-        if (m_channels.Get(i)->GetName() == s) { return m_channels.Get(i); }
-    }
+bool ysBreakdownTimer::WriteChromeTrace(const std::string &filename) {
+    if (!m_enabled) { return false; }
 
-    return nullptr;
+    return ysProfiler::Get()->WriteChromeTrace(filename);
+}
+
+ysBreakdownTimerChannel *ysBreakdownTimer::FindChannel(const std::string &s) {
+    auto channel = m_channelIndex.find(s);
+    return (channel != m_channelIndex.end()) ? channel->second : nullptr;
 }
@@ -1,11 +1,12 @@
 #include "../include/yds_breakdown_timer_channel.h"
 
-#include "../include/yds_timing.h"
+#include "../include/yds_profiler.h"
 
 #include <assert.h>
 
 ysBreakdownTimerChannel::ysBreakdownTimerChannel() {
     m_name = "";
+    m_zone = -1;
     m_sampleBuffer = nullptr;
     m_currentWriteIndex = 0;
     m_bufferSize = 0;
@@ -63,15 +64,12 @@ void ysBreakdownTimerChannel::StartMeasurement(uint64_t timestamp) {
     m_midMeasurement = true;
 }
 
-#if defined(_WIN64)
-
 void ysBreakdownTimerChannel::EndMeasurement(uint64_t timestamp) {
     assert(m_midMeasurement);
 
-    double s = ysTimingSystem::Get()->ConvertToSeconds(timestamp - m_lastMeasurementStart);
+    // Timestamps come from ysProfiler::Now() and are in nanoseconds
+    double s = (timestamp - m_lastMeasurementStart) * 1E-9;
     RecordSample(s);
 
     m_midMeasurement = false;
 }
-
-#endif /* Windows */
@@ -711,13 +711,16 @@ ysError ysD3D10Device::UseIndexBuffer(ysGPUBuffer *buffer, int offset) {
 
     if (buffer) {
         UINT uoffset = (UINT) offset;
+        const DXGI_FORMAT format = (buffer->GetIndexSize() == 4)
+                                           ? DXGI_FORMAT_R32_UINT
+                                           : DXGI_FORMAT_R16_UINT;
 
         ysD3D10GPUBuffer *d3d10Buffer = static_cast<ysD3D10GPUBuffer *>(buffer);
 
         if (d3d10Buffer->m_bufferType == ysGPUBuffer::GPU_INDEX_BUFFER &&
             buffer != m_activeIndexBuffer) {
             GetDevice()->IASetIndexBuffer(d3d10Buffer->m_buffer,
-                                          DXGI_FORMAT_R16_UINT, uoffset);
+                                          format, uoffset);
         }
     } else {
         GetDevice()->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
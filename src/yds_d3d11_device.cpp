@@ -1204,13 +1204,16 @@ ysError ysD3D11Device::UseIndexBuffer(ysGPUBuffer *buffer, int offset) {
 
     if (buffer) {
         UINT uoffset = (UINT) offset;
+        const DXGI_FORMAT format = (buffer->GetIndexSize() == 4)
+                                           ? DXGI_FORMAT_R32_UINT
+                                           : DXGI_FORMAT_R16_UINT;
 
         ysD3D11GPUBuffer *d3d11Buffer = static_cast<ysD3D11GPUBuffer *>(buffer);
 
         if (d3d11Buffer->m_bufferType == ysGPUBuffer::GPU_INDEX_BUFFER &&
             buffer != m_activeIndexBuffer) {
             GetImmediateContext()->IASetIndexBuffer(
-                    d3d11Buffer->m_buffer, DXGI_FORMAT_R16_UINT, uoffset);
+                    d3d11Buffer->m_buffer, format, uoffset);
         }
     } else {
         GetImmediateContext()->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN,
@@ -5,6 +5,10 @@
 #include "../include/yds_opengl_device.h"
 #include "../include/yds_vulkan_device.h"
 
+#if !defined(_WIN64)
+    #include "safe_lib.h"
+#endif
+
 ysDevice::ysDevice() : ysContextObject("API_DEVICE", DeviceAPI::Unknown) {
     for (int i = 0; i < MaxRenderTargets; ++i) {
         m_activeRenderTarget[i] = nullptr;
@@ -463,6 +467,22 @@ ysError ysDevice::DestroyInputLayout(ysInputLayout *&layout) {
     return YDS_ERROR_RETURN(ysError::None);
 }
 
+ysError ysDevice::CreateTexture(ysTexture **texture, const wchar_t *fname,
+                                int width, int height,
+                                const unsigned char *pixels) {
+    YDS_ERROR_DECLARE("CreateTexture");
+
+    if (texture == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+    *texture = nullptr;
+
+    if (fname == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+
+    YDS_NESTED_ERROR_CALL(CreateTexture(texture, width, height, pixels));
+    wcscpy_s((*texture)->m_filename, ysTexture::MAX_FILENAME_LENGTH + 1, fname);
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
 ysError ysDevice::UseTexture(ysTexture *texture, int slot) {
     YDS_ERROR_DECLARE("UseTexture");
 
@@ -1,19 +1,54 @@
 #include "../include/yds_dynamic_allocator.h"
 
-ysDynamicAllocator::ysDynamicAllocator() : ysMemoryAllocator("DYN_ALLOCATOR") {
-    m_blockPool = NULL;
-    m_blocks = NULL;
+#include <string.h>
 
-    m_allocatorBlock = NULL;
+#if defined(_WIN64)
+    #include <intrin.h>
+#endif
 
-    m_nBlocks = 0;
+static_assert(sizeof(void *) + 2 * sizeof(uint32_t) <= ysDynamicAllocator::Alignment,
+    "Block header does not fit before the user data");
 
-    m_maxBlocks = 0;
-    m_maxSize = 0;
+namespace {
 
-    m_totalAllocation = 0;
+    // Index of the lowest/highest set bit, the value must not be 0
+    inline int LowestBit(uint32_t value) {
+    #if defined(_WIN64)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return (int)index;
+    #else
+        return __builtin_ctz(value);
+    #endif
+    }
 
+    inline int HighestBit(uint32_t value) {
+    #if defined(_WIN64)
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return (int)index;
+    #else
+        return 31 - __builtin_clz(value);
+    #endif
+    }
+
+} /* namespace */
+
+ysDynamicAllocator::ysDynamicAllocator() : ysMemoryAllocator("DYN_ALLOCATOR") {
     m_data = NULL;
+    m_firstBlock = NULL;
+
+    memset(m_freeLists, 0, sizeof(m_freeLists));
+    m_firstLevelMap = 0;
+    memset(m_secondLevelMap, 0, sizeof(m_secondLevelMap));
+
+    m_maxSize = 0;
+
+    m_totalAllocation = 0;
+    m_peakAllocation = 0;
+    m_freeSize = 0;
+    m_usedBlocks = 0;
+    m_freeBlocks = 0;
 
     m_parent = NULL;
 }
@@ -21,115 +56,81 @@ ysDynamicAllocator::ysDynamicAllocator() : ysMemoryAllocator("DYN_ALLOCATOR") {
 ysDynamicAllocator::~ysDynamicAllocator() {
 #define REMINDER "Call Destroy() before this point."
 
-    //RaiseError(m_blockPool == NULL, "Block pool still exists after destructor called.\n" REMINDER);
-    //RaiseError(m_blocks == NULL, "Blocks still exist after destructor is called.\n" REMINDER);
     //RaiseError(m_data == NULL, "Data buffer still exists after destructor is called.\n" REMINDER);
 
 #undef REMINDER
 }
 
 void ysDynamicAllocator::SetParent(ysMemoryAllocator *parent) {
-    //RaiseError(!(m_data || m_blocks || m_blockPool), "Allocator has active memory. Call Destroy() before changing the parent.");
-    //RaiseError(!(m_data || m_blocks || m_blockPool), "Allocator has active memory. Call Destroy() before changing the parent.");
+    //RaiseError(!m_data, "Allocator has active memory. Call Destroy() before changing the parent.");
 
     m_parent = parent;
 }
 
 void *ysDynamicAllocator::AllocateBlock(int size, int numObjects) {
-    // Size of total allocation with metadata pointer
-    unsigned int totalSize = size + sizeof(BlockLink *);
-
-    m_totalAllocation += totalSize;
+    if (m_firstBlock == NULL || size < 0) return 0;
 
-    // Get the current allocator block, or find a new one if this one is insufficient
-    BlockLink *freeBlock = m_allocatorBlock;
-    if (!freeBlock->Free || !freeBlock->Valid || freeBlock->Size < totalSize) freeBlock = UpdateAllocatorBlock();
-    if (!freeBlock || freeBlock->Size < totalSize) return 0;
+    // Size of total allocation with the block header
+    uint32_t totalSize = ((uint32_t)size + HeaderSize + Alignment - 1) & ~(uint32_t)(Alignment - 1);
+    if (totalSize < (uint32_t)MinimumBlockSize) totalSize = MinimumBlockSize;
 
-    void *allocatedData = (void *)((char *)freeBlock->Address + sizeof(BlockLink *));
-    BlockLink **metadataPointer = (BlockLink **)((char *)freeBlock->Address);
+    BlockHeader *block = FindFreeBlock(totalSize);
+    if (block == NULL) return 0;
 
-    if (freeBlock->Size == totalSize) {
-        freeBlock->Size = totalSize;
-        freeBlock->Free = 0;
-        freeBlock->NumObjects = numObjects;
+    RemoveFreeBlock(block);
 
-        *metadataPointer = freeBlock;
+    // Return what's left to the pool if it can hold a block of its own
+    const uint32_t blockSize = block->GetSize();
+    if (blockSize - totalSize >= (uint32_t)MinimumBlockSize) {
+        BlockHeader *remainder = (BlockHeader *)((char *)block + totalSize);
+        remainder->PreviousPhysical = block;
+        remainder->SizeAndFlags = (blockSize - totalSize) | 1u;
+        NextPhysical(remainder)->PreviousPhysical = remainder;
 
+        block->SizeAndFlags = totalSize;
+        InsertFreeBlock(remainder);
     }
     else {
-        BlockLink *usedBlock = AddBlock();
-        if (!usedBlock) return 0;
-
-        usedBlock->Address = freeBlock->Address;
-        usedBlock->Free = 0;
-        usedBlock->Size = totalSize;
-        usedBlock->NumObjects = numObjects;
-
-        usedBlock->Next = freeBlock;
-        usedBlock->Previous = freeBlock->Previous;
-
-        if (freeBlock->Previous) freeBlock->Previous->Next = usedBlock;
-        freeBlock->Previous = usedBlock;
-        freeBlock->Address = (void *)((char *)freeBlock->Address + totalSize);
-        freeBlock->Size -= totalSize;
-
-        *metadataPointer = usedBlock;
+        block->SizeAndFlags = blockSize;
     }
 
-    return allocatedData;
-}
-
-int ysDynamicAllocator::FreeBlock(void *block) {
-    BlockLink **metadataPointer = (BlockLink **)( (char *)block - sizeof(BlockLink *) );
-    BlockLink *metadata = *metadataPointer;
+    block->NumObjects = numObjects;
 
-    m_totalAllocation -= metadata->Size;
+    m_totalAllocation += block->GetSize();
+    if (m_totalAllocation > m_peakAllocation) m_peakAllocation = m_totalAllocation;
+    ++m_usedBlocks;
 
-    int nObjects = metadata->NumObjects;
-
-    metadata->Free = 1;
+    return (void *)((char *)block + HeaderSize);
+}
 
-    BlockLink *left, *right;
-    left = metadata->Previous;
-    right = metadata->Next;
+int ysDynamicAllocator::FreeBlock(void *data) {
+    BlockHeader *block = (BlockHeader *)((char *)data - HeaderSize);
 
-    bool leftMerge, rightMerge;
-    leftMerge = left && left->Free;
-    rightMerge = right && right->Free;
+    const int nObjects = block->NumObjects;
 
-    if (!leftMerge && rightMerge) {
-        if (left) left->Next = right;
-        right->Previous = left;
+    m_totalAllocation -= block->GetSize();
+    --m_usedBlocks;
 
-        right->Address = ((char *)right->Address - metadata->Size);
-        right->Size += metadata->Size;
+    uint32_t size = block->GetSize();
 
-        if (right->Size > m_allocatorBlock->Size) m_allocatorBlock = right;
+    BlockHeader *left = block->PreviousPhysical;
+    if (left != NULL && left->IsFree()) {
+        RemoveFreeBlock(left);
 
-        RemoveBlock(metadata->Index);
+        size += left->GetSize();
+        block = left;
     }
 
-    if (leftMerge && !rightMerge) {
-        if (right) right->Previous = left;
-        left->Next = right;
-
-        left->Size += metadata->Size;
-
-        if (left->Size > m_allocatorBlock->Size) m_allocatorBlock = left;
-
-        RemoveBlock(metadata->Index);
+    BlockHeader *right = (BlockHeader *)((char *)block + size);
+    if (right->IsFree()) {
+        RemoveFreeBlock(right);
+        size += right->GetSize();
     }
-    else if (leftMerge && rightMerge) {
-        if (right->Next) right->Next->Previous = left;
-        left->Next = right->Next;
 
-        left->Size += metadata->Size + right->Size;
-        if (left->Size > m_allocatorBlock->Size) m_allocatorBlock = left;
+    block->SizeAndFlags = size | 1u;
+    NextPhysical(block)->PreviousPhysical = block;
 
-        RemoveBlock(metadata->Index);
-        RemoveBlock(right->Index);
-    }
+    InsertFreeBlock(block);
 
     return nObjects;
 }
@@ -150,114 +151,199 @@ void ysDynamicAllocator::CreateBuffer(int size) {
     // To make the buffer easier to see while debugging
     memset(m_data, 0, size);
 #endif
-}
 
-void ysDynamicAllocator::CreateBlocks(int maxBlocks) {
-    if (!m_parent) {
-        m_blockPool = new BlockLink[maxBlocks];
-        m_blocks = new BlockLink *[maxBlocks];
-    }
-    else {
-        m_blockPool = m_parent->Allocate<BlockLink>(maxBlocks);
-        m_blocks = m_parent->Allocate<BlockLink *>(maxBlocks);
+    memset(m_freeLists, 0, sizeof(m_freeLists));
+    m_firstLevelMap = 0;
+    memset(m_secondLevelMap, 0, sizeof(m_secondLevelMap));
+
+    m_totalAllocation = 0;
+    m_peakAllocation = 0;
+    m_freeSize = 0;
+    m_usedBlocks = 0;
+    m_freeBlocks = 0;
+
+    // One free block spanning the buffer, followed by an empty used block so
+    // that the last block has a right neighbour
+    const uintptr_t start = ((uintptr_t)m_data + Alignment - 1) & ~(uintptr_t)(Alignment - 1);
+    const uintptr_t end = ((uintptr_t)m_data + size) & ~(uintptr_t)(Alignment - 1);
+
+    if (m_data == NULL || end < start + MinimumBlockSize + HeaderSize) {
+        m_firstBlock = NULL;
+        return;
     }
 
-    m_maxBlocks = maxBlocks;
-    m_nBlocks = 0;
+    const uint32_t blockSize = (uint32_t)(end - start) - HeaderSize;
 
-    for(int i = 0; i < maxBlocks; i++) {
-        m_blocks[i] = &m_blockPool[i];
+    m_firstBlock = (BlockHeader *)start;
+    m_firstBlock->PreviousPhysical = NULL;
+    m_firstBlock->SizeAndFlags = blockSize | 1u;
 
-        m_blocks[i]->Address = 0;
-        m_blocks[i]->Free = 1;
-        m_blocks[i]->Index = i;
-        m_blocks[i]->Next = 0;
-        m_blocks[i]->Previous = 0;
-        m_blocks[i]->Size = 0;
-        m_blocks[i]->Valid = 0;
-        m_blocks[i]->NumObjects = 0;
-    }
+    BlockHeader *sentinel = NextPhysical(m_firstBlock);
+    sentinel->PreviousPhysical = m_firstBlock;
+    sentinel->SizeAndFlags = 0;
+    sentinel->NumObjects = 0;
 
-    BlockLink *initialBlock = AddBlock();
-    initialBlock->Free = 1;
-    initialBlock->Address = m_data;
-    initialBlock->Size = m_maxSize;
+    InsertFreeBlock(m_firstBlock);
+}
 
-    m_allocatorBlock = initialBlock;
+void ysDynamicAllocator::CreateBlocks(int maxBlocks) {
+    (void)maxBlocks;
 }
 
 void ysDynamicAllocator::Destroy() {
     if (!m_parent) {
-        delete [] m_data;
-        delete [] m_blockPool;
-        delete[] m_blocks;
+        delete [] (char *)m_data;
     }
-    else {
+    else if (m_data != NULL) {
         m_parent->FreeBlock(m_data);
-        m_parent->Free(m_blockPool);
-        m_parent->Free(m_blocks);
     }
 
     m_data = NULL;
-    m_blockPool = NULL;
-    m_blocks = NULL;
+    m_firstBlock = NULL;
 }
 
-// Block Creation/Destruction
+void ysDynamicAllocator::GetStatistics(Statistics *stats) const {
+    stats->TotalSize = m_maxSize;
+    stats->UsedSize = m_totalAllocation;
+    stats->PeakUsedSize = m_peakAllocation;
+    stats->FreeSize = m_freeSize;
+    stats->UsedBlocks = m_usedBlocks;
+    stats->FreeBlocks = m_freeBlocks;
+    stats->LargestFreeBlock = 0;
+
+    // The largest block is in the highest non-empty list
+    if (m_firstLevelMap != 0) {
+        const int fl = HighestBit(m_firstLevelMap);
+        const int sl = HighestBit(m_secondLevelMap[fl]);
+
+        for (BlockHeader *block = m_freeLists[fl][sl]; block != NULL; block = block->NextFree) {
+            const int blockSize = (int)block->GetSize() - HeaderSize;
+            if (blockSize > stats->LargestFreeBlock) stats->LargestFreeBlock = blockSize;
+        }
+    }
+
+    const int usableFree = m_freeSize - m_freeBlocks * HeaderSize;
+    stats->Fragmentation = (usableFree > 0)
+        ? 1.0f - (float)stats->LargestFreeBlock / usableFree
+        : 0.0f;
+}
+
+void ysDynamicAllocator::MapSize(uint32_t size, int *firstLevel, int *secondLevel) {
+    if (size < (uint32_t)SmallBlockSize) {
+        *firstLevel = 0;
+        *secondLevel = (int)(size / Alignment);
+    }
+    else {
+        const int f = HighestBit(size);
+        *firstLevel = f - (FirstLevelShift - 1);
+        *secondLevel = (int)((size >> (f - SecondLevelBits)) ^ (1u << SecondLevelBits));
+    }
+}
+
+ysDynamicAllocator::BlockHeader *ysDynamicAllocator::FindFreeBlock(uint32_t size) {
+    // Round up to the next list so that any block in it is large enough
+    if (size >= (uint32_t)SmallBlockSize) {
+        const uint32_t round = (1u << (HighestBit(size) - SecondLevelBits)) - 1;
+        if (size + round < size) return NULL;
+
+        size += round;
+    }
 
-void ysDynamicAllocator::RemoveBlock(BlockIndex index) {
-    BlockLink *temp = m_blocks[index];
-    m_blocks[index] = m_blocks[m_nBlocks - 1];
-    m_blocks[index]->Index = index;
+    int fl, sl;
+    MapSize(size, &fl, &sl);
+    if (fl >= FirstLevelCount) return NULL;
 
-    m_blocks[m_nBlocks - 1] = temp;
-    m_blocks[m_nBlocks - 1]->Index = m_nBlocks - 1;
-    m_blocks[m_nBlocks - 1]->Valid = 0;
+    uint32_t secondLevelMap = m_secondLevelMap[fl] & (~0u << sl);
+    if (secondLevelMap == 0) {
+        const uint32_t firstLevelMap = (fl + 1 < 32) ? m_firstLevelMap & (~0u << (fl + 1)) : 0;
+        if (firstLevelMap == 0) return NULL;
 
-    m_nBlocks--;
+        fl = LowestBit(firstLevelMap);
+        secondLevelMap = m_secondLevelMap[fl];
+    }
+
+    sl = LowestBit(secondLevelMap);
+    return m_freeLists[fl][sl];
+}
+
+void ysDynamicAllocator::InsertFreeBlock(BlockHeader *block) {
+    int fl, sl;
+    MapSize(block->GetSize(), &fl, &sl);
+
+    BlockHeader *head = m_freeLists[fl][sl];
+    block->NextFree = head;
+    block->PreviousFree = NULL;
+    if (head != NULL) head->PreviousFree = block;
+
+    m_freeLists[fl][sl] = block;
+    m_firstLevelMap |= 1u << fl;
+    m_secondLevelMap[fl] |= 1u << sl;
+
+    m_freeSize += block->GetSize();
+    ++m_freeBlocks;
 }
 
-BlockLink *ysDynamicAllocator::UpdateAllocatorBlock() {
-    int index = -1;
-    unsigned int maxSize = m_allocatorBlock->Size;
+void ysDynamicAllocator::RemoveFreeBlock(BlockHeader *block) {
+    int fl, sl;
+    MapSize(block->GetSize(), &fl, &sl);
 
-    int n = 0;
-    for(int i=0; i < m_maxBlocks; i++) {
-        if (m_blockPool[i].Valid) {
-            if (n >= m_nBlocks) return 0;
+    if (block->NextFree != NULL) block->NextFree->PreviousFree = block->PreviousFree;
+    if (block->PreviousFree != NULL) block->PreviousFree->NextFree = block->NextFree;
 
-            if (m_blockPool[i].Free && m_blockPool[i].Size > maxSize) {
-                index = i;
-                maxSize = m_blockPool[i].Size;
-            }
+    if (m_freeLists[fl][sl] == block) {
+        m_freeLists[fl][sl] = block->NextFree;
 
-            n++;
+        if (m_freeLists[fl][sl] == NULL) {
+            m_secondLevelMap[fl] &= ~(1u << sl);
+            if (m_secondLevelMap[fl] == 0) m_firstLevelMap &= ~(1u << fl);
         }
     }
 
-    if (index < 0 ) return 0;
-    else return &m_blockPool[index];
+    m_freeSize -= block->GetSize();
+    --m_freeBlocks;
 }
 
 // Error Checking
 
 bool ysDynamicAllocator::CheckValid() {
-    int totalSize=0;
-        
-    for(int i=0; i < m_nBlocks; i++) {
-        totalSize += m_blocks[i]->Size;
-    }
+    if (m_firstBlock == NULL) return true;
 
-    if (totalSize != m_maxSize) {
-        return false;
-    }
+    int totalSize = 0;
+    int freeSize = 0;
+    int freeBlocks = 0;
+    int usedBlocks = 0;
+
+    BlockHeader *previous = NULL;
+    for (BlockHeader *block = m_firstBlock; block->GetSize() != 0; block = NextPhysical(block)) {
+        if (block->PreviousPhysical != previous) return false;
+        if (((uintptr_t)block & (Alignment - 1)) != 0) return false;
+        if (block->GetSize() < (uint32_t)MinimumBlockSize) return false;
+
+        // Free neighbours must have been merged
+        if (block->IsFree() && previous != NULL && previous->IsFree()) return false;
+
+        if (block->IsFree()) {
+            int fl, sl;
+            MapSize(block->GetSize(), &fl, &sl);
+            if ((m_secondLevelMap[fl] & (1u << sl)) == 0) return false;
 
-    for(int i=0; i < m_nBlocks; i++) {
-        if (((char *)m_blocks[i]->Address + m_blocks[i]->Size) - (char *)m_data > m_maxSize) {
-            return false;
+            freeSize += block->GetSize();
+            ++freeBlocks;
         }
+        else {
+            ++usedBlocks;
+        }
+
+        totalSize += block->GetSize();
+        if ((char *)block + block->GetSize() > (char *)m_data + m_maxSize) return false;
+
+        previous = block;
     }
 
+    if (totalSize != m_totalAllocation + m_freeSize) return false;
+    if (freeSize != m_freeSize || freeBlocks != m_freeBlocks) return false;
+    if (usedBlocks != m_usedBlocks) return false;
+
     return true;
 }
 
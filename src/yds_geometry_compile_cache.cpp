@@ -0,0 +1,271 @@
+#include "../include/yds_geometry_compile_cache.h"
+
+#include "../include/yds_mapped_file.h"
+
+#include <fstream>
+#include <string.h>
+
+namespace {
+
+    struct CacheFileHeader {
+        uint32_t Magic;
+        int Version;
+        int EntryCount;
+    };
+
+    template <typename T>
+    bool ReadArray(const char **cursor, const char *end, int count, std::vector<T> *output) {
+        if (count < 0 || (size_t)(end - *cursor) / sizeof(T) < (size_t)count) return false;
+
+        output->resize(count);
+        if (count > 0) memcpy(output->data(), *cursor, sizeof(T) * count);
+        *cursor += sizeof(T) * count;
+
+        return true;
+    }
+
+    template <typename T>
+    void WriteArray(std::ofstream &file, const std::vector<T> &values) {
+        if (!values.empty()) file.write((const char *)values.data(), sizeof(T) * values.size());
+    }
+
+} /* namespace */
+
+void ysGeometryCompileCache::Hasher::Add(const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        m_hash ^= bytes[i];
+        m_hash *= 1099511628211ull;
+    }
+}
+
+void ysGeometryCompileCache::Hasher::Add(const char *s) {
+    // Include the terminator so that "ab", "c" and "a", "bc" differ
+    Add(s, strlen(s) + 1);
+}
+
+ysGeometryCompileCache::ysGeometryCompileCache() : ysObject("GEOMETRY_COMPILE_CACHE") {
+    m_hits = 0;
+    m_misses = 0;
+}
+
+ysGeometryCompileCache::~ysGeometryCompileCache() {
+    /* void */
+}
+
+ysError ysGeometryCompileCache::Load(const wchar_t *fname) {
+    YDS_ERROR_DECLARE("Load");
+
+    Clear();
+
+    ysMappedFile file;
+    if (file.Open(fname) != ysError::None) {
+        // Nothing has been cached yet
+        return YDS_ERROR_RETURN(ysError::None);
+    }
+
+    const char *cursor = file.GetData();
+    const char *end = cursor + file.GetSize();
+
+    CacheFileHeader header;
+    if (file.GetSize() < sizeof(CacheFileHeader)) return YDS_ERROR_RETURN(ysError::None);
+    memcpy(&header, cursor, sizeof(CacheFileHeader));
+    cursor += sizeof(CacheFileHeader);
+
+    if (header.Magic != CacheFileMagic || header.Version != CacheFileVersion) {
+        return YDS_ERROR_RETURN(ysError::None);
+    }
+
+    for (int i = 0; i < header.EntryCount; ++i) {
+        EntryHeader entryHeader;
+        if ((size_t)(end - cursor) < sizeof(EntryHeader)) break;
+        memcpy(&entryHeader, cursor, sizeof(EntryHeader));
+        cursor += sizeof(EntryHeader);
+
+        Entry entry;
+        entry.Object.Header = entryHeader.Header;
+        entry.Used = false;
+
+        if (!ReadArray(&cursor, end, entryHeader.VertexDataSize, &entry.Object.VertexData) ||
+            !ReadArray(&cursor, end, entryHeader.IndexCount, &entry.Object.Indices) ||
+            !ReadArray(&cursor, end, entryHeader.BoneMapSize, &entry.Object.BoneMap) ||
+            !ReadArray(&cursor, end, entryHeader.ExtraDataSize, &entry.Object.ExtraData))
+        {
+            // Truncated file, keep what was read so far
+            break;
+        }
+
+        m_entries[entryHeader.EntryKey] = std::move(entry);
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError ysGeometryCompileCache::Save(const wchar_t *fname) {
+    YDS_ERROR_DECLARE("Save");
+
+    std::ofstream file(fname, std::ios::binary);
+    if (!file.is_open()) return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+
+    CacheFileHeader header;
+    header.Magic = CacheFileMagic;
+    header.Version = CacheFileVersion;
+    header.EntryCount = 0;
+    for (const auto &entry : m_entries) {
+        if (entry.second.Used) ++header.EntryCount;
+    }
+
+    file.write((const char *)&header, sizeof(CacheFileHeader));
+
+    for (const auto &entry : m_entries) {
+        if (!entry.second.Used) continue;
+
+        const ysGeometryExportFile::CompiledObject &object = entry.second.Object;
+
+        EntryHeader entryHeader;
+        memset(&entryHeader, 0, sizeof(EntryHeader));
+        entryHeader.EntryKey = entry.first;
+        entryHeader.Header = object.Header;
+        entryHeader.VertexDataSize = (int)object.VertexData.size();
+        entryHeader.IndexCount = (int)object.Indices.size();
+        entryHeader.BoneMapSize = (int)object.BoneMap.size();
+        entryHeader.ExtraDataSize = (int)object.ExtraData.size();
+
+        file.write((const char *)&entryHeader, sizeof(EntryHeader));
+        WriteArray(file, object.VertexData);
+        WriteArray(file, object.Indices);
+        WriteArray(file, object.BoneMap);
+        WriteArray(file, object.ExtraData);
+    }
+
+    if (!file.good()) return YDS_ERROR_RETURN(ysError::CouldNotWriteFile);
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+void ysGeometryCompileCache::Clear() {
+    m_entries.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+bool ysGeometryCompileCache::Find(Key key, ysGeometryExportFile::CompiledObject *object) {
+    auto entry = m_entries.find(key);
+    if (entry == m_entries.end()) {
+        ++m_misses;
+        return false;
+    }
+
+    ++m_hits;
+    entry->second.Used = true;
+    *object = entry->second.Object;
+
+    return true;
+}
+
+void ysGeometryCompileCache::Store(Key key, const ysGeometryExportFile::CompiledObject &object) {
+    Entry &entry = m_entries[key];
+    entry.Object = object;
+    entry.Used = true;
+}
+
+void ysGeometryCompileCache::HashObject(ysObjectData *object, Hasher *hasher) {
+    hasher->Add(object->m_name);
+    hasher->Add(object->m_materialName);
+
+    hasher->AddValue(object->m_objectInformation.ModelIndex);
+    hasher->AddValue(object->m_objectInformation.ParentIndex);
+    hasher->AddValue(object->m_objectInformation.ParentInstance);
+    hasher->AddValue(object->m_objectInformation.ObjectType);
+    hasher->AddValue(object->m_objectInformation.UsesBones);
+    hasher->AddValue(object->m_objectInformation.SkeletonIndex);
+
+    hasher->AddValue(object->m_objectTransformation.Position);
+    hasher->AddValue(object->m_objectTransformation.OrientationEuler);
+    hasher->AddValue(object->m_objectTransformation.Orientation);
+    hasher->AddValue(object->m_objectTransformation.Scale);
+
+    hasher->AddValue(object->m_objectStatistics.NumUVChannels);
+    hasher->AddValue(object->m_objectStatistics.NumVertices);
+    hasher->AddValue(object->m_objectStatistics.NumFaces);
+
+    hasher->AddArray(object->m_vertices.GetBuffer(), object->m_vertices.GetNumObjects());
+    hasher->AddArray(object->m_materialList.GetBuffer(), object->m_materialList.GetNumObjects());
+
+    hasher->AddValue(object->m_boneWeights.GetNumObjects());
+    for (int i = 0; i < object->m_boneWeights.GetNumObjects(); ++i) {
+        ysObjectData::BoneWeights &weights = object->m_boneWeights[i];
+        hasher->AddArray(weights.m_boneIndices.GetBuffer(), weights.m_boneIndices.GetNumObjects());
+        hasher->AddArray(weights.m_boneWeights.GetBuffer(), weights.m_boneWeights.GetNumObjects());
+    }
+
+    hasher->AddValue(object->m_channels.GetNumObjects());
+    for (int i = 0; i < object->m_channels.GetNumObjects(); ++i) {
+        ysExpandingArray<ysVector2> &coordinates = object->m_channels[i].m_coordinates;
+        hasher->AddArray(coordinates.GetBuffer(), coordinates.GetNumObjects());
+    }
+
+    hasher->AddArray(object->m_vertexIndexSet.GetBuffer(), object->m_vertexIndexSet.GetNumObjects());
+    hasher->AddArray(object->m_smoothingGroups.GetBuffer(), object->m_smoothingGroups.GetNumObjects());
+    hasher->AddArray(
+        object->m_extendedSmoothingGroups.GetBuffer(), object->m_extendedSmoothingGroups.GetNumObjects());
+    hasher->AddValue(object->m_numExtendedSmoothingGroups);
+
+    hasher->AddValue(object->m_UVIndexSets.GetNumObjects());
+    for (int i = 0; i < object->m_UVIndexSets.GetNumObjects(); ++i) {
+        ysExpandingArray<ysObjectData::IndexSet> &indices = object->m_UVIndexSets[i].UVIndexSets;
+        hasher->AddArray(indices.GetBuffer(), indices.GetNumObjects());
+    }
+
+    hasher->AddArray(object->m_boneIndices.GetBuffer(), object->m_boneIndices.GetNumObjects());
+
+    hasher->AddValue(object->m_flipNormals);
+    hasher->AddValue(object->m_width);
+    hasher->AddValue(object->m_height);
+    hasher->AddValue(object->m_length);
+}
+
+void ysGeometryCompileCache::HashObject(const ysInterchangeObject &object, Hasher *hasher) {
+    hasher->Add(object.Name.c_str());
+    hasher->Add(object.MaterialName.c_str());
+
+    hasher->AddValue(object.Type);
+    hasher->AddValue(object.ModelIndex);
+    hasher->AddValue(object.ParentIndex);
+    hasher->AddValue(object.InstanceIndex);
+
+    hasher->AddValue(object.Length);
+    hasher->AddValue(object.Width);
+
+    hasher->AddValue(object.Position);
+    hasher->AddValue(object.OrientationEuler);
+    hasher->AddValue(object.Orientation);
+    hasher->AddValue(object.Scale);
+
+    hasher->AddArray(object.Vertices.data(), (int)object.Vertices.size());
+    hasher->AddArray(object.Normals.data(), (int)object.Normals.size());
+    hasher->AddArray(object.Tangents.data(), (int)object.Tangents.size());
+
+    hasher->AddValue((int)object.UVChannels.size());
+    for (const ysInterchangeObject::UVChannel &channel : object.UVChannels) {
+        hasher->AddArray(channel.Coordinates.data(), (int)channel.Coordinates.size());
+    }
+
+    hasher->AddArray(object.VertexIndices.data(), (int)object.VertexIndices.size());
+    hasher->AddArray(object.NormalIndices.data(), (int)object.NormalIndices.size());
+    hasher->AddArray(object.TangentIndices.data(), (int)object.TangentIndices.size());
+
+    hasher->AddValue((int)object.UVIndices.size());
+    for (const std::vector<ysInterchangeObject::IndexSet> &indices : object.UVIndices) {
+        hasher->AddArray(indices.data(), (int)indices.size());
+    }
+
+    const ysInterchangeObject::Light &light = object.LightInformation;
+    hasher->AddValue(light.LightType);
+    hasher->AddValue(light.Intensity);
+    hasher->AddValue(light.CutoffDistance);
+    hasher->AddValue(light.Distance);
+    hasher->AddValue(light.Color);
+    hasher->AddValue(light.SpotAngularSize);
+    hasher->AddValue(light.SpotFade);
+}
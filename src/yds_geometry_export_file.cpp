@@ -8,7 +8,7 @@
 #endif
 
 ysGeometryExportFile::ysGeometryExportFile() : ysObject("ysGeometryExportFile") {
-    /* void */
+    m_maxVertexCount = 0;
 }
 
 ysGeometryExportFile::~ysGeometryExportFile() {
@@ -491,3 +491,242 @@ ysError ysGeometryExportFile::WriteObject(ysInterchangeObject *object, const Ver
 
     return YDS_ERROR_RETURN(ysError::None);
 }
+
+ysError ysGeometryExportFile::AddSceneObject(ysObjectData *object) {
+    YDS_ERROR_DECLARE("AddSceneObject");
+
+    CompiledObject compiled;
+    YDS_NESTED_ERROR_CALL(CompileObject(object, &compiled));
+    YDS_NESTED_ERROR_CALL(AddSceneObject(compiled));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError ysGeometryExportFile::AddSceneObject(ysInterchangeObject *object, const VertexInfo *info) {
+    YDS_ERROR_DECLARE("AddSceneObject");
+
+    CompiledObject compiled;
+    YDS_NESTED_ERROR_CALL(CompileObject(object, info, &compiled));
+    YDS_NESTED_ERROR_CALL(AddSceneObject(compiled));
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError ysGeometryExportFile::AddSceneObject(const CompiledObject &object) {
+    YDS_ERROR_DECLARE("AddSceneObject");
+
+    if ((int)object.VertexData.size() != object.Header.VertexDataSize) {
+        return YDS_ERROR_RETURN(ysError::InvalidParameter);
+    }
+
+    SceneObjectEntry *entry = NewSceneObject(
+        object.Header, object.VertexData.empty() ? nullptr : object.VertexData.data());
+
+    m_indices.insert(m_indices.end(), object.Indices.begin(), object.Indices.end());
+    m_boneMaps.insert(m_boneMaps.end(), object.BoneMap.begin(), object.BoneMap.end());
+
+    if (!object.ExtraData.empty()) {
+        AddExtraData(entry, object.ExtraData.data(), (int)object.ExtraData.size());
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError ysGeometryExportFile::CompileObject(ysObjectData *object, CompiledObject *output) {
+    YDS_ERROR_DECLARE("CompileObject");
+
+    if (object == nullptr || output == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+
+    FillOutputHeader(object, &output->Header);
+    output->VertexData.clear();
+    output->Indices.clear();
+    output->BoneMap.clear();
+    output->ExtraData.clear();
+
+    if (object->m_objectInformation.ObjectType == ysObjectData::ObjectType::Geometry) {
+        void *vertexData = nullptr;
+        output->Header.VertexDataSize = PackVertexData(object, 4 /* TEMP */, &vertexData);
+        output->VertexData.assign(
+            (const char *)vertexData, (const char *)vertexData + output->Header.VertexDataSize);
+        free(vertexData);
+
+        for (int i = 0; i < object->m_objectStatistics.NumFaces; ++i) {
+            for (int facevert = 0; facevert < 3; ++facevert) {
+                output->Indices.push_back((uint32_t)object->m_vertexIndexSet[i].indices[facevert]);
+            }
+        }
+
+        for (int i = 0; i < object->m_boneIndices.GetNumObjects(); ++i) {
+            output->BoneMap.push_back(object->m_boneIndices[i]);
+        }
+    }
+    else if (object->m_objectInformation.ObjectType == ysObjectData::ObjectType::Plane) {
+        const float dimensions[] = { object->m_length, object->m_width };
+        output->ExtraData.assign((const char *)dimensions, (const char *)dimensions + sizeof(dimensions));
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysError ysGeometryExportFile::CompileObject(
+    ysInterchangeObject *object, const VertexInfo *info, CompiledObject *output)
+{
+    YDS_ERROR_DECLARE("CompileObject");
+
+    if (object == nullptr || output == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+
+    VertexInfo defaultInfo;
+    if (info == nullptr) {
+        info = &defaultInfo;
+    }
+
+    FillOutputHeader(object, info, &output->Header);
+    output->VertexData.clear();
+    output->Indices.clear();
+    output->BoneMap.clear();
+    output->ExtraData.clear();
+
+    if (object->Type == ysInterchangeObject::ObjectType::Geometry) {
+        void *vertexData = nullptr;
+        output->Header.VertexDataSize = PackVertexData(object, 4 /* TEMP */, &vertexData, info);
+        output->VertexData.assign(
+            (const char *)vertexData, (const char *)vertexData + output->Header.VertexDataSize);
+        free(vertexData);
+
+        for (size_t i = 0; i < object->VertexIndices.size(); ++i) {
+            for (int facevert = 0; facevert < 3; ++facevert) {
+                output->Indices.push_back((uint32_t)object->VertexIndices[i].indices[facevert]);
+            }
+        }
+    }
+    else if (object->Type == ysInterchangeObject::ObjectType::Plane) {
+        const float dimensions[] = { object->Length, object->Width };
+        output->ExtraData.assign((const char *)dimensions, (const char *)dimensions + sizeof(dimensions));
+    }
+    else if (object->Type == ysInterchangeObject::ObjectType::Light) {
+        output->ExtraData.assign(
+            (const char *)&object->LightInformation,
+            (const char *)&object->LightInformation + sizeof(ysInterchangeObject::Light));
+    }
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+ysGeometryExportFile::SceneObjectEntry *ysGeometryExportFile::NewSceneObject(
+    const ObjectOutputHeader &header, const void *vertexData)
+{
+    SceneObjectEntry entry;
+    memset(&entry, 0, sizeof(SceneObjectEntry));
+
+    entry.Header = header;
+    entry.IndexOffset = (int)m_indices.size();
+    entry.BoneMapOffset = (int)m_boneMaps.size();
+    entry.ExtraDataOffset = -1;
+    entry.ExtraDataSize = 0;
+
+    if (vertexData != nullptr && header.NumVertices > 0) {
+        // Vertices are addressed by base vertex, so each mesh has to start
+        // on a multiple of its own vertex size
+        const int stride = header.VertexDataSize / header.NumVertices;
+        const size_t misalignment = m_vertexData.size() % stride;
+        if (misalignment != 0) m_vertexData.resize(m_vertexData.size() + stride - misalignment, 0);
+
+        entry.VertexOffset = (int)m_vertexData.size();
+        m_vertexData.insert(
+            m_vertexData.end(),
+            (const char *)vertexData,
+            (const char *)vertexData + header.VertexDataSize);
+
+        if (header.NumVertices > m_maxVertexCount) m_maxVertexCount = header.NumVertices;
+    }
+
+    m_sceneObjects.push_back(entry);
+    return &m_sceneObjects.back();
+}
+
+void ysGeometryExportFile::AddExtraData(SceneObjectEntry *entry, const void *data, int size) {
+    entry->ExtraDataOffset = (int)m_extraData.size();
+    entry->ExtraDataSize = size;
+
+    m_extraData.insert(m_extraData.end(), (const char *)data, (const char *)data + size);
+}
+
+void ysGeometryExportFile::WritePadding() {
+    static const char zeros[SectionAlignment] = { 0 };
+
+    const int position = (int)((uint64_t)m_file.tellp() % SectionAlignment);
+    if (position != 0) m_file.write(zeros, SectionAlignment - position);
+}
+
+ysError ysGeometryExportFile::WriteScene() {
+    YDS_ERROR_DECLARE("WriteScene");
+
+    if (!m_file.is_open()) return YDS_ERROR_RETURN(ysError::NoFile);
+
+    SceneFileHeader header;
+    memset(&header, 0, sizeof(SceneFileHeader));
+
+    header.Magic = SceneFileMagic;
+    header.Version = SceneFileVersion;
+    header.ObjectCount = (int)m_sceneObjects.size();
+    header.IndexSize = (m_maxVertexCount > 0xFFFF + 1) ? 4 : 2;
+
+    const uint64_t start = (uint64_t)m_file.tellp();
+    m_file.write((char *)&header, sizeof(SceneFileHeader));
+
+    WritePadding();
+    header.ObjectTableOffset = (uint64_t)m_file.tellp() - start;
+    if (!m_sceneObjects.empty()) {
+        m_file.write((char *)m_sceneObjects.data(), sizeof(SceneObjectEntry) * m_sceneObjects.size());
+    }
+
+    WritePadding();
+    header.BoneMapOffset = (uint64_t)m_file.tellp() - start;
+    if (!m_boneMaps.empty()) {
+        m_file.write((char *)m_boneMaps.data(), sizeof(int) * m_boneMaps.size());
+    }
+
+    WritePadding();
+    header.ExtraDataOffset = (uint64_t)m_file.tellp() - start;
+    if (!m_extraData.empty()) {
+        m_file.write(m_extraData.data(), m_extraData.size());
+    }
+
+    WritePadding();
+    header.VertexDataOffset = (uint64_t)m_file.tellp() - start;
+    header.VertexDataSize = m_vertexData.size();
+    if (!m_vertexData.empty()) {
+        m_file.write(m_vertexData.data(), m_vertexData.size());
+    }
+
+    WritePadding();
+    header.IndexDataOffset = (uint64_t)m_file.tellp() - start;
+    header.IndexDataSize = m_indices.size() * header.IndexSize;
+    if (header.IndexSize == 4) {
+        if (!m_indices.empty()) {
+            m_file.write((char *)m_indices.data(), sizeof(uint32_t) * m_indices.size());
+        }
+    }
+    else {
+        std::vector<unsigned short> reduced(m_indices.begin(), m_indices.end());
+        if (!reduced.empty()) {
+            m_file.write((char *)reduced.data(), sizeof(unsigned short) * reduced.size());
+        }
+    }
+
+    // Fill in the section offsets now that they are known
+    m_file.seekp(start);
+    m_file.write((char *)&header, sizeof(SceneFileHeader));
+    m_file.seekp(0, std::ios::end);
+
+    if (!m_file.good()) return YDS_ERROR_RETURN(ysError::CouldNotWriteFile);
+
+    m_sceneObjects.clear();
+    m_boneMaps.clear();
+    m_extraData.clear();
+    m_vertexData.clear();
+    m_indices.clear();
+    m_maxVertexCount = 0;
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
@@ -1,10 +1,128 @@
 #include "../include/yds_geometry_preprocessing.h"
 
+#include "../include/yds_allocator.h"
+
+#include <algorithm>
 #include <limits>
 #include <stdlib.h>
 #include <memory>
 #include <assert.h>
 #include <float.h>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    ysVector *AllocateVectors(int count) {
+        return (ysVector *)ysAllocator::Allocate(sizeof(ysVector) * std::max(count, 1), 16);
+    }
+
+    // --
+    // Faces that use each vertex, in face order. A face that uses a
+    // vertex more than once is listed once per use.
+    // --
+    class VertexFaces {
+    public:
+        void Build(ysObjectData *object) {
+            const int vertexCount = object->m_objectStatistics.NumVertices;
+            const int faceCount = object->m_objectStatistics.NumFaces;
+
+            m_offsets.assign(vertexCount + 1, 0);
+            for (int face = 0; face < faceCount; face++) {
+                for (int facevert = 0; facevert < 3; facevert++) {
+                    m_offsets[object->m_vertexIndexSet[face].indices[facevert] + 1]++;
+                }
+            }
+
+            for (int vert = 0; vert < vertexCount; vert++) {
+                m_offsets[vert + 1] += m_offsets[vert];
+            }
+
+            std::vector<int> next(m_offsets.begin(), m_offsets.end() - 1);
+            m_faces.resize(faceCount * 3);
+            for (int face = 0; face < faceCount; face++) {
+                for (int facevert = 0; facevert < 3; facevert++) {
+                    m_faces[next[object->m_vertexIndexSet[face].indices[facevert]]++] = face;
+                }
+            }
+        }
+
+        int GetCount(int vert) const { return m_offsets[vert + 1] - m_offsets[vert]; }
+        const int *GetFaces(int vert) const { return m_faces.data() + m_offsets[vert]; }
+
+    protected:
+        std::vector<int> m_offsets;
+        std::vector<int> m_faces;
+    };
+
+    // --
+    // Union-find over the faces around one vertex. The root of each
+    // set is its lowest index, so sets are ordered by first appearance.
+    // --
+    class FaceSets {
+    public:
+        void Reset(int count) {
+            m_parent.resize(count);
+            for (int i = 0; i < count; i++) m_parent[i] = i;
+        }
+
+        int Find(int i) {
+            while (m_parent[i] != i) {
+                m_parent[i] = m_parent[m_parent[i]];
+                i = m_parent[i];
+            }
+
+            return i;
+        }
+
+        void Union(int a, int b) {
+            a = Find(a);
+            b = Find(b);
+
+            if (a < b) m_parent[b] = a;
+            else if (b < a) m_parent[a] = b;
+        }
+
+    protected:
+        std::vector<int> m_parent;
+    };
+
+    // Join faces whose keys are equal
+    void UnionEqualKeys(std::vector<std::pair<int, int>> &keys, FaceSets *sets) {
+        std::sort(keys.begin(), keys.end());
+        for (size_t i = 1; i < keys.size(); i++) {
+            if (keys[i].first == keys[i - 1].first) sets->Union(keys[i].second, keys[i - 1].second);
+        }
+    }
+
+    // --
+    // Give every set of faces around the vertex except the first its own
+    // copy of the vertex.
+    // --
+    void SplitVertex(ysObjectData *object, int vert, const int *faces, int count, FaceSets *sets, std::vector<int> &copies) {
+        copies.assign(count, -1);
+
+        for (int i = 0; i < count; i++) {
+            const int root = sets->Find(i);
+            if (root == 0) continue;
+
+            if (copies[root] == -1) {
+                copies[root] = ysGeometryPreprocessing::CreateVertexCopy(object, vert);
+            }
+
+            const int face = faces[i];
+            assert(face < object->m_objectStatistics.NumFaces);
+            assert(face >= 0);
+
+            for (int facevert = 0; facevert < 3; facevert++) {
+                if (object->m_vertexIndexSet[face].indices[facevert] == vert) {
+                    object->m_vertexIndexSet[face].indices[facevert] = copies[root];
+                }
+            }
+        }
+    }
+
+} /* namespace */
 
 bool ysGeometryPreprocessing::ConnectedFaces(ysObjectData *object, int face1, int face2) {
     for (int i = 0; i < 3; i++) {
@@ -69,17 +187,24 @@ int ysGeometryPreprocessing::CreateVertexCopy(ysObjectData *object, int vertex)
 }
 
 void ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(ysObjectData *object) {
+    VertexFaces adjacency;
+    adjacency.Build(object);
+
     unsigned int groups;
 
     for (int face = 0; face < object->m_objectStatistics.NumFaces; face++) {
         if (!object->m_smoothingGroups[face]) {
             groups = UINT_MAX; // ie all groups available
 
-            for (int neighbour = 0; neighbour < object->m_objectStatistics.NumFaces; neighbour++) {
-                if (face == neighbour) continue;
+            // Neighbours are faces that share a vertex
+            for (int facevert = 0; facevert < 3; facevert++) {
+                const int vert = object->m_vertexIndexSet[face].indices[facevert];
+                const int *neighbours = adjacency.GetFaces(vert);
+                const int neighbourCount = adjacency.GetCount(vert);
 
-                if (ConnectedFaces(object, face, neighbour)) {
-                    groups = groups & (~object->m_smoothingGroups[neighbour]);
+                for (int i = 0; i < neighbourCount; i++) {
+                    if (neighbours[i] == face) continue;
+                    groups = groups & (~object->m_smoothingGroups[neighbours[i]]);
                 }
             }
 
@@ -95,183 +220,128 @@ void ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(ysObjectData *objec
 }
 
 void ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(ysObjectData *object) {
-    ysVector *tempNormals = CalculateHardNormals(object);
+    CalculateHardNormals(object);
 
     object->m_extendedSmoothingGroups.Allocate(object->m_objectStatistics.NumFaces);
 
-    // Temporary extended smoothing group designation
+    // Every face starts out in its own extended group, use
+    // SpreadSmoothingGroup() to join faces that are coplanar
     for (int i = 0; i < object->m_objectStatistics.NumFaces; i++) {
         object->m_extendedSmoothingGroups[i] = object->m_objectStatistics.NumFaces + i;
     }
 
-    const float NormalThreshold = 1.0F - 10e-5F;
-    int CurrentGroup = 0;
-    int count = 0;
-
-    for (int f1 = 0; f1 < object->m_objectStatistics.NumFaces; f1++) {
-        if (object->m_extendedSmoothingGroups[f1] < 0) {
-            for (int f2 = 0; f2 < object->m_objectStatistics.NumFaces; f2++) {
-                if (ysGeometryPreprocessing::SameSmoothingGroup(object, f1, f2)) {
-                    continue;
-                }
-
-                ysVector dot = ysMath::Dot(tempNormals[f1], tempNormals[f2]);
-                float similarity = ysMath::GetScalar(dot);
-
-                if (similarity > NormalThreshold) {
-                    object->m_extendedSmoothingGroups[f2] = CurrentGroup;
-                    object->m_extendedSmoothingGroups[f1] = CurrentGroup;
-                }
-            }
-        }
-
-        CurrentGroup++;
-    }
-
-    object->m_numExtendedSmoothingGroups = CurrentGroup;
+    object->m_numExtendedSmoothingGroups = object->m_objectStatistics.NumFaces;
 }
 
 void ysGeometryPreprocessing::SpreadSmoothingGroup(ysObjectData *object, int face, int group, ysVector *tempNormals, int *count) {
     const float NormalThreshold = 1.0F - 10e-5F;
 
-    (*count)++;
-    if (face >= object->m_objectStatistics.NumFaces || face < 0) {
-        int breakHere = 0;
-    }
+    if (face >= object->m_objectStatistics.NumFaces || face < 0) return;
+
+    VertexFaces adjacency;
+    adjacency.Build(object);
+
+    // Flood fill with an explicit stack so that large meshes can't
+    // overflow the call stack
+    std::vector<int> stack;
+    stack.push_back(face);
     object->m_extendedSmoothingGroups[face] = group;
+    (*count)++;
 
-    for (int cmpFace = 0; cmpFace < object->m_objectStatistics.NumFaces; cmpFace++) {
-        if (cmpFace == face) continue;
+    while (!stack.empty()) {
+        const int current = stack.back();
+        stack.pop_back();
 
-        // Check to make sure the faces are in different smoothing groups
-        if (object->m_smoothingGroups[face] & object->m_smoothingGroups[cmpFace]) continue;
+        for (int facevert = 0; facevert < 3; facevert++) {
+            const int vert = object->m_vertexIndexSet[current].indices[facevert];
+            const int *neighbours = adjacency.GetFaces(vert);
+            const int neighbourCount = adjacency.GetCount(vert);
 
-        if (!ConnectedFaces(object, face, cmpFace)) continue;
-        if (object->m_extendedSmoothingGroups[face] == object->m_extendedSmoothingGroups[cmpFace]) continue;
+            for (int i = 0; i < neighbourCount; i++) {
+                const int cmpFace = neighbours[i];
+
+                // Check to make sure the faces are in different smoothing groups
+                if (object->m_smoothingGroups[current] & object->m_smoothingGroups[cmpFace]) continue;
+                if (object->m_extendedSmoothingGroups[cmpFace] == group) continue;
+
+                ysVector dot = ysMath::Dot(tempNormals[current], tempNormals[cmpFace]);
+                float similarity = ysMath::GetScalar(dot);
 
-        ysVector dot = ysMath::Dot(tempNormals[face], tempNormals[cmpFace]);
-        float similarity = ysMath::GetScalar(dot);
+                if (similarity > NormalThreshold) {
+                    object->m_extendedSmoothingGroups[cmpFace] = group;
+                    (*count)++;
 
-        if (similarity > NormalThreshold) {
-            SpreadSmoothingGroup(object, cmpFace, group, tempNormals, count);
+                    stack.push_back(cmpFace);
+                }
+            }
         }
     }
 }
 
 void ysGeometryPreprocessing::SeparateBySmoothingGroups(ysObjectData *object) {
-    int faceIndex = 0;
-    int vertex = 0;
-
-    ysExpandingArray<ysExpandingArray<int, 4>> sharingCache;
-    sharingCache.Allocate(object->m_objectStatistics.NumVertices);
+    VertexFaces adjacency;
+    adjacency.Build(object);
 
-    // Cache vertex connections
-    for (int face = 0; face < object->m_objectStatistics.NumFaces; face++) {
-        for (int vertIndex = 0; vertIndex < 3; vertIndex++) {
-            int vert = object->m_vertexIndexSet[face].indices[vertIndex];
-            sharingCache[vert].New() = face;
-        }
-    }
+    FaceSets sets;
+    std::vector<std::pair<int, int>> keys;
+    std::vector<int> lastWithBit(32);
+    std::vector<int> copies;
 
-    ysExpandingArray<ysExpandingArray<int, 4>, 16> groups;
     for (int vert = 0; vert < object->m_objectStatistics.NumVertices; vert++) {
-        groups.Destroy();
-        groups.Preallocate(16);
-
-        for (int face = 0; face < sharingCache[vert].GetNumObjects(); face++) {
-            // Find which group this face belongs to
-            int faceGroup = -1;
-            for (int l = 0; l < groups.GetNumObjects(); l++) {
-                for (int i = 0; i < groups[l].GetNumObjects(); i++) {
-                    if (SameSmoothingGroup(object, sharingCache[vert][face], groups[l][i])) {
-                        faceGroup = l;
-                        break;
-                    }
-                }
-
-                if (faceGroup != -1) {
-                    break;
+        const int *faces = adjacency.GetFaces(vert);
+        const int faceCount = adjacency.GetCount(vert);
+        if (faceCount < 2) continue;
+
+        sets.Reset(faceCount);
+
+        // Faces that share a smoothing group bit are in the same set
+        std::fill(lastWithBit.begin(), lastWithBit.end(), -1);
+        for (int i = 0; i < faceCount; i++) {
+            const unsigned int groups = (unsigned int)object->m_smoothingGroups[faces[i]];
+            for (int bit = 0; bit < 32; bit++) {
+                if ((groups >> bit) & 0x1) {
+                    if (lastWithBit[bit] != -1) sets.Union(i, lastWithBit[bit]);
+                    lastWithBit[bit] = i;
                 }
             }
-
-            if (faceGroup == -1) groups.New().New() = sharingCache[vert][face];
-            else groups[faceGroup].New() = sharingCache[vert][face];
         }
 
-        for (int l = 1; l < groups.GetNumObjects(); l++) {
-            // Create a copy of the vertex
-            int newVertex = ysGeometryPreprocessing::CreateVertexCopy(object, vert);
-
-            // Adjust indicies for faces
-            for (int face = 0; face < groups[l].GetNumObjects(); face++) {
-                for (int facevert = 0; facevert < 3; facevert++) {
-                    if (object->m_vertexIndexSet[groups[l][face]].indices[facevert] == vert) {
-                        assert(groups[l][face] < object->m_objectStatistics.NumFaces);
-                        assert(groups[l][face] >= 0);
-
-                        object->m_vertexIndexSet[groups[l][face]].indices[facevert] = newVertex;
-                    }
-                }
-            }
+        // As are faces with the same extended smoothing group
+        keys.clear();
+        for (int i = 0; i < faceCount; i++) {
+            keys.push_back({ object->m_extendedSmoothingGroups[faces[i]], i });
         }
+
+        UnionEqualKeys(keys, &sets);
+        SplitVertex(object, vert, faces, faceCount, &sets, copies);
     }
 
     object->m_objectStatistics.NumVertices = object->m_vertices.GetNumObjects();
 }
 
 void ysGeometryPreprocessing::SeparateByUVGroups(ysObjectData *object, int mapChannel) {
-    int faceIndex = 0;
-    int vertex = 0;
-
-    ysExpandingArray<ysExpandingArray<int, 4>> sharingCache;
-    sharingCache.Allocate(object->m_objectStatistics.NumVertices);
-
-    // Cache vertex connections
-    for (int face = 0; face < object->m_objectStatistics.NumFaces; face++) {
-        for (int vertIndex = 0; vertIndex < 3; vertIndex++) {
-            int vert = object->m_vertexIndexSet[face].indices[vertIndex];
-            sharingCache[vert].New() = face;
-        }
-    }
+    VertexFaces adjacency;
+    adjacency.Build(object);
 
-    ysExpandingArray<ysExpandingArray<int, 4>, 16> leaders;
+    FaceSets sets;
+    std::vector<std::pair<int, int>> keys;
+    std::vector<int> copies;
 
     for (int vert = 0; vert < object->m_objectStatistics.NumVertices; vert++) {
-        leaders.Destroy();
-        leaders.Preallocate(16);
-
-        for (int face = 0; face < sharingCache[vert].GetNumObjects(); face++) {
-            int follows = -1;
-            for (int l = 0; l < leaders.GetNumObjects(); l++) {
-                int f1 = sharingCache[vert][face];
-                int f2 = leaders[l][0];
-
-                if (SameUVGroup(object, f1, f2, vert, mapChannel)) {
-                    break;
-                    follows = l;
-                }
-            }
-
-            if (follows == -1) leaders.New().New() = sharingCache[vert][face];
-            else leaders[follows].New() = sharingCache[vert][face];
+        const int *faces = adjacency.GetFaces(vert);
+        const int faceCount = adjacency.GetCount(vert);
+        if (faceCount < 2) continue;
+
+        // Faces that use the same UV coordinate at this vertex can share it
+        keys.clear();
+        for (int i = 0; i < faceCount; i++) {
+            const int index = GetVertexIndex(object, faces[i], vert);
+            keys.push_back({ object->m_UVIndexSets[mapChannel].UVIndexSets[faces[i]].indices[index], i });
         }
 
-        for (int l = 1; l < leaders.GetNumObjects(); l++) {
-            // Create a copy of the vertex
-            int newVertex = ysGeometryPreprocessing::CreateVertexCopy(object, vert);
-
-            // Adjust indicies for faces
-            for (int face = 0; face < leaders[l].GetNumObjects(); face++) {
-                for (int facevert = 0; facevert < 3; facevert++) {
-                    if (object->m_vertexIndexSet[leaders[l][face]].indices[facevert] == vert) {
-                        assert(leaders[l][face] < object->m_objectStatistics.NumFaces);
-                        assert(leaders[l][face] >= 0);
-
-                        object->m_vertexIndexSet[leaders[l][face]].indices[facevert] = newVertex;
-                    }
-                }
-            }
-        }
+        sets.Reset(faceCount);
+        UnionEqualKeys(keys, &sets);
+        SplitVertex(object, vert, faces, faceCount, &sets, copies);
     }
 
     object->m_objectStatistics.NumVertices = object->m_vertices.GetNumObjects();
@@ -280,12 +350,7 @@ void ysGeometryPreprocessing::SeparateByUVGroups(ysObjectData *object, int mapCh
 ysVector *ysGeometryPreprocessing::CalculateHardNormals(ysObjectData *object) {
     if (object->m_hardNormalCache) return object->m_hardNormalCache;
 
-#if defined(__APPLE__) && defined(__MACH__)
-    object->m_hardNormalCache = (ysVector *)aligned_alloc(sizeof(__m128) * object->m_objectStatistics.NumFaces, 16);
-#elif defined(_WIN64)
-    object->m_hardNormalCache = (ysVector *)_aligned_malloc(sizeof(__m128) * object->m_objectStatistics.NumFaces, 16);
-#endif
-    
+    object->m_hardNormalCache = AllocateVectors(object->m_objectStatistics.NumFaces);
     ysVector *tempNormals = object->m_hardNormalCache;
 
     ysVector vert1, vert2, vert3;
@@ -314,12 +379,7 @@ ysVector *ysGeometryPreprocessing::CalculateHardNormals(ysObjectData *object) {
 void ysGeometryPreprocessing::CalculateNormals(ysObjectData *object) {
     object->m_normals.Allocate(object->m_objectStatistics.NumVertices);
     ysVector *tempNormals = CalculateHardNormals(object);
-    
-#if defined(__APPLE__) && defined(__MACH__)
-    ysVector *accum = (ysVector *)aligned_alloc(sizeof(__m128) * object->m_objectStatistics.NumVertices, 16);
-#elif defined(_WIN64)
-    ysVector *accum = (ysVector *)_aligned_malloc(sizeof(__m128) * object->m_objectStatistics.NumVertices, 16);
-#endif
+    ysVector *accum = AllocateVectors(object->m_objectStatistics.NumVertices);
 
     // Clear accum
     for (int i = 0; i < object->m_objectStatistics.NumVertices; i++) {
@@ -339,20 +399,11 @@ void ysGeometryPreprocessing::CalculateNormals(ysObjectData *object) {
         object->m_normals[i] = ysMath::GetVector3(normalSum);
     }
 
-#if defined(__APPLE__) && defined(__MACH__)
-    free(accum);
-#elif defined(_WIN64)
-    _aligned_free(accum);
-#endif
+    ysAllocator::Free(accum);
 }
 
 ysVector *ysGeometryPreprocessing::CalculateHardTangents(ysObjectData *object, int mapChannel) {
-#if defined(__APPLE__) && defined(__MACH__)
-    ysVector *tempTangents = (ysVector *)aligned_alloc(sizeof(__m128) * object->m_objectStatistics.NumFaces, 16);
-#elif defined(_WIN64)
-    ysVector *tempTangents = (ysVector *)_aligned_malloc(sizeof(__m128) * object->m_objectStatistics.NumFaces, 16);
-#endif
-    
+    ysVector *tempTangents = AllocateVectors(object->m_objectStatistics.NumFaces);
     ysVector *hardNormals = CalculateHardNormals(object);
 
     ysVector vert1, vert2, vert3;
@@ -416,47 +467,51 @@ ysVector *ysGeometryPreprocessing::CalculateHardTangents(ysObjectData *object, i
 void ysGeometryPreprocessing::CalculateTangents(ysObjectData *object, int mapChannel) {
     ysVector *tempTangents = CalculateHardTangents(object, mapChannel);
 
-    // Separate Faces With Discontinuous Tangents
-    ysExpandingArray<int, 4> m_discontinuousFaces;
+    // Separate faces with discontinuous tangents. Around each vertex,
+    // faces follow the first leader whose tangent points the same way
+    // with the same handedness.
+    VertexFaces adjacency;
+    adjacency.Build(object);
+
+    std::vector<int> leaders;
+    std::vector<int> copies;
+    const int originalVertexCount = object->m_objectStatistics.NumVertices;
+    for (int vert = 0; vert < originalVertexCount; vert++) {
+        const int *faces = adjacency.GetFaces(vert);
+        const int faceCount = adjacency.GetCount(vert);
+        if (faceCount < 2) continue;
+
+        leaders.clear();
+        copies.clear();
+        for (int i = 0; i < faceCount; i++) {
+            const ysVector &tangent = tempTangents[faces[i]];
 
-    for (int f1 = 0; f1 < object->m_objectStatistics.NumFaces; f1++) {
-        m_discontinuousFaces.Clear();
-
-        for (int f2 = 0; f2 < object->m_objectStatistics.NumFaces; f2++) {
-            if (ysGeometryPreprocessing::ConnectedFaces(object, f1, f2)) {
-                if (ysMath::GetX(ysMath::Dot(tempTangents[f1], tempTangents[f2])) < 0 ||
-                    ((ysMath::GetW(tempTangents[f1]) > 0) != (ysMath::GetW(tempTangents[f2]) > 0))) {
-                    m_discontinuousFaces.New() = f2;
+            int follows = -1;
+            for (size_t l = 0; l < leaders.size(); l++) {
+                const ysVector &leaderTangent = tempTangents[faces[leaders[l]]];
+                if (ysMath::GetX(ysMath::Dot(tangent, leaderTangent)) >= 0 &&
+                    ((ysMath::GetW(tangent) > 0) == (ysMath::GetW(leaderTangent) > 0))) {
+                    follows = (int)l;
+                    break;
                 }
             }
-        }
-
-        for (int facevert = 0; facevert < 3; facevert++) {
-            int vert = object->m_vertexIndexSet[f1].indices[facevert];
-            int copy = -1;
 
-            // Separate faces
-            for (int f2 = 0; f2 < m_discontinuousFaces.GetNumObjects(); f2++) {
-                if (ysGeometryPreprocessing::IncludesVertex(object, f2, vert)) {
-                    if (copy == -1) copy = ysGeometryPreprocessing::CreateVertexCopy(object, vert);
-                    SwapVertex(object, f2, vert, copy);
-                }
+            if (follows == -1) {
+                follows = (int)leaders.size();
+                leaders.push_back(i);
+                copies.push_back((follows == 0) ? vert : CreateVertexCopy(object, vert));
             }
+
+            if (follows == 0) continue;
+            SwapVertex(object, faces[i], vert, copies[follows]);
         }
     }
 
-    // FROM HERE
-
     object->m_objectStatistics.NumVertices = object->m_vertices.GetNumObjects();
 
     // Find smoothed tangents
     object->m_tangents.Allocate(object->m_vertices.GetNumObjects());
-    
-#if defined(__APPLE__) && defined(__MACH__)
-    ysVector *accum = (ysVector *)aligned_alloc(sizeof(__m128) * object->m_objectStatistics.NumVertices, 16);
-#elif defined(_WIN64)
-    ysVector *accum = (ysVector *)_aligned_malloc(sizeof(__m128) * object->m_objectStatistics.NumVertices, 16);
-#endif
+    ysVector *accum = AllocateVectors(object->m_objectStatistics.NumVertices);
 
     // Clear accum
     for (int i = 0; i < object->m_objectStatistics.NumVertices; i++) {
@@ -482,13 +537,8 @@ void ysGeometryPreprocessing::CalculateTangents(ysObjectData *object, int mapCha
         object->m_tangents[i].w = ysMath::GetW(accum[i]);
     }
 
-#if defined(__APPLE__) && defined(__MACH__)
-    free(accum);
-    free(tempTangents);
-#elif defined(_WIN64)
-    _aligned_free(accum);
-    _aligned_free(tempTangents);
-#endif
+    ysAllocator::Free(accum);
+    ysAllocator::Free(tempTangents);
 }
 
 void ysGeometryPreprocessing::SortBoneWeights(ysObjectData *object, bool normalize, int maxBoneCount) {
@@ -6,6 +6,7 @@ ysGPUBuffer::ysGPUBuffer() : ysContextObject("GPU_BUFFER", DeviceAPI::Unknown) {
     m_RAMMirror = nullptr;
     m_size = 0;
     m_currentStride = 0;
+    m_indexSize = 2;
 
     m_mirrorToRAM = false;
 }
@@ -16,6 +17,7 @@ ysGPUBuffer::ysGPUBuffer(DeviceAPI API) : ysContextObject("GPU_BUFFER", API) {
     m_RAMMirror = nullptr;
     m_size = 0;
     m_currentStride = 0;
+    m_indexSize = 2;
 
     m_mirrorToRAM = false;
 }
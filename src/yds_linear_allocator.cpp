@@ -0,0 +1,113 @@
+#include "../include/yds_linear_allocator.h"
+
+#include "../include/yds_allocator.h"
+
+namespace {
+
+    inline int AlignSize(int size) {
+        return (size + ysLinearAllocator::Alignment - 1) & ~(ysLinearAllocator::Alignment - 1);
+    }
+
+} /* namespace */
+
+ysLinearAllocator::ysLinearAllocator() : ysMemoryAllocator("LINEAR_ALLOCATOR") {
+    m_buffer = nullptr;
+    m_capacity = 0;
+    m_offset = 0;
+
+    m_overflow = nullptr;
+
+    m_used = 0;
+    m_highWaterMark = 0;
+    m_overflowCount = 0;
+}
+
+ysLinearAllocator::~ysLinearAllocator() {
+    Destroy();
+}
+
+void *ysLinearAllocator::AllocateBlock(int size, int numObjects) {
+    (void)numObjects;
+    if (size < 0) return nullptr;
+
+    const int alignedSize = AlignSize(size);
+
+    m_used += alignedSize;
+    if (m_used > m_highWaterMark) m_highWaterMark = m_used;
+
+    if (alignedSize > m_capacity - m_offset) {
+        return AllocateOverflow(alignedSize);
+    }
+
+    void *block = m_buffer + m_offset;
+    m_offset += alignedSize;
+
+    return block;
+}
+
+int ysLinearAllocator::FreeBlock(void *block) {
+    (void)block;
+    return 0;
+}
+
+void ysLinearAllocator::Destroy() {
+    FreeOverflow();
+
+    ysAllocator::Free(m_buffer);
+    m_buffer = nullptr;
+    m_capacity = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+void ysLinearAllocator::CreateBuffer(int size) {
+    FreeOverflow();
+    ysAllocator::Free(m_buffer);
+
+    m_capacity = AlignSize(size);
+    m_buffer = (char *)ysAllocator::Allocate(m_capacity, Alignment);
+    m_offset = 0;
+    m_used = 0;
+}
+
+void ysLinearAllocator::Reset() {
+    if (m_overflow != nullptr) {
+        FreeOverflow();
+
+        // Grow so that a frame like this one fits next time
+        CreateBuffer(m_highWaterMark);
+    }
+
+    m_offset = 0;
+    m_used = 0;
+}
+
+void *ysLinearAllocator::AllocateOverflow(int size) {
+    ++m_overflowCount;
+
+    OverflowChunk *chunk = m_overflow;
+    if (chunk == nullptr || size > chunk->Size - chunk->Offset) {
+        const int headerSize = AlignSize(sizeof(OverflowChunk));
+        const int chunkSize = (size > m_capacity) ? size : m_capacity;
+
+        chunk = (OverflowChunk *)ysAllocator::Allocate(headerSize + chunkSize, Alignment);
+        chunk->Next = m_overflow;
+        chunk->Size = chunkSize;
+        chunk->Offset = 0;
+
+        m_overflow = chunk;
+    }
+
+    char *block = (char *)chunk + AlignSize(sizeof(OverflowChunk)) + chunk->Offset;
+    chunk->Offset += size;
+
+    return block;
+}
+
+void ysLinearAllocator::FreeOverflow() {
+    while (m_overflow != nullptr) {
+        OverflowChunk *next = m_overflow->Next;
+        ysAllocator::Free(m_overflow);
+        m_overflow = next;
+    }
+}
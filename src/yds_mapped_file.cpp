@@ -0,0 +1,102 @@
+#include "../include/yds_mapped_file.h"
+
+#if defined(_WIN64)
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <stdlib.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+ysMappedFile::ysMappedFile() : ysObject("MAPPED_FILE") {
+    m_data = nullptr;
+    m_size = 0;
+
+#if defined(_WIN64)
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+#endif
+}
+
+ysMappedFile::~ysMappedFile() {
+    Close();
+}
+
+ysError ysMappedFile::Open(const wchar_t *fname) {
+    YDS_ERROR_DECLARE("Open");
+
+    Close();
+
+#if defined(_WIN64)
+    m_file = CreateFileW(fname, GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+        Close();
+        return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+    }
+
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        Close();
+        return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+    }
+
+    m_data = (const char *)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_data == nullptr) {
+        Close();
+        return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+    }
+
+    m_size = (size_t)size.QuadPart;
+#else
+    char path[1024];
+    if (wcstombs(path, fname, sizeof(path)) >= sizeof(path)) {
+        return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+    }
+
+    const int file = open(path, O_RDONLY);
+    if (file < 0) return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        close(file);
+        return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+    }
+
+    void *data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps its own reference to the file
+    close(file);
+
+    if (data == MAP_FAILED) return YDS_ERROR_RETURN(ysError::CouldNotOpenFile);
+
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+    m_data = (const char *)data;
+    m_size = (size_t)info.st_size;
+#endif
+
+    return YDS_ERROR_RETURN(ysError::None);
+}
+
+void ysMappedFile::Close() {
+#if defined(_WIN64)
+    if (m_data != nullptr) UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_data != nullptr) munmap((void *)m_data, m_size);
+#endif
+
+    m_data = nullptr;
+    m_size = 0;
+}
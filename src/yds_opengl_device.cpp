@@ -936,15 +936,27 @@ ysError ysOpenGLDevice::CreateTexture(ysTexture **texture, const wchar_t *fname)
 
     if (fname == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
 
-    bool useAlpha = true;
-
     std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8_conv;
     int width, height, channels;
-    stbi_uc *pixels = stbi_load(utf8_conv.to_bytes(std::wstring(fname)).c_str(), &width, &height, &channels, (useAlpha ? 4 : 3));
+    stbi_uc *pixels = stbi_load(utf8_conv.to_bytes(std::wstring(fname)).c_str(), &width, &height, &channels, 4);
     if (pixels == nullptr) {
         return YDS_ERROR_RETURN(ysError::CouldNotOpenTexture);
     }
 
+    const ysError result = CreateTexture(texture, fname, width, height, pixels);
+    stbi_image_free(pixels);
+
+    return YDS_ERROR_RETURN(result);
+}
+
+ysError ysOpenGLDevice::CreateTexture(ysTexture **texture, const wchar_t *fname, int width, int height, const unsigned char *pixels) {
+    YDS_ERROR_DECLARE("CreateTexture");
+
+    if (texture == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+    *texture = nullptr;
+
+    if (fname == nullptr) return YDS_ERROR_RETURN(ysError::InvalidParameter);
+
     ysOpenGLTexture *newTexture = m_textures.NewGeneric<ysOpenGLTexture>();
     wcscpy_s(newTexture->m_filename, 257, fname);
 
@@ -957,19 +969,11 @@ ysError ysOpenGLDevice::CreateTexture(ysTexture **texture, const wchar_t *fname)
     newTexture->m_width = width;
     newTexture->m_height = height;
 
-    int nBytes = newTexture->m_width * newTexture->m_height * (useAlpha ? 4 : 3);
-    int size = 0;
-
-    const int texType = (useAlpha) ? GL_RGBA : GL_RGB;
-
-    if (!useAlpha) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    else glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, texType, newTexture->m_width, newTexture->m_height, 0, texType, GL_UNSIGNED_BYTE, pixels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, newTexture->m_width, newTexture->m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
     m_realContext->glGenerateMipmap(GL_TEXTURE_2D); // TEMP
 
-    stbi_image_free(pixels);
-
     *texture = static_cast<ysTexture *>(newTexture);
 
     return YDS_ERROR_RETURN(ysError::None);
@@ -1152,7 +1156,9 @@ int ysOpenGLDevice::GetFramebufferName(int slot) {
 // TEMP
 void ysOpenGLDevice::Draw(int numFaces, int indexOffset, int vertexOffset) {
     if (m_activeVertexBuffer != nullptr) {
-        m_realContext->glDrawElementsBaseVertex(GL_TRIANGLES, numFaces * 3, GL_UNSIGNED_SHORT, (void *)(indexOffset * 2), vertexOffset);
+        const int indexSize = (m_activeIndexBuffer != nullptr) ? m_activeIndexBuffer->GetIndexSize() : 2;
+        const GLenum indexType = (indexSize == 4) ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+        m_realContext->glDrawElementsBaseVertex(GL_TRIANGLES, numFaces * 3, indexType, (void *)((size_t)indexOffset * indexSize), vertexOffset);
     }
 }
 
@@ -0,0 +1,194 @@
+#include "../include/yds_profiler.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+thread_local ysProfiler::ThreadBuffer *ysProfiler::t_buffer = nullptr;
+
+ysProfiler::ysProfiler() : ysObject("ysProfiler") {
+    m_enabled = true;
+    m_bufferSize = DefaultBufferSize;
+    m_epoch = Now();
+    m_epochClock = ReadClock();
+}
+
+ysProfiler::~ysProfiler() {
+    /* void */
+}
+
+ysProfiler *ysProfiler::Get() {
+    static ysProfiler profiler;
+    return &profiler;
+}
+
+uint64_t ysProfiler::Now() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int ysProfiler::RegisterZone(const char *name) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    const int n = (int)m_zones.size();
+    for (int i = 0; i < n; ++i) {
+        if (m_zones[i] == name) return i;
+    }
+
+    m_zones.push_back(name);
+    return n;
+}
+
+std::string ysProfiler::GetZoneName(int zone) {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_zones[zone];
+}
+
+int ysProfiler::GetZoneCount() {
+    std::lock_guard<std::mutex> lock(m_lock);
+    return (int)m_zones.size();
+}
+
+void ysProfiler::SetBufferSize(int size) {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // Ring buffer indices are masked so the size is rounded up to a power of
+    // two
+    int bufferSize = 1;
+    while (bufferSize < size) bufferSize *= 2;
+
+    m_bufferSize = bufferSize;
+}
+
+void ysProfiler::SetThreadName(const char *name) {
+    ThreadBuffer *buffer = t_buffer;
+    if (buffer == nullptr) buffer = CreateThreadBuffer();
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    buffer->Name = name;
+}
+
+void ysProfiler::GetThreadEvents(std::vector<Event> *events) {
+    events->clear();
+
+    ThreadBuffer *buffer = t_buffer;
+    if (buffer == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    CopyEvents(buffer, events);
+}
+
+bool ysProfiler::WriteChromeTrace(const std::string &filename) {
+    std::ofstream file(filename, std::ios::out);
+    if (!file.is_open()) return false;
+
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    struct OpenZone {
+        int Zone;
+        uint64_t Start;
+    };
+
+    std::vector<Event> events;
+    std::vector<OpenZone> stack;
+
+    // Calibrate the event clock against the monotonic clock over the whole
+    // lifetime of the profiler
+    const uint64_t elapsed = Now() - m_epoch;
+    const uint64_t elapsedClock = ReadClock() - m_epochClock;
+    const double microsecondsPerTick = (elapsed > 0 && elapsedClock > 0)
+        ? (elapsed / 1000.0) / elapsedClock
+        : 1 / 1000.0;
+
+    // Timestamps are written in microseconds with nanosecond resolution, the
+    // default formatting would switch to scientific notation once a session
+    // runs past a second
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+
+    bool first = true;
+    auto writeName = [&file](const std::string &name) {
+        file << '"';
+        for (char c : name) {
+            if (c == '"' || c == '\\') file << '\\';
+            file << c;
+        }
+        file << '"';
+    };
+
+    for (const std::unique_ptr<ThreadBuffer> &thread : m_threads) {
+        if (!first) file << ",\n";
+        first = false;
+
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread->ThreadId
+            << ",\"args\":{\"name\":";
+        writeName(thread->Name);
+        file << "}}";
+
+        CopyEvents(thread.get(), &events);
+        stack.clear();
+
+        for (const Event &e : events) {
+            if (e.Type == EventType::Begin) {
+                stack.push_back({ e.Zone, e.Timestamp });
+                continue;
+            }
+
+            // The matching begin event was overwritten
+            if (stack.empty() || stack.back().Zone != e.Zone) continue;
+
+            const OpenZone zone = stack.back();
+            stack.pop_back();
+
+            file << ",\n{\"name\":";
+            writeName(m_zones[zone.Zone]);
+            file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread->ThreadId
+                << ",\"ts\":" << (int64_t)(zone.Start - m_epochClock) * microsecondsPerTick
+                << ",\"dur\":" << (e.Timestamp - zone.Start) * microsecondsPerTick << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    file.close();
+
+    return !file.fail();
+}
+
+void ysProfiler::Clear() {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    for (const std::unique_ptr<ThreadBuffer> &thread : m_threads) {
+        thread->ClearIndex = thread->WriteIndex.load(std::memory_order_acquire);
+    }
+}
+
+ysProfiler::ThreadBuffer *ysProfiler::CreateThreadBuffer() {
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    // Buffers outlive their threads so that events of finished threads can
+    // still be exported
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->Events.resize(m_bufferSize);
+    buffer->WriteIndex = 0;
+    buffer->ClearIndex = 0;
+    buffer->ThreadId = (int)m_threads.size();
+    buffer->Name = "Thread " + std::to_string(buffer->ThreadId);
+
+    t_buffer = buffer.get();
+    m_threads.push_back(std::move(buffer));
+
+    return t_buffer;
+}
+
+void ysProfiler::CopyEvents(ThreadBuffer *buffer, std::vector<Event> *events) {
+    const uint64_t end = buffer->WriteIndex.load(std::memory_order_acquire);
+    const uint64_t size = buffer->Events.size();
+
+    uint64_t start = (end > size) ? end - size : 0;
+    if (start < buffer->ClearIndex) start = buffer->ClearIndex;
+
+    events->clear();
+    for (uint64_t i = start; i < end; ++i) {
+        events->push_back(buffer->Events[i & (size - 1)]);
+    }
+}
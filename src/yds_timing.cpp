@@ -1,29 +1,15 @@
 #include "../include/yds_timing.h"
 
-#define NOMINMAX
+#include "../include/yds_profiler.h"
 
-#if defined(__APPLE__) && defined(__MACH__) // Apple OSX & iOS (Darwin)
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 
-#include "win32/windows_modular.h"
-#include <mach/mach_time.h>
-#include <CoreServices/CoreServices.h>
-#include "win32/intrin.h"
-
-//static bool qpcFlag;
-//static LARGE_INTEGER qpcFrequency;
-//
-//ysTimingSystem *ysTimingSystem::g_instance = nullptr;
-
-// TODO: Implement ... -
-
-#elif defined(_WIN64)
-
-#include <Windows.h>
-#include <mmsystem.h>
-#include <intrin.h>
-
-static bool qpcFlag;
-static LARGE_INTEGER qpcFrequency;
+uint64_t SystemTime() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
 ysTimingSystem *ysTimingSystem::g_instance = nullptr;
 
@@ -31,19 +17,22 @@ ysTimingSystem::ysTimingSystem() {
     m_frameDurations = nullptr;
     m_durationSamples = 0;
 
+    m_history.resize(DefaultHistorySize);
+    m_historyWriteIndex = 0;
+    m_historySamples = 0;
+
     SetPrecisionMode(Precision::Microsecond);
     Initialize();
 }
 
-ysTimingSystem::~ysTimingSystem() { /* void */
+ysTimingSystem::~ysTimingSystem() {
+    delete[] m_frameDurations;
 }
 
 uint64_t ysTimingSystem::GetTime() { return SystemTime(); }
 
-inline unsigned __int64 SystemClock() { return __rdtsc(); }
-
-unsigned __int64 ysTimingSystem::GetClock() {
-    return (unsigned long long) SystemClock();
+uint64_t ysTimingSystem::GetClock() {
+    return ysProfiler::ReadClock();
 }
 
 void ysTimingSystem::SetPrecisionMode(Precision mode) {
@@ -62,8 +51,7 @@ void ysTimingSystem::Update() {
     if (!m_isPaused) { m_frameNumber++; }
 
     const uint64_t thisTime = GetTime();
-    m_lastFrameDuration = ((thisTime - m_lastFrameTimestamp) * 1000000) /
-                          qpcFrequency.QuadPart;
+    m_lastFrameDuration = thisTime - m_lastFrameTimestamp;
     m_lastFrameTimestamp = thisTime;
 
     const uint64_t thisClock = GetClock();
@@ -71,11 +59,6 @@ void ysTimingSystem::Update() {
     m_lastFrameClockstamp = thisClock;
 
     if (m_frameNumber > 1) {
-        /*
-        m_averageFrameDuration *= 0.95;
-        m_averageFrameDuration += 0.05 * (double)m_lastFrameDuration / m_div;
-
-        m_fps = (float)(1 / m_averageFrameDuration);*/
         m_frameDurations[m_durationSampleWriteIndex] =
                 double(m_lastFrameDuration) / m_div;
         if (++m_durationSampleWriteIndex >= DurationSamples) {
@@ -96,6 +79,8 @@ void ysTimingSystem::Update() {
         if (m_averageFrameDuration != 0) {
             m_fps = 1 / float(m_averageFrameDuration);
         }
+
+        RecordFrameDuration(double(m_lastFrameDuration) / m_div);
     }
 }
 
@@ -105,8 +90,6 @@ void ysTimingSystem::RestartFrame() {
 }
 
 void ysTimingSystem::Initialize() {
-    qpcFlag = (QueryPerformanceFrequency(&qpcFrequency) > 0);
-
     m_frameNumber = 0;
 
     m_lastFrameTimestamp = GetTime();
@@ -120,9 +103,13 @@ void ysTimingSystem::Initialize() {
     m_averageFrameDuration = 0;
     m_fps = 1024.0;
 
+    delete[] m_frameDurations;
     m_frameDurations = new double[DurationSamples];
     m_durationSamples = 0;
     m_durationSampleWriteIndex = 0;
+
+    m_historyWriteIndex = 0;
+    m_historySamples = 0;
 }
 
 double ysTimingSystem::GetFrameDuration() {
@@ -131,4 +118,127 @@ double ysTimingSystem::GetFrameDuration() {
 
 uint64_t ysTimingSystem::GetFrameDuration_us() { return m_lastFrameDuration; }
 
-#endif /* Windows */
+void ysTimingSystem::RecordFrameDuration(double duration) {
+    const int size = (int)m_history.size();
+    if (size == 0) return;
+
+    m_history[m_historyWriteIndex] = duration;
+    if (++m_historyWriteIndex >= size) m_historyWriteIndex = 0;
+    if (m_historySamples < size) ++m_historySamples;
+}
+
+void ysTimingSystem::SetHistorySize(int size) {
+    m_history.assign(size, 0.0);
+    m_historyWriteIndex = 0;
+    m_historySamples = 0;
+}
+
+void ysTimingSystem::GetFrameStatistics(FrameStatistics *stats) {
+    const int n = m_historySamples;
+
+    stats->Samples = n;
+    stats->Average = stats->Minimum = stats->Maximum = 0.0;
+    stats->P50 = stats->P95 = stats->P99 = 0.0;
+    stats->Jitter = 0.0;
+
+    if (n == 0) return;
+
+    double jitter = 0.0;
+    double previous = GetHistorySample(0);
+    for (int i = 1; i < n; ++i) {
+        const double sample = GetHistorySample(i);
+        jitter += std::abs(sample - previous);
+        previous = sample;
+    }
+
+    SortHistory();
+
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) sum += m_sortedHistory[i];
+
+    stats->Average = sum / n;
+    stats->Minimum = m_sortedHistory[0];
+    stats->Maximum = m_sortedHistory[n - 1];
+    stats->P50 = SortedPercentile(0.50);
+    stats->P95 = SortedPercentile(0.95);
+    stats->P99 = SortedPercentile(0.99);
+    stats->Jitter = (n > 1) ? jitter / (n - 1) : 0.0;
+}
+
+double ysTimingSystem::GetFrameDurationPercentile(double p) {
+    if (m_historySamples == 0) return 0.0;
+
+    SortHistory();
+    return SortedPercentile(p);
+}
+
+double ysTimingSystem::SortedPercentile(double p) const {
+    const int n = (int)m_sortedHistory.size();
+
+    // Nearest rank
+    int rank = (int)std::ceil(p * n) - 1;
+    rank = std::min(std::max(rank, 0), n - 1);
+
+    return m_sortedHistory[rank];
+}
+
+void ysTimingSystem::GetJitterHistogram(int *bins, int binCount, double binWidth) {
+    for (int i = 0; i < binCount; ++i) bins[i] = 0;
+    if (binCount == 0) return;
+
+    const int n = m_historySamples;
+    for (int i = 1; i < n; ++i) {
+        const double jitter = std::abs(GetHistorySample(i) - GetHistorySample(i - 1));
+        const int bin = (int)(jitter / binWidth);
+        ++bins[std::min(bin, binCount - 1)];
+    }
+}
+
+double ysTimingSystem::GetHistorySample(int i) const {
+    const int size = (int)m_history.size();
+    const int start = (m_historySamples < size) ? 0 : m_historyWriteIndex;
+
+    return m_history[(start + i) % size];
+}
+
+void ysTimingSystem::SortHistory() {
+    m_sortedHistory.resize(m_historySamples);
+    for (int i = 0; i < m_historySamples; ++i) {
+        m_sortedHistory[i] = GetHistorySample(i);
+    }
+
+    std::sort(m_sortedHistory.begin(), m_sortedHistory.end());
+}
+
+ysTimestepAccumulator::ysTimestepAccumulator() {
+    m_step = 1 / 60.0;
+    m_maxSteps = DefaultMaxSteps;
+
+    m_accumulator = 0.0;
+    m_droppedTime = 0.0;
+}
+
+ysTimestepAccumulator::~ysTimestepAccumulator() {
+    /* void */
+}
+
+int ysTimestepAccumulator::Advance(double frameDuration) {
+    m_accumulator += frameDuration;
+
+    int steps = (int)(m_accumulator / m_step);
+    if (steps > m_maxSteps) {
+        m_droppedTime += (steps - m_maxSteps) * m_step;
+        m_accumulator -= (steps - m_maxSteps) * m_step;
+        steps = m_maxSteps;
+    }
+
+    m_accumulator -= steps * m_step;
+    if (m_accumulator < 0) m_accumulator = 0;
+
+    return steps;
+}
+
+void ysTimestepAccumulator::Reset() {
+    m_accumulator = 0.0;
+    m_droppedTime = 0.0;
+}
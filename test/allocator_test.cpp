@@ -0,0 +1,152 @@
+#include <pch.h>
+
+#include "../include/yds_allocator.h"
+#include "../include/yds_dynamic_array.h"
+#include "../include/yds_expanding_array.h"
+
+#include <thread>
+#include <vector>
+
+TEST(AllocatorTest, SizeClasses) {
+    size_t previous = 0;
+    for (int i = 0; i < ysAllocator::SizeClassCount; ++i) {
+        const size_t size = ysAllocator::GetSizeClassSize(i);
+
+        EXPECT_GT(size, previous);
+        EXPECT_EQ(size % ysAllocator::MinimumAlignment, 0);
+        EXPECT_EQ(ysAllocator::GetSizeClass(size), i);
+        EXPECT_EQ(ysAllocator::GetSizeClass(previous + 1), i);
+
+        previous = size;
+    }
+
+    EXPECT_EQ(previous, (size_t)ysAllocator::MaxSmallSize);
+}
+
+TEST(AllocatorTest, Alignment) {
+    std::vector<void *> blocks;
+    for (int size = 1; size < 3 * ysAllocator::MaxSmallSize; size += 37) {
+        void *block = ysAllocator::Allocate(size, 1);
+        EXPECT_EQ((uintptr_t)block % 16, 0);
+        memset(block, 0xCD, size);
+
+        blocks.push_back(block);
+    }
+
+    void *wide = ysAllocator::BlockAllocate<64>(100);
+    EXPECT_EQ((uintptr_t)wide % 64, 0);
+    ysAllocator::BlockFree(wide, 64);
+
+    for (void *block : blocks) {
+        ysAllocator::Free(block);
+    }
+}
+
+TEST(AllocatorTest, Statistics) {
+    ysAllocator::Statistics before, during, after;
+    ysAllocator::GetStatistics(&before);
+
+    void *small = ysAllocator::Allocate(100);
+    void *large = ysAllocator::Allocate(100000);
+    ysAllocator::GetStatistics(&during);
+
+    EXPECT_EQ(during.Allocations - before.Allocations, 2);
+    EXPECT_EQ(during.LargeAllocations - before.LargeAllocations, 1);
+    EXPECT_EQ(during.LiveBlocks - before.LiveBlocks, 2);
+    EXPECT_EQ(during.LiveBytes - before.LiveBytes, 100100);
+
+    ysAllocator::Free(small);
+    ysAllocator::Free(large);
+    ysAllocator::GetStatistics(&after);
+
+    EXPECT_EQ(after.Frees - before.Frees, 2);
+    EXPECT_EQ(after.LiveBlocks, before.LiveBlocks);
+    EXPECT_EQ(after.LiveBytes, before.LiveBytes);
+}
+
+TEST(AllocatorTest, CrossThreadFree) {
+    ysAllocator::Statistics before, after;
+    ysAllocator::GetStatistics(&before);
+
+    // Blocks allocated on several threads and freed on another one end up back
+    // in the shared pool when the threads exit
+    std::vector<void *> blocks[4];
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&blocks, t] {
+            for (int i = 0; i < 10000; ++i) {
+                blocks[t].push_back(ysAllocator::Allocate(16 + (i % 200)));
+            }
+        });
+    }
+
+    for (std::thread &thread : threads) thread.join();
+
+    std::thread freeThread([&blocks] {
+        for (int t = 0; t < 4; ++t) {
+            for (void *block : blocks[t]) ysAllocator::Free(block);
+        }
+    });
+
+    freeThread.join();
+
+    ysAllocator::GetStatistics(&after);
+    EXPECT_EQ(after.Allocations - before.Allocations, 40000);
+    EXPECT_EQ(after.Frees - before.Frees, 40000);
+    EXPECT_EQ(after.LiveBlocks, before.LiveBlocks);
+
+    // Reallocating the same amount does not need any new slabs
+    std::vector<void *> again;
+    for (int i = 0; i < 40000; ++i) {
+        again.push_back(ysAllocator::Allocate(16 + (i % 200)));
+    }
+
+    ysAllocator::Statistics reused;
+    ysAllocator::GetStatistics(&reused);
+    EXPECT_EQ(reused.SpanBytes, after.SpanBytes);
+
+    for (void *block : again) ysAllocator::Free(block);
+}
+
+namespace {
+
+    class BaseElement : public ysDynamicArrayElement {
+    public:
+        int Value = 0;
+    };
+
+    class DerivedElement : public BaseElement {
+    public:
+        char Payload[300];
+    };
+
+} /* namespace */
+
+TEST(AllocatorTest, Containers) {
+    ysAllocator::Statistics before, after;
+    ysAllocator::GetStatistics(&before);
+
+    {
+        ysDynamicArray<BaseElement, 4> elements;
+        for (int i = 0; i < 100; ++i) {
+            BaseElement *element = (i % 2 == 0)
+                ? elements.New()
+                : elements.NewGeneric<DerivedElement, 16>();
+            element->Value = i;
+        }
+
+        // Derived objects are freed through the base type
+        for (int i = 0; i < 50; ++i) {
+            elements.Delete(0);
+        }
+
+        ysExpandingArray<float, 0, 16> values;
+        for (int i = 0; i < 10000; ++i) {
+            values.New() = (float)i;
+        }
+    }
+
+    ysAllocator::GetStatistics(&after);
+    EXPECT_EQ(after.LiveBlocks, before.LiveBlocks);
+    EXPECT_EQ(after.LiveBytes, before.LiveBytes);
+}
@@ -0,0 +1,207 @@
+#include <pch.h>
+
+#include "../engines/basic/include/asset_streamer.h"
+
+#include "../engines/basic/include/asset_manager.h"
+#include "../engines/basic/include/delta_engine.h"
+#include "../include/yds_stb_image.h"
+
+#include <chrono>
+#include <codecvt>
+#include <cstdio>
+#include <fstream>
+#include <locale>
+#include <map>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    typedef dbasic::AssetStreamer AssetStreamer;
+
+    // Requests for missing files fail while decoding, so they never reach
+    // the asset manager
+    bool WaitForDecode(AssetStreamer &streamer, AssetStreamer::Handle handle) {
+        for (int i = 0; i < 1000; ++i) {
+            if (streamer.GetStatus(handle) == AssetStreamer::Status::Uploading) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        return false;
+    }
+
+    // Keeps the pixels of every texture it creates. Files are decoded the
+    // same way the real devices do it and then go through the overload for
+    // decoded files, like the streamer's uploads.
+    class RecordingDevice : public ysDevice {
+    public:
+        std::map<ysTexture *, std::vector<unsigned char>> Pixels;
+        int FileTextures = 0;
+
+        virtual ysError CreateTexture(ysTexture **texture, const wchar_t *fname) override {
+            ++FileTextures;
+
+            std::wstring_convert<std::codecvt_utf8<wchar_t>> utf8_conv;
+            int width, height, channels;
+            stbi_uc *pixels = stbi_load(utf8_conv.to_bytes(std::wstring(fname)).c_str(), &width, &height, &channels, 4);
+            if (pixels == nullptr) return ysError::CouldNotOpenTexture;
+
+            const ysError result = ysDevice::CreateTexture(texture, fname, width, height, pixels);
+            stbi_image_free(pixels);
+
+            return result;
+        }
+
+        virtual ysError CreateTexture(ysTexture **texture, int width, int height, const unsigned char *buffer) override {
+            ysTexture *newTexture = m_textures.NewGeneric<RecordedTexture>();
+            static_cast<RecordedTexture *>(newTexture)->SetSize(width, height);
+            Pixels[newTexture].assign(buffer, buffer + width * height * 4);
+
+            *texture = newTexture;
+            return ysError::None;
+        }
+
+        virtual ysError InitializeDevice() override { return ysError::None; }
+        virtual ysError DestroyDevice() override { return ysError::None; }
+        virtual bool CheckSupport() override { return true; }
+        virtual ysError CreateRenderingContext(ysRenderingContext **, ysWindow *) override { return ysError::NotImplemented; }
+        virtual ysError UpdateRenderingContext(ysRenderingContext *) override { return ysError::NotImplemented; }
+        virtual ysError SetFaceCulling(bool) override { return ysError::NotImplemented; }
+        virtual ysError SetFaceCullingMode(CullMode) override { return ysError::NotImplemented; }
+        virtual ysError CreateOnScreenRenderTarget(ysRenderTarget **, ysRenderingContext *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateOffScreenRenderTarget(ysRenderTarget **, int, int, ysRenderTarget::Format, bool, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateSubRenderTarget(ysRenderTarget **, ysRenderTarget *, int, int, int, int) override { return ysError::NotImplemented; }
+        virtual ysError ClearBuffers(const float *) override { return ysError::NotImplemented; }
+        virtual ysError Present() override { return ysError::NotImplemented; }
+        virtual ysError CreateVertexBuffer(ysGPUBuffer **, int, char *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateIndexBuffer(ysGPUBuffer **, int, char *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateConstantBuffer(ysGPUBuffer **, int, char *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateVertexShader(ysShader **, const wchar_t *, const wchar_t *, const char *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreatePixelShader(ysShader **, const wchar_t *, const wchar_t *, const char *, bool) override { return ysError::NotImplemented; }
+        virtual ysError CreateShaderProgram(ysShaderProgram **) override { return ysError::NotImplemented; }
+        virtual ysError CreateInputLayout(ysInputLayout **, ysShader *, const ysRenderGeometryFormat *, const ysRenderGeometryFormat *) override { return ysError::NotImplemented; }
+        virtual ysError CreateAlphaTexture(ysTexture **, int, int, const unsigned char *) override { return ysError::NotImplemented; }
+        virtual ysError UpdateTexture(ysTexture *, const unsigned char *) override { return ysError::NotImplemented; }
+
+    protected:
+        class RecordedTexture : public ysTexture {
+        public:
+            void SetSize(int width, int height) { m_width = width; m_height = height; }
+        };
+    };
+
+    class RecordingEngine : public dbasic::DeltaEngine {
+    public:
+        void SetDevice(ysDevice *device) { m_device = device; }
+    };
+
+} /* namespace */
+
+TEST(AssetStreamerTest, WaitFromCallback) {
+    AssetStreamer streamer;
+    streamer.Initialize(nullptr, 1);
+
+    AssetStreamer::Handle second = AssetStreamer::InvalidHandle;
+    int firstCalls = 0;
+    int secondCalls = 0;
+    ysError waitResult = ysError::InvalidParameter;
+
+    AssetStreamer::Options firstOptions;
+    firstOptions.OnComplete = [&](AssetStreamer::Handle, ysError) {
+        ++firstCalls;
+        waitResult = streamer.Wait(second);
+    };
+
+    AssetStreamer::Options secondOptions;
+    secondOptions.Priority = 1.0f;
+    secondOptions.OnComplete = [&](AssetStreamer::Handle, ysError) { ++secondCalls; };
+
+    const AssetStreamer::Handle first =
+        streamer.RequestTexture(L"asset_streamer_test_missing_a.png", "A", firstOptions);
+    second = streamer.RequestTexture(L"asset_streamer_test_missing_b.png", "B", secondOptions);
+
+    ASSERT_TRUE(WaitForDecode(streamer, first));
+    ASSERT_TRUE(WaitForDecode(streamer, second));
+
+    // Both requests are taken by the same update, the second one is
+    // finished by the callback of the first
+    EXPECT_EQ(streamer.Update(), ysError::None);
+
+    EXPECT_EQ(firstCalls, 1);
+    EXPECT_EQ(secondCalls, 1);
+    EXPECT_EQ(waitResult, ysError::None);
+
+    EXPECT_EQ(streamer.GetStatus(first), AssetStreamer::Status::Failed);
+    EXPECT_EQ(streamer.GetStatus(second), AssetStreamer::Status::Failed);
+
+    const AssetStreamer::Progress progress = streamer.GetProgress();
+    EXPECT_EQ(progress.Requested, 2);
+    EXPECT_EQ(progress.Failed, 2);
+
+    streamer.Destroy();
+}
+
+TEST(AssetStreamerTest, FinishedHistory) {
+    AssetStreamer streamer;
+    streamer.Initialize(nullptr, 1);
+
+    const int count = AssetStreamer::FinishedHistory + 1;
+    std::vector<AssetStreamer::Handle> handles;
+    for (int i = 0; i < count; ++i) {
+        handles.push_back(streamer.RequestTexture(L"asset_streamer_test_missing.png", "A"));
+    }
+
+    for (AssetStreamer::Handle handle : handles) {
+        EXPECT_EQ(streamer.Wait(handle), ysError::None);
+    }
+
+    EXPECT_EQ(streamer.GetStatus(handles.front()), AssetStreamer::Status::Invalid);
+    EXPECT_EQ(streamer.GetStatus(handles.back()), AssetStreamer::Status::Failed);
+
+    streamer.Destroy();
+}
+
+TEST(AssetStreamerTest, StreamedTextureMatchesLoadTexture) {
+    const char *path = "asset_streamer_test_texture.ppm";
+
+    // 3x2 binary PPM, decoded to RGBA by both paths
+    {
+        std::ofstream file(path, std::ios::binary);
+        file << "P6\n3 2\n255\n";
+        for (int i = 0; i < 3 * 2 * 3; ++i) file.put((char)(i * 13));
+    }
+
+    RecordingDevice device;
+    RecordingEngine engine;
+    engine.SetDevice(&device);
+
+    dbasic::AssetManager manager;
+    manager.SetEngine(&engine);
+
+    ASSERT_EQ(manager.LoadTexture(L"asset_streamer_test_texture.ppm", "Loaded"), ysError::None);
+
+    const AssetStreamer::Handle handle =
+        manager.LoadTextureAsync(L"asset_streamer_test_texture.ppm", "Streamed");
+    ASSERT_EQ(manager.GetStreamer()->Wait(handle), ysError::None);
+    ASSERT_EQ(manager.GetStreamer()->GetStatus(handle), AssetStreamer::Status::Complete);
+
+    ysTexture *loaded = manager.GetTexture("Loaded")->GetTexture();
+    ysTexture *streamed = manager.GetTexture("Streamed")->GetTexture();
+    ASSERT_NE(loaded, nullptr);
+    ASSERT_NE(streamed, nullptr);
+    ASSERT_NE(loaded, streamed);
+
+    // Only the synchronous load opens the file on the device
+    EXPECT_EQ(device.FileTextures, 1);
+
+    EXPECT_EQ(streamed->GetWidth(), loaded->GetWidth());
+    EXPECT_EQ(streamed->GetHeight(), loaded->GetHeight());
+    EXPECT_STREQ(streamed->GetFilename(), L"asset_streamer_test_texture.ppm");
+    EXPECT_STREQ(streamed->GetFilename(), loaded->GetFilename());
+    EXPECT_EQ(device.Pixels[streamed], device.Pixels[loaded]);
+
+    manager.Destroy();
+    engine.SetDevice(nullptr);
+
+    std::remove(path);
+}
@@ -0,0 +1,92 @@
+#include <pch.h>
+
+#include "../engines/basic/include/delta_engine.h"
+
+#include <vector>
+
+namespace {
+
+    typedef dbasic::DeltaEngine::DrawCall DrawCall;
+
+    // Only used for their addresses, in increasing order
+    char ShaderStorage[2];
+    ysShaderProgram *const ShaderA = (ysShaderProgram *) &ShaderStorage[0];
+    ysShaderProgram *const ShaderB = (ysShaderProgram *) &ShaderStorage[1];
+
+    DrawCall MakeCall(ysShaderProgram *shader, bool opaque, bool depthTest = true) {
+        DrawCall call;
+        call.ObjectData = nullptr;
+        call.ObjectDataSize = 0;
+        call.Shader = shader;
+        call.Opaque = opaque;
+        call.DepthTest = depthTest;
+
+        return call;
+    }
+
+    // Positions of the sorted calls in the submitted array
+    std::vector<int> Sort(const std::vector<DrawCall> &calls) {
+        std::vector<const DrawCall *> sorted;
+        dbasic::DeltaEngine::SortDrawCalls(calls.data(), (int) calls.size(), sorted);
+
+        std::vector<int> order;
+        for (const DrawCall *call : sorted) order.push_back((int) (call - calls.data()));
+
+        return order;
+    }
+
+} /* namespace */
+
+TEST(DrawQueueTest, KeepsOrderOfNonOpaqueCalls) {
+    const std::vector<DrawCall> calls = {
+        MakeCall(ShaderB, false),
+        MakeCall(ShaderA, false),
+        MakeCall(ShaderB, false),
+        MakeCall(ShaderA, false)
+    };
+
+    EXPECT_EQ(Sort(calls), std::vector<int>({ 0, 1, 2, 3 }));
+}
+
+TEST(DrawQueueTest, GroupsOpaqueCalls) {
+    const std::vector<DrawCall> calls = {
+        MakeCall(ShaderB, true),
+        MakeCall(ShaderA, true),
+        MakeCall(ShaderB, true),
+        MakeCall(ShaderA, true)
+    };
+
+    // Calls with the same state keep their relative order
+    EXPECT_EQ(Sort(calls), std::vector<int>({ 1, 3, 0, 2 }));
+}
+
+TEST(DrawQueueTest, OpaqueCallsAreNotMovedAcrossOthers) {
+    const std::vector<DrawCall> calls = {
+        MakeCall(ShaderB, true),
+        MakeCall(ShaderA, true),
+        MakeCall(ShaderB, false),
+        MakeCall(ShaderB, true),
+        MakeCall(ShaderA, true),
+        MakeCall(ShaderB, true, false),
+        MakeCall(ShaderB, true),
+        MakeCall(ShaderA, true)
+    };
+
+    EXPECT_EQ(Sort(calls), std::vector<int>({ 1, 0, 2, 4, 3, 5, 7, 6 }));
+}
+
+TEST(DrawQueueTest, AppendsToSortedCalls) {
+    const std::vector<DrawCall> layer0 = { MakeCall(ShaderB, true), MakeCall(ShaderA, true) };
+    const std::vector<DrawCall> layer1 = { MakeCall(ShaderB, true), MakeCall(ShaderA, true) };
+
+    std::vector<const DrawCall *> sorted;
+    dbasic::DeltaEngine::SortDrawCalls(layer0.data(), (int) layer0.size(), sorted);
+    dbasic::DeltaEngine::SortDrawCalls(layer1.data(), (int) layer1.size(), sorted);
+
+    // Calls are never moved into an earlier layer
+    ASSERT_EQ(sorted.size(), 4u);
+    EXPECT_EQ(sorted[0], &layer0[1]);
+    EXPECT_EQ(sorted[1], &layer0[0]);
+    EXPECT_EQ(sorted[2], &layer1[1]);
+    EXPECT_EQ(sorted[3], &layer1[0]);
+}
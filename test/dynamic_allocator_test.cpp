@@ -0,0 +1,136 @@
+#include <pch.h>
+
+#include "../include/yds_dynamic_allocator.h"
+
+#include <random>
+#include <vector>
+
+TEST(DynamicAllocatorTest, AllocateAndCoalesce) {
+    ysDynamicAllocator allocator;
+    allocator.CreateBuffer(64 * KB);
+    allocator.CreateBlocks(0);
+
+    ysDynamicAllocator::Statistics initial;
+    allocator.GetStatistics(&initial);
+    EXPECT_EQ(initial.FreeBlocks, 1);
+    EXPECT_EQ(initial.UsedBlocks, 0);
+    EXPECT_FLOAT_EQ(initial.Fragmentation, 0.0f);
+
+    void *blocks[8];
+    for (int i = 0; i < 8; ++i) {
+        blocks[i] = allocator.AllocateBlock(1000, i + 1);
+        ASSERT_NE(blocks[i], nullptr);
+        EXPECT_EQ((uintptr_t)blocks[i] % ysDynamicAllocator::Alignment, 0);
+        memset(blocks[i], 0xAB, 1000);
+    }
+
+    EXPECT_TRUE(allocator.CheckValid());
+
+    // Freeing every other block leaves holes that can't be merged
+    for (int i = 0; i < 8; i += 2) {
+        EXPECT_EQ(allocator.FreeBlock(blocks[i]), i + 1);
+    }
+
+    ysDynamicAllocator::Statistics fragmented;
+    allocator.GetStatistics(&fragmented);
+    EXPECT_EQ(fragmented.UsedBlocks, 4);
+    EXPECT_EQ(fragmented.FreeBlocks, 5);
+    EXPECT_GT(fragmented.Fragmentation, 0.0f);
+    EXPECT_TRUE(allocator.CheckValid());
+
+    for (int i = 1; i < 8; i += 2) {
+        allocator.FreeBlock(blocks[i]);
+    }
+
+    ysDynamicAllocator::Statistics merged;
+    allocator.GetStatistics(&merged);
+    EXPECT_EQ(merged.FreeBlocks, 1);
+    EXPECT_EQ(merged.UsedSize, 0);
+    EXPECT_EQ(merged.LargestFreeBlock, initial.LargestFreeBlock);
+    EXPECT_GE(merged.PeakUsedSize, 8 * 1000);
+    EXPECT_TRUE(allocator.CheckValid());
+
+    allocator.Destroy();
+}
+
+TEST(DynamicAllocatorTest, ExhaustAndReuse) {
+    ysDynamicAllocator allocator;
+    allocator.CreateBuffer(16 * KB);
+
+    std::vector<void *> blocks;
+    while (void *block = allocator.AllocateBlock(100)) {
+        blocks.push_back(block);
+    }
+
+    EXPECT_GT(blocks.size(), 100u);
+    EXPECT_EQ(allocator.AllocateBlock(100), nullptr);
+    EXPECT_EQ(allocator.AllocateBlock(32 * KB), nullptr);
+
+    allocator.FreeBlock(blocks[10]);
+    EXPECT_EQ(allocator.AllocateBlock(100), blocks[10]);
+
+    allocator.Destroy();
+}
+
+TEST(DynamicAllocatorTest, RandomChurn) {
+    ysDynamicAllocator allocator;
+    allocator.CreateBuffer(1 * MB);
+
+    std::mt19937 rng(1234);
+    std::vector<std::pair<unsigned char *, int>> live;
+
+    for (int i = 0; i < 20000; ++i) {
+        if (!live.empty() && (rng() % 2 == 0 || live.size() > 500)) {
+            const int index = rng() % live.size();
+
+            // Check that no other block overwrote this one
+            for (int j = 0; j < live[index].second; ++j) {
+                ASSERT_EQ(live[index].first[j], (unsigned char)live[index].second);
+            }
+
+            allocator.FreeBlock(live[index].first);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        else {
+            const int size = 1 + rng() % 4000;
+            unsigned char *block = (unsigned char *)allocator.AllocateBlock(size);
+            if (block == nullptr) continue;
+
+            memset(block, (unsigned char)size, size);
+            live.push_back({ block, size });
+        }
+
+        if (i % 1000 == 0) ASSERT_TRUE(allocator.CheckValid()) << "Iteration " << i;
+    }
+
+    for (auto &block : live) allocator.FreeBlock(block.first);
+
+    ysDynamicAllocator::Statistics stats;
+    allocator.GetStatistics(&stats);
+    EXPECT_EQ(stats.FreeBlocks, 1);
+    EXPECT_EQ(stats.UsedBlocks, 0);
+    EXPECT_TRUE(allocator.CheckValid());
+
+    allocator.Destroy();
+}
+
+TEST(DynamicAllocatorTest, Composite) {
+    ysCompositeAllocator allocator;
+    allocator.Initialize(4, 16 * KB, 64);
+
+    // Larger than a single subdivision used to allow
+    void *block = allocator.AllocateBlock(40 * KB);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(allocator.CheckMemoryAddress(block), 0);
+
+    int *values = allocator.Allocate<int>(10);
+    ASSERT_NE(values, nullptr);
+    allocator.Free(values);
+    EXPECT_EQ(values, nullptr);
+
+    allocator.FreeBlock(block);
+    EXPECT_TRUE(allocator.CheckValid());
+
+    allocator.Destroy();
+}
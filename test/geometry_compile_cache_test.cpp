@@ -0,0 +1,139 @@
+#include <pch.h>
+
+#include "../include/yds_geometry_compile_cache.h"
+#include "../include/yds_mapped_file.h"
+
+#include <string.h>
+
+namespace {
+
+    typedef ysGeometryCompileCache::Key Key;
+    typedef ysGeometryExportFile::CompiledObject CompiledObject;
+
+    ysInterchangeObject MakeMesh(const char *name, int vertexCount) {
+        ysInterchangeObject object;
+        object.Name = name;
+        object.MaterialName = "";
+        object.Type = ysInterchangeObject::ObjectType::Geometry;
+        object.ModelIndex = -1;
+        object.ParentIndex = -1;
+        object.InstanceIndex = -1;
+        object.Length = object.Width = 0.0f;
+        object.Orientation = ysVector4(1.0f, 0.0f, 0.0f, 0.0f);
+        object.Scale = ysVector3(1.0f, 1.0f, 1.0f);
+        memset(&object.LightInformation, 0, sizeof(ysInterchangeObject::Light));
+
+        for (int i = 0; i < vertexCount; ++i) {
+            object.Vertices.push_back(ysVector3((float)i, 0.0f, 0.0f));
+        }
+
+        for (int i = 0; i + 2 < vertexCount; ++i) {
+            ysInterchangeObject::IndexSet face;
+            face.x = i; face.y = i + 1; face.z = i + 2;
+            object.VertexIndices.push_back(face);
+        }
+
+        return object;
+    }
+
+    Key HashMesh(const ysInterchangeObject &object) {
+        ysGeometryCompileCache::Hasher hasher;
+        ysGeometryCompileCache::HashObject(object, &hasher);
+        return hasher.GetKey();
+    }
+
+    std::vector<char> ReadFile(const wchar_t *path) {
+        ysMappedFile file;
+        if (file.Open(path) != ysError::None) return std::vector<char>();
+
+        return std::vector<char>(file.GetData(), file.GetData() + file.GetSize());
+    }
+
+} /* namespace */
+
+TEST(GeometryCompileCacheTest, KeyTracksContent) {
+    ysInterchangeObject a = MakeMesh("Mesh", 5);
+    ysInterchangeObject b = MakeMesh("Mesh", 5);
+
+    EXPECT_EQ(HashMesh(a), HashMesh(b));
+
+    b.Vertices[3].y = 1.0f;
+    EXPECT_NE(HashMesh(a), HashMesh(b));
+
+    ysInterchangeObject c = MakeMesh("Mesh_", 5);
+    EXPECT_NE(HashMesh(a), HashMesh(c));
+}
+
+TEST(GeometryCompileCacheTest, SaveAndLoad) {
+    ysGeometryExportFile exportFile;
+
+    ysInterchangeObject mesh = MakeMesh("Mesh", 6);
+    CompiledObject compiled;
+    ASSERT_EQ(exportFile.CompileObject(&mesh, nullptr, &compiled), ysError::None);
+
+    ysGeometryCompileCache cache;
+    cache.Store(HashMesh(mesh), compiled);
+    cache.Store(1234, compiled);
+    ASSERT_EQ(cache.Save(L"geometry_compile_cache_test.yscc"), ysError::None);
+
+    ysGeometryCompileCache loaded;
+    ASSERT_EQ(loaded.Load(L"geometry_compile_cache_test.yscc"), ysError::None);
+    EXPECT_EQ(loaded.GetEntryCount(), 2);
+
+    CompiledObject cached;
+    ASSERT_TRUE(loaded.Find(HashMesh(mesh), &cached));
+    EXPECT_FALSE(loaded.Find(5678, &cached));
+    EXPECT_EQ(loaded.GetHitCount(), 1);
+    EXPECT_EQ(loaded.GetMissCount(), 1);
+
+    ASSERT_TRUE(loaded.Find(HashMesh(mesh), &cached));
+    EXPECT_STREQ(cached.Header.ObjectName, "Mesh");
+    EXPECT_EQ(cached.VertexData, compiled.VertexData);
+    EXPECT_EQ(cached.Indices, compiled.Indices);
+
+    // Entries that were not used are dropped
+    ASSERT_EQ(loaded.Save(L"geometry_compile_cache_test.yscc"), ysError::None);
+    ysGeometryCompileCache pruned;
+    ASSERT_EQ(pruned.Load(L"geometry_compile_cache_test.yscc"), ysError::None);
+    EXPECT_EQ(pruned.GetEntryCount(), 1);
+
+    remove("geometry_compile_cache_test.yscc");
+}
+
+TEST(GeometryCompileCacheTest, MissingFile) {
+    ysGeometryCompileCache cache;
+    EXPECT_EQ(cache.Load(L"geometry_compile_cache_test_missing.yscc"), ysError::None);
+    EXPECT_EQ(cache.GetEntryCount(), 0);
+}
+
+TEST(GeometryCompileCacheTest, CachedObjectsWriteSameScene) {
+    std::vector<ysInterchangeObject> objects;
+    objects.push_back(MakeMesh("Mesh_A", 5));
+    objects.push_back(MakeMesh("Mesh_B", 9));
+
+    ysGeometryExportFile direct;
+    ASSERT_EQ(direct.Open(L"geometry_compile_cache_test_a.ysce"), ysError::None);
+    for (ysInterchangeObject &object : objects) {
+        ASSERT_EQ(direct.AddSceneObject(&object), ysError::None);
+    }
+    ASSERT_EQ(direct.WriteScene(), ysError::None);
+    direct.Close();
+
+    ysGeometryExportFile fromCache;
+    ASSERT_EQ(fromCache.Open(L"geometry_compile_cache_test_b.ysce"), ysError::None);
+    for (ysInterchangeObject &object : objects) {
+        CompiledObject compiled;
+        ASSERT_EQ(fromCache.CompileObject(&object, nullptr, &compiled), ysError::None);
+        ASSERT_EQ(fromCache.AddSceneObject(compiled), ysError::None);
+    }
+    ASSERT_EQ(fromCache.WriteScene(), ysError::None);
+    fromCache.Close();
+
+    const std::vector<char> a = ReadFile(L"geometry_compile_cache_test_a.ysce");
+    const std::vector<char> b = ReadFile(L"geometry_compile_cache_test_b.ysce");
+    EXPECT_FALSE(a.empty());
+    EXPECT_EQ(a, b);
+
+    remove("geometry_compile_cache_test_a.ysce");
+    remove("geometry_compile_cache_test_b.ysce");
+}
@@ -0,0 +1,141 @@
+#include <pch.h>
+
+#include "../include/yds_geometry_preprocessing.h"
+
+namespace {
+
+    // Square grid of cells, two triangles per cell
+    void MakeGrid(ysObjectData *object, int size) {
+        const int rowLength = size + 1;
+
+        object->m_objectInformation.ObjectType = ysObjectData::ObjectType::Geometry;
+        object->m_objectStatistics.NumVertices = rowLength * rowLength;
+        object->m_objectStatistics.NumFaces = size * size * 2;
+
+        object->m_vertices.Allocate(object->m_objectStatistics.NumVertices);
+        for (int y = 0; y < rowLength; ++y) {
+            for (int x = 0; x < rowLength; ++x) {
+                object->m_vertices[y * rowLength + x] = ysVector3((float)x, (float)y, 0.0f);
+            }
+        }
+
+        object->m_vertexIndexSet.Allocate(object->m_objectStatistics.NumFaces);
+        object->m_smoothingGroups.Allocate(object->m_objectStatistics.NumFaces);
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                const int v = y * rowLength + x;
+                const int face = (y * size + x) * 2;
+
+                ysObjectData::IndexSet &a = object->m_vertexIndexSet[face];
+                a.x = v; a.y = v + 1; a.z = v + rowLength;
+
+                ysObjectData::IndexSet &b = object->m_vertexIndexSet[face + 1];
+                b.x = v + 1; b.y = v + rowLength + 1; b.z = v + rowLength;
+
+                object->m_smoothingGroups[face] = 1;
+                object->m_smoothingGroups[face + 1] = 1;
+            }
+        }
+
+        object->m_hardNormalCache = nullptr;
+    }
+
+    // Single UV coordinate per vertex
+    void MakeSharedUVs(ysObjectData *object) {
+        object->m_UVIndexSets.Allocate(1);
+        object->m_UVIndexSets[0].UVIndexSets.Allocate(object->m_objectStatistics.NumFaces);
+        for (int face = 0; face < object->m_objectStatistics.NumFaces; ++face) {
+            object->m_UVIndexSets[0].UVIndexSets[face] = object->m_vertexIndexSet[face];
+        }
+    }
+
+} /* namespace */
+
+TEST(GeometryPreprocessingTest, SingleSmoothingGroup) {
+    ysObjectData object;
+    MakeGrid(&object, 4);
+
+    ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(&object);
+    ysGeometryPreprocessing::SeparateBySmoothingGroups(&object);
+
+    EXPECT_EQ(object.m_objectStatistics.NumVertices, 25);
+}
+
+TEST(GeometryPreprocessingTest, SeparateSmoothingGroups) {
+    ysObjectData object;
+    MakeGrid(&object, 1);
+
+    // Two triangles that share an edge
+    object.m_smoothingGroups[1] = 2;
+
+    ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(&object);
+    ysGeometryPreprocessing::SeparateBySmoothingGroups(&object);
+
+    EXPECT_EQ(object.m_objectStatistics.NumVertices, 6);
+}
+
+TEST(GeometryPreprocessingTest, TransitiveSmoothingGroups) {
+    ysObjectData object;
+    MakeGrid(&object, 2);
+
+    // Around the center vertex the first face is in group 1, the second
+    // in group 2 and the third in both, which links all of them
+    const int groups[] = { 1 | 2, 1, 2, 1 | 2, 2, 2, 2, 2 };
+    for (int face = 0; face < object.m_objectStatistics.NumFaces; ++face) {
+        object.m_smoothingGroups[face] = groups[face];
+    }
+
+    ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(&object);
+    ysGeometryPreprocessing::SeparateBySmoothingGroups(&object);
+
+    EXPECT_EQ(object.m_objectStatistics.NumVertices, 9);
+}
+
+TEST(GeometryPreprocessingTest, ResolveAmbiguity) {
+    ysObjectData object;
+    MakeGrid(&object, 1);
+
+    object.m_smoothingGroups[0] = 1;
+    object.m_smoothingGroups[1] = 0;
+
+    ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(&object);
+
+    EXPECT_EQ(object.m_smoothingGroups[1], 2);
+}
+
+TEST(GeometryPreprocessingTest, SeparateByUVGroups) {
+    ysObjectData object;
+    MakeGrid(&object, 1);
+    MakeSharedUVs(&object);
+
+    ysGeometryPreprocessing::SeparateByUVGroups(&object, 0);
+    EXPECT_EQ(object.m_objectStatistics.NumVertices, 4);
+
+    // A seam along the shared edge
+    object.m_UVIndexSets[0].UVIndexSets[1].x = 4;
+    object.m_UVIndexSets[0].UVIndexSets[1].z = 5;
+
+    ysGeometryPreprocessing::SeparateByUVGroups(&object, 0);
+    EXPECT_EQ(object.m_objectStatistics.NumVertices, 6);
+}
+
+TEST(GeometryPreprocessingTest, LargeMesh) {
+    ysObjectData object;
+    MakeGrid(&object, 320);
+
+    // Checkerboard of smoothing groups so that every vertex is split
+    for (int face = 0; face < object.m_objectStatistics.NumFaces; ++face) {
+        object.m_smoothingGroups[face] = ((face / 2) % 2 == 0) ? 0 : 1;
+    }
+
+    ysGeometryPreprocessing::ResolveSmoothingGroupAmbiguity(&object);
+    ysGeometryPreprocessing::CreateAutomaticSmoothingGroups(&object);
+    ysGeometryPreprocessing::SeparateBySmoothingGroups(&object);
+    ysGeometryPreprocessing::CalculateNormals(&object);
+
+    EXPECT_GT(object.m_objectStatistics.NumVertices, 321 * 321);
+    EXPECT_EQ(object.m_normals.GetNumObjects(), object.m_objectStatistics.NumVertices);
+
+    const ysVector3 normal = object.m_normals[0];
+    EXPECT_NEAR(normal.z, 1.0f, 1e-5f);
+}
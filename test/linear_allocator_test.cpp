@@ -0,0 +1,62 @@
+#include <pch.h>
+
+#include "../include/yds_linear_allocator.h"
+
+#include <stdint.h>
+
+TEST(LinearAllocatorTest, BumpAndReset) {
+    ysLinearAllocator allocator;
+    allocator.CreateBuffer(1 * KB);
+
+    char *a = (char *)allocator.AllocateBlock(10);
+    char *b = (char *)allocator.AllocateBlock(100);
+    char *c = (char *)allocator.AllocateBlock(1);
+
+    EXPECT_EQ((uintptr_t)a % ysLinearAllocator::Alignment, 0);
+    EXPECT_EQ(b, a + 16);
+    EXPECT_EQ(c, b + 112);
+    EXPECT_EQ(allocator.GetUsed(), 144);
+
+    allocator.Reset();
+    EXPECT_EQ(allocator.GetUsed(), 0);
+    EXPECT_EQ(allocator.GetHighWaterMark(), 144);
+    EXPECT_EQ(allocator.AllocateBlock(10), a);
+
+    allocator.Destroy();
+}
+
+TEST(LinearAllocatorTest, Overflow) {
+    ysLinearAllocator allocator;
+    allocator.CreateBuffer(256);
+
+    // Far more than fits, every block must stay usable until the reset
+    char *blocks[100];
+    for (int i = 0; i < 100; ++i) {
+        blocks[i] = (char *)allocator.AllocateBlock(48);
+        ASSERT_NE(blocks[i], nullptr);
+        EXPECT_EQ((uintptr_t)blocks[i] % ysLinearAllocator::Alignment, 0);
+        memset(blocks[i], i, 48);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        for (int j = 0; j < 48; ++j) ASSERT_EQ(blocks[i][j], (char)i);
+    }
+
+    char *large = (char *)allocator.AllocateBlock(10 * KB);
+    ASSERT_NE(large, nullptr);
+    memset(large, 0, 10 * KB);
+
+    EXPECT_GT(allocator.GetOverflowCount(), 0);
+    EXPECT_EQ(allocator.GetHighWaterMark(), 100 * 48 + 10 * KB);
+
+    // The buffer grows to the high-water mark, so the same frame fits
+    allocator.Reset();
+    EXPECT_GE(allocator.GetCapacity(), 100 * 48 + 10 * KB);
+
+    const int overflows = allocator.GetOverflowCount();
+    for (int i = 0; i < 100; ++i) allocator.AllocateBlock(48);
+    allocator.AllocateBlock(10 * KB);
+    EXPECT_EQ(allocator.GetOverflowCount(), overflows);
+
+    allocator.Destroy();
+}
@@ -0,0 +1,140 @@
+#include <pch.h>
+
+#include "../engines/basic/include/name_index.h"
+
+#include "../engines/basic/include/asset_manager.h"
+#include "../engines/basic/include/material.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+    typedef dbasic::NameIndex NameIndex;
+
+    // Copy that can be bound to a reference by the test macros
+    const int InvalidIndex = NameIndex::InvalidIndex;
+
+    class TestNameIndex : public NameIndex {
+    public:
+        int GetCapacity() const { return (int)m_entries.size(); }
+    };
+
+    // Lookup the asset manager did before it had an index
+    int LinearFind(const std::vector<std::string> &names, const std::string &name) {
+        for (int i = 0; i < (int)names.size(); ++i) {
+            if (names[i] == name) return i;
+        }
+
+        return InvalidIndex;
+    }
+
+    int Find(const NameIndex &index, const std::vector<std::string> &names, const std::string &name) {
+        return index.Find(name.c_str(), [&](int i) { return names[i] == name; });
+    }
+
+} /* namespace */
+
+TEST(NameIndexTest, MissingName) {
+    TestNameIndex index;
+    std::vector<std::string> names;
+
+    EXPECT_EQ(Find(index, names, "Missing"), InvalidIndex);
+
+    names = { "A", "B", "C" };
+    for (int i = 0; i < (int)names.size(); ++i) index.Add(names[i].c_str(), i);
+
+    EXPECT_EQ(Find(index, names, "Missing"), InvalidIndex);
+    EXPECT_EQ(Find(index, names, ""), InvalidIndex);
+
+    // Matching hash but rejected by the caller
+    EXPECT_EQ(index.Find("B", [](int) { return false; }), InvalidIndex);
+}
+
+TEST(NameIndexTest, DuplicateNames) {
+    TestNameIndex index;
+    const std::vector<std::string> names = { "Cube", "Light", "Cube", "Camera", "Light", "Cube" };
+    for (int i = 0; i < (int)names.size(); ++i) index.Add(names[i].c_str(), i);
+
+    // The first entry wins, same as searching the array front to back
+    for (const std::string &name : names) {
+        EXPECT_EQ(Find(index, names, name), LinearFind(names, name)) << name;
+    }
+
+    EXPECT_EQ(Find(index, names, "Cube"), 0);
+    EXPECT_EQ(Find(index, names, "Light"), 1);
+
+    // Later duplicates are reached if the caller rejects the earlier ones
+    EXPECT_EQ(index.Find("Cube", [](int i) { return i > 2; }), 5);
+}
+
+TEST(NameIndexTest, GrowPastLoadFactor) {
+    TestNameIndex index;
+    std::vector<std::string> names;
+
+    // Every name is added three times so that duplicates have to keep
+    // their order through each rehash
+    int capacity = 0;
+    int grows = 0;
+    for (int i = 0; i < 3000; ++i) {
+        names.push_back("Object" + std::to_string(i % 1000));
+        index.Add(names.back().c_str(), i);
+
+        // The table is never more than half full
+        EXPECT_LE(index.GetCount() * 2, index.GetCapacity());
+
+        if (index.GetCapacity() != capacity) {
+            capacity = index.GetCapacity();
+            ++grows;
+        }
+    }
+
+    EXPECT_EQ(index.GetCount(), 3000);
+    EXPECT_GT(grows, 1);
+
+    for (int i = 0; i < 1000; ++i) {
+        const std::string name = "Object" + std::to_string(i);
+        EXPECT_EQ(Find(index, names, name), LinearFind(names, name)) << name;
+        EXPECT_EQ(Find(index, names, name), i);
+    }
+
+    EXPECT_EQ(Find(index, names, "Object1000"), InvalidIndex);
+
+    index.Clear();
+    EXPECT_EQ(index.GetCount(), 0);
+    EXPECT_EQ(Find(index, names, "Object0"), InvalidIndex);
+}
+
+TEST(NameIndexTest, AssetManagerReindexing) {
+    dbasic::AssetManager manager;
+
+    dbasic::Material *a = manager.NewMaterial();
+    a->SetName("A");
+    dbasic::Material *b = manager.NewMaterial();
+    b->SetName("B");
+
+    EXPECT_EQ(manager.FindMaterial("A"), a);
+    EXPECT_EQ(manager.FindMaterial("B"), b);
+    EXPECT_EQ(manager.FindMaterial("C"), nullptr);
+
+    // Assets added after a lookup are indexed by the next one
+    dbasic::Material *c = manager.NewMaterial();
+    c->SetName("C");
+    dbasic::Material *duplicate = manager.NewMaterial();
+    duplicate->SetName("A");
+
+    EXPECT_EQ(manager.FindMaterial("C"), c);
+    EXPECT_EQ(manager.FindMaterial("A"), a);
+
+    // A renamed asset is never returned under its old name, but can only
+    // be found under its new one after the indices are rebuilt
+    a->SetName("Renamed");
+    EXPECT_EQ(manager.FindMaterial("A"), duplicate);
+    EXPECT_EQ(manager.FindMaterial("Renamed"), nullptr);
+
+    manager.RebuildNameIndices();
+    EXPECT_EQ(manager.FindMaterial("Renamed"), a);
+    EXPECT_EQ(manager.FindMaterial("A"), duplicate);
+    EXPECT_EQ(manager.FindMaterial("B"), b);
+    EXPECT_EQ(manager.GetMaterialCount(), 4);
+}
@@ -0,0 +1,142 @@
+#include <pch.h>
+
+#include "../include/yds_profiler.h"
+#include "../include/yds_breakdown_timer.h"
+#include "../include/yds_breakdown_timer_channel.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+TEST(ProfilerTest, ZoneInterning) {
+    const int a = ysProfiler::Get()->RegisterZone("ProfilerTest::A");
+    const int b = ysProfiler::Get()->RegisterZone("ProfilerTest::B");
+
+    EXPECT_NE(a, b);
+    EXPECT_EQ(ysProfiler::Get()->RegisterZone("ProfilerTest::A"), a);
+    EXPECT_EQ(ysProfiler::Get()->GetZoneName(b), "ProfilerTest::B");
+}
+
+TEST(ProfilerTest, NestedZones) {
+    ysProfiler::Get()->Clear();
+
+    {
+        YS_PROFILE_ZONE("ProfilerTest::Outer");
+        {
+            YS_PROFILE_ZONE("ProfilerTest::Inner");
+        }
+    }
+
+    std::vector<ysProfiler::Event> events;
+    ysProfiler::Get()->GetThreadEvents(&events);
+    ASSERT_EQ(events.size(), 4);
+
+    EXPECT_EQ(events[0].Type, ysProfiler::EventType::Begin);
+    EXPECT_EQ(events[1].Type, ysProfiler::EventType::Begin);
+    EXPECT_EQ(events[2].Type, ysProfiler::EventType::End);
+    EXPECT_EQ(events[3].Type, ysProfiler::EventType::End);
+
+    EXPECT_EQ(events[0].Zone, events[3].Zone);
+    EXPECT_EQ(events[1].Zone, events[2].Zone);
+    EXPECT_EQ(ysProfiler::Get()->GetZoneName(events[1].Zone), "ProfilerTest::Inner");
+
+    for (int i = 1; i < 4; ++i) {
+        EXPECT_LE(events[i - 1].Timestamp, events[i].Timestamp);
+    }
+}
+
+TEST(ProfilerTest, ChromeTraceExport) {
+    ysProfiler::Get()->Clear();
+
+    std::thread worker([] {
+        ysProfiler::Get()->SetThreadName("ProfilerTest Worker");
+        for (int i = 0; i < 100; ++i) {
+            YS_PROFILE_ZONE("ProfilerTest::WorkerZone");
+        }
+    });
+
+    {
+        YS_PROFILE_ZONE("ProfilerTest::MainZone");
+        worker.join();
+    }
+
+    ASSERT_TRUE(ysProfiler::Get()->WriteChromeTrace("profiler_test_trace.json"));
+
+    std::ifstream file("profiler_test_trace.json");
+    std::stringstream contents;
+    contents << file.rdbuf();
+    const std::string trace = contents.str();
+
+    EXPECT_EQ(trace.find("{\"traceEvents\":["), 0);
+    EXPECT_EQ(trace.find("\"ts\":-"), std::string::npos);
+    EXPECT_EQ(trace.find("e+"), std::string::npos);
+    EXPECT_EQ(trace.find("e-"), std::string::npos);
+    EXPECT_NE(trace.find("\"ProfilerTest Worker\""), std::string::npos);
+    EXPECT_NE(trace.find("\"ProfilerTest::MainZone\""), std::string::npos);
+
+    int workerZones = 0;
+    for (size_t p = trace.find("ProfilerTest::WorkerZone"); p != std::string::npos;
+        p = trace.find("ProfilerTest::WorkerZone", p + 1))
+    {
+        ++workerZones;
+    }
+
+    EXPECT_EQ(workerZones, 100);
+
+    // Timestamps keep nanosecond resolution
+    const size_t ts = trace.find("\"ts\":");
+    ASSERT_NE(ts, std::string::npos);
+
+    const size_t end = trace.find(',', ts);
+    const size_t point = trace.find('.', ts);
+    ASSERT_LT(point, end);
+    EXPECT_EQ(end - point, 4);
+}
+
+TEST(ProfilerTest, BreakdownTimerMeasurement) {
+    ysBreakdownTimer timer;
+    ysBreakdownTimerChannel *channel = timer.CreateChannel("ProfilerTest::Channel");
+
+    EXPECT_EQ(timer.FindChannel("ProfilerTest::Channel"), channel);
+    EXPECT_EQ(timer.FindChannel("ProfilerTest::Missing"), nullptr);
+
+    timer.StartFrame();
+    timer.StartMeasurement("ProfilerTest::Channel");
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    timer.EndMeasurement("ProfilerTest::Channel");
+    timer.EndFrame();
+
+    EXPECT_EQ(channel->GetEntryCount(), 1);
+    EXPECT_GE(channel->GetLastSample(), 0.002);
+    EXPECT_LT(channel->GetLastSample(), 1.0);
+}
+
+TEST(ProfilerTest, BreakdownTimerThreads) {
+    const int threadCount = 8;
+
+    ysBreakdownTimer timer;
+    std::vector<ysBreakdownTimerChannel *> channels;
+    for (int i = 0; i < threadCount; ++i) {
+        channels.push_back(timer.CreateChannel("ProfilerTest::Thread" + std::to_string(i)));
+    }
+
+    for (int frame = 0; frame < 20; ++frame) {
+        timer.StartFrame();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([&timer, &channels, i] {
+                timer.StartMeasurement(channels[i]);
+                timer.EndMeasurement(channels[i]);
+            });
+        }
+
+        for (std::thread &thread : threads) thread.join();
+
+        timer.EndFrame();
+    }
+
+    for (ysBreakdownTimerChannel *channel : channels) {
+        EXPECT_EQ(channel->GetEntryCount(), 20);
+    }
+}
@@ -0,0 +1,130 @@
+#include <pch.h>
+
+#include "../include/yds_geometry_export_file.h"
+#include "../include/yds_mapped_file.h"
+
+#include <stdint.h>
+
+namespace {
+
+    typedef ysGeometryExportFile::SceneFileHeader SceneFileHeader;
+    typedef ysGeometryExportFile::SceneObjectEntry SceneObjectEntry;
+
+    ysInterchangeObject MakeObject(ysInterchangeObject::ObjectType type, const char *name) {
+        ysInterchangeObject object;
+        object.Name = name;
+        object.MaterialName = "";
+        object.Type = type;
+        object.ModelIndex = -1;
+        object.ParentIndex = -1;
+        object.InstanceIndex = -1;
+        object.Length = object.Width = 0.0f;
+        object.Position = ysVector3(1.0f, 2.0f, 3.0f);
+        object.OrientationEuler = ysVector3(0.0f, 0.0f, 0.0f);
+        object.Orientation = ysVector4(1.0f, 0.0f, 0.0f, 0.0f);
+        object.Scale = ysVector3(1.0f, 1.0f, 1.0f);
+        memset(&object.LightInformation, 0, sizeof(ysInterchangeObject::Light));
+
+        return object;
+    }
+
+    // Strip of triangles over the given number of vertices
+    ysInterchangeObject MakeMesh(const char *name, int vertexCount) {
+        ysInterchangeObject object = MakeObject(ysInterchangeObject::ObjectType::Geometry, name);
+        for (int i = 0; i < vertexCount; ++i) {
+            object.Vertices.push_back(ysVector3((float)i, 0.0f, 0.0f));
+        }
+
+        for (int i = 0; i + 2 < vertexCount; ++i) {
+            ysInterchangeObject::IndexSet face;
+            face.x = i; face.y = i + 1; face.z = i + 2;
+            object.VertexIndices.push_back(face);
+        }
+
+        return object;
+    }
+
+    bool WriteScene(const wchar_t *path, std::vector<ysInterchangeObject> &objects) {
+        ysGeometryExportFile file;
+        if (file.Open(path) != ysError::None) return false;
+
+        for (ysInterchangeObject &object : objects) {
+            if (file.AddSceneObject(&object) != ysError::None) return false;
+        }
+
+        const bool result = file.WriteScene() == ysError::None;
+        file.Close();
+
+        return result;
+    }
+
+} /* namespace */
+
+TEST(SceneFileTest, Layout) {
+    std::vector<ysInterchangeObject> objects;
+    objects.push_back(MakeMesh("Mesh_A", 5));
+    objects.push_back(MakeObject(ysInterchangeObject::ObjectType::Light, "Light"));
+    objects.push_back(MakeMesh("Mesh_B", 7));
+
+    objects[1].LightInformation.Intensity = 4.0f;
+
+    ASSERT_TRUE(WriteScene(L"scene_file_test_layout.ysce", objects));
+
+    ysMappedFile file;
+    ASSERT_EQ(file.Open(L"scene_file_test_layout.ysce"), ysError::None);
+
+    const SceneFileHeader *header = (const SceneFileHeader *)file.GetData();
+    EXPECT_EQ(header->Magic, (uint32_t)ysGeometryExportFile::SceneFileMagic);
+    EXPECT_EQ(header->Version, (int)ysGeometryExportFile::SceneFileVersion);
+    EXPECT_EQ(header->ObjectCount, 3);
+    EXPECT_EQ(header->IndexSize, 2);
+
+    EXPECT_EQ(header->VertexDataOffset % ysGeometryExportFile::SectionAlignment, 0);
+    EXPECT_EQ(header->IndexDataOffset % ysGeometryExportFile::SectionAlignment, 0);
+    EXPECT_LE(header->IndexDataOffset + header->IndexDataSize, file.GetSize());
+
+    const SceneObjectEntry *table = (const SceneObjectEntry *)(file.GetData() + header->ObjectTableOffset);
+    EXPECT_STREQ(table[0].Header.ObjectName, "Mesh_A");
+    EXPECT_STREQ(table[2].Header.ObjectName, "Mesh_B");
+
+    // Mesh vertices start on a multiple of their vertex size
+    const int stride = table[2].Header.VertexDataSize / table[2].Header.NumVertices;
+    EXPECT_EQ(table[2].VertexOffset % stride, 0);
+    EXPECT_EQ(table[2].IndexOffset, 3 * 3);
+    EXPECT_EQ(header->IndexDataSize, (3 + 5) * 3 * sizeof(unsigned short));
+
+    const unsigned short *indices = (const unsigned short *)(file.GetData() + header->IndexDataOffset);
+    EXPECT_EQ(indices[table[2].IndexOffset + 3], 1);
+
+    ASSERT_EQ(table[1].ExtraDataSize, (int)sizeof(ysInterchangeObject::Light));
+    const ysInterchangeObject::Light *light =
+        (const ysInterchangeObject::Light *)(file.GetData() + header->ExtraDataOffset + table[1].ExtraDataOffset);
+    EXPECT_EQ(light->Intensity, 4.0f);
+
+    file.Close();
+    remove("scene_file_test_layout.ysce");
+}
+
+TEST(SceneFileTest, WideIndices) {
+    std::vector<ysInterchangeObject> objects;
+    objects.push_back(MakeMesh("Small", 3));
+    objects.push_back(MakeMesh("Large", 70000));
+
+    ASSERT_TRUE(WriteScene(L"scene_file_test_wide.ysce", objects));
+
+    ysMappedFile file;
+    ASSERT_EQ(file.Open(L"scene_file_test_wide.ysce"), ysError::None);
+
+    const SceneFileHeader *header = (const SceneFileHeader *)file.GetData();
+    EXPECT_EQ(header->IndexSize, 4);
+    EXPECT_EQ(header->IndexDataSize, (1 + 69998) * 3 * sizeof(uint32_t));
+
+    const SceneObjectEntry *table = (const SceneObjectEntry *)(file.GetData() + header->ObjectTableOffset);
+    const uint32_t *indices = (const uint32_t *)(file.GetData() + header->IndexDataOffset);
+
+    const uint32_t *last = indices + table[1].IndexOffset + 69997 * 3;
+    EXPECT_EQ(last[2], 69999u);
+
+    file.Close();
+    remove("scene_file_test_wide.ysce");
+}
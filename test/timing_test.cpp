@@ -0,0 +1,79 @@
+#include <pch.h>
+
+#include "../include/yds_timing.h"
+
+TEST(TimingTest, FramePercentiles) {
+    ysTimingSystem timing;
+    timing.SetHistorySize(200);
+
+    // 1 ms to 100 ms three times, so that the history wraps around
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int i = 1; i <= 100; ++i) {
+            timing.RecordFrameDuration(i / 1000.0);
+        }
+    }
+
+    ysTimingSystem::FrameStatistics stats;
+    timing.GetFrameStatistics(&stats);
+
+    EXPECT_EQ(stats.Samples, 200);
+    EXPECT_DOUBLE_EQ(stats.Minimum, 0.001);
+    EXPECT_DOUBLE_EQ(stats.Maximum, 0.100);
+    EXPECT_NEAR(stats.Average, 0.0505, 1E-9);
+    EXPECT_DOUBLE_EQ(stats.P50, 0.050);
+    EXPECT_DOUBLE_EQ(stats.P95, 0.095);
+    EXPECT_DOUBLE_EQ(stats.P99, 0.099);
+    EXPECT_DOUBLE_EQ(timing.GetFrameDurationPercentile(0.5), stats.P50);
+
+    // 198 changes of 1 ms and one drop of 99 ms
+    EXPECT_NEAR(stats.Jitter, (198 * 0.001 + 0.099) / 199, 1E-9);
+}
+
+TEST(TimingTest, JitterHistogram) {
+    ysTimingSystem timing;
+
+    const double frames[] = { 0.016, 0.017, 0.016, 0.030, 0.016 };
+    for (double frame : frames) {
+        timing.RecordFrameDuration(frame);
+    }
+
+    int bins[4];
+    timing.GetJitterHistogram(bins, 4, 0.002);
+
+    EXPECT_EQ(bins[0], 2);
+    EXPECT_EQ(bins[1], 0);
+    EXPECT_EQ(bins[2], 0);
+    EXPECT_EQ(bins[3], 2);
+}
+
+TEST(TimingTest, FixedTimestepAccumulator) {
+    ysTimestepAccumulator accumulator;
+    accumulator.SetStep(0.01);
+    accumulator.SetMaxSteps(5);
+
+    EXPECT_EQ(accumulator.Advance(0.004), 0);
+    EXPECT_EQ(accumulator.Advance(0.004), 0);
+    EXPECT_EQ(accumulator.Advance(0.004), 1);
+    EXPECT_NEAR(accumulator.GetAlpha(), 0.2, 1E-9);
+
+    EXPECT_EQ(accumulator.Advance(0.025), 2);
+    EXPECT_NEAR(accumulator.GetAccumulator(), 0.007, 1E-9);
+
+    // A long stall is capped and the rest is dropped instead of carried over
+    EXPECT_EQ(accumulator.Advance(1.0), 5);
+    EXPECT_NEAR(accumulator.GetDroppedTime(), 0.95, 1E-9);
+    EXPECT_LT(accumulator.GetAccumulator(), 0.01);
+}
+
+TEST(TimingTest, MonotonicClock) {
+    ysTimingSystem timing;
+
+    const uint64_t t0 = timing.GetTime();
+    timing.Update();
+    timing.Update();
+    const uint64_t t1 = timing.GetTime();
+
+    EXPECT_GE(t1, t0);
+    EXPECT_LE(timing.GetFrameDuration_us(), t1 - t0);
+    EXPECT_EQ(timing.GetHistorySamples(), 1);
+}